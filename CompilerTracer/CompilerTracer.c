@@ -0,0 +1,565 @@
+/*
+Tracer runtime for targets which are instrumented at compile time, as a faster alternative to the Pin tool.
+
+The runtime produces the same raw trace files as the Pin tool (prefix.trace, prefix_data.txt, t<ID>.trace), so they can be
+processed by the existing Pin trace preprocessor. It implements the hooks emitted by the following compiler options:
+    -finstrument-functions
+        Calls and returns (__cyg_profile_func_enter/exit).
+    -fsanitize-coverage=trace-pc
+        Control flow between basic blocks (__sanitizer_cov_trace_pc).
+    -fsanitize=kernel-address --param asan-instrumentation-with-call-threshold=0 --param asan-stack=0 --param asan-globals=0   [GCC]
+    -fsanitize-coverage=trace-loads,trace-stores   [Clang]
+        Memory accesses (__asan_{load,store}*_noabort, __sanitizer_cov_{load,store}*).
+Heap allocations are tracked by interposing malloc(), calloc(), realloc() and free().
+
+The Pin notification functions (PinNotifyTestcaseStart() etc.) are provided by this library, so the wrapper must only declare
+them (define MICROWALK_COMPILER_TRACER when compiling the wrapper template).
+
+The runtime is configured through environment variables, which are set by Microwalk's trace module:
+    MICROWALK_TRACE_PREFIX
+        Path prefix of the output files (usually the trace directory, with a trailing slash).
+    MICROWALK_TRACE_IMAGES
+        Names of interesting images, separated by colons. Defaults to the main executable.
+
+Build this file as a shared library without instrumentation, and link it to the instrumented wrapper.
+As with the Pin tool, only the main thread is traced.
+*/
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+
+/* INCLUDES */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* MACROS */
+
+// The size of the entry buffer.
+#define ENTRY_BUFFER_SIZE 16384
+
+// The maximum call depth for which the last basic block is remembered.
+#define MAX_CALL_DEPTH 4096
+
+// The maximum distance between a function's start and the coverage hook call of its entry block.
+#define MAX_ENTRY_BLOCK_OFFSET 256
+
+// Attributes for exported hook functions.
+#define HOOK __attribute__((visibility("default"), no_instrument_function))
+
+// Thread-local storage with a fast access model, which is valid since this library is always loaded at program start.
+#define THREAD_LOCAL __thread __attribute__((tls_model("initial-exec")))
+
+
+/* TYPES */
+
+// The different types of trace entries.
+// This must match TraceEntryTypes in PinTracer/TraceWriter.h.
+enum TraceEntryTypes
+{
+    MemoryRead = 1,
+    MemoryWrite = 2,
+    HeapAllocSizeParameter = 3,
+    HeapAllocAddressReturn = 4,
+    HeapFreeAddressParameter = 5,
+    Branch = 6,
+    StackPointerInfo = 7,
+    StackPointerModification = 8
+};
+
+// Flags for branch entries.
+// This must match TraceEntryFlags in PinTracer/TraceWriter.h.
+enum TraceEntryFlags
+{
+    BranchTaken = 1 << 0,
+    BranchTypeJump = 1 << 1,
+    BranchTypeCall = 2 << 1,
+    BranchTypeReturn = 3 << 1
+};
+
+// Represents one entry in a trace buffer.
+// This must match TraceEntry in PinTracer/TraceWriter.h.
+#pragma pack(push, 1)
+typedef struct
+{
+    uint32_t Type;
+    uint8_t Flag;
+    uint8_t _padding1;
+    uint16_t Param0;
+    uint64_t Param1;
+    uint64_t Param2;
+} TraceEntry;
+#pragma pack(pop)
+_Static_assert(sizeof(TraceEntry) == 4 + 1 + 1 + 2 + 8 + 8, "Wrong size of TraceEntry struct");
+
+
+/* GLOBAL VARIABLES */
+
+// Forward declarations of the glibc allocator, which is used by the interposed allocation functions.
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+// The buffer entries.
+static TraceEntry _entries[ENTRY_BUFFER_SIZE];
+
+// The next free entry in the buffer. This is only non-null in the main thread, and while a testcase or the prefix is recorded.
+static THREAD_LOCAL TraceEntry* _nextEntry = NULL;
+
+// The last observed basic block of each active function, for generating branch entries. Index 0 belongs to the function which started tracing.
+static THREAD_LOCAL uintptr_t _lastBlockAddresses[MAX_CALL_DEPTH];
+static THREAD_LOCAL int _callDepth = 0;
+
+// The buffer position after the last call of the basic block hook, and the basic block it replaced in the chain.
+// Used for detecting whether the basic block hook was called immediately before the function entry hook.
+static THREAD_LOCAL TraceEntry* _lastBlockHookEnd = NULL;
+static THREAD_LOCAL uintptr_t _lastBlockHookPreviousAddress = 0;
+
+// The path prefix of the output files.
+static char _outputFilenamePrefix[PATH_MAX - 32] = "";
+
+// The file where the trace data is currently written to.
+static int _outputFile = -1;
+
+// The name of the currently open output file.
+static char _currentOutputFilename[PATH_MAX];
+
+// The current testcase ID, or -1 while recording the trace prefix.
+static int _testcaseId = -1;
+
+
+/* FUNCTIONS */
+
+// Writes the given data to the given file, and aborts on failure.
+static void WriteAll(int file, const void* data, size_t length)
+{
+    const char* dataBytes = (const char*)data;
+    while(length > 0)
+    {
+        ssize_t written = write(file, dataBytes, length);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            perror("Error writing trace data");
+            _exit(1);
+        }
+        dataBytes += written;
+        length -= (size_t)written;
+    }
+}
+
+// Opens the given output file and makes it the current one.
+static void OpenOutputFile(const char* name)
+{
+    snprintf(_currentOutputFilename, sizeof(_currentOutputFilename), "%s%s", _outputFilenamePrefix, name);
+    _outputFile = open(_currentOutputFilename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(_outputFile < 0)
+    {
+        fprintf(stderr, "Error: Could not open output file '%s': %s\n", _currentOutputFilename, strerror(errno));
+        _exit(1);
+    }
+}
+
+// Writes the contents of the trace buffer into the output file, and resets the buffer.
+static void WriteBufferToFile(void)
+{
+    if(_nextEntry != _entries)
+        WriteAll(_outputFile, _entries, (size_t)(_nextEntry - _entries) * sizeof(TraceEntry));
+    _nextEntry = _entries;
+    _lastBlockHookEnd = NULL;
+}
+
+// Returns a pointer to a new, zero-initialized trace entry.
+static inline __attribute__((always_inline)) TraceEntry* NewEntry(void)
+{
+    // Entry list full? -> write entries to file, restart writing entries at the list begin
+    if(_nextEntry == &_entries[ENTRY_BUFFER_SIZE])
+        WriteBufferToFile();
+
+    TraceEntry* entry = _nextEntry++;
+    *entry = (TraceEntry){ 0 };
+    return entry;
+}
+
+// Checks whether the given image name appears in the list of interesting images.
+static int IsInterestingImage(const char* imageName, const char* interestingImages)
+{
+    char imageNameLower[PATH_MAX];
+    size_t i;
+    for(i = 0; imageName[i] != '\0' && i < sizeof(imageNameLower) - 1; ++i)
+        imageNameLower[i] = (char)tolower((unsigned char)imageName[i]);
+    imageNameLower[i] = '\0';
+
+    // Do a substring search for each list item, like the Pin tool
+    const char* item = interestingImages;
+    while(*item != '\0')
+    {
+        const char* itemEnd = strchr(item, ':');
+        size_t itemLength = itemEnd != NULL ? (size_t)(itemEnd - item) : strlen(item);
+
+        char itemLower[PATH_MAX];
+        if(itemLength > 0 && itemLength < sizeof(itemLower))
+        {
+            for(i = 0; i < itemLength; ++i)
+                itemLower[i] = (char)tolower((unsigned char)item[i]);
+            itemLower[itemLength] = '\0';
+            if(strstr(imageNameLower, itemLower) != NULL)
+                return 1;
+        }
+
+        if(itemEnd == NULL)
+            break;
+        item = itemEnd + 1;
+    }
+
+    return 0;
+}
+
+// Writes information about the given loaded image into the trace metadata file.
+static int WriteImageLoadData(struct dl_phdr_info* info, size_t size, void* data)
+{
+    int prefixDataFile = *(int*)data;
+
+    // Compute image boundaries
+    uint64_t imageStart = UINT64_MAX;
+    uint64_t imageEnd = 0;
+    for(int i = 0; i < info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr)* segment = &info->dlpi_phdr[i];
+        if(segment->p_type != PT_LOAD)
+            continue;
+
+        uint64_t segmentStart = info->dlpi_addr + segment->p_vaddr;
+        uint64_t segmentEnd = segmentStart + segment->p_memsz - 1;
+        if(segmentStart < imageStart)
+            imageStart = segmentStart;
+        if(segmentEnd > imageEnd)
+            imageEnd = segmentEnd;
+    }
+    if(imageStart > imageEnd)
+        return 0;
+
+    // The main executable has an empty name
+    char imageName[PATH_MAX];
+    int isMainExecutable = info->dlpi_name == NULL || info->dlpi_name[0] == '\0';
+    if(isMainExecutable)
+    {
+        ssize_t nameLength = readlink("/proc/self/exe", imageName, sizeof(imageName) - 1);
+        imageName[nameLength < 0 ? 0 : nameLength] = '\0';
+    }
+    else
+    {
+        snprintf(imageName, sizeof(imageName), "%s", info->dlpi_name);
+    }
+
+    const char* interestingImages = getenv("MICROWALK_TRACE_IMAGES");
+    int interesting = interestingImages != NULL ? IsInterestingImage(imageName, interestingImages) : isMainExecutable;
+
+    // Write image data
+    char line[PATH_MAX + 64];
+    int lineLength = snprintf(line, sizeof(line), "i\t%d\t%llx\t%llx\t%s\n", interesting, (unsigned long long)imageStart, (unsigned long long)imageEnd, imageName);
+    WriteAll(prefixDataFile, line, (size_t)lineLength);
+    return 0;
+}
+
+// Initializes the tracer and starts recording the trace prefix.
+__attribute__((constructor, no_instrument_function)) static void InitTracer(void)
+{
+    const char* outputFilenamePrefix = getenv("MICROWALK_TRACE_PREFIX");
+    if(outputFilenamePrefix != NULL)
+        snprintf(_outputFilenamePrefix, sizeof(_outputFilenamePrefix), "%s", outputFilenamePrefix);
+
+    // Record loaded images
+    OpenOutputFile("prefix_data.txt");
+    int prefixDataFile = _outputFile;
+    dl_iterate_phdr(WriteImageLoadData, &prefixDataFile);
+    close(prefixDataFile);
+
+    // Start trace prefix mode in the main thread
+    OpenOutputFile("prefix.trace");
+    _testcaseId = -1;
+    _nextEntry = _entries;
+    fprintf(stderr, "Trace prefix mode started\n");
+}
+
+// Closes the current trace file and notifies the caller that the testcase has completed.
+static void EndTrace(void)
+{
+    WriteBufferToFile();
+    close(_outputFile);
+    _outputFile = -1;
+    _nextEntry = NULL;
+    _callDepth = 0;
+    _lastBlockAddresses[0] = 0;
+    _lastBlockHookEnd = NULL;
+
+    if(_testcaseId == -1)
+    {
+        fprintf(stderr, "Trace prefix mode ended\n");
+        return;
+    }
+
+    // Notify caller that the trace file is complete
+    char line[PATH_MAX + 32];
+    int lineLength = snprintf(line, sizeof(line), "t\t%s\t%d\n", _currentOutputFilename, _testcaseId);
+    WriteAll(STDOUT_FILENO, line, (size_t)lineLength);
+    _testcaseId = -1;
+}
+
+
+/* PIN NOTIFICATION FUNCTIONS */
+
+HOOK int PinNotifyTestcaseStart(int testcaseId)
+{
+    // Exit prefix mode if necessary
+    if(_nextEntry != NULL)
+        EndTrace();
+
+    // Open file for writing
+    char filename[32];
+    snprintf(filename, sizeof(filename), "t%d.trace", testcaseId);
+    OpenOutputFile(filename);
+    _testcaseId = testcaseId;
+    _nextEntry = _entries;
+    return testcaseId + 42;
+}
+
+HOOK int PinNotifyTestcaseEnd(void)
+{
+    if(_nextEntry != NULL)
+        EndTrace();
+    return 42;
+}
+
+HOOK int PinNotifyStackPointer(uint64_t spMin, uint64_t spMax)
+{
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = StackPointerInfo;
+        entry->Param1 = spMin;
+        entry->Param2 = spMax;
+    }
+    return (int)(spMin + spMax + 42);
+}
+
+HOOK int PinNotifyAllocation(uint64_t address, uint64_t size)
+{
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocSizeParameter;
+        entry->Param1 = size;
+
+        entry = NewEntry();
+        entry->Type = HeapAllocAddressReturn;
+        entry->Param2 = address;
+    }
+    return (int)(address + 23 * size);
+}
+
+
+/* CONTROL FLOW HOOKS */
+
+// Records a branch entry.
+static inline __attribute__((always_inline)) void InsertBranchEntry(uintptr_t source, uintptr_t target, uint8_t type)
+{
+    TraceEntry* entry = NewEntry();
+    entry->Type = Branch;
+    entry->Flag = (uint8_t)(type | BranchTaken);
+    entry->Param1 = source;
+    entry->Param2 = target;
+}
+
+HOOK void __cyg_profile_func_enter(void* function, void* callSite)
+{
+    if(_nextEntry == NULL)
+        return;
+
+    // The coverage hook of the callee's entry block runs before this hook, so it was attributed to the caller
+    // Undo that, and start the callee's basic block chain at the entry block instead
+    uintptr_t entryBlockAddress = (uintptr_t)function;
+    if(_lastBlockHookEnd == _nextEntry && _callDepth < MAX_CALL_DEPTH
+       && _lastBlockAddresses[_callDepth] >= (uintptr_t)function && _lastBlockAddresses[_callDepth] - (uintptr_t)function < MAX_ENTRY_BLOCK_OFFSET)
+    {
+        entryBlockAddress = _lastBlockAddresses[_callDepth];
+        _lastBlockAddresses[_callDepth] = _lastBlockHookPreviousAddress;
+        if(_lastBlockHookPreviousAddress != 0)
+            --_nextEntry;
+    }
+    _lastBlockHookEnd = NULL;
+
+    InsertBranchEntry((uintptr_t)callSite, (uintptr_t)function, BranchTypeCall);
+
+    // Start a new basic block chain for the callee
+    ++_callDepth;
+    if(_callDepth < MAX_CALL_DEPTH)
+        _lastBlockAddresses[_callDepth] = entryBlockAddress;
+}
+
+HOOK void __cyg_profile_func_exit(void* function, void* callSite)
+{
+    if(_nextEntry == NULL)
+        return;
+
+    // The exact address of the return instruction is unknown, use the last basic block of the function instead
+    uintptr_t source = (uintptr_t)function;
+    if(_callDepth < MAX_CALL_DEPTH && _lastBlockAddresses[_callDepth] != 0)
+        source = _lastBlockAddresses[_callDepth];
+    if(_callDepth > 0)
+        --_callDepth;
+    _lastBlockHookEnd = NULL;
+
+    InsertBranchEntry(source, (uintptr_t)callSite, BranchTypeReturn);
+}
+
+HOOK void __sanitizer_cov_trace_pc(void)
+{
+    if(_nextEntry == NULL || _callDepth >= MAX_CALL_DEPTH)
+        return;
+
+    // Record control flow from the previous basic block of the current function to the current one
+    // If the function was entered before tracing started, there is no previous basic block yet
+    uintptr_t blockAddress = (uintptr_t)__builtin_return_address(0);
+    uintptr_t lastBlockAddress = _lastBlockAddresses[_callDepth];
+    _lastBlockAddresses[_callDepth] = blockAddress;
+    if(lastBlockAddress != 0)
+        InsertBranchEntry(lastBlockAddress, blockAddress, BranchTypeJump);
+    _lastBlockHookPreviousAddress = lastBlockAddress;
+    _lastBlockHookEnd = _nextEntry;
+}
+
+// Not used, but may be emitted together with trace-pc.
+HOOK void __sanitizer_cov_trace_pc_guard_init(uint32_t* start, uint32_t* stop)
+{
+}
+
+
+/* MEMORY ACCESS HOOKS */
+
+// Records a memory access entry.
+static inline __attribute__((always_inline)) void InsertMemoryAccessEntry(uint32_t type, uintptr_t instructionAddress, uintptr_t memoryAddress, size_t size)
+{
+    if(_nextEntry == NULL)
+        return;
+
+    TraceEntry* entry = NewEntry();
+    entry->Type = type;
+    entry->Param0 = (uint16_t)size;
+    entry->Param1 = instructionAddress;
+    entry->Param2 = memoryAddress;
+}
+
+// Defines the hooks for fixed-size accesses, for both the ASan and the sanitizer coverage interface.
+#define DEFINE_MEMORY_ACCESS_HOOKS(size) \
+    HOOK void __asan_load##size##_noabort(uintptr_t address) { InsertMemoryAccessEntry(MemoryRead, (uintptr_t)__builtin_return_address(0), address, size); } \
+    HOOK void __asan_store##size##_noabort(uintptr_t address) { InsertMemoryAccessEntry(MemoryWrite, (uintptr_t)__builtin_return_address(0), address, size); } \
+    HOOK void __asan_load##size(uintptr_t address) { InsertMemoryAccessEntry(MemoryRead, (uintptr_t)__builtin_return_address(0), address, size); } \
+    HOOK void __asan_store##size(uintptr_t address) { InsertMemoryAccessEntry(MemoryWrite, (uintptr_t)__builtin_return_address(0), address, size); } \
+    HOOK void __sanitizer_cov_load##size(void* address) { InsertMemoryAccessEntry(MemoryRead, (uintptr_t)__builtin_return_address(0), (uintptr_t)address, size); } \
+    HOOK void __sanitizer_cov_store##size(void* address) { InsertMemoryAccessEntry(MemoryWrite, (uintptr_t)__builtin_return_address(0), (uintptr_t)address, size); }
+
+DEFINE_MEMORY_ACCESS_HOOKS(1)
+DEFINE_MEMORY_ACCESS_HOOKS(2)
+DEFINE_MEMORY_ACCESS_HOOKS(4)
+DEFINE_MEMORY_ACCESS_HOOKS(8)
+DEFINE_MEMORY_ACCESS_HOOKS(16)
+
+HOOK void __asan_loadN_noabort(uintptr_t address, size_t size) { InsertMemoryAccessEntry(MemoryRead, (uintptr_t)__builtin_return_address(0), address, size); }
+HOOK void __asan_storeN_noabort(uintptr_t address, size_t size) { InsertMemoryAccessEntry(MemoryWrite, (uintptr_t)__builtin_return_address(0), address, size); }
+HOOK void __asan_loadN(uintptr_t address, size_t size) { InsertMemoryAccessEntry(MemoryRead, (uintptr_t)__builtin_return_address(0), address, size); }
+HOOK void __asan_storeN(uintptr_t address, size_t size) { InsertMemoryAccessEntry(MemoryWrite, (uintptr_t)__builtin_return_address(0), address, size); }
+
+// Emitted by the ASan instrumentation before calls to noreturn functions; nothing to do here.
+HOOK void __asan_handle_no_return(void)
+{
+}
+
+
+/* ALLOCATION FUNCTIONS */
+
+HOOK void* malloc(size_t size)
+{
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocSizeParameter;
+        entry->Param1 = size;
+    }
+
+    void* result = __libc_malloc(size);
+
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocAddressReturn;
+        entry->Param2 = (uintptr_t)result;
+    }
+    return result;
+}
+
+HOOK void* calloc(size_t count, size_t size)
+{
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocSizeParameter;
+        entry->Param1 = count * size;
+    }
+
+    void* result = __libc_calloc(count, size);
+
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocAddressReturn;
+        entry->Param2 = (uintptr_t)result;
+    }
+    return result;
+}
+
+HOOK void* realloc(void* ptr, size_t size)
+{
+    // Like the Pin tool, only record the new allocation
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocSizeParameter;
+        entry->Param1 = size;
+    }
+
+    void* result = __libc_realloc(ptr, size);
+
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapAllocAddressReturn;
+        entry->Param2 = (uintptr_t)result;
+    }
+    return result;
+}
+
+HOOK void free(void* ptr)
+{
+    if(_nextEntry != NULL)
+    {
+        TraceEntry* entry = NewEntry();
+        entry->Type = HeapFreeAddressParameter;
+        entry->Param2 = (uintptr_t)ptr;
+    }
+
+    __libc_free(ptr);
+}
@@ -40,6 +40,24 @@ public abstract class Node
         return nodeValue;
     }
     
+    /// <summary>
+    /// Parses a value node as double-precision floating point number.
+    /// This method asserts that this object is an instance of <see cref="ValueNode"/>.
+    /// </summary>
+    public double AsDouble()
+    {
+        if(this is not ValueNode scalarNode)
+            throw new ConfigurationException("Invalid node type.");
+
+        if(scalarNode.Value == null)
+            throw new ConfigurationException("Value of floating point node is null.");
+
+        if(!double.TryParse(scalarNode.Value, NumberStyles.Float, CultureInfo.InvariantCulture, out double nodeValue))
+            throw new ConfigurationException("Invalid node value.");
+
+        return nodeValue;
+    }
+
     /// <summary>
     /// Parses a value node as unsigned 64-bit hex string.
     /// This method asserts that this object is an instance of <see cref="ValueNode"/>.
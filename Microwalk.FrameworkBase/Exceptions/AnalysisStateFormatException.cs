@@ -0,0 +1,19 @@
+﻿using System;
+
+namespace Microwalk.FrameworkBase.Exceptions
+{
+    /// <summary>
+    /// Used when encountering problems while reading saved analysis module states.
+    /// </summary>
+    public class AnalysisStateFormatException : Exception
+    {
+        /// <summary>
+        /// Creates a new exception with the given message.
+        /// </summary>
+        /// <param name="message">Message.</param>
+        public AnalysisStateFormatException(string message)
+            : base(message)
+        {
+        }
+    }
+}
@@ -0,0 +1,48 @@
+﻿using System;
+using Microwalk.FrameworkBase.Utilities;
+
+namespace Microwalk.FrameworkBase.Extensions
+{
+    /// <summary>
+    /// Utility extension methods for <see cref="IFastBinaryWriter"/> and <see cref="IFastBinaryReader"/>, for types which are not natively supported.
+    /// </summary>
+    public static class FastBinaryReaderWriterExtensions
+    {
+        /// <summary>
+        /// Writes a length-prefixed ANSI string.
+        /// </summary>
+        public static void WriteLengthPrefixedString(this IFastBinaryWriter writer, string value)
+        {
+            writer.WriteInt32(value.Length);
+            writer.WriteChars(value.ToCharArray());
+        }
+
+        /// <summary>
+        /// Reads a string which was written by <see cref="WriteLengthPrefixedString"/>.
+        /// </summary>
+        public static string ReadLengthPrefixedString(this IFastBinaryReader reader)
+        {
+            int length = reader.ReadInt32();
+            return reader.ReadString(length);
+        }
+
+        /// <summary>
+        /// Writes an unsigned 128-bit integer.
+        /// </summary>
+        public static void WriteUInt128(this IFastBinaryWriter writer, UInt128 value)
+        {
+            writer.WriteUInt64((ulong)value);
+            writer.WriteUInt64((ulong)(value >> 64));
+        }
+
+        /// <summary>
+        /// Reads an unsigned 128-bit integer.
+        /// </summary>
+        public static UInt128 ReadUInt128(this IFastBinaryReader reader)
+        {
+            ulong lower = reader.ReadUInt64();
+            ulong upper = reader.ReadUInt64();
+            return new UInt128(upper, lower);
+        }
+    }
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
-﻿using System.Threading.Tasks;
+﻿using System;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase.Stages
 {
@@ -26,5 +28,43 @@ namespace Microwalk.FrameworkBase.Stages
         /// Performs final analysis steps (e.g. outputting results). This function is called exactly once, after the trace pipeline is done.
         /// </summary>
         public abstract Task FinishAsync();
+
+        /// <summary>
+        /// Returns whether the module can provide running leakage estimates through <see cref="GetLeakageEstimate"/>.
+        /// </summary>
+        public virtual bool SupportsLeakageEstimates => false;
+
+        /// <summary>
+        /// Controls whether the module keeps track of running leakage estimates while traces are added.
+        /// This is set by the pipeline before the first trace is added, if the analysis may be stopped early; otherwise, modules can avoid the
+        /// additional bookkeeping.
+        /// </summary>
+        public bool TrackLeakageEstimates { get; set; }
+
+        /// <summary>
+        /// Returns an estimate of the leakage measures for the traces added so far, or null if the module does not track any estimates.
+        /// This method is expected to be thread-safe and may be called concurrently to <see cref="AddTraceAsync"/>.
+        /// </summary>
+        public virtual LeakageEstimate? GetLeakageEstimate() => null;
+
+        /// <summary>
+        /// Returns whether the module can save its intermediate state through <see cref="SaveStateAsync"/>, and merge saved states through
+        /// <see cref="MergeStateAsync"/>.
+        /// </summary>
+        public virtual bool SupportsStateSerialization => false;
+
+        /// <summary>
+        /// Saves the intermediate analysis state, i.e., everything <see cref="FinishAsync"/> needs for computing the results.
+        /// This function is called after the trace pipeline is done, and before <see cref="FinishAsync"/>.
+        /// </summary>
+        /// <param name="writer">Binary writer.</param>
+        public virtual Task SaveStateAsync(IFastBinaryWriter writer) => throw new NotSupportedException("This module does not support saving its state.");
+
+        /// <summary>
+        /// Merges a state which was saved by <see cref="SaveStateAsync"/> into the current state. The saved state may come from another run of the
+        /// same configuration with a disjoint set of testcases. This function is not called concurrently.
+        /// </summary>
+        /// <param name="reader">Binary reader.</param>
+        public virtual Task MergeStateAsync(IFastBinaryReader reader) => throw new NotSupportedException("This module does not support merging saved states.");
     }
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+﻿using System;
+using System.Globalization;
+
+namespace Microwalk.FrameworkBase.Stages
+{
+    /// <summary>
+    /// Running estimate of the leakage measures of an analysis module, based on the traces which were analyzed so far.
+    /// The pipeline compares successive estimates to decide whether more testcases are likely to change the analysis results.
+    /// </summary>
+    public sealed class LeakageEstimate
+    {
+        /// <summary>
+        /// Number of testcases the estimate is based on.
+        /// </summary>
+        public int TestcaseCount { get; }
+
+        /// <summary>
+        /// Number of locations (e.g., instructions) which yielded more than one distinct trace.
+        /// </summary>
+        public int LeakingLocationCount { get; }
+
+        /// <summary>
+        /// Maximum mutual information of a single location, in bits.
+        /// </summary>
+        public double MaximumMutualInformation { get; }
+
+        /// <summary>
+        /// Average mutual information of the leaking locations, in bits.
+        /// </summary>
+        public double AverageMutualInformation { get; }
+
+        /// <summary>
+        /// Maximum minimum entropy of a single location, in bits.
+        /// </summary>
+        public double MaximumMinEntropy { get; }
+
+        public LeakageEstimate(int testcaseCount, int leakingLocationCount, double maximumMutualInformation, double averageMutualInformation, double maximumMinEntropy)
+        {
+            TestcaseCount = testcaseCount;
+            LeakingLocationCount = leakingLocationCount;
+            MaximumMutualInformation = maximumMutualInformation;
+            AverageMutualInformation = averageMutualInformation;
+            MaximumMinEntropy = maximumMinEntropy;
+        }
+
+        /// <summary>
+        /// Checks whether this estimate matches the given previous estimate: The set of leaking locations must have the same size, and all
+        /// information measures must not differ by more than the given tolerance.
+        /// </summary>
+        /// <param name="previous">Previous estimate.</param>
+        /// <param name="tolerance">Maximum difference of the information measures, in bits.</param>
+        public bool IsWithinTolerance(LeakageEstimate previous, double tolerance)
+        {
+            return LeakingLocationCount == previous.LeakingLocationCount
+                   && Math.Abs(MaximumMutualInformation - previous.MaximumMutualInformation) <= tolerance
+                   && Math.Abs(AverageMutualInformation - previous.AverageMutualInformation) <= tolerance
+                   && Math.Abs(MaximumMinEntropy - previous.MaximumMinEntropy) <= tolerance;
+        }
+
+        public override string ToString()
+        {
+            return string.Create(CultureInfo.InvariantCulture,
+                $"{TestcaseCount} testcases, {LeakingLocationCount} leaking locations, max MI {MaximumMutualInformation:F3} bits, " +
+                $"avg MI {AverageMutualInformation:F3} bits, max min-entropy {MaximumMinEntropy:F3} bits");
+        }
+    }
+}
\ No newline at end of file
@@ -1,4 +1,9 @@
-﻿using System.Threading.Tasks;
+﻿using System;
+using System.IO;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.TraceFormat;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase.Stages
 {
@@ -12,11 +17,57 @@ namespace Microwalk.FrameworkBase.Stages
         /// </summary>
         public static ModuleFactory<PreprocessorStage> Factory { get; } = new();
 
+        /// <summary>
+        /// Name of the file holding the call stack trie, which is stored next to the preprocessed trace files.
+        /// </summary>
+        protected const string CallStacksFileName = "call-stacks.preprocessed";
+
+        /// <summary>
+        /// Magic number at the beginning of the call stack file ("MWCS"), which is followed by the <see cref="TraceFile.RowFormatVersion"/> of the
+        /// stored traces.
+        /// </summary>
+        private const uint _callStacksFileMagic = 0x5343574D;
+
         /// <summary>
         /// Performs preprocessing on the given trace. This method is expected to be thread-safe.
         /// </summary>
         /// <param name="traceEntity">The trace entity pointing to the raw trace data.</param>
         /// <returns></returns>
         public abstract Task PreprocessTraceAsync(TraceEntity traceEntity);
+
+        /// <summary>
+        /// Writes the given call stack trie to the given preprocessed trace directory, and tags the directory with the current trace format version.
+        /// </summary>
+        /// <param name="callStacks">Call stack trie.</param>
+        /// <param name="directory">Directory containing the preprocessed traces.</param>
+        protected static async Task StoreCallStacksAsync(CallStackTrie callStacks, DirectoryInfo directory)
+        {
+            using var writer = new FastBinaryBufferWriter(4 + 2 + 4 + callStacks.Count * (4 + 8 + 8 + 4));
+            writer.WriteUInt32(_callStacksFileMagic);
+            writer.WriteUInt16(TraceFile.RowFormatVersion);
+            callStacks.Store(writer);
+            await using var stream = File.Create(Path.Combine(directory.FullName, CallStacksFileName));
+            await stream.WriteAsync(writer.Buffer.AsMemory(0, writer.Length));
+        }
+
+        /// <summary>
+        /// Loads the call stack trie from the given preprocessed trace directory. Throws a <see cref="TraceFormatException"/>, if the stored traces
+        /// were written with a different trace format version.
+        /// </summary>
+        /// <param name="directory">Directory containing the preprocessed traces.</param>
+        protected static async Task<CallStackTrie> LoadCallStacksAsync(DirectoryInfo directory)
+        {
+            string callStacksFilePath = Path.Combine(directory.FullName, CallStacksFileName);
+            if(!File.Exists(callStacksFilePath))
+                throw new TraceFormatException($"Could not find preprocessed call stack file {callStacksFilePath}. The traces may have been written by an older version, please preprocess the raw traces again.");
+
+            var bytes = await File.ReadAllBytesAsync(callStacksFilePath);
+            var reader = new FastBinaryBufferReader(bytes);
+            ushort version = bytes.Length >= 6 && reader.ReadUInt32() == _callStacksFileMagic ? (ushort)reader.ReadInt16() : (ushort)1;
+            if(version != TraceFile.RowFormatVersion)
+                throw new TraceFormatException($"The preprocessed traces in {directory.FullName} have trace format version {version}, but version {TraceFile.RowFormatVersion} is required. Please preprocess the raw traces again.");
+
+            return new CallStackTrie(reader);
+        }
     }
 }
\ No newline at end of file
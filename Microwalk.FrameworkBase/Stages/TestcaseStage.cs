@@ -26,6 +26,22 @@ namespace Microwalk.FrameworkBase.Stages
         /// <returns></returns>
         public abstract Task<bool> IsDoneAsync();
 
+        /// <summary>
+        /// Advances the test case stage past the next test case, without producing it. This is used when resuming a run from a checkpoint, for
+        /// test cases which have already been analyzed. The default implementation generates the test case and discards it.
+        /// </summary>
+        /// <param name="token">Cancellation token to stop test case generation early.</param>
+        /// <returns></returns>
+        public virtual async Task SkipTestcaseAsync(CancellationToken token)
+        {
+            await NextTestcaseAsync(token);
+        }
+
+        /// <summary>
+        /// Determines whether the generated test cases are stored in files, i.e., <see cref="TraceEntity.TestcaseFilePath"/> is set.
+        /// </summary>
+        public virtual bool ProvidesTestcaseFiles => true;
+
         /// <summary>
         /// The testcase stage does not allow parallelism.
         /// </summary>
@@ -18,5 +18,11 @@ namespace Microwalk.FrameworkBase.Stages
         /// <param name="traceEntity">The trace entity containing the test case data.</param>
         /// <returns></returns>
         public abstract Task GenerateTraceAsync(TraceEntity traceEntity);
+
+        /// <summary>
+        /// Determines whether the module reads the test cases from the files given by <see cref="TraceEntity.TestcaseFilePath"/>.
+        /// If this is set, the test case stage must store its test cases in files.
+        /// </summary>
+        public virtual bool NeedsTestcaseFiles => false;
     }
 }
\ No newline at end of file
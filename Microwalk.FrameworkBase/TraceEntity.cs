@@ -1,4 +1,5 @@
 ﻿using Microwalk.FrameworkBase.TraceFormat;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase
 {
@@ -22,6 +23,17 @@ namespace Microwalk.FrameworkBase
         /// </summary>
         public string TestcaseFilePath { get; init; } = "";
 
+        /// <summary>
+        /// The contents of the associated testcase file, if the testcase stage keeps them in memory. May be null.
+        /// </summary>
+        public byte[]? TestcaseData { get; init; }
+
+        /// <summary>
+        /// Parameters for reproducing a pseudo-random testcase, if the testcase stage generated it deterministically. May be null.
+        /// Trace stages may use this to let the target generate the testcase itself.
+        /// </summary>
+        public DeterministicTestcase? DeterministicTestcase { get; init; }
+
         /// <summary>
         /// The associated raw trace file. May be null.
         /// </summary>
@@ -0,0 +1,234 @@
+using System;
+using System.Collections.Concurrent;
+using System.Numerics;
+using System.Threading;
+using Microwalk.FrameworkBase.Utilities;
+
+namespace Microwalk.FrameworkBase.TraceFormat
+{
+    /// <summary>
+    /// Interns the call stacks observed in a set of traces.
+    /// Each call stack is a node in a trie, where the edges are (call instruction, call target) pairs, and is identified by a compact integer ID.
+    /// Instruction IDs are encoded as <c>(imageId &lt;&lt; 32) | relativeAddress</c>.
+    ///
+    /// The trie is shared between all traces of a run, so a given call stack has the same ID in every trace. This class is thread-safe.
+    /// Nodes are never modified after they were added, so they are stored in fixed-size chunks which can be read without locking.
+    ///
+    /// IDs are assigned in the order in which the call stacks are first encountered, which varies between runs when traces are preprocessed in
+    /// parallel. Results which are written to files or persisted across runs should thus refer to call stacks by their <see cref="Node.Hash"/>,
+    /// which only depends on the call chain.
+    /// </summary>
+    public class CallStackTrie
+    {
+        /// <summary>
+        /// The ID of the root node, i.e., the call stack at the beginning of each trace.
+        /// </summary>
+        public const int RootId = 0;
+
+        /// <summary>
+        /// The hash of the root node.
+        /// </summary>
+        public const ulong RootHash = 0;
+
+        // xxHash64 primes for computing the call stack hashes.
+        private const ulong _hashPrime1 = 0x9E3779B185EBCA87;
+        private const ulong _hashPrime2 = 0xC2B2AE3D27D4EB4F;
+        private const ulong _hashPrime3 = 0x165667B19E3779F9;
+        private const ulong _hashPrime4 = 0x85EBCA77C2B2AE63;
+        private const ulong _hashPrime5 = 0x27D4EB2F165667C5;
+
+        /// <summary>
+        /// Number of nodes per chunk, as power of two.
+        /// </summary>
+        private const int _chunkShift = 12;
+
+        /// <summary>
+        /// Mask for extracting the index of a node within its chunk.
+        /// </summary>
+        private const int _chunkMask = (1 << _chunkShift) - 1;
+
+        /// <summary>
+        /// Trie nodes, indexed by their IDs and split into chunks of 2^<see cref="_chunkShift"/> nodes.
+        /// Existing chunks never move, and the chunk array is only replaced after its contents were copied, so readers never observe a missing node.
+        /// </summary>
+        private Node[]?[] _chunks = new Node[]?[16];
+
+        /// <summary>
+        /// Number of nodes. Nodes are written before this counter is incremented.
+        /// </summary>
+        private volatile int _count;
+
+        /// <summary>
+        /// Serializes the addition of new nodes.
+        /// </summary>
+        private readonly object _addLock = new();
+
+        /// <summary>
+        /// Maps (parent ID, source instruction ID, target instruction ID) to the respective child node ID.
+        /// </summary>
+        private readonly ConcurrentDictionary<(int parentId, ulong sourceInstructionId, ulong targetInstructionId), int> _childIds = new();
+
+        /// <summary>
+        /// Creates a new trie, which only contains the root node.
+        /// </summary>
+        public CallStackTrie()
+        {
+            AddNode(new Node(RootId, 0, 0, 0, RootHash));
+        }
+
+        /// <summary>
+        /// Loads a trie which was previously saved with <see cref="Store"/>.
+        /// </summary>
+        /// <param name="reader">Binary reader.</param>
+        public CallStackTrie(IFastBinaryReader reader)
+        {
+            int nodeCount = reader.ReadInt32();
+            for(int i = 0; i < nodeCount; ++i)
+            {
+                int parentId = reader.ReadInt32();
+                ulong sourceInstructionId = reader.ReadUInt64();
+                ulong targetInstructionId = reader.ReadUInt64();
+                int depth = reader.ReadInt32();
+
+                // Parent nodes always have smaller IDs than their children
+                var node = i == RootId
+                    ? new Node(RootId, 0, 0, 0, RootHash)
+                    : new Node(parentId, sourceInstructionId, targetInstructionId, depth, ComputeHash(GetNode(parentId).Hash, sourceInstructionId, targetInstructionId));
+                AddNode(node);
+                if(i != RootId)
+                    _childIds.TryAdd((node.ParentId, node.SourceInstructionId, node.TargetInstructionId), i);
+            }
+        }
+
+        /// <summary>
+        /// Returns the number of call stacks, including the root.
+        /// </summary>
+        public int Count => _count;
+
+        /// <summary>
+        /// Returns the ID of the call stack that results from executing the given call in the given call stack, and creates it if it does not yet exist.
+        /// </summary>
+        /// <param name="parentId">ID of the call stack containing the call instruction.</param>
+        /// <param name="sourceInstructionId">ID of the call instruction.</param>
+        /// <param name="targetInstructionId">ID of the call target.</param>
+        public int GetOrAddChild(int parentId, ulong sourceInstructionId, ulong targetInstructionId)
+        {
+            var key = (parentId, sourceInstructionId, targetInstructionId);
+            if(_childIds.TryGetValue(key, out int id))
+                return id;
+
+            // Assign IDs under a lock, so concurrent threads agree on the ID of a new call stack
+            lock(_addLock)
+            {
+                if(_childIds.TryGetValue(key, out id))
+                    return id;
+
+                var parent = GetNode(parentId);
+                id = AddNode(new Node(parentId, sourceInstructionId, targetInstructionId, parent.Depth + 1, ComputeHash(parent.Hash, sourceInstructionId, targetInstructionId)));
+                _childIds.TryAdd(key, id);
+                return id;
+            }
+        }
+
+        /// <summary>
+        /// Returns the node of the given call stack. This does not take a lock.
+        /// </summary>
+        /// <param name="id">Call stack ID.</param>
+        public Node GetNode(int id)
+        {
+            if((uint)id >= (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(id));
+
+            return Volatile.Read(ref _chunks)[id >> _chunkShift]![id & _chunkMask];
+        }
+
+        /// <summary>
+        /// Appends the given node and returns its ID. Must be called under <see cref="_addLock"/>, or before the trie is shared.
+        /// </summary>
+        private int AddNode(Node node)
+        {
+            int id = _count;
+            int chunkIndex = id >> _chunkShift;
+
+            var chunks = _chunks;
+            if(chunkIndex == chunks.Length)
+            {
+                var newChunks = new Node[]?[2 * chunks.Length];
+                Array.Copy(chunks, newChunks, chunks.Length);
+                chunks = newChunks;
+                Volatile.Write(ref _chunks, chunks);
+            }
+
+            var chunk = chunks[chunkIndex];
+            if(chunk == null)
+            {
+                chunk = new Node[1 << _chunkShift];
+                Volatile.Write(ref chunks[chunkIndex], chunk);
+            }
+
+            chunk[id & _chunkMask] = node;
+            _count = id + 1;
+            return id;
+        }
+
+        /// <summary>
+        /// Computes the hash of a call stack from the hash of its parent and the call leading to it.
+        /// The call is folded into the parent hash with the round and avalanche functions of xxHash64.
+        /// </summary>
+        private static ulong ComputeHash(ulong parentHash, ulong sourceInstructionId, ulong targetInstructionId)
+        {
+            unchecked
+            {
+                ulong hash = parentHash + _hashPrime5;
+                hash = (BitOperations.RotateLeft(hash ^ HashRound(sourceInstructionId), 27) * _hashPrime1) + _hashPrime4;
+                hash = (BitOperations.RotateLeft(hash ^ HashRound(targetInstructionId), 27) * _hashPrime1) + _hashPrime4;
+
+                hash ^= hash >> 33;
+                hash *= _hashPrime2;
+                hash ^= hash >> 29;
+                hash *= _hashPrime3;
+                hash ^= hash >> 32;
+                return hash;
+            }
+        }
+
+        /// <summary>
+        /// xxHash64 round function.
+        /// </summary>
+        private static ulong HashRound(ulong input)
+        {
+            return unchecked(BitOperations.RotateLeft(input * _hashPrime2, 31) * _hashPrime1);
+        }
+
+        /// <summary>
+        /// Saves the trie.
+        /// </summary>
+        /// <param name="writer">Binary writer.</param>
+        public void Store(IFastBinaryWriter writer)
+        {
+            lock(_addLock)
+            {
+                int count = _count;
+                writer.WriteInt32(count);
+                for(int id = 0; id < count; ++id)
+                {
+                    var node = GetNode(id);
+                    writer.WriteInt32(node.ParentId);
+                    writer.WriteUInt64(node.SourceInstructionId);
+                    writer.WriteUInt64(node.TargetInstructionId);
+                    writer.WriteInt32(node.Depth);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Describes one call stack.
+        /// </summary>
+        /// <param name="ParentId">ID of the call stack containing the call instruction. The root node is its own parent.</param>
+        /// <param name="SourceInstructionId">ID of the call instruction, or 0 for the root node.</param>
+        /// <param name="TargetInstructionId">ID of the call target, or 0 for the root node.</param>
+        /// <param name="Depth">Number of calls in this call stack.</param>
+        /// <param name="Hash">Hash of the call chain, which identifies the call stack independently of the trie. The root node has hash <see cref="RootHash"/>.</param>
+        public readonly record struct Node(int ParentId, ulong SourceInstructionId, ulong TargetInstructionId, int Depth, ulong Hash);
+    }
+}
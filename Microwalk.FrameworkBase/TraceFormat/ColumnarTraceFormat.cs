@@ -0,0 +1,551 @@
+﻿using System;
+using System.Buffers.Binary;
+using System.Collections;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
+using Microwalk.FrameworkBase.Utilities;
+
+namespace Microwalk.FrameworkBase.TraceFormat
+{
+    /// <summary>
+    /// Provides functions to write and read preprocessed traces in the columnar format (version 2).
+    ///
+    /// The default (row) format stores the trace entries as one stream of variable-sized records, which must be decoded sequentially.
+    /// The columnar format instead stores a column with the entry types, and one column per entry type which contains the entries of that type in trace
+    /// order. Within a column, the entries have a fixed size and the same encoding as in the row format (without the type byte), so they can be read
+    /// through the same views. Consumers only touch the columns of the entry types they are interested in, and the type column can be scanned with
+    /// vectorized span operations.
+    ///
+    /// Layout (little endian):
+    /// <code>
+    /// u32 magic ("MWCT"), u16 version, u16 column count, i64 entry count
+    /// column count * (i64 offset, i64 entry count)    -- index: column 0 holds the entry types, column i the entries of type i
+    /// columns, each aligned to 8 bytes
+    /// </code>
+    /// Since row-format traces start with an entry type, the formats can be distinguished by the first bytes.
+    /// </summary>
+    public static class ColumnarTraceFormat
+    {
+        /// <summary>
+        /// Magic number at the beginning of each columnar trace ("MWCT").
+        /// </summary>
+        public const uint Magic = 0x5443574D;
+
+        /// <summary>
+        /// Current format version.
+        /// </summary>
+        public const ushort Version = 2;
+
+        /// <summary>
+        /// Number of columns: The type column, and one for each entry type.
+        /// </summary>
+        internal const int ColumnCount = 8;
+
+        /// <summary>
+        /// Index of the entry type column.
+        /// </summary>
+        private const int _typeColumn = 0;
+
+        /// <summary>
+        /// Size of the fixed header, including the column index.
+        /// </summary>
+        private const int _headerSize = 16 + ColumnCount * 16;
+
+        /// <summary>
+        /// Alignment of column start offsets.
+        /// </summary>
+        private const int _columnAlignment = 8;
+
+        /// <summary>
+        /// Size of the chunks in which files are read and written during conversion.
+        /// </summary>
+        private const int _conversionChunkSize = 1 * 1024 * 1024;
+
+        /// <summary>
+        /// Size of a single column element, indexed by column (i.e., entry type). Entry columns omit the type byte.
+        /// </summary>
+        private static readonly int[] _elementSizes =
+        {
+            1,
+            ImageMemoryAccess.EntrySize - 1,
+            HeapMemoryAccess.EntrySize - 1,
+            StackMemoryAccess.EntrySize - 1,
+            HeapAllocation.EntrySize - 1,
+            HeapFree.EntrySize - 1,
+            Branch.EntrySize - 1,
+            StackAllocation.EntrySize - 1
+        };
+
+        /// <summary>
+        /// Checks whether the given trace data is in the columnar format.
+        /// </summary>
+        /// <param name="data">Trace data, or at least its first bytes.</param>
+        public static bool IsColumnar(ReadOnlySpan<byte> data)
+        {
+            return data.Length >= 4 && BinaryPrimitives.ReadUInt32LittleEndian(data) == Magic;
+        }
+
+        /// <summary>
+        /// Checks whether the given trace file is in the columnar format.
+        /// </summary>
+        /// <param name="path">Path to the trace file.</param>
+        public static bool IsColumnarFile(string path)
+        {
+            Span<byte> magic = stackalloc byte[4];
+            using var fileStream = File.Open(path, FileMode.Open, FileAccess.Read, FileShare.Read);
+            return fileStream.ReadAtLeast(magic, magic.Length, false) == magic.Length && IsColumnar(magic);
+        }
+
+        /// <summary>
+        /// Converts the given row-format trace into the columnar format.
+        /// </summary>
+        /// <param name="rowData">Trace data in row format.</param>
+        /// <returns>Trace data in columnar format.</returns>
+        public static byte[] Convert(ReadOnlySpan<byte> rowData)
+        {
+            Span<long> counts = stackalloc long[ColumnCount];
+            if(CountEntries(rowData, counts) != rowData.Length)
+                throw new TraceFormatException("Incomplete trace entry at end of trace.");
+
+            Span<long> offsets = stackalloc long[ColumnCount];
+            long totalSize = ComputeLayout(counts, offsets);
+            if(totalSize > Array.MaxLength)
+                throw new TraceFormatException("The trace is too large for being converted in memory.");
+
+            byte[] columnarData = new byte[totalSize];
+            WriteHeader(columnarData, counts, offsets);
+
+            Span<int> positions = stackalloc int[ColumnCount];
+            for(int c = 0; c < ColumnCount; ++c)
+                positions[c] = (int)offsets[c];
+
+            int position = 0;
+            while(position < rowData.Length)
+            {
+                byte entryType = rowData[position];
+                int elementSize = _elementSizes[entryType];
+
+                columnarData[positions[_typeColumn]++] = entryType;
+                rowData.Slice(position + 1, elementSize).CopyTo(columnarData.AsSpan(positions[entryType]));
+                positions[entryType] += elementSize;
+
+                position += 1 + elementSize;
+            }
+
+            return columnarData;
+        }
+
+        /// <summary>
+        /// Converts the given row-format trace file into the columnar format.
+        /// Both files are processed in chunks, so the conversion itself works for traces of any size. However, columnar traces are read as a single
+        /// memory-mapped buffer, so the result should not exceed the bound checked by <see cref="GetMaxConvertedSize"/>.
+        /// </summary>
+        /// <param name="rowTracePath">Path to the trace file in row format.</param>
+        /// <param name="columnarTracePath">Path of the resulting columnar trace file.</param>
+        public static void ConvertFile(string rowTracePath, string columnarTracePath)
+        {
+            byte[] chunk = new byte[_conversionChunkSize];
+
+            // First pass: Determine column sizes
+            long[] counts = new long[ColumnCount];
+            using(var inputStream = File.Open(rowTracePath, FileMode.Open, FileAccess.Read, FileShare.Read))
+            {
+                int chunkLength = 0;
+                int bytesRead;
+                while((bytesRead = inputStream.Read(chunk, chunkLength, chunk.Length - chunkLength)) > 0)
+                {
+                    chunkLength += bytesRead;
+                    int consumed = CountEntries(chunk.AsSpan(0, chunkLength), counts);
+                    chunk.AsSpan(consumed, chunkLength - consumed).CopyTo(chunk);
+                    chunkLength -= consumed;
+                }
+
+                if(chunkLength > 0)
+                    throw new TraceFormatException("Incomplete trace entry at end of trace.");
+            }
+
+            long[] offsets = new long[ColumnCount];
+            long totalSize = ComputeLayout(counts, offsets);
+
+            // Second pass: Distribute entries to the columns, each of which is written through its own buffer
+            using var outputHandle = File.OpenHandle(columnarTracePath, FileMode.Create, FileAccess.Write, FileShare.None, FileOptions.None, totalSize);
+            byte[] header = new byte[_headerSize];
+            WriteHeader(header, counts, offsets);
+            RandomAccess.Write(outputHandle, header, 0);
+
+            var columnWriters = new ColumnWriter[ColumnCount];
+            for(int c = 0; c < ColumnCount; ++c)
+                columnWriters[c] = new ColumnWriter(outputHandle, offsets[c]);
+
+            using(var inputStream = File.Open(rowTracePath, FileMode.Open, FileAccess.Read, FileShare.Read))
+            {
+                int chunkLength = 0;
+                int bytesRead;
+                while((bytesRead = inputStream.Read(chunk, chunkLength, chunk.Length - chunkLength)) > 0)
+                {
+                    chunkLength += bytesRead;
+
+                    int position = 0;
+                    while(position < chunkLength)
+                    {
+                        byte entryType = chunk[position];
+                        int elementSize = _elementSizes[entryType];
+                        if(chunkLength - position < 1 + elementSize)
+                            break;
+
+                        columnWriters[_typeColumn].Write(chunk.AsSpan(position, 1));
+                        columnWriters[entryType].Write(chunk.AsSpan(position + 1, elementSize));
+                        position += 1 + elementSize;
+                    }
+
+                    chunk.AsSpan(position, chunkLength - position).CopyTo(chunk);
+                    chunkLength -= position;
+                }
+            }
+
+            foreach(var columnWriter in columnWriters)
+                columnWriter.Flush();
+            RandomAccess.SetLength(outputHandle, totalSize);
+        }
+
+        /// <summary>
+        /// Returns an upper bound for the size of the columnar trace which results from converting a row-format trace of the given size.
+        /// The columns hold the same bytes as the row format, so only the header and the column alignment are added.
+        /// </summary>
+        /// <param name="rowTraceSize">Size of the trace in row format.</param>
+        public static long GetMaxConvertedSize(long rowTraceSize)
+        {
+            return rowTraceSize + _headerSize + ColumnCount * (_columnAlignment - 1);
+        }
+
+        /// <summary>
+        /// Passes all entries of the given columnar trace to the given visitor, in trace order.
+        /// </summary>
+        /// <param name="data">Trace data in columnar format.</param>
+        /// <param name="visitor">Trace entry visitor.</param>
+        public static void VisitEntries<TVisitor>(ReadOnlySpan<byte> data, ref TVisitor visitor)
+            where TVisitor : struct, ITraceEntryVisitor
+        {
+            Span<int> offsets = stackalloc int[ColumnCount];
+            Span<int> counts = stackalloc int[ColumnCount];
+            ReadHeader(data, offsets, counts);
+
+            var entryTypes = GetColumn(data, offsets, counts, _typeColumn);
+
+            // The header check ensures that the column sizes match the type column, so the positions never run past their columns.
+            // This allows creating the entry views without further bounds checks, which keeps the loop small enough for the column state to fit
+            // into registers.
+            ref byte dataStart = ref MemoryMarshal.GetReference(data);
+            int imageMemoryAccessPosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.ImageMemoryAccess];
+            int heapMemoryAccessPosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.HeapMemoryAccess];
+            int stackMemoryAccessPosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.StackMemoryAccess];
+            int heapAllocationPosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.HeapAllocation];
+            int heapFreePosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.HeapFree];
+            int branchPosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.Branch];
+            int stackAllocationPosition = offsets[(int)TraceEntryTypes.TraceEntryTypes.StackAllocation];
+            foreach(byte entryType in entryTypes)
+            {
+                switch((TraceEntryTypes.TraceEntryTypes)entryType)
+                {
+                    case TraceEntryTypes.TraceEntryTypes.ImageMemoryAccess:
+                        visitor.VisitImageMemoryAccess(new ImageMemoryAccess.View(GetElement(ref dataStart, imageMemoryAccessPosition, ImageMemoryAccess.EntrySize - 1)));
+                        imageMemoryAccessPosition += ImageMemoryAccess.EntrySize - 1;
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.HeapMemoryAccess:
+                        visitor.VisitHeapMemoryAccess(new HeapMemoryAccess.View(GetElement(ref dataStart, heapMemoryAccessPosition, HeapMemoryAccess.EntrySize - 1)));
+                        heapMemoryAccessPosition += HeapMemoryAccess.EntrySize - 1;
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.StackMemoryAccess:
+                        visitor.VisitStackMemoryAccess(new StackMemoryAccess.View(GetElement(ref dataStart, stackMemoryAccessPosition, StackMemoryAccess.EntrySize - 1)));
+                        stackMemoryAccessPosition += StackMemoryAccess.EntrySize - 1;
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.HeapAllocation:
+                        visitor.VisitHeapAllocation(new HeapAllocation.View(GetElement(ref dataStart, heapAllocationPosition, HeapAllocation.EntrySize - 1)));
+                        heapAllocationPosition += HeapAllocation.EntrySize - 1;
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.HeapFree:
+                        visitor.VisitHeapFree(new HeapFree.View(GetElement(ref dataStart, heapFreePosition, HeapFree.EntrySize - 1)));
+                        heapFreePosition += HeapFree.EntrySize - 1;
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.Branch:
+                        visitor.VisitBranch(new Branch.View(GetElement(ref dataStart, branchPosition, Branch.EntrySize - 1)));
+                        branchPosition += Branch.EntrySize - 1;
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.StackAllocation:
+                        visitor.VisitStackAllocation(new StackAllocation.View(GetElement(ref dataStart, stackAllocationPosition, StackAllocation.EntrySize - 1)));
+                        stackAllocationPosition += StackAllocation.EntrySize - 1;
+                        break;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns the column element at the given offset, without bounds checks.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static ReadOnlySpan<byte> GetElement(ref byte dataStart, int offset, int elementSize)
+        {
+            return MemoryMarshal.CreateReadOnlySpan(ref Unsafe.Add(ref dataStart, offset), elementSize);
+        }
+
+        /// <summary>
+        /// Returns the number of entries of the given type in the given columnar trace, without scanning the trace.
+        /// </summary>
+        /// <param name="data">Trace data in columnar format.</param>
+        /// <param name="entryType">Entry type.</param>
+        public static int GetEntryCount(ReadOnlySpan<byte> data, TraceEntryTypes.TraceEntryTypes entryType)
+        {
+            Span<int> offsets = stackalloc int[ColumnCount];
+            Span<int> counts = stackalloc int[ColumnCount];
+            ReadHeader(data, offsets, counts);
+            return counts[(int)entryType];
+        }
+
+        /// <summary>
+        /// Reads and validates the header of the given columnar trace.
+        /// </summary>
+        /// <param name="data">Trace data in columnar format.</param>
+        /// <param name="offsets">Receives the column offsets.</param>
+        /// <param name="counts">Receives the number of elements of each column.</param>
+        internal static void ReadHeader(ReadOnlySpan<byte> data, Span<int> offsets, Span<int> counts)
+        {
+            if(data.Length < _headerSize || !IsColumnar(data))
+                throw new TraceFormatException("Invalid columnar trace header.");
+            ushort version = BinaryPrimitives.ReadUInt16LittleEndian(data[4..]);
+            if(version != Version)
+                throw new TraceFormatException($"Unsupported columnar trace format version {version}.");
+            if(BinaryPrimitives.ReadUInt16LittleEndian(data[6..]) != ColumnCount)
+                throw new TraceFormatException("Unexpected number of columns in columnar trace.");
+            long entryCount = BinaryPrimitives.ReadInt64LittleEndian(data[8..]);
+
+            long entrySum = 0;
+            for(int c = 0; c < ColumnCount; ++c)
+            {
+                long offset = BinaryPrimitives.ReadInt64LittleEndian(data[(16 + 16 * c)..]);
+                long count = BinaryPrimitives.ReadInt64LittleEndian(data[(24 + 16 * c)..]);
+                if(offset < _headerSize || count < 0 || count > data.Length || offset + count * _elementSizes[c] > data.Length)
+                    throw new TraceFormatException("Columnar trace column exceeds the trace data.");
+
+                offsets[c] = (int)offset;
+                counts[c] = (int)count;
+                if(c != _typeColumn)
+                    entrySum += count;
+            }
+
+            if(counts[_typeColumn] != entryCount || entrySum != entryCount)
+                throw new TraceFormatException("Inconsistent entry counts in columnar trace.");
+
+            // Ensure that the type column matches the entry columns (vectorized)
+            var entryTypes = data.Slice(offsets[_typeColumn], counts[_typeColumn]);
+            if(entryTypes.IndexOfAnyExceptInRange((byte)1, (byte)(ColumnCount - 1)) >= 0)
+                throw new TraceFormatException("Illegal trace entry type.");
+            for(int c = 1; c < ColumnCount; ++c)
+            {
+                if(entryTypes.Count((byte)c) != counts[c])
+                    throw new TraceFormatException("Inconsistent entry counts in columnar trace.");
+            }
+        }
+
+        /// <summary>
+        /// Returns the given column.
+        /// </summary>
+        private static ReadOnlySpan<byte> GetColumn(ReadOnlySpan<byte> data, ReadOnlySpan<int> offsets, ReadOnlySpan<int> counts, int column)
+        {
+            return data.Slice(offsets[column], counts[column] * _elementSizes[column]);
+        }
+
+        /// <summary>
+        /// Adds the number of entries of each type in the given row-format data to the given counters.
+        /// </summary>
+        /// <param name="rowData">Trace data in row format.</param>
+        /// <param name="counts">Entry counts, indexed by column.</param>
+        /// <returns>The number of consumed bytes. Any remaining bytes belong to an incomplete trace entry.</returns>
+        private static int CountEntries(ReadOnlySpan<byte> rowData, Span<long> counts)
+        {
+            int position = 0;
+            while(position < rowData.Length)
+            {
+                byte entryType = rowData[position];
+                if(entryType < 1 || entryType >= ColumnCount)
+                    throw new TraceFormatException("Illegal trace entry type.");
+
+                int entrySize = 1 + _elementSizes[entryType];
+                if(rowData.Length - position < entrySize)
+                    break;
+
+                ++counts[_typeColumn];
+                ++counts[entryType];
+                position += entrySize;
+            }
+
+            return position;
+        }
+
+        /// <summary>
+        /// Computes the column offsets for the given entry counts.
+        /// </summary>
+        /// <param name="counts">Entry counts, indexed by column.</param>
+        /// <param name="offsets">Receives the column offsets.</param>
+        /// <returns>The total size of the columnar trace.</returns>
+        private static long ComputeLayout(ReadOnlySpan<long> counts, Span<long> offsets)
+        {
+            long position = _headerSize;
+            for(int c = 0; c < ColumnCount; ++c)
+            {
+                position = (position + _columnAlignment - 1) & ~(long)(_columnAlignment - 1);
+                offsets[c] = position;
+                position += counts[c] * _elementSizes[c];
+            }
+
+            return position;
+        }
+
+        /// <summary>
+        /// Writes the header with the given column index into the given buffer.
+        /// </summary>
+        private static void WriteHeader(Span<byte> buffer, ReadOnlySpan<long> counts, ReadOnlySpan<long> offsets)
+        {
+            BinaryPrimitives.WriteUInt32LittleEndian(buffer, Magic);
+            BinaryPrimitives.WriteUInt16LittleEndian(buffer[4..], Version);
+            BinaryPrimitives.WriteUInt16LittleEndian(buffer[6..], ColumnCount);
+            BinaryPrimitives.WriteInt64LittleEndian(buffer[8..], counts[_typeColumn]);
+            for(int c = 0; c < ColumnCount; ++c)
+            {
+                BinaryPrimitives.WriteInt64LittleEndian(buffer[(16 + 16 * c)..], offsets[c]);
+                BinaryPrimitives.WriteInt64LittleEndian(buffer[(24 + 16 * c)..], counts[c]);
+            }
+        }
+
+        /// <summary>
+        /// Buffers sequential writes to a single column of a columnar trace file.
+        /// </summary>
+        private class ColumnWriter
+        {
+            private const int _bufferSize = 64 * 1024;
+
+            private readonly SafeFileHandle _fileHandle;
+            private readonly byte[] _buffer = new byte[_bufferSize];
+            private int _bufferLength;
+            private long _fileOffset;
+
+            public ColumnWriter(SafeFileHandle fileHandle, long fileOffset)
+            {
+                _fileHandle = fileHandle;
+                _fileOffset = fileOffset;
+            }
+
+            public void Write(ReadOnlySpan<byte> data)
+            {
+                if(_bufferLength + data.Length > _bufferSize)
+                    Flush();
+
+                data.CopyTo(_buffer.AsSpan(_bufferLength));
+                _bufferLength += data.Length;
+            }
+
+            public void Flush()
+            {
+                if(_bufferLength == 0)
+                    return;
+
+                RandomAccess.Write(_fileHandle, _buffer.AsSpan(0, _bufferLength), _fileOffset);
+                _fileOffset += _bufferLength;
+                _bufferLength = 0;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Enumerator for columnar traces (see <see cref="ColumnarTraceFormat"/>).
+    /// </summary>
+    public class ColumnarTraceFileEnumerator : IEnumerator<ITraceEntry>
+    {
+        private readonly FastBinaryBufferReader _reader;
+        private readonly bool _reuseEntries;
+        private readonly IDisposable? _owner;
+
+        private readonly int[] _columnOffsets = new int[ColumnarTraceFormat.ColumnCount];
+        private readonly int[] _columnCounts = new int[ColumnarTraceFormat.ColumnCount];
+        private readonly int[] _columnPositions = new int[ColumnarTraceFormat.ColumnCount];
+        private int _index;
+
+        private ITraceEntry? _current;
+
+        // Preallocated trace entry objects, indexed by entry type. Only used when entries are reused.
+        private readonly ITraceEntry[] _reusedEntries =
+        {
+            null!,
+            new ImageMemoryAccess(),
+            new HeapMemoryAccess(),
+            new StackMemoryAccess(),
+            new HeapAllocation(),
+            new HeapFree(),
+            new Branch(),
+            new StackAllocation()
+        };
+
+        public ITraceEntry Current => _current ?? throw new InvalidOperationException("Current should not be used in this state");
+        object IEnumerator.Current => Current;
+
+        /// <summary>
+        /// Creates a new enumerator for the given columnar trace.
+        /// </summary>
+        /// <param name="buffer">Trace data in columnar format.</param>
+        /// <param name="reuseEntries">
+        /// Determines whether the trace entry objects are reused. In this case, they must be processed on-the-fly and not stored by the consumer.
+        /// </param>
+        /// <param name="owner">Object owning the trace data, which is disposed together with this enumerator. May be null.</param>
+        public ColumnarTraceFileEnumerator(Memory<byte> buffer, bool reuseEntries, IDisposable? owner = null)
+        {
+            _reader = new FastBinaryBufferReader(buffer);
+            _reuseEntries = reuseEntries;
+            _owner = owner;
+
+            ColumnarTraceFormat.ReadHeader(buffer.Span, _columnOffsets, _columnCounts);
+            Reset();
+        }
+
+        public bool MoveNext()
+        {
+            // Done?
+            if(_index >= _columnCounts[0])
+                return false;
+
+            // Read type of next trace entry
+            var entryType = (TraceEntryTypes.TraceEntryTypes)_reader.Buffer.Span[_columnOffsets[0] + _index++];
+
+            // Deserialize trace entry from its column
+            _current = _reuseEntries ? _reusedEntries[(int)entryType] : entryType switch
+            {
+                TraceEntryTypes.TraceEntryTypes.HeapAllocation => new HeapAllocation(),
+                TraceEntryTypes.TraceEntryTypes.HeapFree => new HeapFree(),
+                TraceEntryTypes.TraceEntryTypes.StackAllocation => new StackAllocation(),
+                TraceEntryTypes.TraceEntryTypes.Branch => new Branch(),
+                TraceEntryTypes.TraceEntryTypes.HeapMemoryAccess => new HeapMemoryAccess(),
+                TraceEntryTypes.TraceEntryTypes.ImageMemoryAccess => new ImageMemoryAccess(),
+                TraceEntryTypes.TraceEntryTypes.StackMemoryAccess => new StackMemoryAccess(),
+                _ => throw new TraceFormatException("Illegal trace entry type.")
+            };
+            _reader.Position = _columnPositions[(int)entryType];
+            _current.FromReader(_reader);
+            _columnPositions[(int)entryType] = (int)_reader.Position;
+            return true;
+        }
+
+        public void Reset()
+        {
+            _columnOffsets.CopyTo(_columnPositions, 0);
+            _index = 0;
+        }
+
+        public void Dispose()
+        {
+            _owner?.Dispose();
+        }
+    }
+}
\ No newline at end of file
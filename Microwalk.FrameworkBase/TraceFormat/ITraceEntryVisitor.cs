@@ -0,0 +1,54 @@
+﻿using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
+
+namespace Microwalk.FrameworkBase.TraceFormat
+{
+    /// <summary>
+    /// Receives the entries of a trace file, without allocating an object per entry.
+    /// Visitors should be implemented as structs, so the visit methods are dispatched statically (see <see cref="TraceFile.Visit{TVisitor}"/>).
+    /// The passed views are only valid for the duration of the respective call.
+    /// </summary>
+    public interface ITraceEntryVisitor
+    {
+        /// <summary>
+        /// Handles a heap allocation.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitHeapAllocation(HeapAllocation.View entry);
+
+        /// <summary>
+        /// Handles a memory free.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitHeapFree(HeapFree.View entry);
+
+        /// <summary>
+        /// Handles a stack allocation.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitStackAllocation(StackAllocation.View entry);
+
+        /// <summary>
+        /// Handles a code branch.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitBranch(Branch.View entry);
+
+        /// <summary>
+        /// Handles an access to heap memory.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitHeapMemoryAccess(HeapMemoryAccess.View entry);
+
+        /// <summary>
+        /// Handles an access to image file memory.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitImageMemoryAccess(ImageMemoryAccess.View entry);
+
+        /// <summary>
+        /// Handles an access to stack memory.
+        /// </summary>
+        /// <param name="entry">Trace entry.</param>
+        public void VisitStackMemoryAccess(StackMemoryAccess.View entry);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+using System;
+using System.Collections.Generic;
+using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
+
+namespace Microwalk.FrameworkBase.TraceFormat
+{
+    /// <summary>
+    /// Tracks the call stack of a single trace during preprocessing and assigns interned call stack IDs to its branch entries.
+    /// </summary>
+    public class ShadowCallStack
+    {
+        private readonly CallStackTrie _callStacks;
+        private readonly Stack<int> _callStackIds = new();
+
+        /// <summary>
+        /// Creates a new shadow call stack, which starts at the root node of the given trie.
+        /// </summary>
+        /// <param name="callStacks">Call stack trie, shared between all traces.</param>
+        public ShadowCallStack(CallStackTrie callStacks)
+        {
+            _callStacks = callStacks;
+            _callStackIds.Push(CallStackTrie.RootId);
+        }
+
+        /// <summary>
+        /// Creates a new shadow call stack, which continues from a previously saved state, e.g., the call stack at the end of the trace prefix.
+        /// </summary>
+        /// <param name="callStacks">Call stack trie, shared between all traces.</param>
+        /// <param name="callStackIds">Saved call stack IDs, as returned by <see cref="GetCallStackIds"/>.</param>
+        public ShadowCallStack(CallStackTrie callStacks, IEnumerable<int> callStackIds)
+        {
+            _callStacks = callStacks;
+            foreach(int callStackId in callStackIds)
+                _callStackIds.Push(callStackId);
+        }
+
+        /// <summary>
+        /// Returns the IDs of the currently active call stacks, starting with the root node.
+        /// </summary>
+        public int[] GetCallStackIds()
+        {
+            int[] callStackIds = _callStackIds.ToArray();
+            Array.Reverse(callStackIds);
+            return callStackIds;
+        }
+
+        /// <summary>
+        /// Updates the call stack with the given branch entry and stores the resulting call stack ID in the entry.
+        /// Unbalanced returns leave the call stack at the root node.
+        /// </summary>
+        /// <param name="branch">The next branch entry of the trace.</param>
+        public void Update(Branch branch)
+        {
+            if(branch.BranchType == Branch.BranchTypes.Call && branch.Taken)
+            {
+                ulong sourceInstructionId = ((ulong)branch.SourceImageId << 32) | branch.SourceInstructionRelativeAddress;
+                ulong targetInstructionId = ((ulong)branch.DestinationImageId << 32) | branch.DestinationInstructionRelativeAddress;
+                _callStackIds.Push(_callStacks.GetOrAddChild(_callStackIds.Peek(), sourceInstructionId, targetInstructionId));
+            }
+            else if(branch.BranchType == Branch.BranchTypes.Return && _callStackIds.Count > 1)
+            {
+                _callStackIds.Pop();
+            }
+
+            branch.CallStackId = _callStackIds.Peek();
+        }
+    }
+}
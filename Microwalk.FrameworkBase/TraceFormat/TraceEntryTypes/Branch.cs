@@ -1,4 +1,6 @@
-﻿using Microwalk.FrameworkBase.Utilities;
+﻿using System;
+using System.Buffers.Binary;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
 {
@@ -8,7 +10,7 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
     public class Branch : ITraceEntry
     {
         public TraceEntryTypes EntryType => TraceEntryTypes.Branch;
-        public const int EntrySize = 1 + 4 + 4 + 4 + 4 + 1 + 1;
+        public const int EntrySize = 1 + 4 + 4 + 4 + 4 + 1 + 1 + 4;
 
         public void FromReader(IFastBinaryReader reader)
         {
@@ -18,6 +20,7 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
             DestinationInstructionRelativeAddress = reader.ReadUInt32();
             Taken = reader.ReadBoolean();
             BranchType = (BranchTypes)reader.ReadByte();
+            CallStackId = reader.ReadInt32();
         }
 
         public void Store(IFastBinaryWriter writer)
@@ -29,6 +32,7 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
             writer.WriteUInt32(DestinationInstructionRelativeAddress);
             writer.WriteBoolean(Taken);
             writer.WriteByte((byte)BranchType);
+            writer.WriteInt32(CallStackId);
         }
 
         /// <summary>
@@ -61,6 +65,12 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
         /// </summary>
         public BranchTypes BranchType { get; set; }
 
+        /// <summary>
+        /// The ID of the call stack after executing this branch, as interned in <see cref="TracePrefixFile.CallStacks"/>.
+        /// For calls this is the call stack of the callee, for returns the call stack of the caller.
+        /// </summary>
+        public int CallStackId { get; set; }
+
         /// <summary>
         /// The type of the branching instruction.
         /// </summary>
@@ -70,5 +80,43 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
             Call = 1,
             Return = 2
         }
+
+        /// <summary>
+        /// Allocation-free view of a serialized entry, which is passed to trace entry visitors.
+        /// </summary>
+        public readonly ref struct View
+        {
+            private readonly ReadOnlySpan<byte> _data;
+
+            /// <summary>
+            /// Creates a view of the given entry data, which begins after the entry type byte.
+            /// </summary>
+            /// <param name="data">Serialized entry data.</param>
+            public View(ReadOnlySpan<byte> data)
+            {
+                _data = data;
+            }
+
+            /// <inheritdoc cref="Branch.SourceImageId"/>
+            public int SourceImageId => BinaryPrimitives.ReadInt32LittleEndian(_data);
+
+            /// <inheritdoc cref="Branch.SourceInstructionRelativeAddress"/>
+            public uint SourceInstructionRelativeAddress => BinaryPrimitives.ReadUInt32LittleEndian(_data[4..]);
+
+            /// <inheritdoc cref="Branch.DestinationImageId"/>
+            public int DestinationImageId => BinaryPrimitives.ReadInt32LittleEndian(_data[8..]);
+
+            /// <inheritdoc cref="Branch.DestinationInstructionRelativeAddress"/>
+            public uint DestinationInstructionRelativeAddress => BinaryPrimitives.ReadUInt32LittleEndian(_data[12..]);
+
+            /// <inheritdoc cref="Branch.Taken"/>
+            public bool Taken => _data[16] != 0;
+
+            /// <inheritdoc cref="Branch.BranchType"/>
+            public BranchTypes BranchType => (BranchTypes)_data[17];
+
+            /// <inheritdoc cref="Branch.CallStackId"/>
+            public int CallStackId => BinaryPrimitives.ReadInt32LittleEndian(_data[18..]);
+        }
     }
 }
\ No newline at end of file
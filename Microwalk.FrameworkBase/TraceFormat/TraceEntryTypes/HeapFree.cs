@@ -1,4 +1,6 @@
-﻿using Microwalk.FrameworkBase.Utilities;
+﻿using System;
+using System.Buffers.Binary;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
 {
@@ -25,5 +27,25 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
         /// The ID of the freed allocation block.
         /// </summary>
         public int Id { get; set; }
+
+        /// <summary>
+        /// Allocation-free view of a serialized entry, which is passed to trace entry visitors.
+        /// </summary>
+        public readonly ref struct View
+        {
+            private readonly ReadOnlySpan<byte> _data;
+
+            /// <summary>
+            /// Creates a view of the given entry data, which begins after the entry type byte.
+            /// </summary>
+            /// <param name="data">Serialized entry data.</param>
+            public View(ReadOnlySpan<byte> data)
+            {
+                _data = data;
+            }
+
+            /// <inheritdoc cref="HeapFree.Id"/>
+            public int Id => BinaryPrimitives.ReadInt32LittleEndian(_data);
+        }
     }
 }
\ No newline at end of file
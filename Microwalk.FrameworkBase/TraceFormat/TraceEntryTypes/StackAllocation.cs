@@ -1,4 +1,6 @@
-﻿using Microwalk.FrameworkBase.Utilities;
+﻿using System;
+using System.Buffers.Binary;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
 {
@@ -53,5 +55,37 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
         /// The base address of the allocated memory.
         /// </summary>
         public ulong Address { get; set; }
+
+        /// <summary>
+        /// Allocation-free view of a serialized entry, which is passed to trace entry visitors.
+        /// </summary>
+        public readonly ref struct View
+        {
+            private readonly ReadOnlySpan<byte> _data;
+
+            /// <summary>
+            /// Creates a view of the given entry data, which begins after the entry type byte.
+            /// </summary>
+            /// <param name="data">Serialized entry data.</param>
+            public View(ReadOnlySpan<byte> data)
+            {
+                _data = data;
+            }
+
+            /// <inheritdoc cref="StackAllocation.Id"/>
+            public int Id => BinaryPrimitives.ReadInt32LittleEndian(_data);
+
+            /// <inheritdoc cref="StackAllocation.InstructionImageId"/>
+            public int InstructionImageId => BinaryPrimitives.ReadInt32LittleEndian(_data[4..]);
+
+            /// <inheritdoc cref="StackAllocation.InstructionRelativeAddress"/>
+            public uint InstructionRelativeAddress => BinaryPrimitives.ReadUInt32LittleEndian(_data[8..]);
+
+            /// <inheritdoc cref="StackAllocation.Size"/>
+            public uint Size => BinaryPrimitives.ReadUInt32LittleEndian(_data[12..]);
+
+            /// <inheritdoc cref="StackAllocation.Address"/>
+            public ulong Address => BinaryPrimitives.ReadUInt64LittleEndian(_data[16..]);
+        }
     }
 }
\ No newline at end of file
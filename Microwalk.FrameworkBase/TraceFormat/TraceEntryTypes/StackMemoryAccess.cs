@@ -1,4 +1,6 @@
-﻿using Microwalk.FrameworkBase.Utilities;
+﻿using System;
+using System.Buffers.Binary;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
 {
@@ -61,5 +63,40 @@ namespace Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes
         /// The address of the accessed memory, relative to the allocated block's start address.
         /// </summary>
         public uint MemoryRelativeAddress { get; set; }
+
+        /// <summary>
+        /// Allocation-free view of a serialized entry, which is passed to trace entry visitors.
+        /// </summary>
+        public readonly ref struct View
+        {
+            private readonly ReadOnlySpan<byte> _data;
+
+            /// <summary>
+            /// Creates a view of the given entry data, which begins after the entry type byte.
+            /// </summary>
+            /// <param name="data">Serialized entry data.</param>
+            public View(ReadOnlySpan<byte> data)
+            {
+                _data = data;
+            }
+
+            /// <inheritdoc cref="StackMemoryAccess.IsWrite"/>
+            public bool IsWrite => _data[0] != 0;
+
+            /// <inheritdoc cref="StackMemoryAccess.Size"/>
+            public short Size => BinaryPrimitives.ReadInt16LittleEndian(_data[1..]);
+
+            /// <inheritdoc cref="StackMemoryAccess.InstructionImageId"/>
+            public int InstructionImageId => BinaryPrimitives.ReadInt32LittleEndian(_data[3..]);
+
+            /// <inheritdoc cref="StackMemoryAccess.InstructionRelativeAddress"/>
+            public uint InstructionRelativeAddress => BinaryPrimitives.ReadUInt32LittleEndian(_data[7..]);
+
+            /// <inheritdoc cref="StackMemoryAccess.StackAllocationBlockId"/>
+            public int StackAllocationBlockId => BinaryPrimitives.ReadInt32LittleEndian(_data[11..]);
+
+            /// <inheritdoc cref="StackMemoryAccess.MemoryRelativeAddress"/>
+            public uint MemoryRelativeAddress => BinaryPrimitives.ReadUInt32LittleEndian(_data[15..]);
+        }
     }
 }
\ No newline at end of file
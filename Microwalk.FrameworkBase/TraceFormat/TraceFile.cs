@@ -1,7 +1,10 @@
 ﻿using System;
 using System.Collections;
 using System.Collections.Generic;
+using System.IO;
 using System.Linq;
+using System.Runtime.InteropServices;
+using System.Threading.Tasks;
 using Microwalk.FrameworkBase.Exceptions;
 using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
 using Microwalk.FrameworkBase.Utilities;
@@ -11,9 +14,23 @@ namespace Microwalk.FrameworkBase.TraceFormat
     /// <summary>
     /// Provides functions to read trace files.
     /// Iterating this trace file does not include the trace prefix!
+    ///
+    /// Trace data may be in the row format or in the columnar format (see <see cref="ColumnarTraceFormat"/>), which is detected automatically.
+    /// Columnar trace files which are read lazily are memory-mapped while they are being read.
     /// </summary>
-    public class TraceFile : IEnumerable<ITraceEntry>
+    public class TraceFile : IEnumerable<ITraceEntry>, IDisposable
     {
+        /// <summary>
+        /// Size of the chunks in which lazily read trace files are passed to visitors.
+        /// </summary>
+        private const int _visitChunkSize = 1 * 1024 * 1024;
+
+        /// <summary>
+        /// Version of the row format. Row-format traces do not have a header, so stored preprocessed traces are tagged with this version through
+        /// their call stack file (see <see cref="Stages.PreprocessorStage"/>). This must be incremented whenever the encoding of a trace entry changes.
+        /// </summary>
+        public const ushort RowFormatVersion = 2;
+
         /// <summary>
         /// The associated trace prefix.
         /// </summary>
@@ -25,21 +42,33 @@ namespace Microwalk.FrameworkBase.TraceFormat
         /// </summary>
         protected Memory<byte>? Buffer { get; init; }
 
+        /// <summary>
+        /// Owner of the trace data buffer, which is disposed together with this trace file. May be null.
+        /// </summary>
+        private readonly IDisposable? _bufferOwner;
+
         /// <summary>
         /// Path of the trace file, which should be read lazily.
         /// </summary>
         private readonly string? _path;
 
+        /// <summary>
+        /// Caches whether the lazily read trace file is in the columnar format. Null, if not yet determined.
+        /// </summary>
+        private bool? _isColumnarFile;
+
         /// <summary>
         /// Initializes a new trace file from the given byte buffer, using a previously initialized prefix.
         /// </summary>
         /// <param name="prefix">The previously loaded prefix file.</param>
         /// <param name="buffer">Buffer containing the trace data.</param>
-        public TraceFile(TracePrefixFile prefix, Memory<byte> buffer)
+        /// <param name="bufferOwner">Optional owner of the buffer (e.g., a <see cref="MappedFileMemory"/>), which is disposed together with this trace file.</param>
+        public TraceFile(TracePrefixFile prefix, Memory<byte> buffer, IDisposable? bufferOwner = null)
             : this()
         {
             Prefix = prefix;
             Buffer = buffer;
+            _bufferOwner = bufferOwner;
         }
 
         /// <summary>
@@ -62,57 +91,226 @@ namespace Microwalk.FrameworkBase.TraceFormat
         {
         }
 
+        /// <summary>
+        /// Returns the number of trace data bytes which are held in a buffer on the managed heap.
+        /// This is 0 for traces which are read from a file or from a memory-mapped buffer.
+        /// </summary>
+        public long ManagedBufferSize => Buffer != null && MemoryMarshal.TryGetArray<byte>(Buffer.Value, out _) ? Buffer.Value.Length : 0;
+
+        /// <summary>
+        /// Releases the trace data buffer, if it is owned by this trace file. The trace file must not be used afterwards.
+        /// </summary>
+        public void Dispose()
+        {
+            _bufferOwner?.Dispose();
+        }
+
+        /// <summary>
+        /// Writes the in-memory trace data to the given file and returns a trace file object which reads the data lazily from there.
+        /// This allows releasing the trace data buffer.
+        /// </summary>
+        /// <param name="path">Path of the output file.</param>
+        public async Task<TraceFile> SpillAsync(string path)
+        {
+            if(Buffer == null)
+                throw new InvalidOperationException("The trace is not held in memory.");
+
+            await using(var fileStream = File.Open(path, FileMode.Create, FileAccess.Write, FileShare.None))
+                await fileStream.WriteAsync(Buffer.Value);
+
+            return new TraceFile(Prefix!, path);
+        }
+
         /// <summary>
         /// Returns all trace entries, including the trace prefix.
         /// </summary>
         /// <returns></returns>
         public IEnumerable<ITraceEntry> GetEntriesWithPrefix() => Prefix == null ? this : Prefix.Concat(this);
 
-        public IEnumerator<ITraceEntry> GetEnumerator()
+        public IEnumerator<ITraceEntry> GetEnumerator() => CreateEnumerator(false);
+
+        IEnumerator IEnumerable.GetEnumerator() => CreateEnumerator(false);
+
+        public IEnumerator<ITraceEntry> GetNonAllocatingEnumerator() => CreateEnumerator(true);
+
+        public IEnumerator<ITraceEntry> GetNonAllocatingEnumeratorWithPrefix()
         {
-            if(Buffer == null)
-                return new TraceFileEnumerator(new FastBinaryFileReader(_path!));
-            else
-                return new TraceFileEnumerator(new FastBinaryBufferReader(Buffer.Value));
+            if(Prefix == null)
+                return GetNonAllocatingEnumerator();
+
+            return new ConcatEnumerator<ITraceEntry>
+            (
+                new NonAllocatingTraceFileEnumerator(new FastBinaryBufferReader(Prefix.Buffer!.Value)),
+                CreateEnumerator(true)
+            );
         }
 
-        IEnumerator IEnumerable.GetEnumerator()
+        /// <summary>
+        /// Passes all trace entries to the given visitor, without allocating objects for them.
+        /// This does not include the trace prefix.
+        /// </summary>
+        /// <param name="visitor">Trace entry visitor.</param>
+        public void Visit<TVisitor>(ref TVisitor visitor)
+            where TVisitor : struct, ITraceEntryVisitor
         {
             if(Buffer == null)
-                return new TraceFileEnumerator(new FastBinaryFileReader(_path!));
-            else
-                return new TraceFileEnumerator(new FastBinaryBufferReader(Buffer.Value));
+            {
+                if(IsColumnarFile())
+                {
+                    using var mappedFile = MapColumnarFile();
+                    ColumnarTraceFormat.VisitEntries(mappedFile.Memory.Span, ref visitor);
+                }
+                else
+                    VisitFile(_path!, ref visitor);
+            }
+            else if(ColumnarTraceFormat.IsColumnar(Buffer.Value.Span))
+                ColumnarTraceFormat.VisitEntries(Buffer.Value.Span, ref visitor);
+            else if(VisitEntries(Buffer.Value.Span, ref visitor) != Buffer.Value.Length)
+                throw new TraceFormatException("Incomplete trace entry at end of trace.");
+        }
+
+        /// <summary>
+        /// Passes all trace entries, including the trace prefix, to the given visitor, without allocating objects for them.
+        /// </summary>
+        /// <param name="visitor">Trace entry visitor.</param>
+        public void VisitWithPrefix<TVisitor>(ref TVisitor visitor)
+            where TVisitor : struct, ITraceEntryVisitor
+        {
+            Prefix?.Visit(ref visitor);
+            Visit(ref visitor);
         }
 
-        public IEnumerator<ITraceEntry> GetNonAllocatingEnumerator()
+        /// <summary>
+        /// Creates an enumerator for the trace entries, depending on the storage and format of the trace data.
+        /// </summary>
+        /// <param name="reuseEntries">Determines whether the trace entry objects are reused, i.e., whether a non-allocating enumerator is created.</param>
+        private IEnumerator<ITraceEntry> CreateEnumerator(bool reuseEntries)
         {
             if(Buffer == null)
-                return new NonAllocatingTraceFileEnumerator(new FastBinaryFileReader(_path!));
-            else
-                return new NonAllocatingTraceFileEnumerator(new FastBinaryBufferReader(Buffer.Value));
+            {
+                if(IsColumnarFile())
+                {
+                    var mappedFile = MapColumnarFile();
+                    return new ColumnarTraceFileEnumerator(mappedFile.Memory, reuseEntries, mappedFile);
+                }
+
+                var fileReader = new FastBinaryFileReader(_path!);
+                return reuseEntries ? new NonAllocatingTraceFileEnumerator(fileReader) : new TraceFileEnumerator(fileReader);
+            }
+
+            if(ColumnarTraceFormat.IsColumnar(Buffer.Value.Span))
+                return new ColumnarTraceFileEnumerator(Buffer.Value, reuseEntries);
+
+            var bufferReader = new FastBinaryBufferReader(Buffer.Value);
+            return reuseEntries ? new NonAllocatingTraceFileEnumerator(bufferReader) : new TraceFileEnumerator(bufferReader);
         }
 
-        public IEnumerator<ITraceEntry> GetNonAllocatingEnumeratorWithPrefix()
+        /// <summary>
+        /// Checks whether the lazily read trace file is in the columnar format.
+        /// </summary>
+        private bool IsColumnarFile()
         {
-            if(Prefix == null)
-                return GetNonAllocatingEnumerator();
+            _isColumnarFile ??= ColumnarTraceFormat.IsColumnarFile(_path!);
+            return _isColumnarFile.Value;
+        }
 
-            if(Buffer == null)
+        /// <summary>
+        /// Maps the lazily read columnar trace file into memory.
+        /// Columnar traces are always accessed as a single buffer, so they are limited to the size supported by <see cref="MappedFileMemory"/>.
+        /// </summary>
+        private MappedFileMemory MapColumnarFile()
+        {
+            if(!MappedFileMemory.CanMap(_path!))
+                throw new TraceFormatException($"Columnar trace file \"{_path}\" is too large for being read. Use the row format for traces of this size.");
+            return new MappedFileMemory(_path!);
+        }
+
+        /// <summary>
+        /// Passes the complete row-format trace entries contained in the given buffer to the given visitor.
+        /// </summary>
+        /// <param name="data">Buffer containing serialized trace entries.</param>
+        /// <param name="visitor">Trace entry visitor.</param>
+        /// <returns>The number of consumed bytes. Any remaining bytes belong to an incomplete trace entry.</returns>
+        public static int VisitEntries<TVisitor>(ReadOnlySpan<byte> data, ref TVisitor visitor)
+            where TVisitor : struct, ITraceEntryVisitor
+        {
+            int position = 0;
+            while(position < data.Length)
             {
-                return new ConcatEnumerator<ITraceEntry>
-                (
-                    new NonAllocatingTraceFileEnumerator(new FastBinaryBufferReader(Prefix.Buffer!.Value)),
-                    new NonAllocatingTraceFileEnumerator(new FastBinaryFileReader(_path!))
-                );
+                var entryType = (TraceEntryTypes.TraceEntryTypes)data[position];
+                int entrySize = entryType switch
+                {
+                    TraceEntryTypes.TraceEntryTypes.HeapAllocation => HeapAllocation.EntrySize,
+                    TraceEntryTypes.TraceEntryTypes.HeapFree => HeapFree.EntrySize,
+                    TraceEntryTypes.TraceEntryTypes.StackAllocation => StackAllocation.EntrySize,
+                    TraceEntryTypes.TraceEntryTypes.Branch => Branch.EntrySize,
+                    TraceEntryTypes.TraceEntryTypes.HeapMemoryAccess => HeapMemoryAccess.EntrySize,
+                    TraceEntryTypes.TraceEntryTypes.ImageMemoryAccess => ImageMemoryAccess.EntrySize,
+                    TraceEntryTypes.TraceEntryTypes.StackMemoryAccess => StackMemoryAccess.EntrySize,
+                    _ => throw new TraceFormatException("Illegal trace entry type.")
+                };
+                if(data.Length - position < entrySize)
+                    break;
+
+                // Skip type byte
+                var entryData = data.Slice(position + 1, entrySize - 1);
+                switch(entryType)
+                {
+                    case TraceEntryTypes.TraceEntryTypes.HeapAllocation:
+                        visitor.VisitHeapAllocation(new HeapAllocation.View(entryData));
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.HeapFree:
+                        visitor.VisitHeapFree(new HeapFree.View(entryData));
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.StackAllocation:
+                        visitor.VisitStackAllocation(new StackAllocation.View(entryData));
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.Branch:
+                        visitor.VisitBranch(new Branch.View(entryData));
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.HeapMemoryAccess:
+                        visitor.VisitHeapMemoryAccess(new HeapMemoryAccess.View(entryData));
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.ImageMemoryAccess:
+                        visitor.VisitImageMemoryAccess(new ImageMemoryAccess.View(entryData));
+                        break;
+                    case TraceEntryTypes.TraceEntryTypes.StackMemoryAccess:
+                        visitor.VisitStackMemoryAccess(new StackMemoryAccess.View(entryData));
+                        break;
+                }
+
+                position += entrySize;
             }
-            else
+
+            return position;
+        }
+
+        /// <summary>
+        /// Reads the given trace file in chunks and passes its entries to the given visitor.
+        /// </summary>
+        /// <param name="path">Path to the trace file.</param>
+        /// <param name="visitor">Trace entry visitor.</param>
+        private static void VisitFile<TVisitor>(string path, ref TVisitor visitor)
+            where TVisitor : struct, ITraceEntryVisitor
+        {
+            using var fileStream = File.Open(path, FileMode.Open, FileAccess.Read, FileShare.Read);
+            byte[] chunk = new byte[_visitChunkSize];
+            int chunkLength = 0;
+            while(true)
             {
-                return new ConcatEnumerator<ITraceEntry>
-                (
-                    new NonAllocatingTraceFileEnumerator(new FastBinaryBufferReader(Prefix.Buffer!.Value)),
-                    new NonAllocatingTraceFileEnumerator(new FastBinaryBufferReader(Buffer.Value))
-                );
+                int bytesRead = fileStream.Read(chunk, chunkLength, chunk.Length - chunkLength);
+                if(bytesRead == 0)
+                    break;
+                chunkLength += bytesRead;
+
+                // Keep incomplete entry at the end of the chunk for the next iteration
+                int consumed = VisitEntries(chunk.AsSpan(0, chunkLength), ref visitor);
+                chunk.AsSpan(consumed, chunkLength - consumed).CopyTo(chunk);
+                chunkLength -= consumed;
             }
+
+            if(chunkLength > 0)
+                throw new TraceFormatException("Incomplete trace entry at end of trace.");
         }
     }
 
@@ -15,6 +15,11 @@ namespace Microwalk.FrameworkBase.TraceFormat
         /// </summary>
         public Dictionary<int, ImageFileInfo> ImageFiles { get; }
 
+        /// <summary>
+        /// The call stacks referenced by the branch entries of the traces belonging to this prefix.
+        /// </summary>
+        public CallStackTrie CallStacks { get; init; } = new();
+
         /// <summary>
         /// Loads a trace prefix file from the given byte buffer.
         /// </summary>
@@ -32,7 +37,7 @@ namespace Microwalk.FrameworkBase.TraceFormat
             }
 
             // Set internal buffer
-            Buffer = buffer.Slice(reader.Position);
+            Buffer = buffer.Slice((int)reader.Position);
         }
 
         /// <summary>
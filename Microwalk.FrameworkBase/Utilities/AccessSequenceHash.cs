@@ -0,0 +1,150 @@
+﻿using System.Numerics;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace Microwalk.FrameworkBase.Utilities
+{
+    /// <summary>
+    /// Incrementally computes the 64-bit xxHash of a sequence of 64-bit values, e.g., the memory addresses accessed by a single instruction.
+    /// The result is identical to hashing the concatenated little-endian representation of all values at once.
+    ///
+    /// Values are buffered until a full 32-byte stripe of four values is available, which is then mixed into the four independent lane accumulators
+    /// of xxHash64. Compared to re-hashing the previous hash and the new value for every access, this needs only one multiply-rotate round per
+    /// value, and the four rounds of a stripe do not depend on each other, so they can execute in parallel.
+    ///
+    /// The default value represents an empty sequence, so instances can be created in place, e.g. through
+    /// <see cref="System.Runtime.InteropServices.CollectionsMarshal.GetValueRefOrAddDefault{TKey,TValue}"/>.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct AccessSequenceHash
+    {
+        private const ulong _prime1 = 0x9E3779B185EBCA87UL;
+        private const ulong _prime2 = 0xC2B2AE3D27D4EB4FUL;
+        private const ulong _prime3 = 0x165667B19E3779F9UL;
+        private const ulong _prime4 = 0x85EBCA77C2B2AE63UL;
+        private const ulong _prime5 = 0x27D4EB2F165667C5UL;
+
+        private ulong _accumulator1;
+        private ulong _accumulator2;
+        private ulong _accumulator3;
+        private ulong _accumulator4;
+
+        /// <summary>
+        /// Values of the current incomplete stripe. These fields must stay adjacent, as they are indexed by <see cref="Add"/>.
+        /// </summary>
+        private ulong _pending1;
+
+        private ulong _pending2;
+        private ulong _pending3;
+
+        /// <summary>
+        /// Number of values in the sequence.
+        /// </summary>
+        public long Count { get; private set; }
+
+        /// <summary>
+        /// The value which was added last, or 0 if the sequence is empty.
+        /// </summary>
+        public ulong LastValue { get; private set; }
+
+        /// <summary>
+        /// Appends the given value to the sequence.
+        /// </summary>
+        /// <param name="value">Value.</param>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public void Add(ulong value)
+        {
+            // Buffer the value without branching on its position, unless it completes a stripe
+            int stripeIndex = (int)Count & 3;
+            if(stripeIndex == 3)
+                ProcessStripe(value);
+            else
+                Unsafe.Add(ref _pending1, stripeIndex) = value;
+
+            ++Count;
+            LastValue = value;
+        }
+
+        /// <summary>
+        /// Returns the hash of the current sequence. The sequence may be extended afterwards.
+        /// </summary>
+        public readonly ulong GetHash()
+        {
+            ulong hash;
+            if(Count >= 4)
+            {
+                hash = BitOperations.RotateLeft(_accumulator1, 1) + BitOperations.RotateLeft(_accumulator2, 7)
+                                                                 + BitOperations.RotateLeft(_accumulator3, 12) + BitOperations.RotateLeft(_accumulator4, 18);
+                hash = MergeAccumulator(hash, _accumulator1);
+                hash = MergeAccumulator(hash, _accumulator2);
+                hash = MergeAccumulator(hash, _accumulator3);
+                hash = MergeAccumulator(hash, _accumulator4);
+            }
+            else
+            {
+                hash = _prime5;
+            }
+
+            hash += (ulong)Count * 8;
+
+            // Mix remaining values of the incomplete stripe
+            int remaining = (int)(Count & 3);
+            if(remaining >= 1)
+                hash = MixTail(hash, _pending1);
+            if(remaining >= 2)
+                hash = MixTail(hash, _pending2);
+            if(remaining >= 3)
+                hash = MixTail(hash, _pending3);
+
+            // Avalanche
+            hash ^= hash >> 33;
+            hash *= _prime2;
+            hash ^= hash >> 29;
+            hash *= _prime3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+        /// <summary>
+        /// Mixes the buffered values and the given value into the lane accumulators.
+        /// </summary>
+        private void ProcessStripe(ulong value4)
+        {
+            // The accumulators are only initialized once they are needed, so the default value is a valid empty state
+            if(Count == 3)
+            {
+                _accumulator1 = unchecked(_prime1 + _prime2);
+                _accumulator2 = _prime2;
+                _accumulator3 = 0;
+                _accumulator4 = unchecked(0 - _prime1);
+            }
+
+            _accumulator1 = Round(_accumulator1, _pending1);
+            _accumulator2 = Round(_accumulator2, _pending2);
+            _accumulator3 = Round(_accumulator3, _pending3);
+            _accumulator4 = Round(_accumulator4, value4);
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static ulong Round(ulong accumulator, ulong value)
+        {
+            accumulator += value * _prime2;
+            accumulator = BitOperations.RotateLeft(accumulator, 31);
+            return accumulator * _prime1;
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static ulong MergeAccumulator(ulong hash, ulong accumulator)
+        {
+            hash ^= Round(0, accumulator);
+            return hash * _prime1 + _prime4;
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static ulong MixTail(ulong hash, ulong value)
+        {
+            hash ^= Round(0, value);
+            return BitOperations.RotateLeft(hash, 27) * _prime1 + _prime4;
+        }
+    }
+}
\ No newline at end of file
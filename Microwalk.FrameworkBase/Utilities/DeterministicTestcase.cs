@@ -0,0 +1,62 @@
+﻿using System;
+using System.Buffers.Binary;
+
+namespace Microwalk.FrameworkBase.Utilities
+{
+    /// <summary>
+    /// Describes a pseudo-random testcase which can be reproduced from a seed and an index.
+    ///
+    /// The testcase bytes are generated in counter mode: The i-th 8-byte block of testcase n is the SplitMix64 output function applied to
+    /// <c>seed + n * 0xD1B54A32D192ED03 + (i + 1) * 0x9E3779B97F4A7C15</c>, stored in little endian byte order.
+    /// The same algorithm is implemented in the Pin tracer wrapper, so the wrapper can generate testcases itself instead of loading them from files.
+    /// Note: The generator is not cryptographically secure.
+    /// </summary>
+    public class DeterministicTestcase
+    {
+        /// <summary>
+        /// The seed of the testcase series.
+        /// </summary>
+        public ulong Seed { get; init; }
+
+        /// <summary>
+        /// The index of the testcase in its series.
+        /// </summary>
+        public ulong Index { get; init; }
+
+        /// <summary>
+        /// The testcase length in bytes.
+        /// </summary>
+        public int Length { get; init; }
+
+        /// <summary>
+        /// Generates the bytes of the given testcase.
+        /// </summary>
+        /// <param name="seed">The seed of the testcase series.</param>
+        /// <param name="index">The index of the testcase in its series.</param>
+        /// <param name="output">Output buffer, which is filled entirely.</param>
+        public static void Generate(ulong seed, ulong index, Span<byte> output)
+        {
+            Span<byte> block = stackalloc byte[8];
+            ulong counterBase = unchecked(seed + index * 0xD1B54A32D192ED03);
+            for(int i = 0; i < output.Length; i += 8)
+            {
+                ulong value = Mix(unchecked(counterBase + (ulong)(i / 8 + 1) * 0x9E3779B97F4A7C15));
+                BinaryPrimitives.WriteUInt64LittleEndian(block, value);
+                block[..Math.Min(8, output.Length - i)].CopyTo(output[i..]);
+            }
+        }
+
+        /// <summary>
+        /// SplitMix64 output function.
+        /// </summary>
+        private static ulong Mix(ulong z)
+        {
+            unchecked
+            {
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+                return z ^ (z >> 31);
+            }
+        }
+    }
+}
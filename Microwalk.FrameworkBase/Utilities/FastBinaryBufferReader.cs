@@ -12,12 +12,21 @@ namespace Microwalk.FrameworkBase.Utilities
         /// <summary>
         /// Returns or sets the current read position.
         /// </summary>
-        public int Position { get; set; }
+        public long Position
+        {
+            get => _position;
+            set => _position = (int)value;
+        }
 
         /// <summary>
         /// Total length of the binary data.
         /// </summary>
-        public int Length => Buffer.Length;
+        public long Length => Buffer.Length;
+
+        /// <summary>
+        /// Current read position. Buffers are always smaller than 2 GB, so we use a 32-bit index internally.
+        /// </summary>
+        private int _position;
 
         /// <summary>
         /// The byte buffer this object reads from.
@@ -40,7 +49,7 @@ namespace Microwalk.FrameworkBase.Utilities
         public byte ReadByte()
         {
             // Read and increase position
-            return Buffer.Span[Position++];
+            return Buffer.Span[_position++];
         }
 
         /// <summary>
@@ -50,7 +59,7 @@ namespace Microwalk.FrameworkBase.Utilities
         public bool ReadBoolean()
         {
             // Read and increase position
-            return Buffer.Span[Position++] != 0;
+            return Buffer.Span[_position++] != 0;
         }
 
         /// <summary>
@@ -61,9 +70,9 @@ namespace Microwalk.FrameworkBase.Utilities
         {
             // Read and increase position
             string str;
-            fixed(byte* buf = &Buffer.Span[Position])
+            fixed(byte* buf = &Buffer.Span[_position])
                 str = new string((sbyte*)buf, 0, length, Encoding.ASCII);
-            Position += length;
+            _position += length;
             return str;
         }
 
@@ -75,12 +84,12 @@ namespace Microwalk.FrameworkBase.Utilities
         {
             // Read and increase position
             short val;
-            fixed(byte* buf = &Buffer.Span[Position])
-                if((Position & 0b1) == 0) // If the alignment is right, direct conversion is possible
+            fixed(byte* buf = &Buffer.Span[_position])
+                if((_position & 0b1) == 0) // If the alignment is right, direct conversion is possible
                     val = *((short*)buf);
                 else
                     val = (short)((*buf) | (*(buf + 1) << 8)); // Little Endian
-            Position += 2;
+            _position += 2;
             return val;
         }
 
@@ -92,12 +101,12 @@ namespace Microwalk.FrameworkBase.Utilities
         {
             // Read and increase position
             int val;
-            fixed(byte* buf = &Buffer.Span[Position])
-                if((Position & 0b11) == 0) // If the alignment is right, direct conversion is possible
+            fixed(byte* buf = &Buffer.Span[_position])
+                if((_position & 0b11) == 0) // If the alignment is right, direct conversion is possible
                     val = *((int*)buf);
                 else
                     val = (*buf) | (*(buf + 1) << 8) | (*(buf + 2) << 16) | (*(buf + 3) << 24); // Little Endian
-            Position += 4;
+            _position += 4;
             return val;
         }
 
@@ -119,8 +128,8 @@ namespace Microwalk.FrameworkBase.Utilities
         {
             // Read and increase position
             long val;
-            fixed(byte* buf = &Buffer.Span[Position])
-                if((Position & 0b111) == 0) // If the alignment is right, direct conversion is possible
+            fixed(byte* buf = &Buffer.Span[_position])
+                if((_position & 0b111) == 0) // If the alignment is right, direct conversion is possible
                     val = *((long*)buf);
                 else
                 {
@@ -130,7 +139,7 @@ namespace Microwalk.FrameworkBase.Utilities
                     val = (uint)i1 | ((long)i2 << 32);
                 }
 
-            Position += 8;
+            _position += 8;
             return val;
         }
 
@@ -16,17 +16,17 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
     /// <summary>
     /// Returns or sets the current read position.
     /// </summary>
-    public int Position { get; set; }
+    public long Position { get; set; }
 
     /// <summary>
     /// Total length of the binary data.
     /// </summary>
-    public int Length { get; }
+    public long Length { get; }
 
     /// <summary>
     /// File position of the first byte in the chunk buffer.
     /// </summary>
-    private int _chunkPosition;
+    private long _chunkPosition;
 
     /// <summary>
     /// Byte buffer holding the current chunk.
@@ -48,7 +48,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         _fileStream = File.Open(filename, FileMode.Open, FileAccess.Read, FileShare.Read);
         Position = 0;
         _chunkPosition = 0;
-        Length = (int)_fileStream.Length;
+        Length = _fileStream.Length;
 
         // Load first chunk
         ReadFullChunkFromStream(_chunk);
@@ -83,7 +83,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
             return;
 
         // Read data, so the new chunk begins at the current position
-        int nextChunkPosition = _chunkPosition + _chunkSize;
+        long nextChunkPosition = _chunkPosition + _chunkSize;
         if(nextChunkPosition == Position)
         {
             // Sequential next chunk, no leftover
@@ -94,7 +94,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         {
             // Sequential next chunk, but there is some leftover from the current one
 
-            int leftover = nextChunkPosition - Position;
+            int leftover = (int)(nextChunkPosition - Position);
             var chunkSpan = _chunk.AsSpan();
 
             // Copy leftover bytes to beginning
@@ -123,7 +123,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         EnsureAvailable(1);
 
         // Read and increase position
-        int chunkPos = (Position++) - _chunkPosition;
+        int chunkPos = (int)(Position++ - _chunkPosition);
         return _chunk[chunkPos];
     }
 
@@ -136,7 +136,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         EnsureAvailable(1);
 
         // Read and increase position
-        int chunkPos = (Position++) - _chunkPosition;
+        int chunkPos = (int)(Position++ - _chunkPosition);
         return _chunk[chunkPos] != 0;
     }
 
@@ -149,7 +149,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         EnsureAvailable(length);
 
         // Read and increase position
-        int chunkPos = Position - _chunkPosition;
+        int chunkPos = (int)(Position - _chunkPosition);
         string str;
         fixed(byte* buf = &_chunk[chunkPos])
             str = new string((sbyte*)buf, 0, length, Encoding.ASCII);
@@ -166,7 +166,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         EnsureAvailable(2);
 
         // Read and increase position
-        int chunkPos = Position - _chunkPosition;
+        int chunkPos = (int)(Position - _chunkPosition);
         short val;
         fixed(byte* buf = &_chunk[chunkPos])
             if((chunkPos & 0b1) == 0) // If the alignment is right, direct conversion is possible
@@ -186,7 +186,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         EnsureAvailable(4);
 
         // Read and increase position
-        int chunkPos = Position - _chunkPosition;
+        int chunkPos = (int)(Position - _chunkPosition);
         int val;
         fixed(byte* buf = &_chunk[chunkPos])
             if((chunkPos & 0b11) == 0) // If the alignment is right, direct conversion is possible
@@ -216,7 +216,7 @@ public class FastBinaryFileReader : IFastBinaryReader, IDisposable
         EnsureAvailable(8);
 
         // Read and increase position
-        int chunkPos = Position - _chunkPosition;
+        int chunkPos = (int)(Position - _chunkPosition);
         long val;
         fixed(byte* buf = &_chunk[chunkPos])
             if((chunkPos & 0b111) == 0) // If the alignment is right, direct conversion is possible
@@ -7,12 +7,12 @@ public interface IFastBinaryReader
     /// <summary>
     /// Returns or sets the current read position.
     /// </summary>
-    int Position { get; set; }
+    long Position { get; set; }
     
     /// <summary>
     /// Total length of the binary data.
     /// </summary>
-    int Length { get; }
+    long Length { get; }
 
     /// <summary>
     /// Reads a byte from the buffer.
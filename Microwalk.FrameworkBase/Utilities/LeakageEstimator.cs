@@ -0,0 +1,115 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Microwalk.FrameworkBase.Stages;
+
+namespace Microwalk.FrameworkBase.Utilities
+{
+    /// <summary>
+    /// Keeps track of the distinct trace hashes of each location (e.g., an instruction) while testcases are analyzed, and computes running
+    /// <see cref="LeakageEstimate"/> objects from them.
+    ///
+    /// The mutual information of a location with n testcases and hash counts c_i equals log2(n) - (sum_i c_i * log2(c_i)) / n, so only the sum
+    /// needs to be updated when a hash is added, and an estimate can be computed without iterating the hashes.
+    ///
+    /// This class is thread-safe.
+    /// </summary>
+    /// <typeparam name="TLocation">Location identifier type.</typeparam>
+    public class LeakageEstimator<TLocation> where TLocation : notnull
+    {
+        private readonly ConcurrentDictionary<TLocation, LocationData> _locations = new();
+
+        private int _testcaseCount;
+
+        /// <summary>
+        /// Records the trace hash of a location in the current testcase.
+        /// </summary>
+        /// <param name="location">Location.</param>
+        /// <param name="hash">Hash of the trace of the location.</param>
+        public void Add(TLocation location, UInt128 hash)
+        {
+            _locations.GetOrAdd(location, _ => new LocationData()).Add(hash);
+        }
+
+        /// <summary>
+        /// Marks that all hashes of a testcase were recorded.
+        /// </summary>
+        public void CompleteTestcase()
+        {
+            Interlocked.Increment(ref _testcaseCount);
+        }
+
+        /// <summary>
+        /// Computes an estimate from the hashes recorded so far. May be called concurrently to <see cref="Add"/>.
+        /// </summary>
+        public LeakageEstimate GetEstimate()
+        {
+            int leakingLocationCount = 0;
+            double maximumMutualInformation = 0.0;
+            double mutualInformationSum = 0.0;
+            double maximumMinEntropy = 0.0;
+            foreach(var location in _locations.Values)
+            {
+                var (mutualInformation, minEntropy) = location.GetMeasures();
+                if(minEntropy == 0)
+                    continue;
+
+                ++leakingLocationCount;
+                mutualInformationSum += mutualInformation;
+                maximumMutualInformation = Math.Max(maximumMutualInformation, mutualInformation);
+                maximumMinEntropy = Math.Max(maximumMinEntropy, minEntropy);
+            }
+
+            return new LeakageEstimate(Volatile.Read(ref _testcaseCount),
+                leakingLocationCount,
+                maximumMutualInformation,
+                leakingLocationCount == 0 ? 0.0 : mutualInformationSum / leakingLocationCount,
+                maximumMinEntropy);
+        }
+
+        /// <summary>
+        /// Returns the increase of sum_i c_i * log2(c_i) when the count of a hash is incremented to the given value.
+        /// </summary>
+        /// <param name="newCount">Hash count after incrementing.</param>
+        private static double GetCountEntropyIncrement(int newCount)
+        {
+            return newCount == 1 ? 0.0 : newCount * Math.Log2(newCount) - (newCount - 1) * Math.Log2(newCount - 1);
+        }
+
+        /// <summary>
+        /// Hash counts of a single location.
+        /// </summary>
+        private class LocationData
+        {
+            private readonly Dictionary<UInt128, int> _hashCounts = new();
+            private int _testcaseCount;
+            private double _countEntropySum;
+
+            public void Add(UInt128 hash)
+            {
+                lock(_hashCounts)
+                {
+                    ref int count = ref CollectionsMarshal.GetValueRefOrAddDefault(_hashCounts, hash, out _);
+                    ++count;
+                    ++_testcaseCount;
+                    _countEntropySum += GetCountEntropyIncrement(count);
+                }
+            }
+
+            public (double mutualInformation, double minEntropy) GetMeasures()
+            {
+                lock(_hashCounts)
+                {
+                    if(_testcaseCount == 0)
+                        return (0.0, 0.0);
+
+                    // Clamp small negative values caused by rounding errors in the running sum
+                    double mutualInformation = Math.Max(0.0, Math.Log2(_testcaseCount) - _countEntropySum / _testcaseCount);
+                    return (mutualInformation, Math.Log2(_hashCounts.Count));
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
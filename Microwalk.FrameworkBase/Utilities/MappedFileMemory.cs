@@ -0,0 +1,84 @@
+﻿using System;
+using System.Buffers;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+
+namespace Microwalk.FrameworkBase.Utilities
+{
+    /// <summary>
+    /// Exposes a read-only memory-mapped file as <see cref="Memory{T}"/>, so it can be used like a buffer which was loaded into memory.
+    /// The file contents are paged in by the operating system on demand and do not count towards the managed heap.
+    ///
+    /// The mapping is released when this object is disposed; the returned memory must not be used afterwards.
+    /// Writing to the memory is not supported.
+    /// </summary>
+    public sealed unsafe class MappedFileMemory : MemoryManager<byte>
+    {
+        private readonly MemoryMappedFile? _file;
+        private readonly MemoryMappedViewAccessor? _view;
+        private readonly byte* _pointer;
+        private readonly int _length;
+        private bool _disposed;
+
+        /// <summary>
+        /// Maps the given file into memory.
+        /// </summary>
+        /// <param name="path">File path.</param>
+        /// <exception cref="NotSupportedException">The file is too large to be represented by <see cref="Memory{T}"/>.</exception>
+        public MappedFileMemory(string path)
+        {
+            long length = new FileInfo(path).Length;
+            if(length > int.MaxValue)
+                throw new NotSupportedException($"File \"{path}\" is too large for being mapped as a single buffer.");
+            _length = (int)length;
+
+            // Empty files cannot be mapped
+            if(_length == 0)
+                return;
+
+            _file = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+            _view = _file.CreateViewAccessor(0, _length, MemoryMappedFileAccess.Read);
+            _view.SafeMemoryMappedViewHandle.AcquirePointer(ref _pointer);
+            _pointer += _view.PointerOffset;
+        }
+
+        /// <summary>
+        /// Checks whether the given file can be mapped by this class.
+        /// </summary>
+        /// <param name="path">File path.</param>
+        public static bool CanMap(string path) => new FileInfo(path).Length <= int.MaxValue;
+
+        public override Span<byte> GetSpan()
+        {
+            ObjectDisposedException.ThrowIf(_disposed, this);
+            return _length == 0 ? Span<byte>.Empty : new Span<byte>(_pointer, _length);
+        }
+
+        public override MemoryHandle Pin(int elementIndex = 0)
+        {
+            ObjectDisposedException.ThrowIf(_disposed, this);
+            if((uint)elementIndex > (uint)_length)
+                throw new ArgumentOutOfRangeException(nameof(elementIndex));
+
+            // The mapping does not move, so there is nothing to pin
+            return new MemoryHandle(_pointer + elementIndex);
+        }
+
+        public override void Unpin()
+        {
+            // Nothing to do here
+        }
+
+        protected override void Dispose(bool disposing)
+        {
+            if(_disposed)
+                return;
+            _disposed = true;
+
+            // The view handle is reference counted; it is only unmapped after the pointer was released
+            _view?.SafeMemoryMappedViewHandle.ReleasePointer();
+            _view?.Dispose();
+            _file?.Dispose();
+        }
+    }
+}
\ No newline at end of file
@@ -52,6 +52,16 @@ public class JsTracePreprocessor : PreprocessorStage
     /// </summary>
     private TracePrefixFile _tracePrefix = null!;
 
+    /// <summary>
+    /// Call stack trie, which is filled while preprocessing the trace prefix and then shared with all traces through <see cref="_tracePrefix"/>.
+    /// </summary>
+    private readonly CallStackTrie _callStacks = new();
+
+    /// <summary>
+    /// Shadow call stack state at the end of the trace prefix, starting with the root node.
+    /// </summary>
+    private int[]? _prefixCallStackIds;
+
     /// <summary>
     /// Next heap allocation offset after processing the trace prefix.
     /// </summary>
@@ -200,7 +210,10 @@ public class JsTracePreprocessor : PreprocessorStage
 
                 // Create trace prefix object
                 var preprocessedTracePrefixData = tracePrefixFileWriter.Buffer.AsMemory(0, tracePrefixFileWriter.Length);
-                _tracePrefix = new TracePrefixFile(preprocessedTracePrefixData);
+                _tracePrefix = new TracePrefixFile(preprocessedTracePrefixData)
+                {
+                    CallStacks = _callStacks
+                };
 
                 // Store to disk?
                 if(_storeTraces)
@@ -282,6 +295,7 @@ public class JsTracePreprocessor : PreprocessorStage
 
         // Preallocated trace entry variables (only needed for serialization)
         Branch branchEntry = new();
+        var shadowCallStack = _prefixCallStackIds == null ? new ShadowCallStack(_callStacks) : new ShadowCallStack(_callStacks, _prefixCallStackIds);
         HeapAllocation heapAllocationEntry = new();
         HeapMemoryAccess heapMemoryAccessEntry = new();
 
@@ -488,17 +502,11 @@ public class JsTracePreprocessor : PreprocessorStage
                         tryAddRequestedMapEntry((destination.imageData.ImageFileInfo.Id, destination.relativeStartAddress), null);
                         tryAddRequestedMapEntry((destination.imageData.ImageFileInfo.Id, destination.relativeEndAddress), null);
 
+                        // Record function name, if it is not already known
                         if(_firstTestcase)
-                        {
-                            // Record function name, if it is not already known
                             destination.imageData.FunctionNameLookupPrefix!.TryAdd((destination.relativeStartAddress, destination.relativeEndAddress), new string(namePart));
-
-                            // Do not trace branches in prefix mode
-                            break;
-                        }
-
-                        // Record function name, if it is not already known
-                        destination.imageData.FunctionNameLookup!.TryAdd((destination.relativeStartAddress, destination.relativeEndAddress), new string(namePart));
+                        else
+                            destination.imageData.FunctionNameLookup!.TryAdd((destination.relativeStartAddress, destination.relativeEndAddress), new string(namePart));
 
                         // Record call
                         branchEntry.BranchType = Branch.BranchTypes.Call;
@@ -507,6 +515,12 @@ public class JsTracePreprocessor : PreprocessorStage
                         branchEntry.SourceInstructionRelativeAddress = source.relativeStartAddress;
                         branchEntry.DestinationImageId = destination.imageData.ImageFileInfo.Id;
                         branchEntry.DestinationInstructionRelativeAddress = destination.relativeStartAddress;
+                        shadowCallStack.Update(branchEntry);
+
+                        // Do not trace branches in prefix mode, only keep track of the call stack
+                        if(_firstTestcase)
+                            break;
+
                         branchEntry.Store(traceFileWriter);
 
                         break;
@@ -548,10 +562,6 @@ public class JsTracePreprocessor : PreprocessorStage
                         // Produce MAP entries
                         tryAddRequestedMapEntry((location.imageData.ImageFileInfo.Id, location.relativeStartAddress), null);
 
-                        // Do not trace branches in prefix mode
-                        if(_firstTestcase)
-                            break;
-
                         // Create branch entry
                         branchEntry.BranchType = Branch.BranchTypes.Return;
                         branchEntry.Taken = true;
@@ -572,6 +582,12 @@ public class JsTracePreprocessor : PreprocessorStage
                             branchEntry.SourceInstructionRelativeAddress = _catchAllExternalFunctionAddress;
                         }
 
+                        shadowCallStack.Update(branchEntry);
+
+                        // Do not trace branches in prefix mode, only keep track of the call stack
+                        if(_firstTestcase)
+                            break;
+
                         branchEntry.Store(traceFileWriter);
 
                         break;
@@ -605,6 +621,7 @@ public class JsTracePreprocessor : PreprocessorStage
                         branchEntry.SourceInstructionRelativeAddress = source.relativeStartAddress;
                         branchEntry.DestinationImageId = destination.imageData.ImageFileInfo.Id;
                         branchEntry.DestinationInstructionRelativeAddress = destination.relativeStartAddress;
+                        shadowCallStack.Update(branchEntry);
                         branchEntry.Store(traceFileWriter);
 
                         break;
@@ -703,6 +720,7 @@ public class JsTracePreprocessor : PreprocessorStage
             _prefixNextHeapAllocationAddress = nextHeapAllocationAddress;
             _prefixHeapObjects = heapObjects;
             _prefixCompressedLinesLookup = compressedLinesLookup;
+            _prefixCallStackIds = shadowCallStack.GetCallStackIds();
         }
     }
 
@@ -832,6 +850,10 @@ public class JsTracePreprocessor : PreprocessorStage
 
     public override async Task UnInitAsync()
     {
+        // Store call stacks, so the preprocessed traces can be loaded again
+        if(_storeTraces && _tracePrefix != null)
+            await StoreCallStacksAsync(_tracePrefix.CallStacks, _outputDirectory!);
+
         List<char> replaceChars = Path.GetInvalidPathChars().Append('/').Append('\\').Append('.').ToList();
 
         // Save MAP data
@@ -0,0 +1,221 @@
+﻿using System.Collections.Generic;
+using System.Linq;
+using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
+
+namespace Microwalk.Plugins.PinTracer
+{
+    /// <summary>
+    /// Index of live heap allocations, which resolves addresses to the allocation blocks containing them.
+    ///
+    /// Allocations are registered in fixed-size address buckets, so inserting, removing and resolving take time proportional to the number of
+    /// blocks sharing a bucket instead of the total number of live blocks. Large blocks are registered in a second level of coarser buckets, and
+    /// huge ones in a plain list, to avoid registering them in many buckets. Since consecutive memory accesses usually hit the same block, the last
+    /// resolved block is checked first, unless <see cref="CacheLastHit"/> is disabled.
+    ///
+    /// <see cref="Find"/> updates the last hit cache. Thus, reading (<see cref="Find"/>, <see cref="TryGetByAddress"/>) is only thread-safe if the
+    /// cache is disabled and the index is not modified concurrently.
+    /// </summary>
+    public class HeapAllocationIndex
+    {
+        /// <summary>
+        /// Size of an address bucket, as power of two.
+        /// </summary>
+        private const int _smallBucketShift = 12;
+
+        /// <summary>
+        /// Size of an address bucket for large blocks, as power of two.
+        /// </summary>
+        private const int _largeBucketShift = 20;
+
+        /// <summary>
+        /// Blocks spanning more buckets than this are moved to the next level.
+        /// </summary>
+        private const ulong _maxBucketsPerAllocation = 64;
+
+        /// <summary>
+        /// Live allocations, indexed by start address.
+        /// </summary>
+        private readonly Dictionary<ulong, HeapAllocation> _allocationsByAddress = new();
+
+        /// <summary>
+        /// Allocations overlapping a given bucket, indexed by bucket number.
+        /// </summary>
+        private readonly Dictionary<ulong, List<HeapAllocation>> _smallBuckets = new();
+
+        /// <summary>
+        /// Large allocations overlapping a given coarse bucket, indexed by bucket number.
+        /// </summary>
+        private readonly Dictionary<ulong, List<HeapAllocation>> _largeBuckets = new();
+
+        /// <summary>
+        /// Allocations which are too big to be registered in buckets.
+        /// </summary>
+        private readonly List<HeapAllocation> _hugeAllocations = new();
+
+        /// <summary>
+        /// The allocation returned by the last successful lookup. May be null.
+        /// </summary>
+        private HeapAllocation? _lastHit;
+
+        /// <summary>
+        /// Backing field of <see cref="CacheLastHit"/>.
+        /// </summary>
+        private bool _cacheLastHit = true;
+
+        /// <summary>
+        /// Determines whether <see cref="Find"/> remembers the last resolved block. This should be disabled for indices which are shared between threads,
+        /// as each lookup would write the cache.
+        /// </summary>
+        public bool CacheLastHit
+        {
+            get => _cacheLastHit;
+            set
+            {
+                _cacheLastHit = value;
+                _lastHit = null;
+            }
+        }
+
+        /// <summary>
+        /// Returns the number of live allocations.
+        /// </summary>
+        public int Count => _allocationsByAddress.Count;
+
+        /// <summary>
+        /// Returns all live allocations, sorted by start address.
+        /// </summary>
+        public IEnumerable<HeapAllocation> Allocations => _allocationsByAddress.Values.OrderBy(a => a.Address);
+
+        /// <summary>
+        /// Adds the given allocation. An existing allocation with the same start address is replaced.
+        /// </summary>
+        /// <param name="allocation">Allocation block.</param>
+        public void Add(HeapAllocation allocation)
+        {
+            if(_allocationsByAddress.TryGetValue(allocation.Address, out var existingAllocation))
+                Remove(existingAllocation);
+            _allocationsByAddress.Add(allocation.Address, allocation);
+
+            // The cached block may now be shadowed by the new one
+            var lastHit = _lastHit;
+            if(lastHit != null && lastHit.Address <= allocation.Address + allocation.Size && allocation.Address <= lastHit.Address + lastHit.Size)
+                _lastHit = null;
+
+            var (buckets, bucketShift) = GetBuckets(allocation);
+            if(buckets == null)
+            {
+                _hugeAllocations.Add(allocation);
+                return;
+            }
+
+            ulong lastBucket = (allocation.Address + allocation.Size) >> bucketShift;
+            for(ulong bucket = allocation.Address >> bucketShift; bucket <= lastBucket; ++bucket)
+            {
+                if(!buckets.TryGetValue(bucket, out var bucketAllocations))
+                {
+                    bucketAllocations = new List<HeapAllocation>(2);
+                    buckets.Add(bucket, bucketAllocations);
+                }
+
+                bucketAllocations.Add(allocation);
+            }
+        }
+
+        /// <summary>
+        /// Removes the allocation starting at the address of the given allocation.
+        /// </summary>
+        /// <param name="allocation">Allocation block.</param>
+        public void Remove(HeapAllocation allocation)
+        {
+            if(!_allocationsByAddress.Remove(allocation.Address, out allocation!))
+                return;
+            if(ReferenceEquals(_lastHit, allocation))
+                _lastHit = null;
+
+            var (buckets, bucketShift) = GetBuckets(allocation);
+            if(buckets == null)
+            {
+                _hugeAllocations.Remove(allocation);
+                return;
+            }
+
+            ulong lastBucket = (allocation.Address + allocation.Size) >> bucketShift;
+            for(ulong bucket = allocation.Address >> bucketShift; bucket <= lastBucket; ++bucket)
+            {
+                var bucketAllocations = buckets[bucket];
+                bucketAllocations.Remove(allocation);
+                if(bucketAllocations.Count == 0)
+                    buckets.Remove(bucket);
+            }
+        }
+
+        /// <summary>
+        /// Returns the allocation starting at the given address.
+        /// </summary>
+        /// <param name="address">Start address.</param>
+        /// <param name="allocation">Allocation block, if found.</param>
+        /// <returns></returns>
+        public bool TryGetByAddress(ulong address, out HeapAllocation allocation)
+        {
+            return _allocationsByAddress.TryGetValue(address, out allocation!);
+        }
+
+        /// <summary>
+        /// Returns the allocation containing the given address, or null if there is none.
+        /// If several allocations contain the address, the one with the highest start address is returned.
+        /// </summary>
+        /// <param name="address">The address to be searched.</param>
+        /// <returns></returns>
+        public HeapAllocation? Find(ulong address)
+        {
+            // Fast path: Same block as last time
+            var lastHit = _lastHit;
+            if(lastHit != null && Contains(lastHit, address))
+                return lastHit;
+
+            HeapAllocation? result = null;
+            if(_smallBuckets.TryGetValue(address >> _smallBucketShift, out var bucketAllocations))
+                FindInList(bucketAllocations, address, ref result);
+            if(_largeBuckets.TryGetValue(address >> _largeBucketShift, out bucketAllocations))
+                FindInList(bucketAllocations, address, ref result);
+            FindInList(_hugeAllocations, address, ref result);
+
+            if(result != null && _cacheLastHit)
+                _lastHit = result;
+            return result;
+        }
+
+        /// <summary>
+        /// Checks whether the given allocation contains the given address. As in the preprocessed traces, the end address is inclusive.
+        /// </summary>
+        private static bool Contains(HeapAllocation allocation, ulong address)
+        {
+            return allocation.Address <= address && address <= allocation.Address + allocation.Size;
+        }
+
+        /// <summary>
+        /// Updates the given result with the allocation with the highest start address in the given list which contains the given address.
+        /// </summary>
+        private static void FindInList(List<HeapAllocation> allocations, ulong address, ref HeapAllocation? result)
+        {
+            foreach(var allocation in allocations)
+            {
+                if(Contains(allocation, address) && (result == null || allocation.Address > result.Address))
+                    result = allocation;
+            }
+        }
+
+        /// <summary>
+        /// Returns the bucket level the given allocation is registered in, or null if it is stored in <see cref="_hugeAllocations"/>.
+        /// </summary>
+        private (Dictionary<ulong, List<HeapAllocation>>? buckets, int bucketShift) GetBuckets(HeapAllocation allocation)
+        {
+            ulong endAddress = allocation.Address + allocation.Size;
+            if((endAddress >> _smallBucketShift) - (allocation.Address >> _smallBucketShift) < _maxBucketsPerAllocation)
+                return (_smallBuckets, _smallBucketShift);
+            if((endAddress >> _largeBucketShift) - (allocation.Address >> _largeBucketShift) < _maxBucketsPerAllocation)
+                return (_largeBuckets, _largeBucketShift);
+            return (null, 0);
+        }
+    }
+}
@@ -1,8 +1,14 @@
 ﻿using System;
+using System.Buffers.Binary;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
+using System.IO.MemoryMappedFiles;
 using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Channels;
 using System.Threading.Tasks;
 using Microwalk.FrameworkBase;
 using Microwalk.FrameworkBase.Configuration;
@@ -27,11 +33,87 @@ namespace Microwalk.Plugins.PinTracer
         /// </summary>
         private Process _pinToolProcess = null!;
 
-        // Not supported. This module only manages a single Pin instance, which currently is fast enough.
-        public override bool SupportsParallelism => false;
+        /// <summary>
+        /// Determines whether testcases are sent to the wrapper with the binary batched protocol.
+        /// </summary>
+        private bool _useBinaryProtocol;
+
+        /// <summary>
+        /// Encoded commands which are waiting to be sent to the wrapper (binary protocol only).
+        /// </summary>
+        private Channel<byte[]> _pendingCommands = null!;
+
+        /// <summary>
+        /// Testcases which were sent to the wrapper, but whose traces are not yet complete, indexed by testcase ID (binary protocol only).
+        /// </summary>
+        private readonly ConcurrentDictionary<int, TaskCompletionSource<string>> _pendingTestcases = new();
+
+        /// <summary>
+        /// Task which writes the pending commands to the wrapper's standard input (binary protocol only).
+        /// </summary>
+        private Task _commandWriterTask = null!;
+
+        /// <summary>
+        /// Task which reads the trace completion records from the Pin tool's standard output (binary protocol only).
+        /// </summary>
+        private Task _completionReaderTask = null!;
+
+        /// <summary>
+        /// The error which terminated the command writer or the completion reader, if any (binary protocol only).
+        /// Once this is set, no further traces can be generated.
+        /// </summary>
+        private Exception? _protocolException;
+
+        /// <summary>
+        /// Determines how testcases are passed to the wrapper.
+        /// </summary>
+        private TestcaseDeliveryMode _testcaseDelivery;
+
+        /// <summary>
+        /// Path of the shared memory arena file.
+        /// </summary>
+        private string _sharedMemoryPath = null!;
+
+        /// <summary>
+        /// The shared memory arena.
+        /// </summary>
+        private MemoryMappedFile _sharedMemory = null!;
+
+        /// <summary>
+        /// Accessor for the shared memory arena.
+        /// </summary>
+        private MemoryMappedViewAccessor _sharedMemoryAccessor = null!;
+
+        /// <summary>
+        /// The size of a single testcase slot in the shared memory arena.
+        /// </summary>
+        private int _sharedMemorySlotSize;
+
+        /// <summary>
+        /// Indices of currently unused testcase slots in the shared memory arena.
+        /// </summary>
+        private readonly ConcurrentQueue<int> _freeSharedMemorySlots = new();
+
+        /// <summary>
+        /// Counts the unused testcase slots in the shared memory arena.
+        /// </summary>
+        private SemaphoreSlim _freeSharedMemorySlotsSemaphore = null!;
+
+        // With the text protocol, each testcase needs a full round-trip, so there can only be one testcase in flight.
+        // The binary protocol allows to queue several testcases at the wrapper, which still runs them sequentially in a single Pin instance.
+        public override bool SupportsParallelism => _useBinaryProtocol;
+
+        // The in-memory delivery modes only fall back to files for testcases which cannot be passed otherwise
+        public override bool NeedsTestcaseFiles => _testcaseDelivery == TestcaseDeliveryMode.File;
 
         public override async Task GenerateTraceAsync(TraceEntity traceEntity)
         {
+            if(_useBinaryProtocol)
+            {
+                await GenerateTraceBinaryAsync(traceEntity);
+                return;
+            }
+
             string logMessagePrefix = $"[trace:pin:{traceEntity.Id}]";
 
             // Debug
@@ -57,17 +139,267 @@ namespace Microwalk.Plugins.PinTracer
                     break;
                 }
 
+                if(outputParts[0] == "f" && outputParts.Length >= 2)
+                    throw new IOException($"The wrapper could not run testcase #{traceEntity.Id}: {outputParts[1]}");
+
                 await Logger.LogWarningAsync($"{logMessagePrefix} Unexpected message from Pin tool.\nPlease make sure that the investigated program does not print anything on stdout, since this might interfere with the Pin tool's output pipe.");
             }
         }
 
+        /// <summary>
+        /// Queues the given testcase at the wrapper, and waits until the Pin tool reports that the trace is complete.
+        /// </summary>
+        private async Task GenerateTraceBinaryAsync(TraceEntity traceEntity)
+        {
+            string logMessagePrefix = $"[trace:pin:{traceEntity.Id}]";
+
+            // Debug
+            await Logger.LogDebugAsync($"{logMessagePrefix} Trace #" + traceEntity.Id);
+
+            // Register testcase before sending it, so the completion record cannot be missed
+            var completionSource = new TaskCompletionSource<string>(TaskCreationOptions.RunContinuationsAsynchronously);
+            if(!_pendingTestcases.TryAdd(traceEntity.Id, completionSource))
+                throw new InvalidOperationException($"Testcase #{traceEntity.Id} is already being traced.");
+
+            // If the protocol handlers have already terminated, nobody would complete the testcase
+            // Else, they are guaranteed to see the registered testcase when they fail later
+            var protocolException = Volatile.Read(ref _protocolException);
+            if(protocolException != null)
+            {
+                _pendingTestcases.TryRemove(traceEntity.Id, out _);
+                throw new IOException("The connection to the Pin tool was lost.", protocolException);
+            }
+
+            // Place testcase in shared memory or let the wrapper generate it, if possible
+            int sharedMemorySlot = -1;
+            byte[] command;
+            if(_testcaseDelivery == TestcaseDeliveryMode.Generate && traceEntity.DeterministicTestcase != null)
+            {
+                // 'R', payload length, first testcase ID, testcase count, seed, first index, length
+                var deterministicTestcase = traceEntity.DeterministicTestcase;
+                command = new byte[1 + 4 + 4 + 4 + 8 + 8 + 4];
+                command[0] = (byte)'R';
+                BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(1), 4 + 4 + 8 + 8 + 4);
+                BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(5), traceEntity.Id);
+                BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(9), 1);
+                BinaryPrimitives.WriteUInt64LittleEndian(command.AsSpan(13), deterministicTestcase.Seed);
+                BinaryPrimitives.WriteUInt64LittleEndian(command.AsSpan(21), deterministicTestcase.Index);
+                BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(29), deterministicTestcase.Length);
+            }
+            else if(_testcaseDelivery == TestcaseDeliveryMode.SharedMemory)
+            {
+                byte[] testcaseData = traceEntity.TestcaseData ?? await File.ReadAllBytesAsync(traceEntity.TestcaseFilePath, PipelineToken);
+                if(testcaseData.Length <= _sharedMemorySlotSize)
+                {
+                    await _freeSharedMemorySlotsSemaphore.WaitAsync(PipelineToken);
+                    if(!_freeSharedMemorySlots.TryDequeue(out sharedMemorySlot))
+                        throw new InvalidOperationException("Could not allocate shared memory slot.");
+                    long offset = (long)sharedMemorySlot * _sharedMemorySlotSize;
+                    _sharedMemoryAccessor.WriteArray(offset, testcaseData, 0, testcaseData.Length);
+
+                    // 'M', payload length, testcase ID, offset, length
+                    command = new byte[1 + 4 + 4 + 8 + 4];
+                    command[0] = (byte)'M';
+                    BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(1), 4 + 8 + 4);
+                    BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(5), traceEntity.Id);
+                    BinaryPrimitives.WriteInt64LittleEndian(command.AsSpan(9), offset);
+                    BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(17), testcaseData.Length);
+                }
+                else
+                {
+                    await Logger.LogDebugAsync($"{logMessagePrefix} Testcase is larger than a shared memory slot, passing file name instead");
+                    command = EncodeFileTestcaseCommand(traceEntity);
+                }
+            }
+            else
+            {
+                command = EncodeFileTestcaseCommand(traceEntity);
+            }
+
+            try
+            {
+                // Send test case
+                await _pendingCommands.Writer.WriteAsync(command, PipelineToken);
+
+                // Wait for trace
+                traceEntity.RawTraceFilePath = await completionSource.Task.WaitAsync(PipelineToken);
+            }
+            finally
+            {
+                // The wrapper is done with the testcase, so the slot can be reused
+                if(sharedMemorySlot >= 0)
+                {
+                    _freeSharedMemorySlots.Enqueue(sharedMemorySlot);
+                    _freeSharedMemorySlotsSemaphore.Release();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Encodes a binary command which instructs the wrapper to load the testcase from its file.
+        /// </summary>
+        private static byte[] EncodeFileTestcaseCommand(TraceEntity traceEntity)
+        {
+            if(string.IsNullOrEmpty(traceEntity.TestcaseFilePath))
+                throw new InvalidOperationException($"Testcase #{traceEntity.Id} does not have a file and cannot be passed to the wrapper in memory.");
+
+            // 'T', payload length, testcase ID, file path
+            byte[] path = Encoding.UTF8.GetBytes(traceEntity.TestcaseFilePath);
+            byte[] command = new byte[1 + 4 + 4 + path.Length];
+            command[0] = (byte)'T';
+            BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(1), 4 + path.Length);
+            BinaryPrimitives.WriteInt32LittleEndian(command.AsSpan(5), traceEntity.Id);
+            path.CopyTo(command, 9);
+            return command;
+        }
+
+        /// <summary>
+        /// Writes queued commands to the wrapper's standard input. All commands that are available at a given time are sent in a single batch.
+        /// Consecutive deterministic testcases are merged into a single range command.
+        /// </summary>
+        private async Task WriteCommandsAsync()
+        {
+            try
+            {
+                var stream = _pinToolProcess.StandardInput.BaseStream;
+                while(await _pendingCommands.Reader.WaitToReadAsync())
+                {
+                    byte[]? pendingRange = null;
+                    while(_pendingCommands.Reader.TryRead(out var command))
+                    {
+                        if(pendingRange != null && command[0] == 'R' && TryExtendRangeCommand(pendingRange, command))
+                            continue;
+
+                        if(pendingRange != null)
+                            await stream.WriteAsync(pendingRange);
+                        pendingRange = null;
+
+                        if(command[0] == 'R')
+                            pendingRange = command;
+                        else
+                            await stream.WriteAsync(command);
+                    }
+
+                    if(pendingRange != null)
+                        await stream.WriteAsync(pendingRange);
+                    await stream.FlushAsync();
+                }
+            }
+            catch(Exception ex)
+            {
+                // E.g., broken pipe: The queued testcases will never be run
+                await Logger.LogErrorAsync($"{_genericLogMessagePrefix} Could not send commands to the Pin tool: {ex.Message}");
+                _pendingCommands.Writer.TryComplete(ex);
+                FailPendingTestcases(ex);
+            }
+        }
+
+        /// <summary>
+        /// Queues the exit command ('E', empty payload) for the binary protocol, and completes the command channel.
+        /// Does nothing if the channel was already completed.
+        /// </summary>
+        private void QueueExitCommand()
+        {
+            _pendingCommands.Writer.TryWrite([(byte)'E', 0, 0, 0, 0]);
+            _pendingCommands.Writer.TryComplete();
+        }
+
+        /// <summary>
+        /// Appends the given single-testcase range command to an existing range command, if the latter is directly followed by the former.
+        /// </summary>
+        /// <param name="range">Range command, which is updated in-place.</param>
+        /// <param name="next">Range command with a single testcase.</param>
+        /// <returns>Whether the command could be appended.</returns>
+        private static bool TryExtendRangeCommand(byte[] range, byte[] next)
+        {
+            int firstId = BinaryPrimitives.ReadInt32LittleEndian(range.AsSpan(5));
+            int count = BinaryPrimitives.ReadInt32LittleEndian(range.AsSpan(9));
+            ulong firstIndex = BinaryPrimitives.ReadUInt64LittleEndian(range.AsSpan(21));
+
+            // Seed and length must match, ID and index must directly follow the range
+            if(!range.AsSpan(13, 8).SequenceEqual(next.AsSpan(13, 8))
+               || !range.AsSpan(29, 4).SequenceEqual(next.AsSpan(29, 4))
+               || BinaryPrimitives.ReadInt32LittleEndian(next.AsSpan(5)) != firstId + count
+               || BinaryPrimitives.ReadUInt64LittleEndian(next.AsSpan(21)) != firstIndex + (ulong)count)
+                return false;
+
+            BinaryPrimitives.WriteInt32LittleEndian(range.AsSpan(9), count + 1);
+            return true;
+        }
+
+        /// <summary>
+        /// Reads trace completion records from the Pin tool's standard output and notifies the respective waiting testcases.
+        /// </summary>
+        private async Task ReadCompletionsAsync()
+        {
+            try
+            {
+                while(true)
+                {
+                    string? pinToolOutput = await _pinToolProcess.StandardOutput.ReadLineAsync();
+                    if(pinToolOutput == null)
+                        break;
+
+                    // Parse output: "t", trace file path, testcase ID
+                    await Logger.LogDebugAsync($"{_genericLogMessagePrefix} Pin tool output: {pinToolOutput}");
+                    string[] outputParts = pinToolOutput.Split('\t');
+                    // The wrapper reports testcases which it could not run with "f", error message, testcase ID
+                    if(outputParts.Length < 3 || (outputParts[0] != "t" && outputParts[0] != "f") || !int.TryParse(outputParts[2], out int testcaseId))
+                    {
+                        await Logger.LogWarningAsync($"{_genericLogMessagePrefix} Unexpected message from Pin tool.\nPlease make sure that the investigated program does not print anything on stdout, since this might interfere with the Pin tool's output pipe.");
+                        continue;
+                    }
+
+                    if(!_pendingTestcases.TryRemove(testcaseId, out var completionSource))
+                        await Logger.LogWarningAsync($"{_genericLogMessagePrefix} Received trace for unknown testcase #{testcaseId}.");
+                    else if(outputParts[0] == "f")
+                        completionSource.SetException(new IOException($"The wrapper could not run testcase #{testcaseId}: {outputParts[1]}"));
+                    else
+                        completionSource.SetResult(outputParts[1]);
+                }
+            }
+            catch(Exception ex)
+            {
+                FailPendingTestcases(ex);
+                return;
+            }
+
+            // The Pin tool has exited, so there won't be any further traces
+            FailPendingTestcases(new IOException("Could not read from Pin tool standard output (null). Probably the process has exited early."));
+        }
+
+        /// <summary>
+        /// Records that the binary protocol can no longer be used due to the given error, and fails all testcases which are currently waiting
+        /// for their trace. Testcases which are queued afterwards fail immediately.
+        /// </summary>
+        /// <param name="ex">The error which terminated the command writer or the completion reader.</param>
+        private void FailPendingTestcases(Exception ex)
+        {
+            // Keep the first error, which is usually the most helpful one
+            Interlocked.CompareExchange(ref _protocolException, ex, null);
+
+            foreach(var pendingTestcase in _pendingTestcases.Values)
+                pendingTestcase.TrySetException(ex);
+        }
+
         protected override async Task InitAsync(MappingNode? moduleOptions)
         {
             if(moduleOptions == null)
                 throw new ConfigurationException("Missing module configuration.");
 
+            // Determine tracing backend
+            string backend = moduleOptions.GetChildNodeOrDefault("backend")?.AsString() ?? "pin";
+            bool useCompilerTracer = backend switch
+            {
+                "pin" => false,
+                "compiler" => true,
+                _ => throw new ConfigurationException($"Unknown tracing backend '{backend}'.")
+            };
+
             // Extract mandatory configuration values
-            string pinToolPath = moduleOptions.GetChildNodeOrDefault("pin-tool-path")?.AsString() ?? throw new ConfigurationException("Missing Pin tool path.");
+            string? pinToolPath = moduleOptions.GetChildNodeOrDefault("pin-tool-path")?.AsString();
+            if(pinToolPath == null && !useCompilerTracer)
+                throw new ConfigurationException("Missing Pin tool path.");
             string wrapperPath = moduleOptions.GetChildNodeOrDefault("wrapper-path")?.AsString() ?? throw new ConfigurationException("Missing wrapper path.");
 
             // Check output directory
@@ -85,6 +417,49 @@ namespace Microwalk.Plugins.PinTracer
             ulong? fixedRdrand = moduleOptions.GetChildNodeOrDefault("rdrand")?.AsUnsignedLongHex();
             int cpuModelId = moduleOptions.GetChildNodeOrDefault("cpu")?.AsInteger() ?? 0;
             bool enableStackTracking = moduleOptions.GetChildNodeOrDefault("stack-tracking")?.AsBoolean() ?? false;
+            string protocol = moduleOptions.GetChildNodeOrDefault("protocol")?.AsString() ?? "text";
+            _useBinaryProtocol = protocol switch
+            {
+                "text" => false,
+                "binary" => true,
+                _ => throw new ConfigurationException($"Unknown wrapper protocol '{protocol}'.")
+            };
+            string testcaseDelivery = moduleOptions.GetChildNodeOrDefault("testcase-delivery")?.AsString() ?? "file";
+            _testcaseDelivery = testcaseDelivery switch
+            {
+                "file" => TestcaseDeliveryMode.File,
+                "shared-memory" => TestcaseDeliveryMode.SharedMemory,
+                "generate" => TestcaseDeliveryMode.Generate,
+                _ => throw new ConfigurationException($"Unknown testcase delivery mode '{testcaseDelivery}'.")
+            };
+            if(_testcaseDelivery != TestcaseDeliveryMode.File)
+            {
+                if(!_useBinaryProtocol)
+                    throw new ConfigurationException("In-memory testcase delivery requires the binary wrapper protocol.");
+                if(!OperatingSystem.IsLinux())
+                    throw new ConfigurationException("In-memory testcase delivery is only supported on Linux.");
+            }
+            if(_testcaseDelivery == TestcaseDeliveryMode.SharedMemory)
+            {
+                _sharedMemorySlotSize = moduleOptions.GetChildNodeOrDefault("shared-memory-slot-size")?.AsInteger() ?? 64 * 1024;
+                int sharedMemorySlotCount = moduleOptions.GetChildNodeOrDefault("shared-memory-slots")?.AsInteger() ?? 16;
+                if(_sharedMemorySlotSize <= 0 || sharedMemorySlotCount <= 0)
+                    throw new ConfigurationException("Invalid shared memory arena size.");
+
+                // Create arena file, preferably in a RAM-backed file system
+                string sharedMemoryDirectory = Directory.Exists("/dev/shm") ? "/dev/shm" : _outputDirectory.FullName;
+                _sharedMemoryPath = Path.Combine(sharedMemoryDirectory, $"microwalk-testcases-{Environment.ProcessId}-{Guid.NewGuid():N}");
+                _sharedMemory = MemoryMappedFile.CreateFromFile(_sharedMemoryPath, FileMode.CreateNew, null, (long)_sharedMemorySlotSize * sharedMemorySlotCount);
+                _sharedMemoryAccessor = _sharedMemory.CreateViewAccessor();
+
+                for(int i = 0; i < sharedMemorySlotCount; ++i)
+                    _freeSharedMemorySlots.Enqueue(i);
+                _freeSharedMemorySlotsSemaphore = new SemaphoreSlim(sharedMemorySlotCount);
+            }
+
+            // The compiler-instrumentation tracer is built into the wrapper, so Pin-specific features are not available
+            if(useCompilerTracer && (fixedRdrand != null || cpuModelId != 0 || enableStackTracking))
+                await Logger.LogWarningAsync($"{_genericLogMessagePrefix} The options 'rdrand', 'cpu' and 'stack-tracking' are not supported by the compiler-instrumentation tracer and will be ignored.");
 
             // Prepare argument list
             var pinArgs = new List<string>
@@ -113,18 +488,20 @@ namespace Microwalk.Plugins.PinTracer
             pinArgs.Add(wrapperPath);
 
             // Prepare Pin tool process
+            // With the compiler-instrumentation tracer, the wrapper writes the traces itself and is run directly
             await Logger.LogDebugAsync($"{_genericLogMessagePrefix} Starting Pin tool process");
             ProcessStartInfo pinToolProcessStartInfo = new()
             {
                 Arguments = string.Empty,
-                FileName = pinPath,
+                FileName = useCompilerTracer ? wrapperPath : pinPath,
                 WorkingDirectory = _outputDirectory.FullName, // Places pin.log at the trace directory
                 UseShellExecute = false,
                 RedirectStandardInput = true,
                 RedirectStandardOutput = true,
                 RedirectStandardError = true
             };
-            pinToolProcessStartInfo.ArgumentList.AddRange(pinArgs);
+            if(!useCompilerTracer)
+                pinToolProcessStartInfo.ArgumentList.AddRange(pinArgs);
 
             // Environment variables
             var environmentNode = moduleOptions.GetChildNodeOrDefault("environment");
@@ -141,10 +518,29 @@ namespace Microwalk.Plugins.PinTracer
 
             pinToolProcessStartInfo.EnvironmentVariables["PATH"] += Path.PathSeparator + Path.GetDirectoryName(wrapperPath);
 
+            // Pass the Pin tool options to the compiler-instrumentation tracer
+            if(useCompilerTracer)
+            {
+                pinToolProcessStartInfo.EnvironmentVariables["MICROWALK_TRACE_PREFIX"] = Path.GetFullPath(_outputDirectory.FullName) + Path.DirectorySeparatorChar;
+                pinToolProcessStartInfo.EnvironmentVariables["MICROWALK_TRACE_IMAGES"] = imagesList;
+            }
+
+            // Tell the wrapper where to find the testcase arena
+            if(_testcaseDelivery == TestcaseDeliveryMode.SharedMemory)
+                pinToolProcessStartInfo.EnvironmentVariables["MICROWALK_TESTCASE_ARENA"] = _sharedMemoryPath;
+
             // Start Pin tool
             await Logger.LogDebugAsync($"{_genericLogMessagePrefix} Pin tool command: {pinToolProcessStartInfo.FileName} {string.Join(" ", pinToolProcessStartInfo.ArgumentList)}");
             _pinToolProcess = Process.Start(pinToolProcessStartInfo) ?? throw new Exception("Could not start the Pin process.");
 
+            // Start protocol handlers
+            if(_useBinaryProtocol)
+            {
+                _pendingCommands = Channel.CreateUnbounded<byte[]>(new UnboundedChannelOptions { SingleReader = true });
+                _commandWriterTask = Task.Run(WriteCommandsAsync);
+                _completionReaderTask = Task.Run(ReadCompletionsAsync);
+            }
+
             // Ensure that the Pin process is eventually stopped when the Pipeline gets aborted early
             PipelineToken.Register(() =>
             {
@@ -154,7 +550,11 @@ namespace Microwalk.Plugins.PinTracer
                 try
                 {
                     // Try to stop the Pin process the clean way
-                    _pinToolProcess.StandardInput.WriteLineAsync("e 0").Wait(1000);
+                    // In binary mode, the exit command must go through the command writer, so it does not end up in the middle of another command
+                    if(_useBinaryProtocol)
+                        QueueExitCommand();
+                    else
+                        _pinToolProcess.StandardInput.WriteLineAsync("e 0").Wait(1000);
                     if(_pinToolProcess.WaitForExit(1000))
                         return;
 
@@ -182,11 +582,50 @@ namespace Microwalk.Plugins.PinTracer
         {
             // Exit Pin tool process
             await Logger.LogDebugAsync($"{_genericLogMessagePrefix} Stopping Pin tool process");
-            if(!_pinToolProcess.HasExited)
+            if(_useBinaryProtocol)
+            {
+                // Send exit command, unless the pipeline abort handler did so already
+                if(!_pinToolProcess.HasExited)
+                    QueueExitCommand();
+                _pendingCommands.Writer.TryComplete();
+
+                await _commandWriterTask;
+                await _pinToolProcess.WaitForExitAsync();
+                await _completionReaderTask;
+
+                if(_testcaseDelivery == TestcaseDeliveryMode.SharedMemory)
+                {
+                    _sharedMemoryAccessor.Dispose();
+                    _sharedMemory.Dispose();
+                    File.Delete(_sharedMemoryPath);
+                }
+            }
+            else if(!_pinToolProcess.HasExited)
             {
                 await _pinToolProcess.StandardInput.WriteLineAsync("e 0");
                 await _pinToolProcess.WaitForExitAsync();
             }
         }
+
+        /// <summary>
+        /// Ways to pass testcases to the wrapper.
+        /// </summary>
+        private enum TestcaseDeliveryMode
+        {
+            /// <summary>
+            /// The wrapper opens the testcase files.
+            /// </summary>
+            File,
+
+            /// <summary>
+            /// The testcases are copied into a shared memory arena.
+            /// </summary>
+            SharedMemory,
+
+            /// <summary>
+            /// The wrapper generates deterministic testcases itself.
+            /// </summary>
+            Generate
+        }
     }
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 using System.Collections.Generic;
 using System.Globalization;
 using System.IO;
+using System.IO.MemoryMappedFiles;
 using System.Linq;
 using System.Runtime.InteropServices;
+using System.Security.Cryptography;
 using System.Threading;
 using System.Threading.Tasks;
 using Microwalk.FrameworkBase;
@@ -19,6 +21,27 @@ namespace Microwalk.Plugins.PinTracer
     [FrameworkModule("pin", "Preprocesses traces generated with the Pin tool.")]
     public class PinTracePreprocessor : PreprocessorStage
     {
+        /// <summary>
+        /// Version of the prefix cache entries. This must be incremented whenever the preprocessing of the trace prefix or the cached state changes.
+        /// Changes of the trace entry encoding are covered by <see cref="TraceFile.RowFormatVersion"/>, which is part of the cache key as well.
+        /// </summary>
+        private const int _prefixCacheVersion = 2;
+
+        /// <summary>
+        /// Number of raw trace entries which are mapped into memory at once.
+        /// </summary>
+        private const int _rawTraceChunkEntryCount = 4 * 1024 * 1024;
+
+        /// <summary>
+        /// Number of raw trace entries which are handled by one parallel image lookup work item.
+        /// </summary>
+        private const int _resolveBlockEntryCount = 64 * 1024;
+
+        /// <summary>
+        /// Marks addresses whose image was not looked up in advance.
+        /// </summary>
+        private const int _imageIndexUnresolved = -2;
+
         /// <summary>
         /// The preprocessed trace output directory.
         /// </summary>
@@ -29,11 +52,31 @@ namespace Microwalk.Plugins.PinTracer
         /// </summary>
         private bool _storeTraces;
 
+        /// <summary>
+        /// Determines whether preprocessed traces are streamed to disk, instead of being kept in memory.
+        /// </summary>
+        private bool _streamTraces;
+
+        /// <summary>
+        /// Determines whether preprocessed traces are converted into the columnar format.
+        /// </summary>
+        private bool _columnarTraces;
+
         /// <summary>
         /// Determines whether raw traces are kept or deleted after preprocessing.
         /// </summary>
         private bool _keepRawTraces;
 
+        /// <summary>
+        /// Number of threads used for looking up images within a single trace.
+        /// </summary>
+        private int _intraTraceThreads;
+
+        /// <summary>
+        /// Directory where preprocessed trace prefixes are cached across runs. May be null.
+        /// </summary>
+        private DirectoryInfo? _prefixCacheDirectory;
+
         /// <summary>
         /// Determines whether the next incoming test case is the first one.
         /// </summary>
@@ -67,7 +110,7 @@ namespace Microwalk.Plugins.PinTracer
         /// <summary>
         /// Heap allocation information from the trace prefix, indexed by start address.
         /// </summary>
-        private SortedList<ulong, HeapAllocation>? _tracePrefixHeapAllocationLookup;
+        private HeapAllocationIndex? _tracePrefixHeapAllocationLookup;
 
         /// <summary>
         /// Stack frames from the trace prefix.
@@ -76,6 +119,17 @@ namespace Microwalk.Plugins.PinTracer
         /// </summary>
         private List<(int id, ulong baseAddress)>? _tracePrefixStackFrames;
 
+        /// <summary>
+        /// Call stack trie, which is filled while preprocessing the trace prefix and then shared with all traces through <see cref="_tracePrefix"/>.
+        /// </summary>
+        private CallStackTrie _callStacks = new();
+
+        /// <summary>
+        /// Shadow call stack state at the end of the trace prefix, starting with the root node.
+        /// The shadow call stack of each trace is initialized with these IDs, so calls made by the prefix stay on the call stack.
+        /// </summary>
+        private int[]? _tracePrefixCallStackIds;
+
         /// <summary>
         /// The last heap allocation ID used by the trace prefix.
         /// </summary>
@@ -105,46 +159,18 @@ namespace Microwalk.Plugins.PinTracer
                     string prefixDataFilePath = Path.Combine(rawTraceFileDirectory, "prefix_data.txt");
                     string tracePrefixFilePath = Path.Combine(rawTraceFileDirectory, "prefix.trace");
 
-                    // Read image data
-                    string[] imageDataLines = await File.ReadAllLinesAsync(prefixDataFilePath);
-                    int nextImageFileId = 0;
-                    int maxImageNameLength = 1;
-                    List<TracePrefixFile.ImageFileInfo> imageFiles = new();
-                    foreach(string line in imageDataLines)
-                    {
-                        string[] imageData = line.Split('\t');
-                        var imageFile = new TracePrefixFile.ImageFileInfo
-                        {
-                            Id = nextImageFileId++,
-                            Interesting = byte.Parse(imageData[1]) != 0,
-                            StartAddress = ulong.Parse(imageData[2], NumberStyles.HexNumber),
-                            EndAddress = ulong.Parse(imageData[3], NumberStyles.HexNumber),
-                            Name = Path.GetFileName(imageData[4])
-                        };
-                        imageFiles.Add(imageFile);
-
-                        if(imageFile.Name.Length > maxImageNameLength)
-                            maxImageNameLength = imageFile.Name.Length;
-                    }
-
-                    // Order image files
-                    // Interesting image files come first, since memory accesses almost always hit those
-                    _imageFiles = imageFiles.OrderByDescending(img => img.Interesting).ToArray();
-
-                    // Prepare writer for serializing trace data
-                    using var tracePrefixFileWriter = new FastBinaryBufferWriter(_imageFiles.Length * (32 + maxImageNameLength));
-
-                    // Write image files
-                    tracePrefixFileWriter.WriteInt32(_imageFiles.Length);
-                    foreach(var imageFile in _imageFiles)
-                        imageFile.Store(tracePrefixFileWriter);
-
-                    // Load and parse trace prefix data
-                    PreprocessFile(tracePrefixFilePath, true, tracePrefixFileWriter, "[preprocess:prefix]");
+                    // Try to reuse a cached preprocessed prefix, else preprocess the raw prefix
+                    string? prefixCacheKey = _prefixCacheDirectory == null ? null : await ComputePrefixCacheKeyAsync(prefixDataFilePath, tracePrefixFilePath);
+                    Memory<byte>? cachedTracePrefixData = prefixCacheKey == null ? null : await TryLoadCachedPrefixAsync(prefixCacheKey);
+                    Memory<byte> preprocessedTracePrefixData = cachedTracePrefixData ?? await PreprocessPrefixAsync(prefixDataFilePath, tracePrefixFilePath);
+                    if(prefixCacheKey != null && cachedTracePrefixData == null)
+                        await StorePrefixInCacheAsync(prefixCacheKey, preprocessedTracePrefixData);
 
                     // Create trace prefix object
-                    var preprocessedTracePrefixData = tracePrefixFileWriter.Buffer.AsMemory(0, tracePrefixFileWriter.Length);
-                    _tracePrefix = new TracePrefixFile(preprocessedTracePrefixData);
+                    _tracePrefix = new TracePrefixFile(preprocessedTracePrefixData)
+                    {
+                        CallStacks = _callStacks
+                    };
                     _firstTestcase = false;
 
                     // Keep raw trace data?
@@ -168,25 +194,61 @@ namespace Microwalk.Plugins.PinTracer
                 _firstTestcaseSemaphore.Release();
             }
 
-            // Prepare writer for serializing trace data
-            // The buffer will be resized by the preprocess method, which can compute a good upper bound for the output file size
-            using var traceFileWriter = new FastBinaryBufferWriter(1);
+            TraceFile preprocessedTraceFile;
+            if(_streamTraces)
+            {
+                // Write trace to file, do not keep it in memory
+                traceEntity.PreprocessedTraceFilePath = Path.Combine(_outputDirectory!.FullName, Path.GetFileName(traceEntity.RawTraceFilePath) + ".preprocessed");
+                string rowTraceFilePath = _columnarTraces ? traceEntity.PreprocessedTraceFilePath + ".row" : traceEntity.PreprocessedTraceFilePath;
+                using(var traceFileWriter = new FastBinaryFileWriter(rowTraceFilePath))
+                    PreprocessFile(traceEntity.RawTraceFilePath, false, traceFileWriter, $"[preprocess:{traceEntity.Id}]");
 
-            // Preprocess trace data
-            PreprocessFile(traceEntity.RawTraceFilePath, false, traceFileWriter, $"[preprocess:{traceEntity.Id}]");
+                // Transpose trace into columns
+                // Columnar traces are read through a single memory mapping, so traces which exceed its size limit are kept in the row format
+                if(_columnarTraces)
+                {
+                    if(ColumnarTraceFormat.GetMaxConvertedSize(new FileInfo(rowTraceFilePath).Length) <= int.MaxValue)
+                    {
+                        ColumnarTraceFormat.ConvertFile(rowTraceFilePath, traceEntity.PreprocessedTraceFilePath);
+                        File.Delete(rowTraceFilePath);
+                    }
+                    else
+                    {
+                        await Logger.LogWarningAsync($"[preprocess:{traceEntity.Id}] Trace is too large for the columnar format, storing it in the row format");
+                        File.Move(rowTraceFilePath, traceEntity.PreprocessedTraceFilePath, true);
+                    }
+                }
 
-            // Create trace file object
-            var preprocessedTraceData = traceFileWriter.Buffer.AsMemory(0, traceFileWriter.Length);
-            var preprocessedTraceFile = new TraceFile(_tracePrefix, preprocessedTraceData);
-            
-            // Store to disk?
-            if(_storeTraces)
+                // Create trace file object, which reads the trace lazily
+                preprocessedTraceFile = new TraceFile(_tracePrefix, traceEntity.PreprocessedTraceFilePath);
+            }
+            else
             {
-                traceEntity.PreprocessedTraceFilePath = Path.Combine(_outputDirectory!.FullName, Path.GetFileName(traceEntity.RawTraceFilePath) + ".preprocessed");
-                await using var writer = new BinaryWriter(File.Open(traceEntity.PreprocessedTraceFilePath, FileMode.Create, FileAccess.Write, FileShare.None));
-                writer.Write(preprocessedTraceData.Span);
+                // Prepare writer for serializing trace data
+                // The buffer will be resized by the preprocess method, which can compute a good upper bound for the output file size
+                using var traceFileWriter = new FastBinaryBufferWriter(1);
+
+                // Preprocess trace data
+                PreprocessFile(traceEntity.RawTraceFilePath, false, traceFileWriter, $"[preprocess:{traceEntity.Id}]");
+
+                // Create trace file object
+                // The writer's buffer is sized for the worst case, so the trace data is moved into a buffer of the actual size, which is then kept
+                // alive by the trace file
+                Memory<byte> preprocessedTraceData = _columnarTraces
+                    ? ColumnarTraceFormat.Convert(traceFileWriter.Buffer.AsSpan(0, traceFileWriter.Length))
+                    : traceFileWriter.Buffer.AsSpan(0, traceFileWriter.Length).ToArray();
+                preprocessedTraceFile = new TraceFile(_tracePrefix, preprocessedTraceData);
+
+                // Store to disk?
+                if(_storeTraces)
+                {
+                    traceEntity.PreprocessedTraceFilePath = Path.Combine(_outputDirectory!.FullName, Path.GetFileName(traceEntity.RawTraceFilePath) + ".preprocessed");
+                    await using var writer = new BinaryWriter(File.Open(traceEntity.PreprocessedTraceFilePath, FileMode.Create, FileAccess.Write, FileShare.None));
+                    writer.Write(preprocessedTraceData.Span);
+                }
             }
-            
+
+
             // Keep raw trace?
             if(!_keepRawTraces)
             {
@@ -194,29 +256,240 @@ namespace Microwalk.Plugins.PinTracer
                 traceEntity.RawTraceFilePath = null;
             }
 
-            // Keep trace data in memory for the analysis stages
+            // Hand trace data to the analysis stages
             traceEntity.PreprocessedTraceFile = preprocessedTraceFile;
         }
 
+        /// <summary>
+        /// Reads the image data and preprocesses the raw trace prefix.
+        /// </summary>
+        /// <param name="prefixDataFilePath">Path of the raw image data file.</param>
+        /// <param name="tracePrefixFilePath">Path of the raw trace prefix file.</param>
+        /// <returns>The preprocessed trace prefix, including the image data.</returns>
+        private async Task<Memory<byte>> PreprocessPrefixAsync(string prefixDataFilePath, string tracePrefixFilePath)
+        {
+            // Read image data
+            string[] imageDataLines = await File.ReadAllLinesAsync(prefixDataFilePath);
+            int nextImageFileId = 0;
+            int maxImageNameLength = 1;
+            List<TracePrefixFile.ImageFileInfo> imageFiles = new();
+            foreach(string line in imageDataLines)
+            {
+                string[] imageData = line.Split('\t');
+                var imageFile = new TracePrefixFile.ImageFileInfo
+                {
+                    Id = nextImageFileId++,
+                    Interesting = byte.Parse(imageData[1]) != 0,
+                    StartAddress = ulong.Parse(imageData[2], NumberStyles.HexNumber),
+                    EndAddress = ulong.Parse(imageData[3], NumberStyles.HexNumber),
+                    Name = Path.GetFileName(imageData[4])
+                };
+                imageFiles.Add(imageFile);
+
+                if(imageFile.Name.Length > maxImageNameLength)
+                    maxImageNameLength = imageFile.Name.Length;
+            }
+
+            // Order image files
+            // Interesting image files come first, since memory accesses almost always hit those
+            _imageFiles = imageFiles.OrderByDescending(img => img.Interesting).ToArray();
+
+            // Prepare writer for serializing trace data
+            using var tracePrefixFileWriter = new FastBinaryBufferWriter(_imageFiles.Length * (32 + maxImageNameLength));
+
+            // Write image files
+            tracePrefixFileWriter.WriteInt32(_imageFiles.Length);
+            foreach(var imageFile in _imageFiles)
+                imageFile.Store(tracePrefixFileWriter);
+
+            // Load and parse trace prefix data
+            PreprocessFile(tracePrefixFilePath, true, tracePrefixFileWriter, "[preprocess:prefix]");
+
+            return tracePrefixFileWriter.Buffer.AsMemory(0, tracePrefixFileWriter.Length);
+        }
+
+        /// <summary>
+        /// Computes the key of the prefix cache entry for the given raw prefix files.
+        /// </summary>
+        /// <remarks>
+        /// The preprocessed prefix and the associated preprocessor state only depend on the raw image data and the raw trace prefix, so these are hashed
+        /// directly: This covers changes of the wrapper, the investigated libraries and the Pin tool options, and also differing image or stack addresses
+        /// (e.g., due to ASLR), which would make a cached prefix unusable.
+        /// Hashing is much cheaper than preprocessing, so the first testcase is released quickly.
+        /// </remarks>
+        /// <param name="prefixDataFilePath">Path of the raw image data file.</param>
+        /// <param name="tracePrefixFilePath">Path of the raw trace prefix file.</param>
+        private static async Task<string> ComputePrefixCacheKeyAsync(string prefixDataFilePath, string tracePrefixFilePath)
+        {
+            using var hash = IncrementalHash.CreateHash(HashAlgorithmName.SHA256);
+            hash.AppendData(BitConverter.GetBytes(_prefixCacheVersion));
+            hash.AppendData(BitConverter.GetBytes(TraceFile.RowFormatVersion));
+
+            byte[] buffer = new byte[1024 * 1024];
+            foreach(string path in new[] { prefixDataFilePath, tracePrefixFilePath })
+            {
+                await using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read, 1, FileOptions.SequentialScan);
+                hash.AppendData(BitConverter.GetBytes(stream.Length));
+
+                int bytesRead;
+                while((bytesRead = await stream.ReadAsync(buffer)) > 0)
+                    hash.AppendData(buffer, 0, bytesRead);
+            }
+
+            return Convert.ToHexString(hash.GetHashAndReset()).ToLowerInvariant();
+        }
+
+        /// <summary>
+        /// Loads the preprocessed trace prefix and the associated preprocessor state from the prefix cache, if an entry with the given key exists.
+        /// </summary>
+        /// <param name="prefixCacheKey">Key of the cache entry.</param>
+        /// <returns>The preprocessed trace prefix, or null if there is no usable cache entry.</returns>
+        private async Task<Memory<byte>?> TryLoadCachedPrefixAsync(string prefixCacheKey)
+        {
+            string prefixPath = Path.Combine(_prefixCacheDirectory!.FullName, prefixCacheKey + ".prefix");
+            string statePath = Path.Combine(_prefixCacheDirectory!.FullName, prefixCacheKey + ".state");
+            if(!File.Exists(prefixPath) || !File.Exists(statePath))
+            {
+                await Logger.LogDebugAsync($"[preprocess:prefix] Prefix cache miss ({prefixCacheKey})");
+                return null;
+            }
+
+            try
+            {
+                byte[] tracePrefixData = await File.ReadAllBytesAsync(prefixPath);
+                byte[] stateData = await File.ReadAllBytesAsync(statePath);
+
+                // Restore image list, in the order used for preprocessing
+                var imageReader = new FastBinaryBufferReader(tracePrefixData);
+                var imageFiles = new TracePrefixFile.ImageFileInfo[imageReader.ReadInt32()];
+                for(int i = 0; i < imageFiles.Length; ++i)
+                    imageFiles[i] = new TracePrefixFile.ImageFileInfo(imageReader);
+
+                // Restore preprocessor state
+                var stateReader = new FastBinaryBufferReader(stateData);
+                ulong stackPointerMin = stateReader.ReadUInt64();
+                ulong stackPointerMax = stateReader.ReadUInt64();
+                int lastHeapAllocationId = stateReader.ReadInt32();
+                int lastStackAllocationId = stateReader.ReadInt32();
+
+                int heapAllocationCount = stateReader.ReadInt32();
+                var heapAllocationLookup = new HeapAllocationIndex();
+                for(int i = 0; i < heapAllocationCount; ++i)
+                {
+                    var heapAllocation = new HeapAllocation
+                    {
+                        Id = stateReader.ReadInt32(),
+                        Size = stateReader.ReadUInt32(),
+                        Address = stateReader.ReadUInt64()
+                    };
+                    heapAllocationLookup.Add(heapAllocation);
+                }
+
+                int stackFrameCount = stateReader.ReadInt32();
+                var stackFrames = new List<(int id, ulong baseAddress)>(stackFrameCount);
+                for(int i = 0; i < stackFrameCount; ++i)
+                    stackFrames.Add((stateReader.ReadInt32(), stateReader.ReadUInt64()));
+
+                var callStacks = new CallStackTrie(stateReader);
+                var callStackIds = new int[stateReader.ReadInt32()];
+                for(int i = 0; i < callStackIds.Length; ++i)
+                    callStackIds[i] = stateReader.ReadInt32();
+
+                _imageFiles = imageFiles;
+                _stackPointerMin = stackPointerMin;
+                _stackPointerMax = stackPointerMax;
+                _tracePrefixLastHeapAllocationId = lastHeapAllocationId;
+                _tracePrefixLastStackAllocationId = lastStackAllocationId;
+                heapAllocationLookup.CacheLastHit = false; // Shared by all preprocessing threads
+                _tracePrefixHeapAllocationLookup = heapAllocationLookup;
+                _tracePrefixStackFrames = stackFrames;
+                _callStacks = callStacks;
+                _tracePrefixCallStackIds = callStackIds;
+
+                await Logger.LogInfoAsync($"[preprocess:prefix] Loaded preprocessed trace prefix from cache ({prefixCacheKey})");
+                return tracePrefixData;
+            }
+            catch(Exception ex) when(ex is IOException or IndexOutOfRangeException or ArgumentOutOfRangeException)
+            {
+                await Logger.LogWarningAsync($"[preprocess:prefix] Could not load cached trace prefix ({prefixCacheKey}), preprocessing it again: {ex.Message}");
+                return null;
+            }
+        }
+
+        /// <summary>
+        /// Stores the preprocessed trace prefix and the associated preprocessor state in the prefix cache.
+        /// </summary>
+        /// <param name="prefixCacheKey">Key of the cache entry.</param>
+        /// <param name="preprocessedTracePrefixData">The preprocessed trace prefix.</param>
+        private async Task StorePrefixInCacheAsync(string prefixCacheKey, Memory<byte> preprocessedTracePrefixData)
+        {
+            // Serialize preprocessor state
+            using var stateWriter = new FastBinaryBufferWriter(4 * 8 + _tracePrefixHeapAllocationLookup!.Count * 16 + _tracePrefixStackFrames!.Count * 12
+                                                               + 4 + _callStacks.Count * (4 + 8 + 8 + 4) + 4 + _tracePrefixCallStackIds!.Length * 4);
+            stateWriter.WriteUInt64(_stackPointerMin);
+            stateWriter.WriteUInt64(_stackPointerMax);
+            stateWriter.WriteInt32(_tracePrefixLastHeapAllocationId);
+            stateWriter.WriteInt32(_tracePrefixLastStackAllocationId);
+            stateWriter.WriteInt32(_tracePrefixHeapAllocationLookup.Count);
+            foreach(var heapAllocation in _tracePrefixHeapAllocationLookup.Allocations)
+            {
+                stateWriter.WriteInt32(heapAllocation.Id);
+                stateWriter.WriteUInt32(heapAllocation.Size);
+                stateWriter.WriteUInt64(heapAllocation.Address);
+            }
+            stateWriter.WriteInt32(_tracePrefixStackFrames.Count);
+            foreach(var (id, baseAddress) in _tracePrefixStackFrames)
+            {
+                stateWriter.WriteInt32(id);
+                stateWriter.WriteUInt64(baseAddress);
+            }
+            _callStacks.Store(stateWriter);
+            stateWriter.WriteInt32(_tracePrefixCallStackIds.Length);
+            foreach(int callStackId in _tracePrefixCallStackIds)
+                stateWriter.WriteInt32(callStackId);
+
+            // Write to temporary files first, so concurrent runs never see incomplete entries
+            string prefixPath = Path.Combine(_prefixCacheDirectory!.FullName, prefixCacheKey + ".prefix");
+            string statePath = Path.Combine(_prefixCacheDirectory!.FullName, prefixCacheKey + ".state");
+            string temporarySuffix = $".{Environment.ProcessId}.tmp";
+            try
+            {
+                await File.WriteAllBytesAsync(statePath + temporarySuffix, stateWriter.Buffer.AsMemory(0, stateWriter.Length).ToArray());
+                await using(var prefixStream = File.Open(prefixPath + temporarySuffix, FileMode.Create, FileAccess.Write, FileShare.None))
+                    await prefixStream.WriteAsync(preprocessedTracePrefixData);
+
+                File.Move(statePath + temporarySuffix, statePath, true);
+                File.Move(prefixPath + temporarySuffix, prefixPath, true);
+
+                await Logger.LogDebugAsync($"[preprocess:prefix] Stored preprocessed trace prefix in cache ({prefixCacheKey})");
+            }
+            catch(IOException ex)
+            {
+                await Logger.LogWarningAsync($"[preprocess:prefix] Could not store trace prefix in cache: {ex.Message}");
+            }
+        }
+
         /// <summary>
         /// Preprocesses the given raw trace file and emits a preprocessed one.
         /// </summary>
         /// <param name="inputFileName">Input file.</param>
         /// <param name="isPrefix">Determines whether the prefix file is handled.</param>
-        /// <param name="traceFileWriter">Writer for storing the preprocessed trace data.</param>
+        /// <param name="traceFileWriter">Writer for storing the preprocessed trace data, either in memory or in a file.</param>
         /// <param name="logPrefix">Short prefix for log messages printed by this function.</param>
         /// <remarks>
         /// This function as not designed as asynchronous, to allow unsafe operations and stack allocations.
         /// </remarks>
-        private unsafe void PreprocessFile(string inputFileName, bool isPrefix, FastBinaryBufferWriter traceFileWriter, string logPrefix)
+        private unsafe void PreprocessFile(string inputFileName, bool isPrefix, IFastBinaryWriter traceFileWriter, string logPrefix)
         {
-            // Read entire trace file into memory, since these files should not get too big
-            byte[] inputFile = File.ReadAllBytes(inputFileName);
-            int inputFileLength = inputFile.Length;
+            // The trace file is mapped into memory chunk by chunk, so memory usage does not depend on the trace size
+            long inputFileLength = new FileInfo(inputFileName).Length;
             int rawTraceEntrySize = Marshal.SizeOf(typeof(RawTraceEntry));
+            if(inputFileLength % rawTraceEntrySize != 0)
+                Logger.LogWarningAsync($"{logPrefix} Raw trace file size is not a multiple of the entry size, ignoring incomplete last entry").Wait();
 
             // Resize output buffer to avoid re-allocations
-            traceFileWriter.ResizeBuffer(MaxPreprocessedTraceEntrySize * inputFileLength / rawTraceEntrySize);
+            if(traceFileWriter is FastBinaryBufferWriter traceFileBufferWriter)
+                traceFileBufferWriter.ResizeBuffer((int)Math.Min(Array.MaxLength / 2, MaxPreprocessedTraceEntrySize * (inputFileLength / rawTraceEntrySize)));
 
             // Parse trace entries
             var lastAllocationSizes = new Stack<uint>();
@@ -225,366 +498,397 @@ namespace Microwalk.Plugins.PinTracer
                 stackFrames.AddRange(_tracePrefixStackFrames);
             ulong lastAllocReturnAddress = 0;
             bool encounteredSizeSinceLastAlloc = false;
-            var heapAllocationLookup = new SortedList<ulong, HeapAllocation>();
+            var heapAllocationLookup = new HeapAllocationIndex();
             int nextHeapAllocationId = isPrefix ? 0 : _tracePrefixLastHeapAllocationId + 1;
             int nextStackAllocationId = isPrefix ? 0 : _tracePrefixLastStackAllocationId + 1;
-            fixed(byte* inputFilePtr = inputFile)
+            var shadowCallStack = _tracePrefixCallStackIds == null ? new ShadowCallStack(_callStacks) : new ShadowCallStack(_callStacks, _tracePrefixCallStackIds);
+            int[]? resolvedImageIndices = !isPrefix && _intraTraceThreads > 1 && inputFileLength >= 2L * _resolveBlockEntryCount * rawTraceEntrySize
+                ? new int[2 * Math.Min(_rawTraceChunkEntryCount, inputFileLength / rawTraceEntrySize)]
+                : null;
+            using var inputFile = inputFileLength == 0 ? null : MemoryMappedFile.CreateFromFile(inputFileName, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+            long inputChunkSize = (long)rawTraceEntrySize * _rawTraceChunkEntryCount;
+            for(long chunkStart = 0; chunkStart < inputFileLength; chunkStart += inputChunkSize)
             {
-                for(long pos = 0; pos < inputFileLength; pos += rawTraceEntrySize)
+                long chunkLength = Math.Min(inputChunkSize, inputFileLength - chunkStart);
+                using var inputView = inputFile!.CreateViewAccessor(chunkStart, chunkLength, MemoryMappedFileAccess.Read);
+                byte* inputChunkPtr = null;
+                inputView.SafeMemoryMappedViewHandle.AcquirePointer(ref inputChunkPtr);
+                try
                 {
-                    // Read entry
-                    RawTraceEntry rawTraceEntry = *(RawTraceEntry*)&inputFilePtr[pos];
-                    switch(rawTraceEntry.Type)
-                    {
-                        case RawTraceEntryTypes.HeapAllocSizeParameter:
-                        {
-                            // Remember size parameter until the address return
-                            lastAllocationSizes.Push((uint)rawTraceEntry.Param1);
-                            encounteredSizeSinceLastAlloc = true;
+                    inputChunkPtr += inputView.PointerOffset;
+                    int chunkEntryCount = (int)(chunkLength / rawTraceEntrySize);
 
-                            break;
-                        }
+                    // Resolve the images of all entries in parallel, as this does not depend on the allocation state.
+                    // The remaining loop only handles the heap allocation, stack frame and call stack state, which is carried sequentially through the trace.
+                    if(resolvedImageIndices != null)
+                        ResolveImageIndices(inputChunkPtr, chunkEntryCount, resolvedImageIndices);
 
-                        case RawTraceEntryTypes.HeapAllocAddressReturn:
+                    for(int entryIndex = 0; entryIndex < chunkEntryCount; ++entryIndex)
+                    {
+                        // Read entry
+                        RawTraceEntry rawTraceEntry = *(RawTraceEntry*)&inputChunkPtr[(long)entryIndex * rawTraceEntrySize];
+                        switch(rawTraceEntry.Type)
                         {
-                            // Catch double returns of the same allocated address (happens for some allocator implementations)
-                            if(rawTraceEntry.Param2 == lastAllocReturnAddress && !encounteredSizeSinceLastAlloc)
+                            case RawTraceEntryTypes.HeapAllocSizeParameter:
                             {
-                                Logger.LogDebugAsync($"{logPrefix} Skipped double return of allocated address").Wait();
+                                // Remember size parameter until the address return
+                                lastAllocationSizes.Push((uint)rawTraceEntry.Param1);
+                                encounteredSizeSinceLastAlloc = true;
+
                                 break;
                             }
 
-                            // HeapAllocation stack empty?
-                            if(lastAllocationSizes.Count == 0)
+                            case RawTraceEntryTypes.HeapAllocAddressReturn:
                             {
-                                Logger.LogErrorAsync($"{logPrefix} Encountered heap allocation address return, but size stack is empty").Wait();
-                                break;
-                            }
+                                // Catch double returns of the same allocated address (happens for some allocator implementations)
+                                if(rawTraceEntry.Param2 == lastAllocReturnAddress && !encounteredSizeSinceLastAlloc)
+                                {
+                                    Logger.LogDebugAsync($"{logPrefix} Skipped double return of allocated address").Wait();
+                                    break;
+                                }
 
-                            uint size = lastAllocationSizes.Pop();
+                                // HeapAllocation stack empty?
+                                if(lastAllocationSizes.Count == 0)
+                                {
+                                    Logger.LogErrorAsync($"{logPrefix} Encountered heap allocation address return, but size stack is empty").Wait();
+                                    break;
+                                }
 
-                            // Create entry
-                            var entry = new HeapAllocation
-                            {
-                                Id = nextHeapAllocationId++,
-                                Size = size,
-                                Address = rawTraceEntry.Param2
-                            };
-                            entry.Store(traceFileWriter);
+                                uint size = lastAllocationSizes.Pop();
 
-                            // Store allocation information
-                            heapAllocationLookup[entry.Address] = entry;
+                                // Create entry
+                                var entry = new HeapAllocation
+                                {
+                                    Id = nextHeapAllocationId++,
+                                    Size = size,
+                                    Address = rawTraceEntry.Param2
+                                };
+                                entry.Store(traceFileWriter);
 
-                            // Update state
-                            lastAllocReturnAddress = entry.Address;
-                            encounteredSizeSinceLastAlloc = false;
+                                // Store allocation information
+                                heapAllocationLookup.Add(entry);
 
-                            break;
-                        }
+                                // Update state
+                                lastAllocReturnAddress = entry.Address;
+                                encounteredSizeSinceLastAlloc = false;
 
-                        case RawTraceEntryTypes.HeapFreeAddressParameter:
-                        {
-                            // Skip nonsense frees
-                            if(rawTraceEntry.Param2 == 0)
-                                break;
-                            if(!heapAllocationLookup.TryGetValue(rawTraceEntry.Param2, out var allocationEntry))
-                            {
-                                // Reasons why this may happen:
-                                // - We missed a heap allocation (unknown function, missed heap allocation address return due to tail call, ...)
-                                // - The allocation was within the prefix or another trace. Due to parallelism we do not carry over allocations from preceding traces
-                                Logger.LogWarningAsync($"{logPrefix} Free of address {rawTraceEntry.Param2:x16} does not correspond to any heap allocation, skipping").Wait();
                                 break;
                             }
 
-                            // Create entry
-                            var entry = new HeapFree
+                            case RawTraceEntryTypes.HeapFreeAddressParameter:
                             {
-                                Id = allocationEntry.Id
-                            };
-                            entry.Store(traceFileWriter);
-
-                            // Remove entry from allocation list
-                            heapAllocationLookup.Remove(allocationEntry.Address);
-
-                            break;
-                        }
-
-                        case RawTraceEntryTypes.StackPointerInfo:
-                        {
-                            // Save stack pointer data
-                            _stackPointerMin = rawTraceEntry.Param1;
-                            _stackPointerMax = rawTraceEntry.Param2;
-                            Logger.LogDebugAsync($"{logPrefix} Stack pointer info: {_stackPointerMin:x16}..{_stackPointerMax:x16}");
+                                // Skip nonsense frees
+                                if(rawTraceEntry.Param2 == 0)
+                                    break;
+                                if(!heapAllocationLookup.TryGetByAddress(rawTraceEntry.Param2, out var allocationEntry))
+                                {
+                                    // Reasons why this may happen:
+                                    // - We missed a heap allocation (unknown function, missed heap allocation address return due to tail call, ...)
+                                    // - The allocation was within the prefix or another trace. Due to parallelism we do not carry over allocations from preceding traces
+                                    Logger.LogWarningAsync($"{logPrefix} Free of address {rawTraceEntry.Param2:x16} does not correspond to any heap allocation, skipping").Wait();
+                                    break;
+                                }
 
-                            // HACK See comment below
-                            if(stackFrames.Count == 0)
-                            {
-                                stackFrames.Add((nextStackAllocationId, _stackPointerMin));
-                                var entry = new StackAllocation
+                                // Create entry
+                                var entry = new HeapFree
                                 {
-                                    Id = nextStackAllocationId++,
-                                    InstructionImageId = _imageFiles.First().Id,
-                                    InstructionRelativeAddress = 0,
-                                    Size = (uint)(_stackPointerMax - _stackPointerMin),
-                                    Address = _stackPointerMin
+                                    Id = allocationEntry.Id
                                 };
                                 entry.Store(traceFileWriter);
-                            }
 
-                            break;
-                        }
+                                // Remove entry from allocation list
+                                heapAllocationLookup.Remove(allocationEntry);
 
-                        case RawTraceEntryTypes.StackPointerModification:
-                        {
-                            // TODO This is disabled for now. Problem: A function without any call instructions may never explicitly allocate a stack frame,
-                            //      because it doesn't need to ("red zone"). It can just use the empty stack space. However, this breaks the assumption of
-                            //      our stack frame tracking: We can't determine a minimum "base address" for stack frame, but have to use the stack pointer
-                            //      at the time of the call/ret instruction. This in turn means that stack memory accesses need to support negative offsets.
-                            //      For the time being, we just generate a single dummy stack frame and ignore all other stack pointer data.
-
-                            /*
-                             * To reduce overhead and complexity, we focus on the "easy" and most likely cases:
-                             * (STACKMOD marks a StackPointerModification trace entry)
-                             *
-                             *     call func       ; STACKMOD - new <stack frame #x+1> with the return address (and possible arguments on the stack)
-                             * 
-                             *   func:
-                             *     push r15        ; ignored
-                             *     sub rsp, 0x20   ; STACKMOD - new <stack frame #x+2> which includes the pushed register
-                             *     ...
-                             *     add rsp, 0x20   ; STACKMOD - new temporary <stack frame #x+3> which only includes the pushed register;
-                             *                     ;   will get discarded with the next call instruction, so this causes no harm
-                             *     pop r15         ; ignored
-                             *     ret             ; STACKMOD - end of <stack frame #x+1>; if there are arguments on the stack, there may be allocation of
-                             *                     ;   temporary <stack frame #x+4>. This causes no harm, as this scenario (lots of arguments) is unlikely
-                             *
-                             * -- OR --
-                             *
-                             *     call func       ; STACKMOD - new <stack frame #x+1> with the return address (and possible arguments on the stack)
-                             * 
-                             *   func:
-                             *     sub rsp, 0x20   ; STACKMOD - new <stack frame #x+2>
-                             *     ...
-                             *     ret 0x20        ; STACKMOD - full deallocation of <stack frame #x+2> and <stack frame #x+1>, <stack frame #x> is back on top, or
-                             *                     ;   creation of temporary <stack frame #x+3> if there are arguments on the stack
-                             *
-                             * The temporary stack frames usually get quietly discarded, as push/pop instructions are ignored and there will probably be no
-                             * other direct accesses to that areas.
-                             */
-
-                            /*
-                            // Remove all addresses from stack frame list which are strictly smaller than the new one
-                            // We assume that an instruction never accesses addresses which are _before_ (i.e. smaller than) the current stack frame
-                            ulong newStackPointerValue = rawTraceEntry.Param2;
-                            while(stackFrames.Count > 0 && stackFrames[^1].baseAddress < newStackPointerValue)
+                                break;
+                            }
+
+                            case RawTraceEntryTypes.StackPointerInfo:
                             {
-                                stackFrames.RemoveAt(stackFrames.Count - 1);
+                                // Save stack pointer data
+                                _stackPointerMin = rawTraceEntry.Param1;
+                                _stackPointerMax = rawTraceEntry.Param2;
+                                Logger.LogDebugAsync($"{logPrefix} Stack pointer info: {_stackPointerMin:x16}..{_stackPointerMax:x16}");
+
+                                // HACK See comment below
+                                if(stackFrames.Count == 0)
+                                {
+                                    stackFrames.Add((nextStackAllocationId, _stackPointerMin));
+                                    var entry = new StackAllocation
+                                    {
+                                        Id = nextStackAllocationId++,
+                                        InstructionImageId = _imageFiles.First().Id,
+                                        InstructionRelativeAddress = 0,
+                                        Size = (uint)(_stackPointerMax - _stackPointerMin),
+                                        Address = _stackPointerMin
+                                    };
+                                    entry.Store(traceFileWriter);
+                                }
+
+                                break;
                             }
 
-                            // The new address is the top most stack frame
-                            if(stackFrames.Count == 0 || stackFrames[^1].baseAddress != newStackPointerValue)
+                            case RawTraceEntryTypes.StackPointerModification:
                             {
-                                // Resolve allocating instruction
-                                var (instructionImageId, instructionImage) = FindImage(rawTraceEntry.Param1);
-                                if(instructionImageId < 0)
+                                // TODO This is disabled for now. Problem: A function without any call instructions may never explicitly allocate a stack frame,
+                                //      because it doesn't need to ("red zone"). It can just use the empty stack space. However, this breaks the assumption of
+                                //      our stack frame tracking: We can't determine a minimum "base address" for stack frame, but have to use the stack pointer
+                                //      at the time of the call/ret instruction. This in turn means that stack memory accesses need to support negative offsets.
+                                //      For the time being, we just generate a single dummy stack frame and ignore all other stack pointer data.
+
+                                /*
+                                 * To reduce overhead and complexity, we focus on the "easy" and most likely cases:
+                                 * (STACKMOD marks a StackPointerModification trace entry)
+                                 *
+                                 *     call func       ; STACKMOD - new <stack frame #x+1> with the return address (and possible arguments on the stack)
+                                 * 
+                                 *   func:
+                                 *     push r15        ; ignored
+                                 *     sub rsp, 0x20   ; STACKMOD - new <stack frame #x+2> which includes the pushed register
+                                 *     ...
+                                 *     add rsp, 0x20   ; STACKMOD - new temporary <stack frame #x+3> which only includes the pushed register;
+                                 *                     ;   will get discarded with the next call instruction, so this causes no harm
+                                 *     pop r15         ; ignored
+                                 *     ret             ; STACKMOD - end of <stack frame #x+1>; if there are arguments on the stack, there may be allocation of
+                                 *                     ;   temporary <stack frame #x+4>. This causes no harm, as this scenario (lots of arguments) is unlikely
+                                 *
+                                 * -- OR --
+                                 *
+                                 *     call func       ; STACKMOD - new <stack frame #x+1> with the return address (and possible arguments on the stack)
+                                 * 
+                                 *   func:
+                                 *     sub rsp, 0x20   ; STACKMOD - new <stack frame #x+2>
+                                 *     ...
+                                 *     ret 0x20        ; STACKMOD - full deallocation of <stack frame #x+2> and <stack frame #x+1>, <stack frame #x> is back on top, or
+                                 *                     ;   creation of temporary <stack frame #x+3> if there are arguments on the stack
+                                 *
+                                 * The temporary stack frames usually get quietly discarded, as push/pop instructions are ignored and there will probably be no
+                                 * other direct accesses to that areas.
+                                 */
+
+                                /*
+                                // Remove all addresses from stack frame list which are strictly smaller than the new one
+                                // We assume that an instruction never accesses addresses which are _before_ (i.e. smaller than) the current stack frame
+                                ulong newStackPointerValue = rawTraceEntry.Param2;
+                                while(stackFrames.Count > 0 && stackFrames[^1].baseAddress < newStackPointerValue)
                                 {
-                                    Logger.LogWarningAsync($"{logPrefix} Could not resolve image information of instruction {rawTraceEntry.Param1:x16}, skipping").Wait();
-                                    break;
+                                    stackFrames.RemoveAt(stackFrames.Count - 1);
                                 }
 
-                                // Create trace entry
-                                var entry = new StackAllocation
+                                // The new address is the top most stack frame
+                                if(stackFrames.Count == 0 || stackFrames[^1].baseAddress != newStackPointerValue)
                                 {
-                                    Id = nextStackAllocationId++,
-                                    InstructionImageId = instructionImageId,
-                                    InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage!.StartAddress),
-                                    Size = (uint)(stackFrames.Count == 0 ? _stackPointerMax - newStackPointerValue : stackFrames[^1].baseAddress - newStackPointerValue),
-                                    Address = newStackPointerValue
-                                };
-                                entry.Store(traceFileWriter);
+                                    // Resolve allocating instruction
+                                    var (instructionImageId, instructionImage) = FindImage(rawTraceEntry.Param1);
+                                    if(instructionImageId < 0)
+                                    {
+                                        Logger.LogWarningAsync($"{logPrefix} Could not resolve image information of instruction {rawTraceEntry.Param1:x16}, skipping").Wait();
+                                        break;
+                                    }
 
-                                stackFrames.Add((entry.Id, newStackPointerValue));
-                            }
-                            */
-
-                            /*
-                            // NOTE The instruction type flag is ignored right now, as the stack pointer tracking technique does not depend on it.
-                            //      It may be used to do more fine granular tracking, or for inferring which kind of data is contained in the allocation blocks.
-                            var flags = (RawTraceStackPointerModificationEntryFlags)rawTraceEntry.Flag;
-                            var instructionType = flags & RawTraceStackPointerModificationEntryFlags.InstructionTypeMask;
-                            if(instructionType == RawTraceStackPointerModificationEntryFlags.PushOrPop)
-                            {
-                                
-                            }
-                            else if(instructionType == RawTraceStackPointerModificationEntryFlags.Return)
-                            {
-                                
-                            }
-                            else if(instructionType == RawTraceStackPointerModificationEntryFlags.Other)
-                            {
-                                
-                            }
-                            */
+                                    // Create trace entry
+                                    var entry = new StackAllocation
+                                    {
+                                        Id = nextStackAllocationId++,
+                                        InstructionImageId = instructionImageId,
+                                        InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage!.StartAddress),
+                                        Size = (uint)(stackFrames.Count == 0 ? _stackPointerMax - newStackPointerValue : stackFrames[^1].baseAddress - newStackPointerValue),
+                                        Address = newStackPointerValue
+                                    };
+                                    entry.Store(traceFileWriter);
 
-                            break;
-                        }
+                                    stackFrames.Add((entry.Id, newStackPointerValue));
+                                }
+                                */
+
+                                /*
+                                // NOTE The instruction type flag is ignored right now, as the stack pointer tracking technique does not depend on it.
+                                //      It may be used to do more fine granular tracking, or for inferring which kind of data is contained in the allocation blocks.
+                                var flags = (RawTraceStackPointerModificationEntryFlags)rawTraceEntry.Flag;
+                                var instructionType = flags & RawTraceStackPointerModificationEntryFlags.InstructionTypeMask;
+                                if(instructionType == RawTraceStackPointerModificationEntryFlags.PushOrPop)
+                                {
+                            
+                                }
+                                else if(instructionType == RawTraceStackPointerModificationEntryFlags.Return)
+                                {
+                            
+                                }
+                                else if(instructionType == RawTraceStackPointerModificationEntryFlags.Other)
+                                {
+                            
+                                }
+                                */
 
-                        case RawTraceEntryTypes.Branch when !isPrefix:
-                        {
-                            // Find image of source and destination instruction
-                            var (sourceImageId, sourceImage) = FindImage(rawTraceEntry.Param1);
-                            var (destinationImageId, destinationImage) = FindImage(rawTraceEntry.Param2);
-                            if(sourceImageId < 0 || destinationImageId < 0)
-                            {
-                                Logger.LogWarningAsync($"{logPrefix} Could not resolve image information of branch {rawTraceEntry.Param1:x16} -> {rawTraceEntry.Param2:x16}, skipping").Wait();
                                 break;
                             }
 
-                            // Interesting?
-                            if(!sourceImage!.Interesting && !destinationImage!.Interesting)
-                                break;
-
-                            // Create entry
-                            var flags = (RawTraceBranchEntryFlags)rawTraceEntry.Flag;
-                            var entry = new Branch
-                            {
-                                SourceImageId = sourceImageId,
-                                SourceInstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - sourceImage.StartAddress),
-                                DestinationImageId = destinationImageId,
-                                DestinationInstructionRelativeAddress = (uint)(rawTraceEntry.Param2 - destinationImage!.StartAddress),
-                                Taken = (flags & RawTraceBranchEntryFlags.Taken) != 0
-                            };
-                            var rawBranchType = flags & RawTraceBranchEntryFlags.BranchEntryTypeMask;
-                            if(rawBranchType == RawTraceBranchEntryFlags.Jump)
-                                entry.BranchType = Branch.BranchTypes.Jump;
-                            else if(rawBranchType == RawTraceBranchEntryFlags.Call)
-                                entry.BranchType = Branch.BranchTypes.Call;
-                            else if(rawBranchType == RawTraceBranchEntryFlags.Return)
-                                entry.BranchType = Branch.BranchTypes.Return;
-                            else
+                            case RawTraceEntryTypes.Branch:
                             {
-                                Logger.LogErrorAsync($"{logPrefix} Unspecified instruction type on branch {rawTraceEntry.Param1:x16} -> {rawTraceEntry.Param2:x16}, skipping").Wait();
-                                break;
-                            }
+                                // Find image of source and destination instruction
+                                var (sourceImageId, sourceImage) = GetImage(resolvedImageIndices, 2 * entryIndex, rawTraceEntry.Param1);
+                                var (destinationImageId, destinationImage) = GetImage(resolvedImageIndices, 2 * entryIndex + 1, rawTraceEntry.Param2);
+                                if(sourceImageId < 0 || destinationImageId < 0)
+                                {
+                                    Logger.LogWarningAsync($"{logPrefix} Could not resolve image information of branch {rawTraceEntry.Param1:x16} -> {rawTraceEntry.Param2:x16}, skipping").Wait();
+                                    break;
+                                }
 
-                            entry.Store(traceFileWriter);
+                                // Interesting?
+                                if(!sourceImage!.Interesting && !destinationImage!.Interesting)
+                                    break;
 
-                            break;
-                        }
+                                // Create entry
+                                var flags = (RawTraceBranchEntryFlags)rawTraceEntry.Flag;
+                                var entry = new Branch
+                                {
+                                    SourceImageId = sourceImageId,
+                                    SourceInstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - sourceImage.StartAddress),
+                                    DestinationImageId = destinationImageId,
+                                    DestinationInstructionRelativeAddress = (uint)(rawTraceEntry.Param2 - destinationImage!.StartAddress),
+                                    Taken = (flags & RawTraceBranchEntryFlags.Taken) != 0
+                                };
+                                var rawBranchType = flags & RawTraceBranchEntryFlags.BranchEntryTypeMask;
+                                if(rawBranchType == RawTraceBranchEntryFlags.Jump)
+                                    entry.BranchType = Branch.BranchTypes.Jump;
+                                else if(rawBranchType == RawTraceBranchEntryFlags.Call)
+                                    entry.BranchType = Branch.BranchTypes.Call;
+                                else if(rawBranchType == RawTraceBranchEntryFlags.Return)
+                                    entry.BranchType = Branch.BranchTypes.Return;
+                                else
+                                {
+                                    Logger.LogErrorAsync($"{logPrefix} Unspecified instruction type on branch {rawTraceEntry.Param1:x16} -> {rawTraceEntry.Param2:x16}, skipping").Wait();
+                                    break;
+                                }
 
-                        case RawTraceEntryTypes.MemoryRead when !isPrefix:
-                        case RawTraceEntryTypes.MemoryWrite when !isPrefix:
-                        {
-                            // Find image of instruction
-                            var (instructionImageId, instructionImage) = FindImage(rawTraceEntry.Param1);
-                            if(instructionImageId < 0)
-                            {
-                                Logger.LogWarningAsync($"{logPrefix} Could not resolve image information of instruction {rawTraceEntry.Param1:x16}, skipping").Wait();
-                                break;
-                            }
+                                // Assign interned call stack ID, so the analysis stages do not need to reconstruct the call stack
+                                shadowCallStack.Update(entry);
+
+                                // The prefix only contributes its call stack, its branches are not stored
+                                if(!isPrefix)
+                                    entry.Store(traceFileWriter);
 
-                            // Interesting?
-                            if(!instructionImage!.Interesting)
                                 break;
+                            }
 
-                            // Resolve access location: Image, stack or heap?
-                            bool isWrite = rawTraceEntry.Type == RawTraceEntryTypes.MemoryWrite;
-                            if(_stackPointerMin <= rawTraceEntry.Param2 && rawTraceEntry.Param2 <= _stackPointerMax)
+                            case RawTraceEntryTypes.MemoryRead when !isPrefix:
+                            case RawTraceEntryTypes.MemoryWrite when !isPrefix:
                             {
-                                // Find stack allocation
-                                int stackAllocationId = -1;
-                                ulong relativeAddress = 0;
-                                bool stackFrameFound = false;
-                                for(int i = stackFrames.Count - 1; i >= 0; --i)
+                                // Find image of instruction
+                                var (instructionImageId, instructionImage) = GetImage(resolvedImageIndices, 2 * entryIndex, rawTraceEntry.Param1);
+                                if(instructionImageId < 0)
                                 {
-                                    var currentStackFrame = stackFrames[i];
-                                    if(rawTraceEntry.Param2 >= currentStackFrame.baseAddress)
+                                    Logger.LogWarningAsync($"{logPrefix} Could not resolve image information of instruction {rawTraceEntry.Param1:x16}, skipping").Wait();
+                                    break;
+                                }
+
+                                // Interesting?
+                                if(!instructionImage!.Interesting)
+                                    break;
+
+                                // Resolve access location: Image, stack or heap?
+                                bool isWrite = rawTraceEntry.Type == RawTraceEntryTypes.MemoryWrite;
+                                if(_stackPointerMin <= rawTraceEntry.Param2 && rawTraceEntry.Param2 <= _stackPointerMax)
+                                {
+                                    // Find stack allocation
+                                    int stackAllocationId = -1;
+                                    ulong relativeAddress = 0;
+                                    bool stackFrameFound = false;
+                                    for(int i = stackFrames.Count - 1; i >= 0; --i)
                                     {
-                                        // Check next stack frame
-                                        if(i == 0 || stackFrames[i - 1].baseAddress > rawTraceEntry.Param2)
+                                        var currentStackFrame = stackFrames[i];
+                                        if(rawTraceEntry.Param2 >= currentStackFrame.baseAddress)
                                         {
-                                            // We've found our allocation
-                                            stackAllocationId = currentStackFrame.id;
-                                            relativeAddress = rawTraceEntry.Param2 - currentStackFrame.baseAddress;
-                                            stackFrameFound = true;
-
-                                            break;
+                                            // Check next stack frame
+                                            if(i == 0 || stackFrames[i - 1].baseAddress > rawTraceEntry.Param2)
+                                            {
+                                                // We've found our allocation
+                                                stackAllocationId = currentStackFrame.id;
+                                                relativeAddress = rawTraceEntry.Param2 - currentStackFrame.baseAddress;
+                                                stackFrameFound = true;
+
+                                                break;
+                                            }
                                         }
                                     }
-                                }
 
-                                if(!stackFrameFound)
-                                {
-                                    Logger.LogWarningAsync($"{logPrefix} Could not resolve stack frame of stack memory access {rawTraceEntry.Param1:x16} -> [{rawTraceEntry.Param2:x16}] ({(isWrite ? "write" : "read")}), skipping")
-                                        .Wait();
+                                    if(!stackFrameFound)
+                                    {
+                                        Logger.LogWarningAsync($"{logPrefix} Could not resolve stack frame of stack memory access {rawTraceEntry.Param1:x16} -> [{rawTraceEntry.Param2:x16}] ({(isWrite ? "write" : "read")}), skipping")
+                                            .Wait();
 
-                                    break;
-                                }
+                                        break;
+                                    }
 
-                                var entry = new StackMemoryAccess
-                                {
-                                    IsWrite = isWrite,
-                                    Size = rawTraceEntry.Param0,
-                                    InstructionImageId = instructionImageId,
-                                    InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage.StartAddress),
-                                    StackAllocationBlockId = stackAllocationId,
-                                    MemoryRelativeAddress = (uint)relativeAddress
-                                };
-                                entry.Store(traceFileWriter);
-                            }
-                            else
-                            {
-                                // Image
-                                var (accessedImageId, accessedImage) = FindImage(rawTraceEntry.Param2);
-                                if(accessedImageId >= 0)
-                                {
-                                    var entry = new ImageMemoryAccess
+                                    var entry = new StackMemoryAccess
                                     {
                                         IsWrite = isWrite,
                                         Size = rawTraceEntry.Param0,
                                         InstructionImageId = instructionImageId,
                                         InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage.StartAddress),
-                                        MemoryImageId = accessedImageId,
-                                        MemoryRelativeAddress = (uint)(rawTraceEntry.Param2 - accessedImage!.StartAddress)
+                                        StackAllocationBlockId = stackAllocationId,
+                                        MemoryRelativeAddress = (uint)relativeAddress
                                     };
                                     entry.Store(traceFileWriter);
                                 }
                                 else
                                 {
-                                    // Heap
-                                    var (allocationBlockId, allocationBlock) = FindAllocation(heapAllocationLookup, rawTraceEntry.Param2);
-                                    if(allocationBlockId < 0)
-                                        (allocationBlockId, allocationBlock) = FindAllocation(_tracePrefixHeapAllocationLookup!, rawTraceEntry.Param2);
-                                    if(allocationBlockId < 0)
+                                    // Image
+                                    var (accessedImageId, accessedImage) = GetImage(resolvedImageIndices, 2 * entryIndex + 1, rawTraceEntry.Param2);
+                                    if(accessedImageId >= 0)
                                     {
-                                        Logger.LogWarningAsync($"{logPrefix} Could not resolve target of memory access {rawTraceEntry.Param1:x16} -> [{rawTraceEntry.Param2:x16}] ({(isWrite ? "write" : "read")}), skipping").Wait();
-                                        break;
+                                        var entry = new ImageMemoryAccess
+                                        {
+                                            IsWrite = isWrite,
+                                            Size = rawTraceEntry.Param0,
+                                            InstructionImageId = instructionImageId,
+                                            InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage.StartAddress),
+                                            MemoryImageId = accessedImageId,
+                                            MemoryRelativeAddress = (uint)(rawTraceEntry.Param2 - accessedImage!.StartAddress)
+                                        };
+                                        entry.Store(traceFileWriter);
                                     }
-
-                                    var entry = new HeapMemoryAccess
+                                    else
                                     {
-                                        IsWrite = isWrite,
-                                        Size = rawTraceEntry.Param0,
-                                        InstructionImageId = instructionImageId,
-                                        InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage.StartAddress),
-                                        HeapAllocationBlockId = allocationBlockId,
-                                        MemoryRelativeAddress = (uint)(rawTraceEntry.Param2 - allocationBlock!.Address)
-                                    };
-                                    entry.Store(traceFileWriter);
+                                        // Heap
+                                        var allocationBlock = heapAllocationLookup.Find(rawTraceEntry.Param2)
+                                                              ?? _tracePrefixHeapAllocationLookup!.Find(rawTraceEntry.Param2);
+                                        if(allocationBlock == null)
+                                        {
+                                            Logger.LogWarningAsync($"{logPrefix} Could not resolve target of memory access {rawTraceEntry.Param1:x16} -> [{rawTraceEntry.Param2:x16}] ({(isWrite ? "write" : "read")}), skipping").Wait();
+                                            break;
+                                        }
+
+                                        var entry = new HeapMemoryAccess
+                                        {
+                                            IsWrite = isWrite,
+                                            Size = rawTraceEntry.Param0,
+                                            InstructionImageId = instructionImageId,
+                                            InstructionRelativeAddress = (uint)(rawTraceEntry.Param1 - instructionImage.StartAddress),
+                                            HeapAllocationBlockId = allocationBlock.Id,
+                                            MemoryRelativeAddress = (uint)(rawTraceEntry.Param2 - allocationBlock.Address)
+                                        };
+                                        entry.Store(traceFileWriter);
+                                    }
                                 }
-                            }
 
-                            break;
+                                break;
+                            }
                         }
                     }
                 }
+                finally
+                {
+                    inputView.SafeMemoryMappedViewHandle.ReleasePointer();
+                }
             }
 
             // Create trace file object
             if(isPrefix)
             {
+                heapAllocationLookup.CacheLastHit = false; // Shared by all preprocessing threads
                 _tracePrefixHeapAllocationLookup = heapAllocationLookup;
                 _tracePrefixStackFrames = stackFrames;
+                _tracePrefixCallStackIds = shadowCallStack.GetCallStackIds();
                 _tracePrefixLastHeapAllocationId = nextHeapAllocationId - 1;
                 _tracePrefixLastStackAllocationId = nextStackAllocationId - 1;
             }
@@ -596,62 +900,95 @@ namespace Microwalk.Plugins.PinTracer
         /// <param name="address">The address to be searched.</param>
         /// <returns></returns>
         private (int, TracePrefixFile.ImageFileInfo?) FindImage(ulong address)
+        {
+            int index = FindImageIndex(address);
+            return index < 0 ? (-1, null) : (_imageFiles[index].Id, _imageFiles[index]);
+        }
+
+        /// <summary>
+        /// Finds the image that contains the given address and returns its index in the image list, or -1 if the image is not found.
+        /// </summary>
+        /// <param name="address">The address to be searched.</param>
+        /// <returns></returns>
+        private int FindImageIndex(ulong address)
         {
             // Find image by linear search; the image count is expected to be rather small
             // Images are sorted by "interesting" status, to reduce number of loop iterations
             // TODO Improve this further - maybe by counting hits and then sorting after processing the first non-prefix trace?
-            foreach(var img in _imageFiles)
+            for(int i = 0; i < _imageFiles.Length; ++i)
             {
+                var img = _imageFiles[i];
                 if(img.StartAddress <= address)
                 {
                     // Check end address
                     if(img.EndAddress >= address)
-                        return (img.Id, img);
+                        return i;
                 }
             }
 
-            return (-1, null);
+            return -1;
         }
 
         /// <summary>
-        /// Finds the allocation block that contains the given address and returns its ID, or -1 if the block is not found.
+        /// Returns the image that contains the given address, using the result of <see cref="ResolveImageIndices"/> if it is available.
         /// </summary>
-        /// <param name="allocationLookup">List containing all heap allocations, sorted by start address in ascending order.</param>
+        /// <param name="resolvedImageIndices">Resolved image indices of the current chunk. May be null.</param>
+        /// <param name="slot">Index of the address in the resolved image index array.</param>
         /// <param name="address">The address to be searched.</param>
         /// <returns></returns>
-        private (int, HeapAllocation?) FindAllocation(SortedList<ulong, HeapAllocation> allocationLookup, ulong address)
+        private (int, TracePrefixFile.ImageFileInfo?) GetImage(int[]? resolvedImageIndices, int slot, ulong address)
+        {
+            int index = resolvedImageIndices?[slot] ?? _imageIndexUnresolved;
+            if(index == _imageIndexUnresolved)
+                return FindImage(address);
+            return index < 0 ? (-1, null) : (_imageFiles[index].Id, _imageFiles[index]);
+        }
+
+        /// <summary>
+        /// Looks up the images of the instruction and target addresses of the given raw trace entries in parallel.
+        /// The image indices of entry i are stored at positions 2i and 2i+1 of the output array; addresses which are not looked up are marked as unresolved.
+        /// </summary>
+        /// <param name="entries">Pointer to the raw trace entries.</param>
+        /// <param name="entryCount">Number of raw trace entries.</param>
+        /// <param name="resolvedImageIndices">Output array.</param>
+        private unsafe void ResolveImageIndices(byte* entries, int entryCount, int[] resolvedImageIndices)
         {
-            // Use binary search to find allocation block with start address <= address
-            var startAddresses = allocationLookup.Keys;
-            int left = 0;
-            int right = startAddresses.Count - 1;
-            int index = -1;
-            bool found = false;
-            while(left <= right)
+            int rawTraceEntrySize = Marshal.SizeOf(typeof(RawTraceEntry));
+            nint entriesAddress = (nint)entries;
+            int blockCount = (entryCount + _resolveBlockEntryCount - 1) / _resolveBlockEntryCount;
+            Parallel.For(0, blockCount, new ParallelOptions { MaxDegreeOfParallelism = _intraTraceThreads }, block =>
             {
-                index = left + ((right - left) / 2);
-                ulong startAddress = startAddresses[index];
-                if(startAddress == address)
+                byte* blockEntries = (byte*)entriesAddress;
+                int end = Math.Min(entryCount, (block + 1) * _resolveBlockEntryCount);
+                for(int i = block * _resolveBlockEntryCount; i < end; ++i)
                 {
-                    found = true;
-                    break;
-                }
-                else if(startAddress < address)
-                    left = index + 1;
-                else
-                    right = index - 1;
-            }
+                    RawTraceEntry rawTraceEntry = *(RawTraceEntry*)&blockEntries[(long)i * rawTraceEntrySize];
+                    int instructionImageIndex = _imageIndexUnresolved;
+                    int targetImageIndex = _imageIndexUnresolved;
+                    switch(rawTraceEntry.Type)
+                    {
+                        case RawTraceEntryTypes.Branch:
+                        {
+                            instructionImageIndex = FindImageIndex(rawTraceEntry.Param1);
+                            targetImageIndex = FindImageIndex(rawTraceEntry.Param2);
+                            break;
+                        }
 
-            if(!found)
-                index = left - 1;
-            if(index < 0)
-                return (-1, default);
+                        case RawTraceEntryTypes.MemoryRead:
+                        case RawTraceEntryTypes.MemoryWrite:
+                        {
+                            // Stack accesses do not need an image lookup
+                            instructionImageIndex = FindImageIndex(rawTraceEntry.Param1);
+                            if(rawTraceEntry.Param2 < _stackPointerMin || _stackPointerMax < rawTraceEntry.Param2)
+                                targetImageIndex = FindImageIndex(rawTraceEntry.Param2);
+                            break;
+                        }
+                    }
 
-            // Check end address
-            var block = allocationLookup[startAddresses[index]];
-            if(address <= (block.Address + block.Size))
-                return (block.Id, block);
-            return (-1, default);
+                    resolvedImageIndices[2 * i] = instructionImageIndex;
+                    resolvedImageIndices[2 * i + 1] = targetImageIndex;
+                }
+            });
         }
 
         protected override Task InitAsync(MappingNode? moduleOptions)
@@ -664,14 +1001,35 @@ namespace Microwalk.Plugins.PinTracer
             _storeTraces = moduleOptions?.GetChildNodeOrDefault("store-traces")?.AsBoolean() ?? false;
             if(_storeTraces && outputDirectoryPath == null)
                 throw new ConfigurationException("Missing output directory for preprocessed traces.");
+            _streamTraces = moduleOptions?.GetChildNodeOrDefault("stream-traces")?.AsBoolean() ?? false;
+            if(_streamTraces && !_storeTraces)
+                throw new ConfigurationException("Streaming preprocessed traces requires storing them (store-traces).");
             _keepRawTraces = moduleOptions?.GetChildNodeOrDefault("keep-raw-traces")?.AsBoolean() ?? false;
 
+            string traceFormat = moduleOptions?.GetChildNodeOrDefault("trace-format")?.AsString() ?? "row";
+            _columnarTraces = traceFormat switch
+            {
+                "row" => false,
+                "columnar" => true,
+                _ => throw new ConfigurationException($"Unknown preprocessed trace format \"{traceFormat}\".")
+            };
+
+            _intraTraceThreads = moduleOptions?.GetChildNodeOrDefault("intra-trace-threads")?.AsInteger() ?? 1;
+            if(_intraTraceThreads < 1)
+                throw new ConfigurationException("The number of intra-trace threads must be positive.");
+
+            string? prefixCacheDirectoryPath = moduleOptions?.GetChildNodeOrDefault("prefix-cache-directory")?.AsString();
+            if(prefixCacheDirectoryPath != null)
+                _prefixCacheDirectory = Directory.CreateDirectory(prefixCacheDirectoryPath);
+
             return Task.CompletedTask;
         }
 
-        public override Task UnInitAsync()
+        public override async Task UnInitAsync()
         {
-            return Task.CompletedTask;
+            // Store call stacks, so the preprocessed traces can be loaded again
+            if(_storeTraces && !_firstTestcase)
+                await StoreCallStacksAsync(_tracePrefix.CallStacks, _outputDirectory!);
         }
 
         /// <summary>
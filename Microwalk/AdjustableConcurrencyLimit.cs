@@ -0,0 +1,106 @@
+﻿using System.Threading;
+using System.Threading.Tasks;
+
+namespace Microwalk;
+
+/// <summary>
+/// Limits the number of concurrent operations, like a <see cref="SemaphoreSlim"/>, but allows changing the limit at runtime.
+///
+/// Raising the limit releases additional slots. Lowering the limit takes free slots immediately; if there are not enough free slots, the next
+/// released slots are retained instead, so running operations are never interrupted.
+/// </summary>
+internal class AdjustableConcurrencyLimit
+{
+    private readonly SemaphoreSlim _semaphore;
+
+    /// <summary>
+    /// Number of slots which must be retained when they are released, to reach a lowered limit.
+    /// </summary>
+    private int _pendingReductions;
+
+    private int _limit;
+    private int _waitingCount;
+
+    /// <summary>
+    /// Creates a new concurrency limit.
+    /// </summary>
+    /// <param name="limit">Initial limit.</param>
+    public AdjustableConcurrencyLimit(int limit)
+    {
+        _limit = limit;
+        _semaphore = new SemaphoreSlim(limit);
+    }
+
+    /// <summary>
+    /// Current limit.
+    /// </summary>
+    public int Limit => Volatile.Read(ref _limit);
+
+    /// <summary>
+    /// Number of operations which wait for a slot.
+    /// </summary>
+    public int WaitingCount => Volatile.Read(ref _waitingCount);
+
+    /// <summary>
+    /// Waits for a free slot.
+    /// </summary>
+    /// <param name="token">Cancellation token.</param>
+    public async Task WaitAsync(CancellationToken token = default)
+    {
+        Interlocked.Increment(ref _waitingCount);
+        try
+        {
+            await _semaphore.WaitAsync(token);
+        }
+        finally
+        {
+            Interlocked.Decrement(ref _waitingCount);
+        }
+    }
+
+    /// <summary>
+    /// Releases a slot which was acquired through <see cref="WaitAsync"/>.
+    /// </summary>
+    public void Release()
+    {
+        lock(_semaphore)
+        {
+            if(_pendingReductions > 0)
+            {
+                --_pendingReductions;
+                return;
+            }
+
+            _semaphore.Release();
+        }
+    }
+
+    /// <summary>
+    /// Changes the limit.
+    /// </summary>
+    /// <param name="limit">New limit, must be positive.</param>
+    public void SetLimit(int limit)
+    {
+        lock(_semaphore)
+        {
+            int difference = limit - _limit;
+            _limit = limit;
+
+            if(difference > 0)
+            {
+                // Cancel pending reductions first
+                int cancelledReductions = difference < _pendingReductions ? difference : _pendingReductions;
+                _pendingReductions -= cancelledReductions;
+                if(difference > cancelledReductions)
+                    _semaphore.Release(difference - cancelledReductions);
+            }
+            else if(difference < 0)
+            {
+                // Take free slots, and retain the remaining ones when they are released
+                _pendingReductions -= difference;
+                while(_pendingReductions > 0 && _semaphore.Wait(0))
+                    --_pendingReductions;
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -5,15 +5,17 @@ using System.Collections.Generic;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Runtime.InteropServices;
+using System.Threading;
 using System.Threading.Tasks;
 using Microwalk.FrameworkBase;
 using Microwalk.FrameworkBase.Configuration;
 using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.Extensions;
 using Microwalk.FrameworkBase.Stages;
 using Microwalk.FrameworkBase.TraceFormat;
 using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
 using Microwalk.FrameworkBase.Utilities;
-using Standart.Hash.xxHash;
 
 namespace Microwalk.Analysis.Modules
 {
@@ -23,9 +25,21 @@ namespace Microwalk.Analysis.Modules
         private const string _genericLogMessagePrefix = "[analyze:csmal]";
         
         /// <summary>
-        /// Maps testcase IDs to call trees.
+        /// Memory access hashes aggregated over all testcases, indexed by call stack hash.
+        /// The call stack IDs of the traces depend on the order in which the traces were preprocessed, so they can not be used for merging saved states
+        /// of other runs.
         /// </summary>
-        private readonly ConcurrentDictionary<int, CallTreeNode> _testcaseCallTrees = new();
+        private readonly ConcurrentDictionary<ulong, CallStackData> _callStackData = new();
+
+        /// <summary>
+        /// Number of analyzed testcases.
+        /// </summary>
+        private int _testcaseCount;
+
+        /// <summary>
+        /// Running leakage estimate per (call stack hash, instruction ID). Only updated when <see cref="AnalysisStage.TrackLeakageEstimates"/> is set.
+        /// </summary>
+        private readonly LeakageEstimator<(ulong, ulong)> _leakageEstimator = new();
 
         /// <summary>
         /// Maps instruction addresses to formatted instructions.
@@ -54,7 +68,11 @@ namespace Microwalk.Analysis.Modules
 
         public override bool SupportsParallelism => true;
 
-        public override async Task AddTraceAsync(TraceEntity traceEntity)
+        public override bool SupportsLeakageEstimates => true;
+
+        public override bool SupportsStateSerialization => true;
+
+        public override Task AddTraceAsync(TraceEntity traceEntity)
         {
             // Input check
             if(traceEntity.PreprocessedTraceFile == null)
@@ -62,237 +80,103 @@ namespace Microwalk.Analysis.Modules
             
             string logMessagePrefix = $"[analyze:csmal:{traceEntity.Id}]";
             
-            // Trace call tree
-            var currentCallTree = new Stack<CallTreeNode>();
-            var rootNode = new CallTreeNode
+            // Collect per-call stack data of this trace
+            // The call stack IDs are interned by the preprocessor, so we do not need to reconstruct the call tree here
+            var callStacks = traceEntity.PreprocessedTraceFile.Prefix!.CallStacks;
+            var visitor = new TraceVisitor(this, traceEntity.PreprocessedTraceFile.Prefix!, logMessagePrefix);
+            traceEntity.PreprocessedTraceFile.Visit(ref visitor);
+
+            // Fold the hashes of this trace into the per-call stack tables, so only distinct call stacks, instructions and hashes occupy memory
+            // The call stacks and instructions are enumerated in order of their first occurrence, which determines the output order
+            int callStackIndex = 0;
+            int instructionIndex = 0;
+            foreach(var (callStackId, callStackLevel) in visitor.CallStackLevels)
             {
-                InstructionId = 0,
-                CallStackId = 0, // Starting value
-                Hits = 1,
-                Parent = null,
-                Children = new Dictionary<ulong, CallTreeNode>(),
-                InstructionHashes = new Dictionary<ulong, byte[]>()
-            };
-            currentCallTree.Push(rootNode);
-            
-            // Try to unify allocation IDs
-            int nextUnifiedAllocationId = 1;
-            Dictionary<int, int> allocationIdToUnifiedIdMap = new();
-
-            // Iterate trace entries
-            byte[] callStackHashBuffer = new byte[16];
-            foreach(var traceEntry in traceEntity.PreprocessedTraceFile)
-            {
-                // Retrieve current call tree node
-                var currentNode = currentCallTree.Peek();
-                BinaryPrimitives.WriteUInt64LittleEndian(callStackHashBuffer, currentNode.CallStackId);
+                ulong callStackHash = callStacks.GetNode(callStackId).Hash;
+                _callStackData.GetOrAdd(callStackHash, static (_, arg) => new CallStackData(GetCallChain(arg.callStacks, arg.callStackId)), (callStacks, callStackId))
+                    .AddTestcase(traceEntity.Id, callStackIndex++, instructionIndex, callStackLevel, _dumpFullData);
+                instructionIndex += callStackLevel.InstructionHashes.Count;
 
-                // Handle allocations
-                if(traceEntry.EntryType == TraceEntryTypes.HeapAllocation)
+                if(TrackLeakageEstimates)
                 {
-                    var allocation = (HeapAllocation)traceEntry;
-                    allocationIdToUnifiedIdMap.Add(allocation.Id,nextUnifiedAllocationId++);
+                    foreach(var (instructionId, hash) in callStackLevel.InstructionHashes)
+                        _leakageEstimator.Add((callStackHash, instructionId), GetFinalHash(hash));
                 }
-                
-                // Handle branch instructions
-                if(traceEntry.EntryType == TraceEntryTypes.Branch)
-                {
-                    var branch = (Branch)traceEntry;
-
-                    // Only analyze taken branches
-                    if(!branch.Taken)
-                        continue;
-
-                    // Call or return?
-                    if(branch.BranchType == Branch.BranchTypes.Call)
-                    {
-                        // Retrieve or create node of target instruction
-                        ulong targetInstructionId = ((ulong)branch.DestinationImageId << 32) | branch.DestinationInstructionRelativeAddress;
-                        if(!currentNode.Children.TryGetValue(targetInstructionId, out var targetNode))
-                        {
-                            // New node
-                            targetNode = new CallTreeNode
-                            {
-                                InstructionId = targetInstructionId,
-                                Hits = 0,
-                                Parent = currentNode,
-                                Children = new Dictionary<ulong, CallTreeNode>(),
-                                InstructionHashes = new Dictionary<ulong, byte[]>()
-                            };
-                            currentNode.Children.Add(targetInstructionId, targetNode);
-
-                            // Compute call stack ID
-                            BinaryPrimitives.WriteUInt64LittleEndian(callStackHashBuffer.AsSpan(8), targetInstructionId);
-                            targetNode.CallStackId = xxHash64.ComputeHash(callStackHashBuffer, 16);
-                        }
+            }
 
-                        // Format instruction
-                        StoreFormattedInstruction(targetInstructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[branch.DestinationImageId],
-                                                  branch.DestinationInstructionRelativeAddress);
+            Interlocked.Increment(ref _testcaseCount);
+            if(TrackLeakageEstimates)
+                _leakageEstimator.CompleteTestcase();
 
-                        // This will be the next node
-                        ++targetNode.Hits;
-                        currentCallTree.Push(targetNode);
-                    }
-                    else if(branch.BranchType == Branch.BranchTypes.Return)
-                    {
-                        // Sanity check for unbalanced calls/returns: Never pop the root node
-                        if(currentCallTree.Count == 1)
-                        {
-                            await Logger.LogWarningAsync($"{logMessagePrefix} Skipping unbalanced return entry in call tree analysis. Results may be incorrect.");
-                            continue;
-                        }
-
-                        // Go up by one layer
-                        currentCallTree.Pop();
-                    }
+            return Task.CompletedTask;
+        }
 
-                    continue;
-                }
+        public override LeakageEstimate? GetLeakageEstimate() => TrackLeakageEstimates ? _leakageEstimator.GetEstimate() : null;
 
-                // This is a memory access
-                // Extract instruction and memory address IDs
-                ulong instructionId;
-                ulong memoryAddressId;
-                switch(traceEntry.EntryType)
-                {
-                    case TraceEntryTypes.HeapMemoryAccess:
-                    {
-                        var heapMemoryAccess = (HeapMemoryAccess)traceEntry;
-
-                        if(!allocationIdToUnifiedIdMap.TryGetValue(heapMemoryAccess.HeapAllocationBlockId, out int unifiedAllocationId))
-                            unifiedAllocationId = 1000000 + heapMemoryAccess.HeapAllocationBlockId;
-                        
-                        instructionId = ((ulong)heapMemoryAccess.InstructionImageId << 32) | heapMemoryAccess.InstructionRelativeAddress;
-                        memoryAddressId = ((ulong)unifiedAllocationId << 32) | heapMemoryAccess.MemoryRelativeAddress;
-
-                        // Format instruction
-                        StoreFormattedInstruction(instructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[heapMemoryAccess.InstructionImageId],
-                                                  heapMemoryAccess.InstructionRelativeAddress);
-                        break;
-                    }
-                    case TraceEntryTypes.ImageMemoryAccess:
-                    {
-                        var imageMemoryAccess = (ImageMemoryAccess)traceEntry;
-                        instructionId = ((ulong)imageMemoryAccess.InstructionImageId << 32) | imageMemoryAccess.InstructionRelativeAddress;
-                        memoryAddressId = ((ulong)imageMemoryAccess.MemoryImageId << 32) | imageMemoryAccess.MemoryRelativeAddress;
-
-                        // Format instruction
-                        StoreFormattedInstruction(instructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[imageMemoryAccess.InstructionImageId],
-                                                  imageMemoryAccess.InstructionRelativeAddress);
-                        break;
-                    }
-                    case TraceEntryTypes.StackMemoryAccess:
-                    {
-                        var stackMemoryAccess = (StackMemoryAccess)traceEntry;
-                        instructionId = ((ulong)stackMemoryAccess.InstructionImageId << 32) | stackMemoryAccess.InstructionRelativeAddress;
-                        memoryAddressId = stackMemoryAccess.MemoryRelativeAddress;
-
-                        // Format instruction
-                        StoreFormattedInstruction(instructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[stackMemoryAccess.InstructionImageId],
-                                                  stackMemoryAccess.InstructionRelativeAddress);
-                        break;
-                    }
-                    default:
-                        continue;
-                }
+        public override Task SaveStateAsync(IFastBinaryWriter writer)
+        {
+            writer.WriteInt32(_testcaseCount);
+            writer.WriteBoolean(_dumpFullData);
 
-                // Retrieve old hash
-                if(!currentNode.InstructionHashes.TryGetValue(instructionId, out var hash))
-                {
-                    hash = new byte[16];
-                    currentNode.InstructionHashes.Add(instructionId, hash);
-                }
+            writer.WriteInt32(_formattedInstructions.Count);
+            foreach(var (instructionId, formattedInstruction) in _formattedInstructions)
+            {
+                writer.WriteUInt64(instructionId);
+                writer.WriteLengthPrefixedString(formattedInstruction);
+            }
 
-                // Update hash:
-                // newHash = hash(oldHash || address)
-                BinaryPrimitives.WriteUInt64LittleEndian(hash.AsSpan(8), memoryAddressId);
-                BinaryPrimitives.WriteUInt64LittleEndian(hash.AsSpan(0), xxHash64.ComputeHash(hash, 16));
+            writer.WriteInt32(_callStackData.Count);
+            foreach(var (callStackHash, callStackData) in _callStackData)
+            {
+                writer.WriteUInt64(callStackHash);
+                callStackData.Store(writer);
             }
 
-            // Store call tree
-            _testcaseCallTrees.AddOrUpdate(traceEntity.Id, rootNode, (_, n) => n);
+            return Task.CompletedTask;
         }
 
-        public override async Task FinishAsync()
+        public override Task MergeStateAsync(IFastBinaryReader reader)
         {
-            // Keep track of call stacks: Call stack ID -> [instruction ID 1, instruction ID 2, ...]
-            // Note that the instruction order is reversed: Leaf, ..., Root
-            var callStacks = new Dictionary<ulong, CallStackData>();
+            _testcaseCount += reader.ReadInt32();
+            bool hasTestcaseIds = reader.ReadBoolean();
+            if(_dumpFullData && !hasTestcaseIds)
+                throw new Exception("The saved state does not contain testcase IDs, which are needed for a full data dump. Enable dump-full-data when saving the state.");
 
-            // Instruction data by (call stack ID, instruction ID)
-            var instructions = new Dictionary<(ulong, ulong), InstructionData>();
-
-            // Transform per-testcase call trees into flat per-(call stack, instruction) representation
-            await Logger.LogInfoAsync($"{_genericLogMessagePrefix} Transforming call trees");
-            foreach(var testcase in _testcaseCallTrees)
+            int formattedInstructionCount = reader.ReadInt32();
+            for(int i = 0; i < formattedInstructionCount; ++i)
             {
-                // Iterate call tree using BFS
-                Queue<CallTreeNode> pendingCallTreeNodes = new();
-                pendingCallTreeNodes.Enqueue(testcase.Value);
-                while(pendingCallTreeNodes.TryDequeue(out var currentNode))
-                {
-                    // If this call stack is still unknown, store it
-                    if(!callStacks.TryGetValue(currentNode.CallStackId, out var callStackData))
-                    {
-                        // Create object
-                        callStackData = new CallStackData
-                        {
-                            InstructionIds = new List<ulong>(),
-                            HitCounts = _dumpFullData ? new Dictionary<int, int>() : null
-                        };
-
-                        // Fill call chain info
-                        var currentParent = currentNode;
-                        while(currentParent != null)
-                        {
-                            callStackData.InstructionIds.Add(currentParent.InstructionId);
-                            currentParent = currentParent.Parent;
-                        }
-
-                        callStacks.Add(currentNode.CallStackId, callStackData);
-                    }
-
-                    // Remember hit counts?
-                    if(_dumpFullData)
-                        callStackData.HitCounts!.Add(testcase.Key, testcase.Value.Hits);
-
-                    // Enqueue all children
-                    foreach(var childNode in currentNode.Children)
-                        pendingCallTreeNodes.Enqueue(childNode.Value);
-
-                    // Iterate instructions at this call stack level
-                    foreach(var instruction in currentNode.InstructionHashes)
-                    {
-                        // Did we already encounter this call stack? Retrieve instruction data container
-                        if(!instructions.TryGetValue((currentNode.CallStackId, instruction.Key), out var instructionData))
-                        {
-                            instructionData = new InstructionData();
-                            instructions.Add((currentNode.CallStackId, instruction.Key), instructionData);
-                        }
-
-                        // Add data from this testcase
-                        ++instructionData.TestcaseCount;
-                        instructionData.HashCounts.TryGetValue(instruction.Value, out int hashCount); // Will be 0 if not existing
-                        instructionData.HashCounts[instruction.Value] = hashCount + 1;
+                ulong instructionId = reader.ReadUInt64();
+                string formattedInstruction = reader.ReadLengthPrefixedString();
+                if(_formattedInstructions.GetOrAdd(instructionId, formattedInstruction) != formattedInstruction)
+                    throw new Exception($"The saved state resolves instruction {instructionId:X16} differently, were the traces generated with the same target binaries?");
+            }
 
-                        // Store testcase IDs only when a full data dump is requested, since this is quite expensive
-                        if(_dumpFullData)
-                        {
-                            // Make sure testcase ID list exists
-                            if(!instructionData.HashTestcases.ContainsKey(instruction.Value))
-                                instructionData.HashTestcases.Add(instruction.Value, new List<int>());
-                            instructionData.HashTestcases[instruction.Value].Add(testcase.Key);
-                        }
-                    }
-                }
+            int callStackCount = reader.ReadInt32();
+            for(int i = 0; i < callStackCount; ++i)
+            {
+                ulong callStackHash = reader.ReadUInt64();
+                var callChain = CallStackData.ReadCallChain(reader);
+                _callStackData.GetOrAdd(callStackHash, _ => new CallStackData(callChain)).Merge(reader, hasTestcaseIds, _dumpFullData);
             }
 
-            // Instruction leakage by (call stack ID, instruction ID)
+            return Task.CompletedTask;
+        }
+
+        public override async Task FinishAsync()
+        {
+            // Restore the order in which a sequential analysis would have encountered the call stacks, instructions and hashes, to get deterministic results
+            var callStacks = _callStackData
+                .OrderBy(c => c.Value.FirstTestcaseId)
+                .ThenBy(c => c.Value.FirstTestcaseCallStackIndex)
+                .ToList();
+            var instructions = callStacks
+                .SelectMany(c => c.Value.Instructions.Select(i => (key: (c.Key, i.Key), instructionData: i.Value)))
+                .OrderBy(i => i.instructionData.FirstTestcaseId)
+                .ThenBy(i => i.instructionData.FirstTestcaseInstructionIndex)
+                .Select(i => (i.key, testcaseCount: i.instructionData.TestcaseCount, hashes: i.instructionData.GetOrderedHashes()))
+                .ToList();
+
+            // Instruction leakage by (call stack hash, instruction ID)
             var instructionLeakage = new Dictionary<(ulong, ulong), InstructionLeakageResult>();
 
             // Calculate leakage measures for each call stack/instruction tuple
@@ -301,21 +185,21 @@ namespace Microwalk.Analysis.Modules
             foreach(var instruction in instructions)
             {
                 var leakageResult = new InstructionLeakageResult();
-                instructionLeakage.Add(instruction.Key, leakageResult);
+                instructionLeakage.Add(instruction.key, leakageResult);
 
                 // Mutual information
                 {
                     // Calculate probabilities of keys, and keys with traces (if they caused a call of this instruction)
                     // Since the keys are distinct and randomly generated, we have a uniform distribution
-                    double pX = 1.0 / instruction.Value.TestcaseCount; // p(x)
-                    double pXy = 1.0 / instruction.Value.TestcaseCount; // p(x,y)
+                    double pX = 1.0 / instruction.testcaseCount; // p(x)
+                    double pXy = 1.0 / instruction.testcaseCount; // p(x,y)
 
                     // Calculate mutual information
                     double mutualInformation = 0.0;
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    foreach(var hashCount in instruction.hashes)
                     {
-                        double pY = (double)hashCount.Value / instruction.Value.TestcaseCount; // p(y)
-                        mutualInformation += hashCount.Value * pXy * Math.Log2(pXy / (pX * pY));
+                        double pY = (double)hashCount.Value.Count / instruction.testcaseCount; // p(y)
+                        mutualInformation += hashCount.Value.Count * pXy * Math.Log2(pXy / (pX * pY));
                     }
 
                     leakageResult.MutualInformation = mutualInformation;
@@ -324,7 +208,7 @@ namespace Microwalk.Analysis.Modules
                 // Minimum entropy
                 {
                     // Compute amount of unique traces
-                    int uniqueTraceCount = instruction.Value.HashCounts.Count;
+                    int uniqueTraceCount = instruction.hashes.Count;
                     leakageResult.MinEntropy = Math.Log2(uniqueTraceCount);
                 }
 
@@ -332,14 +216,14 @@ namespace Microwalk.Analysis.Modules
                 {
                     // Sum guessing entropy for each trace, weighting by its probability -> average value
                     double conditionalGuessingEntropy = 0.0;
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    foreach(var hashCount in instruction.hashes)
                     {
                         // Probability of trace
-                        double pY = (double)hashCount.Value / instruction.Value.TestcaseCount; // p(y)
+                        double pY = (double)hashCount.Value.Count / instruction.testcaseCount; // p(y)
 
                         // Sum over all possible inputs
                         // Application of Gaussian sum formula, simplification due to test cases being distinct and uniformly distributed -> p(x) = 1/n
-                        conditionalGuessingEntropy += pY * (hashCount.Value + 1.0) / 2;
+                        conditionalGuessingEntropy += pY * (hashCount.Value.Count + 1.0) / 2;
                     }
 
                     leakageResult.ConditionalGuessingEntropy = conditionalGuessingEntropy;
@@ -350,10 +234,10 @@ namespace Microwalk.Analysis.Modules
                     // Find minimum guessing entropy of each trace, weighting is not needed here
                     // Also store the hash value which has the lowest guessing entropy value
                     double minConditionalGuessingEntropy = double.MaxValue;
-                    byte[] minConditionalGuessingEntropyHash = Array.Empty<byte>();
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    UInt128 minConditionalGuessingEntropyHash = 0;
+                    foreach(var hashCount in instruction.hashes)
                     {
-                        double traceConditionalGuessingEntropy = (hashCount.Value + 1.0) / 2;
+                        double traceConditionalGuessingEntropy = (hashCount.Value.Count + 1.0) / 2;
                         if(traceConditionalGuessingEntropy < minConditionalGuessingEntropy)
                         {
                             minConditionalGuessingEntropy = traceConditionalGuessingEntropy;
@@ -368,13 +252,13 @@ namespace Microwalk.Analysis.Modules
 
             // Show warning if there likely were not enough testcases
             const double warnThreshold = 0.9;
-            double testcaseCountBits = Math.Log2(_testcaseCallTrees.Count);
+            double testcaseCountBits = Math.Log2(_testcaseCount);
             if(maximumMutualInformation > testcaseCountBits - warnThreshold)
                 await Logger.LogWarningAsync($"{_genericLogMessagePrefix} For some instructions the calculated mutual information is suspiciously near to the testcase range. It is recommended to run more testcases.");
 
             // Store results
             await Logger.LogInfoAsync($"{_genericLogMessagePrefix} Call stack memory access trace leakage analysis completed, writing results");
-            string FormatCallStackId(ulong callStackId) => "CS-" + callStackId.ToString("x16");
+            string FormatCallStackId(ulong callStackHash) => "CS-" + callStackHash.ToString("x16");
             string csvListSeparator = ";"; // TextInfo.ListSeparator is unreliable
             if(_outputFormat == OutputFormat.Txt)
             {
@@ -399,7 +283,7 @@ namespace Microwalk.Analysis.Modules
                 foreach(var instructionData in instructionLeakage.OrderBy(l => l.Value.MinConditionalGuessingEntropy).ThenBy(mi => mi.Key))
                     await minCondGuessEntropyWriter.WriteLineAsync($"Instruction {FormatCallStackId(instructionData.Key.Item1)}...{_formattedInstructions[instructionData.Key.Item2]}: " +
                                                                    $"{instructionData.Value.MinConditionalGuessingEntropy.ToString("N", numberFormat)} guesses " +
-                                                                   $"[IN-{string.Concat(instructionData.Value.MinConditionalGuessingEntropyHash.Take(8).Select(b => b.ToString("X2")))}]");
+                                                                   $"[{FormatHash(instructionData.Value.MinConditionalGuessingEntropyHash)}]");
             }
             else if(_outputFormat == OutputFormat.Csv)
             {
@@ -437,7 +321,7 @@ namespace Microwalk.Analysis.Modules
                                                    csvListSeparator +
                                                    leakageData.MinConditionalGuessingEntropy.ToString("N3") +
                                                    csvListSeparator +
-                                                   "IN-" + string.Concat(leakageData.MinConditionalGuessingEntropyHash.Take(8).Select(b => b.ToString("X2"))));
+                                                   FormatHash(leakageData.MinConditionalGuessingEntropyHash));
                 }
             }
 
@@ -445,8 +329,8 @@ namespace Microwalk.Analysis.Modules
             await using var callStackWriter = new StreamWriter(File.Create(Path.Combine(_outputDirectory.FullName, "call-stacks.txt")));
             foreach(var callStack in callStacks)
             {
-                await callStackWriter.WriteAsync($"CS-{callStack.Key:x16}: ");
-                await WriteCallStackAsync(callStackWriter, ((IEnumerable<ulong>)callStack.Value.InstructionIds).Reverse());
+                await callStackWriter.WriteAsync($"{FormatCallStackId(callStack.Key)}: ");
+                await WriteCallStackAsync(callStackWriter, callStack.Value.CallChain);
                 await callStackWriter.WriteLineAsync();
             }
 
@@ -462,31 +346,32 @@ namespace Microwalk.Analysis.Modules
                 //    instruction2
                 // ...
                 await using var traceHashDumpWriter = new StreamWriter(File.Create(Path.Combine(_outputDirectory.FullName, "trace-hash-dump.txt")));
-                foreach(var callStack in instructions.GroupBy(ins => ins.Key.Item1))
+                foreach(var callStack in instructions.GroupBy(ins => ins.key.Item1))
                 {
                     // Call stack name
-                    await traceHashDumpWriter.WriteAsync($"CS-{callStack.Key:x16}: ");
-                    await WriteCallStackAsync(traceHashDumpWriter, ((IEnumerable<ulong>)callStacks[callStack.Key].InstructionIds).Reverse());
+                    await traceHashDumpWriter.WriteAsync($"{FormatCallStackId(callStack.Key)}: ");
+                    await WriteCallStackAsync(traceHashDumpWriter, _callStackData[callStack.Key].CallChain);
                     await traceHashDumpWriter.WriteLineAsync();
 
                     // Write instructions
                     foreach(var instruction in callStack)
                     {
                         // Instruction name
-                        await traceHashDumpWriter.WriteLineAsync("   " + _formattedInstructions[instruction.Key.Item2]);
+                        await traceHashDumpWriter.WriteLineAsync("   " + _formattedInstructions[instruction.key.Item2]);
 
                         // Hashes
-                        foreach(var hashCount in instruction.Value.HashCounts)
+                        foreach(var hashCount in instruction.hashes)
                         {
                             // Write hash and number of hits
-                            await traceHashDumpWriter.WriteAsync($"      IN-{string.Concat(hashCount.Key.Take(8).Select(b => b.ToString("X2")))}: [{hashCount.Value}]");
+                            await traceHashDumpWriter.WriteAsync($"      {FormatHash(hashCount.Key)}: [{hashCount.Value.Count}]");
 
                             // Write testcases yielding this hash
                             // Try to merge consecutive test case IDs: "1 3 4 5 7" -> "1 3-5 7"
                             int consecutiveStart = -1;
                             int consecutiveCurrent = -1;
                             const int consecutiveThreshold = 2;
-                            foreach(var testcaseId in instruction.Value.HashTestcases[hashCount.Key])
+                            hashCount.Value.TestcaseIds!.Sort();
+                            foreach(var testcaseId in hashCount.Value.TestcaseIds)
                             {
                                 if(consecutiveStart == -1)
                                 {
@@ -535,14 +420,14 @@ namespace Microwalk.Analysis.Modules
                 // Write call stack hit counts
                 await using var callStackInfoWriter = new StreamWriter(File.Create(Path.Combine(_outputDirectory.FullName, "call-stack-hit-counts.csv")));
                 await callStackInfoWriter.WriteAsync("Test Case ID");
-                var callStacksFixedOrder = callStacks.ToList();
-                foreach(var callStack in callStacksFixedOrder)
-                    await callStackInfoWriter.WriteAsync($"{csvListSeparator}CS-{callStack.Key:x16}");
+                foreach(var callStack in callStacks)
+                    await callStackInfoWriter.WriteAsync($"{csvListSeparator}{FormatCallStackId(callStack.Key)}");
                 await callStackInfoWriter.WriteLineAsync();
-                foreach(var testcase in _testcaseCallTrees.Keys.ToList())
+                // Each testcase enters the root call stack
+                foreach(var testcase in _callStackData[CallStackTrie.RootHash].HitCounts!.Keys.OrderBy(t => t))
                 {
                     await callStackInfoWriter.WriteAsync(testcase.ToString());
-                    foreach(var callStack in callStacksFixedOrder)
+                    foreach(var callStack in callStacks)
                     {
                         if(callStack.Value.HitCounts!.TryGetValue(testcase, out int hits))
                             await callStackInfoWriter.WriteAsync($"{csvListSeparator}{hits}");
@@ -555,6 +440,29 @@ namespace Microwalk.Analysis.Modules
             }
         }
 
+        /// <summary>
+        /// Utility function. Returns the call chain of the given call stack, in order: Root, ..., Leaf.
+        /// </summary>
+        /// <param name="callStacks">Call stack trie.</param>
+        /// <param name="callStackId">Call stack ID.</param>
+        /// <returns></returns>
+        private static List<ulong> GetCallChain(CallStackTrie callStacks, int callStackId)
+        {
+            var callChain = new List<ulong>();
+            int currentId = callStackId;
+            while(true)
+            {
+                var callStackNode = callStacks.GetNode(currentId);
+                callChain.Add(callStackNode.TargetInstructionId);
+                if(currentId == CallStackTrie.RootId)
+                    break;
+                currentId = callStackNode.ParentId;
+            }
+
+            callChain.Reverse();
+            return callChain;
+        }
+
         /// <summary>
         /// Utility function. Writes the given call stack in text format, as a single line without a line break at the end.
         /// </summary>
@@ -627,38 +535,158 @@ namespace Microwalk.Analysis.Modules
             _formattedInstructions.TryAdd(instructionKey, _mapFileCollection.FormatAddress(imageFileInfo.Id, imageFileInfo.Name, instructionAddress));
         }
 
-        private class CallTreeNode
+        /// <summary>
+        /// Formats the given hash as hex string, truncated to the sequence hash.
+        /// </summary>
+        private static string FormatHash(UInt128 hash)
         {
-            /// <summary>
-            /// Identifier for the associated call instruction.
-            /// </summary>
-            public ulong InstructionId { get; init; }
+            Span<byte> hashBytes = stackalloc byte[16];
+            BinaryPrimitives.WriteUInt128LittleEndian(hashBytes, hash);
+            return "IN-" + Convert.ToHexString(hashBytes[..8]);
+        }
 
-            /// <summary>
-            /// Identifier for the call stack until this node.
-            /// Computed using a running hash: id = hash(parentId || instructionId).
-            /// </summary>
-            public ulong CallStackId { get; set; }
+        /// <summary>
+        /// Computes the final hash of a memory access sequence.
+        /// The lower half is the sequence hash, the upper half the last accessed address.
+        /// </summary>
+        private static UInt128 GetFinalHash(AccessSequenceHash hash) => new(hash.LastValue, hash.GetHash());
 
+        /// <summary>
+        /// Utility class to store per-testcase info about a call stack.
+        /// </summary>
+        private class CallStackLevel
+        {
             /// <summary>
-            /// Counts the number of times the call instruction of this node was hit.
+            /// Counts the number of times this call stack was entered.
             /// </summary>
             public int Hits { get; set; }
 
             /// <summary>
-            /// Parent node.
+            /// Memory access sequence hashes of read/write instructions. Instruction ID -> hash.
             /// </summary>
-            public CallTreeNode? Parent { get; init; }
+            public Dictionary<ulong, AccessSequenceHash> InstructionHashes { get; } = new();
+        }
 
-            /// <summary>
-            /// Child nodes, indexed by target instruction ID.
-            /// </summary>
-            public Dictionary<ulong, CallTreeNode> Children { get; init; } = null!;
+        /// <summary>
+        /// Computes the per-call stack memory access hashes of a single trace.
+        /// </summary>
+        private struct TraceVisitor : ITraceEntryVisitor
+        {
+            private readonly CallStackMemoryAccessTraceLeakage _analysis;
+            private readonly TracePrefixFile _tracePrefix;
+            private readonly string _logMessagePrefix;
 
             /// <summary>
-            /// Memory address hashes of read/write instructions. Instruction ID -> hash.
+            /// Per-call stack data, indexed by call stack ID.
             /// </summary>
-            public Dictionary<ulong, byte[]> InstructionHashes { get; init; } = null!;
+            public Dictionary<int, CallStackLevel> CallStackLevels { get; } = new();
+
+            private int _currentCallStackId = CallStackTrie.RootId;
+            private CallStackLevel _currentLevel = new() { Hits = 1 };
+
+            // Try to unify allocation IDs
+            private int _nextUnifiedAllocationId = 1;
+            private readonly Dictionary<int, int> _allocationIdToUnifiedIdMap = new();
+
+            public TraceVisitor(CallStackMemoryAccessTraceLeakage analysis, TracePrefixFile tracePrefix, string logMessagePrefix)
+            {
+                _analysis = analysis;
+                _tracePrefix = tracePrefix;
+                _logMessagePrefix = logMessagePrefix;
+
+                CallStackLevels.Add(_currentCallStackId, _currentLevel);
+            }
+
+            public void VisitHeapAllocation(HeapAllocation.View entry)
+            {
+                _allocationIdToUnifiedIdMap.Add(entry.Id, _nextUnifiedAllocationId++);
+            }
+
+            public void VisitHeapFree(HeapFree.View entry)
+            {
+            }
+
+            public void VisitStackAllocation(StackAllocation.View entry)
+            {
+            }
+
+            public void VisitBranch(Branch.View entry)
+            {
+                // Only analyze taken branches
+                if(!entry.Taken)
+                    return;
+
+                // Call or return?
+                if(entry.BranchType == Branch.BranchTypes.Call)
+                {
+                    // Format instruction
+                    _analysis.StoreFormattedInstruction(((ulong)entry.DestinationImageId << 32) | entry.DestinationInstructionRelativeAddress,
+                                                        _tracePrefix.ImageFiles[entry.DestinationImageId],
+                                                        entry.DestinationInstructionRelativeAddress);
+
+                    // Enter call stack of callee
+                    _currentCallStackId = entry.CallStackId;
+                    if(!CallStackLevels.TryGetValue(_currentCallStackId, out _currentLevel!))
+                    {
+                        _currentLevel = new CallStackLevel();
+                        CallStackLevels.Add(_currentCallStackId, _currentLevel);
+                    }
+
+                    ++_currentLevel.Hits;
+                }
+                else if(entry.BranchType == Branch.BranchTypes.Return)
+                {
+                    // Sanity check for unbalanced calls/returns: The preprocessor never leaves the root node
+                    if(_currentCallStackId == CallStackTrie.RootId)
+                    {
+                        _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} Skipping unbalanced return entry in call stack analysis. Results may be incorrect.").Wait();
+                        return;
+                    }
+
+                    // Go up by one layer; the caller's call stack was entered before
+                    _currentCallStackId = entry.CallStackId;
+                    _currentLevel = CallStackLevels[_currentCallStackId];
+                }
+            }
+
+            public void VisitHeapMemoryAccess(HeapMemoryAccess.View entry)
+            {
+                if(!_allocationIdToUnifiedIdMap.TryGetValue(entry.HeapAllocationBlockId, out int unifiedAllocationId))
+                    unifiedAllocationId = 1000000 + entry.HeapAllocationBlockId;
+
+                // Extract instruction and memory address IDs
+                ulong instructionId = ((ulong)entry.InstructionImageId << 32) | entry.InstructionRelativeAddress;
+                ulong memoryAddressId = ((ulong)unifiedAllocationId << 32) | entry.MemoryRelativeAddress;
+
+                UpdateHash(instructionId, memoryAddressId, entry.InstructionImageId, entry.InstructionRelativeAddress);
+            }
+
+            public void VisitImageMemoryAccess(ImageMemoryAccess.View entry)
+            {
+                ulong instructionId = ((ulong)entry.InstructionImageId << 32) | entry.InstructionRelativeAddress;
+                ulong memoryAddressId = ((ulong)entry.MemoryImageId << 32) | entry.MemoryRelativeAddress;
+
+                UpdateHash(instructionId, memoryAddressId, entry.InstructionImageId, entry.InstructionRelativeAddress);
+            }
+
+            public void VisitStackMemoryAccess(StackMemoryAccess.View entry)
+            {
+                ulong instructionId = ((ulong)entry.InstructionImageId << 32) | entry.InstructionRelativeAddress;
+                ulong memoryAddressId = entry.MemoryRelativeAddress;
+
+                UpdateHash(instructionId, memoryAddressId, entry.InstructionImageId, entry.InstructionRelativeAddress);
+            }
+
+            private void UpdateHash(ulong instructionId, ulong memoryAddressId, int instructionImageId, uint instructionRelativeAddress)
+            {
+                // Retrieve hash state, and format the instruction when it is encountered first at this call stack level
+                ref var hash = ref CollectionsMarshal.GetValueRefOrAddDefault(_currentLevel.InstructionHashes, instructionId, out bool exists);
+                if(!exists)
+                    _analysis.StoreFormattedInstruction(instructionId, _tracePrefix.ImageFiles[instructionImageId], instructionRelativeAddress);
+
+                // Append address to the instruction's access sequence
+                hash.Add(memoryAddressId);
+            }
         }
 
         /// <summary>
@@ -667,35 +695,300 @@ namespace Microwalk.Analysis.Modules
         private class CallStackData
         {
             /// <summary>
-            /// Instructions making up the call chain of this call stack, in reverse order: Leaf, ..., Root.
+            /// Call targets of this call stack, in order: Root, ..., Leaf.
+            /// </summary>
+            public List<ulong> CallChain { get; }
+
+            /// <summary>
+            /// Smallest ID of a testcase which entered this call stack.
             /// </summary>
-            public List<ulong> InstructionIds { get; init; } = null!;
+            public int FirstTestcaseId { get; private set; } = int.MaxValue;
+
+            /// <summary>
+            /// Position of this call stack in the call stack list of the testcase with ID <see cref="FirstTestcaseId"/>.
+            /// </summary>
+            public int FirstTestcaseCallStackIndex { get; private set; }
+
+            /// <summary>
+            /// Hit counts per test case ID. This is only filled and used when a data dump is requested.
+            /// </summary>
+            public Dictionary<int, int>? HitCounts { get; private set; }
+
+            /// <summary>
+            /// Aggregated hashes of the read/write instructions at this call stack level. Instruction ID -> data.
+            /// </summary>
+            public Dictionary<ulong, InstructionData> Instructions { get; } = new();
+
+            public CallStackData(List<ulong> callChain)
+            {
+                CallChain = callChain;
+            }
+
+            /// <summary>
+            /// Reads the call chain which was saved by <see cref="Store"/>, which precedes the data to be passed to <see cref="Merge"/>.
+            /// </summary>
+            /// <param name="reader">Binary reader.</param>
+            public static List<ulong> ReadCallChain(IFastBinaryReader reader)
+            {
+                int callChainLength = reader.ReadInt32();
+                var callChain = new List<ulong>(callChainLength);
+                for(int i = 0; i < callChainLength; ++i)
+                    callChain.Add(reader.ReadUInt64());
+                return callChain;
+            }
 
             /// <summary>
-            /// Hit counts per test case ID.
+            /// Adds the hashes of the given testcase.
             /// </summary>
-            public Dictionary<int, int>? HitCounts { get; init; }
+            /// <param name="testcaseId">Testcase ID.</param>
+            /// <param name="callStackIndex">Position of this call stack in the call stack list of the testcase.</param>
+            /// <param name="firstInstructionIndex">Position of the first instruction of this call stack in the instruction list of the testcase.</param>
+            /// <param name="callStackLevel">Data of this call stack in the testcase.</param>
+            /// <param name="storeTestcaseIds">Controls whether the testcase IDs are recorded. This is quite expensive.</param>
+            public void AddTestcase(int testcaseId, int callStackIndex, int firstInstructionIndex, CallStackLevel callStackLevel, bool storeTestcaseIds)
+            {
+                lock(Instructions)
+                {
+                    if(testcaseId < FirstTestcaseId)
+                    {
+                        FirstTestcaseId = testcaseId;
+                        FirstTestcaseCallStackIndex = callStackIndex;
+                    }
+
+                    if(storeTestcaseIds)
+                    {
+                        HitCounts ??= new Dictionary<int, int>();
+                        HitCounts.Add(testcaseId, callStackLevel.Hits);
+                    }
+
+                    int instructionIndex = firstInstructionIndex;
+                    foreach(var (instructionId, hash) in callStackLevel.InstructionHashes)
+                    {
+                        ref var instructionData = ref CollectionsMarshal.GetValueRefOrAddDefault(Instructions, instructionId, out _);
+                        instructionData ??= new InstructionData();
+                        instructionData.AddTestcase(testcaseId, instructionIndex++, GetFinalHash(hash), storeTestcaseIds);
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Saves the aggregated data. Must not be called concurrently to <see cref="AddTestcase"/>.
+            /// </summary>
+            /// <param name="writer">Binary writer.</param>
+            public void Store(IFastBinaryWriter writer)
+            {
+                writer.WriteInt32(CallChain.Count);
+                foreach(var callTarget in CallChain)
+                    writer.WriteUInt64(callTarget);
+
+                writer.WriteInt32(FirstTestcaseId);
+                writer.WriteInt32(FirstTestcaseCallStackIndex);
+
+                if(HitCounts != null)
+                {
+                    writer.WriteInt32(HitCounts.Count);
+                    foreach(var (testcaseId, hits) in HitCounts)
+                    {
+                        writer.WriteInt32(testcaseId);
+                        writer.WriteInt32(hits);
+                    }
+                }
+
+                writer.WriteInt32(Instructions.Count);
+                foreach(var (instructionId, instructionData) in Instructions)
+                {
+                    writer.WriteUInt64(instructionId);
+                    instructionData.Store(writer);
+                }
+            }
+
+            /// <summary>
+            /// Merges data which was saved by <see cref="Store"/>, after the call chain was read by <see cref="ReadCallChain"/>.
+            /// Must not be called concurrently to <see cref="AddTestcase"/>.
+            /// </summary>
+            /// <param name="reader">Binary reader.</param>
+            /// <param name="hasTestcaseIds">Determines whether the saved data includes testcase IDs.</param>
+            /// <param name="storeTestcaseIds">Controls whether the testcase IDs are kept.</param>
+            public void Merge(IFastBinaryReader reader, bool hasTestcaseIds, bool storeTestcaseIds)
+            {
+                int firstTestcaseId = reader.ReadInt32();
+                int firstTestcaseCallStackIndex = reader.ReadInt32();
+                if(firstTestcaseId < FirstTestcaseId)
+                {
+                    FirstTestcaseId = firstTestcaseId;
+                    FirstTestcaseCallStackIndex = firstTestcaseCallStackIndex;
+                }
+
+                if(storeTestcaseIds)
+                    HitCounts ??= new Dictionary<int, int>();
+                if(hasTestcaseIds)
+                {
+                    int hitCountCount = reader.ReadInt32();
+                    for(int i = 0; i < hitCountCount; ++i)
+                    {
+                        int testcaseId = reader.ReadInt32();
+                        int hits = reader.ReadInt32();
+                        if(HitCounts != null)
+                            HitCounts[testcaseId] = hits;
+                    }
+                }
+
+                int instructionCount = reader.ReadInt32();
+                for(int i = 0; i < instructionCount; ++i)
+                {
+                    ref var instructionData = ref CollectionsMarshal.GetValueRefOrAddDefault(Instructions, reader.ReadUInt64(), out _);
+                    instructionData ??= new InstructionData();
+                    instructionData.Merge(reader, hasTestcaseIds, storeTestcaseIds);
+                }
+            }
         }
 
         /// <summary>
-        /// Utility class to hold a tuple of testcase count/hash count.
+        /// Aggregated hashes of one instruction in one call stack. Access is synchronized by the containing <see cref="CallStackData"/> object.
         /// </summary>
         private class InstructionData
         {
-            public int TestcaseCount { get; set; }
-            public Dictionary<byte[], int> HashCounts { get; }
+            public int TestcaseCount { get; private set; }
+
+            /// <summary>
+            /// Smallest ID of a testcase which executed this instruction in this call stack.
+            /// </summary>
+            public int FirstTestcaseId { get; private set; } = int.MaxValue;
+
+            /// <summary>
+            /// Position of this instruction in the instruction list of the testcase with ID <see cref="FirstTestcaseId"/>.
+            /// </summary>
+            public int FirstTestcaseInstructionIndex { get; private set; }
+
+            /// <summary>
+            /// Number of testcases and further information for each distinct hash.
+            /// </summary>
+            private readonly Dictionary<UInt128, HashData> _hashes = new();
 
             /// <summary>
-            /// This is only filled and used when a data dump is requested.
+            /// Adds the hash of the given testcase.
             /// </summary>
-            public Dictionary<byte[], List<int>> HashTestcases { get; }
+            /// <param name="testcaseId">Testcase ID.</param>
+            /// <param name="instructionIndex">Position of this instruction in the instruction list of the testcase.</param>
+            /// <param name="hash">Memory access hash.</param>
+            /// <param name="storeTestcaseIds">Controls whether the testcase IDs yielding each hash are recorded.</param>
+            public void AddTestcase(int testcaseId, int instructionIndex, UInt128 hash, bool storeTestcaseIds)
+            {
+                ++TestcaseCount;
+                if(testcaseId < FirstTestcaseId)
+                {
+                    FirstTestcaseId = testcaseId;
+                    FirstTestcaseInstructionIndex = instructionIndex;
+                }
 
-            public InstructionData()
+                ref var hashData = ref CollectionsMarshal.GetValueRefOrAddDefault(_hashes, hash, out bool exists);
+                if(!exists)
+                {
+                    hashData.FirstTestcaseId = testcaseId;
+                    if(storeTestcaseIds)
+                        hashData.TestcaseIds = new List<int>();
+                }
+
+                ++hashData.Count;
+                if(testcaseId < hashData.FirstTestcaseId)
+                    hashData.FirstTestcaseId = testcaseId;
+                hashData.TestcaseIds?.Add(testcaseId);
+            }
+
+            /// <summary>
+            /// Saves the aggregated hashes.
+            /// </summary>
+            /// <param name="writer">Binary writer.</param>
+            public void Store(IFastBinaryWriter writer)
             {
-                TestcaseCount = 0;
-                HashCounts = new Dictionary<byte[], int>(new ByteArrayComparer());
-                HashTestcases = new Dictionary<byte[], List<int>>(new ByteArrayComparer());
+                writer.WriteInt32(TestcaseCount);
+                writer.WriteInt32(FirstTestcaseId);
+                writer.WriteInt32(FirstTestcaseInstructionIndex);
+
+                writer.WriteInt32(_hashes.Count);
+                foreach(var (hash, hashData) in _hashes)
+                {
+                    writer.WriteUInt128(hash);
+                    writer.WriteInt32(hashData.Count);
+                    writer.WriteInt32(hashData.FirstTestcaseId);
+
+                    if(hashData.TestcaseIds != null)
+                    {
+                        writer.WriteInt32(hashData.TestcaseIds.Count);
+                        foreach(var testcaseId in hashData.TestcaseIds)
+                            writer.WriteInt32(testcaseId);
+                    }
+                }
             }
+
+            /// <summary>
+            /// Merges hashes which were saved by <see cref="Store"/>.
+            /// </summary>
+            /// <param name="reader">Binary reader.</param>
+            /// <param name="hasTestcaseIds">Determines whether the saved hashes include testcase IDs.</param>
+            /// <param name="storeTestcaseIds">Controls whether the testcase IDs are kept.</param>
+            public void Merge(IFastBinaryReader reader, bool hasTestcaseIds, bool storeTestcaseIds)
+            {
+                TestcaseCount += reader.ReadInt32();
+                int firstTestcaseId = reader.ReadInt32();
+                int firstTestcaseInstructionIndex = reader.ReadInt32();
+                if(firstTestcaseId < FirstTestcaseId)
+                {
+                    FirstTestcaseId = firstTestcaseId;
+                    FirstTestcaseInstructionIndex = firstTestcaseInstructionIndex;
+                }
+
+                int hashCount = reader.ReadInt32();
+                for(int i = 0; i < hashCount; ++i)
+                {
+                    ref var hashData = ref CollectionsMarshal.GetValueRefOrAddDefault(_hashes, reader.ReadUInt128(), out bool exists);
+                    if(!exists)
+                    {
+                        hashData.FirstTestcaseId = int.MaxValue;
+                        if(storeTestcaseIds)
+                            hashData.TestcaseIds = new List<int>();
+                    }
+
+                    hashData.Count += reader.ReadInt32();
+                    hashData.FirstTestcaseId = Math.Min(hashData.FirstTestcaseId, reader.ReadInt32());
+
+                    if(hasTestcaseIds)
+                    {
+                        int testcaseIdCount = reader.ReadInt32();
+                        for(int t = 0; t < testcaseIdCount; ++t)
+                        {
+                            int testcaseId = reader.ReadInt32();
+                            hashData.TestcaseIds?.Add(testcaseId);
+                        }
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Returns the hashes ordered by the first testcase yielding them.
+            /// </summary>
+            public List<KeyValuePair<UInt128, HashData>> GetOrderedHashes() => _hashes.OrderBy(h => h.Value.FirstTestcaseId).ToList();
+        }
+
+        /// <summary>
+        /// Information about one distinct hash of an instruction.
+        /// </summary>
+        private struct HashData
+        {
+            /// <summary>
+            /// Number of testcases yielding this hash.
+            /// </summary>
+            public int Count;
+
+            /// <summary>
+            /// Smallest ID of a testcase yielding this hash.
+            /// </summary>
+            public int FirstTestcaseId;
+
+            /// <summary>
+            /// IDs of the testcases yielding this hash. This is only filled and used when a data dump is requested.
+            /// </summary>
+            public List<int>? TestcaseIds;
         }
 
         /// <summary>
@@ -707,7 +1000,7 @@ namespace Microwalk.Analysis.Modules
             public double MinEntropy { get; set; }
             public double ConditionalGuessingEntropy { get; set; }
             public double MinConditionalGuessingEntropy { get; set; }
-            public byte[] MinConditionalGuessingEntropyHash { get; set; } = null!;
+            public UInt128 MinConditionalGuessingEntropyHash { get; set; }
         }
 
         /// <summary>
@@ -0,0 +1,399 @@
+﻿using System.Collections.Generic;
+using System.Linq;
+
+namespace Microwalk.Analysis.Modules;
+
+public partial class ControlFlowLeakage
+{
+    /// <summary>
+    /// Call tree which is built from a subset of the traces by a single thread at a time, and later merged into the main call tree.
+    /// </summary>
+    private class PartialCallTree
+    {
+        public RootNode RootNode { get; } = new();
+
+        /// <summary>
+        /// Number of traces which were added to this tree.
+        /// </summary>
+        public int TraceCount { get; set; }
+    }
+
+    /// <summary>
+    /// Position in the main and the partial call tree during a merge.
+    /// </summary>
+    /// <param name="Target">Current node of the main call tree.</param>
+    /// <param name="TargetIndex">Current successor index in <paramref name="Target"/>.</param>
+    /// <param name="Source">Current node of the partial call tree.</param>
+    /// <param name="SourceIndex">Index of the next successor of <paramref name="Source"/> which is merged.</param>
+    /// <param name="IsSplitSuccessor">Determines whether <paramref name="Source"/> is a split successor whose testcases are not yet placed.</param>
+    private readonly record struct MergePosition(SplitNode Target, int TargetIndex, SplitNode Source, int SourceIndex, bool IsSplitSuccessor = false);
+
+    /// <summary>
+    /// Merges the given partial call tree into the main call tree. Nodes of the partial tree are moved into the main tree, so the partial tree
+    /// must not be used afterwards.
+    ///
+    /// The testcases of the partial tree are handled like the visitor handles a single testcase, i.e., the main tree is split where they
+    /// diverge from it. Thus, the result matches the one of adding all traces directly, except for the order of split successors, memory access
+    /// targets and allocation IDs, which depends on the order of the testcases and is restored by <see cref="NormalizeCallTree"/>.
+    /// </summary>
+    /// <param name="partialRootNode">Root node of the partial call tree.</param>
+    private void MergeCallTree(RootNode partialRootNode)
+    {
+        // Maps allocation IDs of the partial tree to the IDs of the corresponding existing nodes in the main tree
+        var allocationIdMapping = new Dictionary<int, int>();
+
+        _rootNode.TestcaseIds.UnionWith(partialRootNode.TestcaseIds);
+
+        // Testcases of pending split successors. They are already included in the target node at the split successors' position, but were not
+        // placed beyond it, so they must not be passed on to nodes which are split off from there.
+        var unplacedTestcaseIds = new TestcaseIdSet();
+
+        // The testcases of a source node are already included in the corresponding target node
+        var pendingPositions = new Stack<MergePosition>();
+        pendingPositions.Push(new MergePosition(_rootNode, 0, partialRootNode, 0));
+        while(pendingPositions.TryPop(out var position))
+        {
+            var (targetNode, targetIndex, sourceNode, sourceIndex, isSplitSuccessor) = position;
+            var testcaseIds = sourceNode.TestcaseIds;
+            if(isSplitSuccessor)
+                unplacedTestcaseIds.ExceptWith(testcaseIds);
+
+            bool sourceNodeDone = false;
+            while(sourceIndex < sourceNode.Successors.Count)
+            {
+                var sourceSuccessor = sourceNode.Successors[sourceIndex];
+
+                // Are there successor nodes in the main tree?
+                if(targetIndex < targetNode.Successors.Count)
+                {
+                    if(!NodesMatch(targetNode.Successors[targetIndex], sourceSuccessor))
+                    {
+                        // Split the main tree node, the remaining source nodes are only used by our testcases
+                        var newSplitNode = targetNode.SplitAtSuccessor(targetIndex, testcaseIds);
+                        targetNode.SplitSuccessors[0].TestcaseIds.ExceptWith(unplacedTestcaseIds);
+                        MoveSuccessors(newSplitNode, sourceNode, sourceIndex, allocationIdMapping);
+
+                        sourceNodeDone = true;
+                        break;
+                    }
+
+                    if(MergeMatchingSuccessor(targetNode, targetIndex, sourceNode, sourceIndex, unplacedTestcaseIds, allocationIdMapping, pendingPositions))
+                    {
+                        sourceNodeDone = true;
+                        break;
+                    }
+
+                    ++targetIndex;
+                    ++sourceIndex;
+                    continue;
+                }
+
+                // We ran out of successor nodes
+                // Check whether other testcases already hit this particular path
+                if(CountPlacedTestcases(targetNode, unplacedTestcaseIds) == testcaseIds.Count)
+                {
+                    // No, so we can just append the remaining source nodes
+                    MoveSuccessors(targetNode, sourceNode, sourceIndex, allocationIdMapping);
+
+                    sourceNodeDone = true;
+                    break;
+                }
+
+                // Is there a split successor that matches?
+                var splitSuccessor = targetNode.SplitSuccessors.FirstOrDefault(s => NodesMatch(s.Successors[0], sourceSuccessor));
+                if(splitSuccessor != null)
+                {
+                    splitSuccessor.TestcaseIds.UnionWith(testcaseIds);
+
+                    if(MergeMatchingSuccessor(splitSuccessor, 0, sourceNode, sourceIndex, unplacedTestcaseIds, allocationIdMapping, pendingPositions))
+                    {
+                        sourceNodeDone = true;
+                        break;
+                    }
+
+                    // Continue in split successor
+                    targetNode = splitSuccessor;
+                    targetIndex = 1;
+                    ++sourceIndex;
+                    continue;
+                }
+
+                if(targetNode.SplitSuccessors.Count == 0)
+                {
+                    // Other testcases already hit this node and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
+                    Logger.LogWarningAsync("[analyze:cfl] Encountered weird case while merging call trees").Wait();
+                }
+
+                // Add new split successor
+                var splitNode = new SplitNode();
+                splitNode.TestcaseIds.UnionWith(testcaseIds);
+                targetNode.SplitSuccessors.Add(splitNode);
+                MoveSuccessors(splitNode, sourceNode, sourceIndex, allocationIdMapping);
+
+                sourceNodeDone = true;
+                break;
+            }
+
+            if(sourceNodeDone)
+                continue;
+
+            // All successors are merged, now the split successors of the source node continue from the current position
+            // Reverse order, so they are merged in the original order
+            for(int s = sourceNode.SplitSuccessors.Count - 1; s >= 0; --s)
+            {
+                unplacedTestcaseIds.UnionWith(sourceNode.SplitSuccessors[s].TestcaseIds);
+                pendingPositions.Push(new MergePosition(targetNode, targetIndex, sourceNode.SplitSuccessors[s], 0, true));
+            }
+        }
+    }
+
+    /// <summary>
+    /// Merges the partial call trees which are not currently used by a thread into the main call tree, in the order of their smallest testcase ID.
+    /// Must not be called concurrently to <see cref="AddTraceAsync"/>.
+    /// </summary>
+    private void MergeIdlePartialCallTrees()
+    {
+        foreach(var partialCallTree in _idlePartialCallTrees.OrderBy(t => t.RootNode.TestcaseIds.Min))
+            MergeCallTree(partialCallTree.RootNode);
+        _idlePartialCallTrees.Clear();
+    }
+
+    /// <summary>
+    /// Returns the number of testcases of the given main tree node, excluding the given unplaced testcases.
+    /// </summary>
+    private static int CountPlacedTestcases(SplitNode targetNode, TestcaseIdSet unplacedTestcaseIds)
+    {
+        if(unplacedTestcaseIds.Count == 0)
+            return targetNode.TestcaseIds.Count;
+
+        var placedTestcaseIds = targetNode.TestcaseIds.Copy();
+        placedTestcaseIds.ExceptWith(unplacedTestcaseIds);
+        return placedTestcaseIds.Count;
+    }
+
+    /// <summary>
+    /// Checks whether the given main and partial tree nodes represent the same trace entry, using the same criteria as the trace visitor.
+    /// </summary>
+    private static bool NodesMatch(CallTreeNode targetNode, CallTreeNode sourceNode)
+    {
+        return sourceNode switch
+        {
+            CallNode sourceCallNode => targetNode is CallNode callNode && callNode.SourceInstructionId == sourceCallNode.SourceInstructionId && callNode.TargetInstructionId == sourceCallNode.TargetInstructionId,
+            ReturnNode sourceReturnNode => targetNode is ReturnNode returnNode && returnNode.SourceInstructionId == sourceReturnNode.SourceInstructionId && returnNode.TargetInstructionId == sourceReturnNode.TargetInstructionId,
+            BranchNode sourceBranchNode => targetNode is BranchNode branchNode && branchNode.SourceInstructionId == sourceBranchNode.SourceInstructionId && branchNode.TargetInstructionId == sourceBranchNode.TargetInstructionId,
+            AllocationNode sourceAllocationNode => targetNode is AllocationNode allocationNode && allocationNode.Size == sourceAllocationNode.Size && allocationNode.IsHeap == sourceAllocationNode.IsHeap,
+            MemoryAccessNode sourceMemoryNode => targetNode is MemoryAccessNode memoryNode && memoryNode.InstructionId == sourceMemoryNode.InstructionId,
+            _ => false
+        };
+    }
+
+    /// <summary>
+    /// Merges a partial tree node into the matching main tree node.
+    /// </summary>
+    /// <param name="targetNode">Main tree node containing the matching node. Must already include the testcases of <paramref name="sourceNode"/>.</param>
+    /// <param name="targetIndex">Successor index of the matching node in <paramref name="targetNode"/>.</param>
+    /// <param name="sourceNode">Partial tree node containing the node being merged.</param>
+    /// <param name="sourceIndex">Successor index of the node being merged in <paramref name="sourceNode"/>.</param>
+    /// <param name="unplacedTestcaseIds">Testcases of pending split successors.</param>
+    /// <param name="allocationIdMapping">Allocation ID mapping.</param>
+    /// <param name="pendingPositions">Pending merge positions.</param>
+    /// <returns>True if the merge of the current source node was deferred to <paramref name="pendingPositions"/>.</returns>
+    private static bool MergeMatchingSuccessor(SplitNode targetNode, int targetIndex, SplitNode sourceNode, int sourceIndex, TestcaseIdSet unplacedTestcaseIds,
+        Dictionary<int, int> allocationIdMapping, Stack<MergePosition> pendingPositions)
+    {
+        switch(sourceNode.Successors[sourceIndex])
+        {
+            case CallNode sourceCallNode:
+            {
+                // Merge callee, and continue after it when it returns
+                var targetCallNode = (CallNode)targetNode.Successors[targetIndex];
+                targetCallNode.TestcaseIds.UnionWith(sourceCallNode.TestcaseIds);
+
+                pendingPositions.Push(new MergePosition(targetNode, targetIndex + 1, sourceNode, sourceIndex + 1));
+                pendingPositions.Push(new MergePosition(targetCallNode, 0, sourceCallNode, 0));
+                return true;
+            }
+
+            case AllocationNode sourceAllocationNode:
+            {
+                // Use existing allocation ID for subsequent memory accesses
+                allocationIdMapping.TryAdd(sourceAllocationNode.Id, ((AllocationNode)targetNode.Successors[targetIndex]).Id);
+                break;
+            }
+
+            case MemoryAccessNode sourceMemoryNode:
+            {
+                // Like the visitor, we assume that all other testcases of the target node accessed the existing target
+                var targetMemoryNode = (MemoryAccessNode)targetNode.Successors[targetIndex];
+                var targets = new Dictionary<ulong, TestcaseIdSet>();
+                if(sourceMemoryNode is SimpleMemoryAccessNode simpleSourceMemoryNode)
+                    targets.Add(TranslateAddressId(simpleSourceMemoryNode.TargetAddress, allocationIdMapping), sourceNode.TestcaseIds);
+                else
+                {
+                    foreach(var (targetAddress, targetTestcaseIds) in ((SplitMemoryAccessNode)sourceMemoryNode).Targets)
+                        AddMemoryAccessTarget(targets, TranslateAddressId(targetAddress, allocationIdMapping), targetTestcaseIds);
+                }
+
+                if(targetMemoryNode is SimpleMemoryAccessNode simpleTargetMemoryNode)
+                {
+                    if(targets.Count == 1 && targets.ContainsKey(simpleTargetMemoryNode.TargetAddress))
+                        break;
+
+                    var splitMemoryNode = new SplitMemoryAccessNode(targetMemoryNode.InstructionId, targetMemoryNode.IsWrite);
+                    var existingTargetTestcaseIds = targetNode.TestcaseIds.Copy();
+                    existingTargetTestcaseIds.ExceptWith(sourceNode.TestcaseIds);
+                    existingTargetTestcaseIds.ExceptWith(unplacedTestcaseIds);
+                    splitMemoryNode.Targets.Add(simpleTargetMemoryNode.TargetAddress, existingTargetTestcaseIds);
+                    targetNode.Successors[targetIndex] = splitMemoryNode;
+                    targetMemoryNode = splitMemoryNode;
+                }
+
+                var splitTargets = ((SplitMemoryAccessNode)targetMemoryNode).Targets;
+                foreach(var (targetAddress, targetTestcaseIds) in targets)
+                    AddMemoryAccessTarget(splitTargets, targetAddress, targetTestcaseIds);
+
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    /// <summary>
+    /// Moves the successors of the given partial tree node, starting at the given index, and its split successors to the given main tree node.
+    /// </summary>
+    private static void MoveSuccessors(SplitNode targetNode, SplitNode sourceNode, int sourceIndex, Dictionary<int, int> allocationIdMapping)
+    {
+        int firstMovedIndex = targetNode.Successors.Count;
+        targetNode.Successors.AddRange(sourceNode.Successors.Skip(sourceIndex));
+        targetNode.SplitSuccessors.AddRange(sourceNode.SplitSuccessors);
+
+        // Moved memory accesses may refer to allocations which were merged with existing ones
+        if(allocationIdMapping.Count == 0)
+            return;
+
+        var pendingNodes = new Stack<(SplitNode node, int firstIndex)>();
+        pendingNodes.Push((targetNode, firstMovedIndex));
+        while(pendingNodes.TryPop(out var entry))
+        {
+            var (node, firstIndex) = entry;
+            for(int i = firstIndex; i < node.Successors.Count; ++i)
+            {
+                switch(node.Successors[i])
+                {
+                    case CallNode callNode:
+                        pendingNodes.Push((callNode, 0));
+                        break;
+                    case MemoryAccessNode memoryNode:
+                        TranslateMemoryAccessTargets(memoryNode, allocationIdMapping);
+                        break;
+                }
+            }
+
+            // All split successors of the target node were moved
+            foreach(var splitSuccessor in node.SplitSuccessors)
+                pendingNodes.Push((splitSuccessor, 0));
+        }
+    }
+
+    /// <summary>
+    /// Brings the call tree into a canonical form, which does not depend on the order in which the traces were added or merged:
+    /// Split successors and memory access targets are ordered by their smallest testcase ID, and allocation IDs are assigned in the order in which
+    /// the trace visitor would have created the allocation nodes when processing the testcases sequentially.
+    /// </summary>
+    private void NormalizeCallTree()
+    {
+        // Collect allocation nodes in the order of the smallest testcase ID hitting them, and of the position in that testcase's trace
+        var allocationNodes = new List<(int firstTestcaseId, int index, AllocationNode node)>();
+        var memoryAccessNodes = new List<MemoryAccessNode>();
+        var pendingNodes = new Stack<(SplitNode node, int successorIndex)>();
+        pendingNodes.Push((_rootNode, 0));
+        while(pendingNodes.TryPop(out var entry))
+        {
+            var (node, successorIndex) = entry;
+            if(successorIndex == 0)
+                node.SplitSuccessors.Sort((s1, s2) => s1.TestcaseIds.Min.CompareTo(s2.TestcaseIds.Min));
+
+            bool enteredCall = false;
+            int firstTestcaseId = node.TestcaseIds.Min;
+            for(int i = successorIndex; i < node.Successors.Count; ++i)
+            {
+                var successor = node.Successors[i];
+                if(successor is AllocationNode allocationNode)
+                    allocationNodes.Add((firstTestcaseId, allocationNodes.Count, allocationNode));
+                else if(successor is MemoryAccessNode memoryNode)
+                    memoryAccessNodes.Add(memoryNode);
+                else if(successor is CallNode callNode)
+                {
+                    // Handle callee first, as its allocations precede the following ones
+                    pendingNodes.Push((node, i + 1));
+                    pendingNodes.Push((callNode, 0));
+                    enteredCall = true;
+                    break;
+                }
+            }
+
+            if(enteredCall)
+                continue;
+
+            for(int s = node.SplitSuccessors.Count - 1; s >= 0; --s)
+                pendingNodes.Push((node.SplitSuccessors[s], 0));
+        }
+
+        // Assign new allocation IDs
+        var allocationIdMapping = new Dictionary<int, int>();
+        int nextAllocationId = _unmappedHeapAllocationId + 1;
+        foreach(var (_, _, allocationNode) in allocationNodes.OrderBy(a => a.firstTestcaseId).ThenBy(a => a.index))
+        {
+            if(allocationNode.Id != nextAllocationId)
+                allocationIdMapping.Add(allocationNode.Id, nextAllocationId);
+            allocationNode.Id = nextAllocationId++;
+        }
+
+        _nextSharedAllocationId = nextAllocationId;
+
+        foreach(var memoryNode in memoryAccessNodes)
+            TranslateMemoryAccessTargets(memoryNode, allocationIdMapping);
+    }
+
+    /// <summary>
+    /// Applies the given allocation ID mapping to the targets of the given memory access node, and orders them by their smallest testcase ID.
+    /// </summary>
+    private static void TranslateMemoryAccessTargets(MemoryAccessNode memoryNode, Dictionary<int, int> allocationIdMapping)
+    {
+        if(memoryNode is SimpleMemoryAccessNode simpleMemoryNode)
+            simpleMemoryNode.TargetAddress = TranslateAddressId(simpleMemoryNode.TargetAddress, allocationIdMapping);
+        else if(memoryNode is SplitMemoryAccessNode splitMemoryNode)
+        {
+            var targets = splitMemoryNode.Targets.OrderBy(t => t.Value.Min).ToList();
+            splitMemoryNode.Targets.Clear();
+            foreach(var (targetAddress, targetTestcaseIds) in targets)
+                AddMemoryAccessTarget(splitMemoryNode.Targets, TranslateAddressId(targetAddress, allocationIdMapping), targetTestcaseIds);
+        }
+    }
+
+    /// <summary>
+    /// Adds the given testcases to the given memory access target.
+    /// </summary>
+    private static void AddMemoryAccessTarget(Dictionary<ulong, TestcaseIdSet> targets, ulong targetAddressId, TestcaseIdSet testcaseIds)
+    {
+        if(targets.TryGetValue(targetAddressId, out var targetTestcaseIds))
+            targetTestcaseIds.UnionWith(testcaseIds);
+        else
+            targets.Add(targetAddressId, testcaseIds.Copy());
+    }
+
+    /// <summary>
+    /// Applies the given allocation ID mapping to the given encoded memory address.
+    /// </summary>
+    private static ulong TranslateAddressId(ulong addressId, Dictionary<int, int> allocationIdMapping)
+    {
+        if((addressId & _addressIdFlagMemory) == 0 || allocationIdMapping.Count == 0)
+            return addressId;
+
+        if(!allocationIdMapping.TryGetValue(GetAllocationId(addressId), out int mappedAllocationId))
+            return addressId;
+
+        return (addressId & (_addressIdFlagsMask | 0xFFFF_FFFF)) | ((ulong)mappedAllocationId << 32);
+    }
+}
\ No newline at end of file
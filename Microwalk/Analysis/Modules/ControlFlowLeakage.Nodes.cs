@@ -38,23 +38,38 @@ public partial class ControlFlowLeakage
         /// <param name="firstSuccessor">First successor of the new split branch.</param>
         /// <returns></returns>
         public SplitNode SplitAtSuccessor(int successorIndex, int testcaseId, CallTreeNode firstSuccessor)
+        {
+            var splitNode2 = SplitAtSuccessor(successorIndex, new TestcaseIdSet(testcaseId));
+            splitNode2.Successors.Add(firstSuccessor);
+
+            return splitNode2;
+        }
+
+        /// <summary>
+        /// Splits the given node at the given successor index, and returns an empty split branch for the given testcases.
+        /// </summary>
+        /// <param name="successorIndex">Index of the successor where the split is created.</param>
+        /// <param name="testcaseIds">Testcase IDs following the new split branch.</param>
+        /// <returns></returns>
+        public SplitNode SplitAtSuccessor(int successorIndex, TestcaseIdSet testcaseIds)
         {
             // Copy remaining info from this node over to 1st split node
             var splitNode1 = new SplitNode
             {
                 TestcaseIds = TestcaseIds.Copy()
             };
-            splitNode1.TestcaseIds.Remove(testcaseId);
+            splitNode1.TestcaseIds.ExceptWith(testcaseIds);
 
             splitNode1.Successors.AddRange(Successors.Skip(successorIndex));
             Successors.RemoveRange(successorIndex, Successors.Count - successorIndex);
             splitNode1.SplitSuccessors.AddRange(SplitSuccessors);
             SplitSuccessors.Clear();
 
-            // The 2nd split node holds the new, conflicting entry
-            var splitNode2 = new SplitNode();
-            splitNode2.Successors.Add(firstSuccessor);
-            splitNode2.TestcaseIds.Add(testcaseId);
+            // The 2nd split node holds the new, conflicting entries
+            var splitNode2 = new SplitNode
+            {
+                TestcaseIds = testcaseIds.Copy()
+            };
 
             SplitSuccessors.Add(splitNode1);
             SplitSuccessors.Add(splitNode2);
@@ -166,7 +181,7 @@ public partial class ControlFlowLeakage
             TargetAddress = targetAddress;
         }
 
-        public ulong TargetAddress { get; }
+        public ulong TargetAddress { get; set; }
     }
 
     private class SplitMemoryAccessNode : MemoryAccessNode
@@ -194,7 +209,7 @@ public partial class ControlFlowLeakage
         /// <summary>
         /// Unique allocation ID of this node, which all testcase-specific IDs map to. 
         /// </summary>
-        public int Id { get; }
+        public int Id { get; set; }
 
         public bool IsHeap { get; }
 
@@ -0,0 +1,356 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase.Extensions;
+using Microwalk.FrameworkBase.Utilities;
+
+namespace Microwalk.Analysis.Modules;
+
+public partial class ControlFlowLeakage
+{
+    /// <summary>
+    /// Node types in a saved call tree.
+    /// </summary>
+    private enum SavedNodeType : byte
+    {
+        Split,
+        Call,
+        Branch,
+        Return,
+        SimpleMemoryAccess,
+        SplitMemoryAccess,
+        Allocation
+    }
+
+    public override bool SupportsStateSerialization => true;
+
+    public override Task SaveStateAsync(IFastBinaryWriter writer)
+    {
+        lock(_rootNode)
+        {
+            MergeIdlePartialCallTrees();
+
+            writer.WriteInt32(_formattedImageAddresses.Count);
+            foreach(var (key, formattedAddress) in _formattedImageAddresses)
+            {
+                writer.WriteUInt64(key);
+                writer.WriteLengthPrefixedString(formattedAddress);
+            }
+
+            writer.WriteInt32(_imageAddresses.Count);
+            foreach(var (key, (imageName, offset)) in _imageAddresses)
+            {
+                writer.WriteUInt64(key);
+                writer.WriteLengthPrefixedString(imageName);
+                writer.WriteUInt32(offset);
+            }
+
+            WriteCallTree(writer);
+        }
+
+        return Task.CompletedTask;
+    }
+
+    public override Task MergeStateAsync(IFastBinaryReader reader)
+    {
+        int formattedImageAddressCount = reader.ReadInt32();
+        for(int i = 0; i < formattedImageAddressCount; ++i)
+        {
+            ulong key = reader.ReadUInt64();
+            string formattedAddress = reader.ReadLengthPrefixedString();
+            if(_formattedImageAddresses.GetOrAdd(key, formattedAddress) != formattedAddress)
+                throw new Exception($"The saved state resolves address {key:X16} differently, were the traces generated with the same target binaries?");
+        }
+
+        int imageAddressCount = reader.ReadInt32();
+        for(int i = 0; i < imageAddressCount; ++i)
+        {
+            ulong key = reader.ReadUInt64();
+            string imageName = reader.ReadLengthPrefixedString();
+            uint offset = reader.ReadUInt32();
+            _imageAddresses.TryAdd(key, (imageName, offset));
+        }
+
+        var savedRootNode = ReadCallTree(reader);
+
+        // The saved call tree is merged like a partial call tree
+        lock(_rootNode)
+        {
+            var duplicateTestcaseIds = _rootNode.TestcaseIds.Copy();
+            duplicateTestcaseIds.IntersectWith(savedRootNode.TestcaseIds);
+            if(duplicateTestcaseIds.Count > 0)
+                throw new Exception($"The saved state contains testcases which were already added: {duplicateTestcaseIds}");
+
+            MergeCallTree(savedRootNode);
+        }
+
+        return Task.CompletedTask;
+    }
+
+    /// <summary>
+    /// Saves the main call tree.
+    /// Nodes are written in depth-first order: Each split node is followed by its successors, where calls are directly followed by their subtree,
+    /// and then by its split successors.
+    /// </summary>
+    /// <param name="writer">Binary writer.</param>
+    private void WriteCallTree(IFastBinaryWriter writer)
+    {
+        WriteSplitNodeHeader(writer, _rootNode);
+
+        var pendingNodes = new Stack<(SplitNode node, int successorIndex, int splitSuccessorIndex)>();
+        pendingNodes.Push((_rootNode, 0, -1));
+        while(pendingNodes.TryPop(out var entry))
+        {
+            var (node, successorIndex, splitSuccessorIndex) = entry;
+
+            bool enteredCall = false;
+            while(successorIndex < node.Successors.Count)
+            {
+                var successor = node.Successors[successorIndex++];
+                switch(successor)
+                {
+                    case CallNode callNode:
+                    {
+                        WriteSplitNodeHeader(writer, callNode);
+
+                        // Continue after the call once its subtree is written
+                        pendingNodes.Push((node, successorIndex, -1));
+                        pendingNodes.Push((callNode, 0, -1));
+                        enteredCall = true;
+                        break;
+                    }
+
+                    case ReturnNode returnNode:
+                    {
+                        writer.WriteByte((byte)SavedNodeType.Return);
+                        writer.WriteUInt64(returnNode.SourceInstructionId);
+                        writer.WriteUInt64(returnNode.TargetInstructionId);
+                        break;
+                    }
+
+                    case BranchNode branchNode:
+                    {
+                        writer.WriteByte((byte)SavedNodeType.Branch);
+                        writer.WriteUInt64(branchNode.SourceInstructionId);
+                        writer.WriteUInt64(branchNode.TargetInstructionId);
+                        writer.WriteBoolean(branchNode.Taken);
+                        break;
+                    }
+
+                    case SimpleMemoryAccessNode simpleMemoryNode:
+                    {
+                        writer.WriteByte((byte)SavedNodeType.SimpleMemoryAccess);
+                        writer.WriteUInt64(simpleMemoryNode.InstructionId);
+                        writer.WriteBoolean(simpleMemoryNode.IsWrite);
+                        writer.WriteUInt64(simpleMemoryNode.TargetAddress);
+                        break;
+                    }
+
+                    case SplitMemoryAccessNode splitMemoryNode:
+                    {
+                        writer.WriteByte((byte)SavedNodeType.SplitMemoryAccess);
+                        writer.WriteUInt64(splitMemoryNode.InstructionId);
+                        writer.WriteBoolean(splitMemoryNode.IsWrite);
+                        writer.WriteInt32(splitMemoryNode.Targets.Count);
+                        foreach(var (targetAddress, testcaseIds) in splitMemoryNode.Targets)
+                        {
+                            writer.WriteUInt64(targetAddress);
+                            testcaseIds.Store(writer);
+                        }
+
+                        break;
+                    }
+
+                    case AllocationNode allocationNode:
+                    {
+                        writer.WriteByte((byte)SavedNodeType.Allocation);
+                        writer.WriteInt32(allocationNode.Id);
+                        writer.WriteUInt32(allocationNode.Size);
+                        writer.WriteBoolean(allocationNode.IsHeap);
+                        break;
+                    }
+
+                    default:
+                        throw new Exception($"Unexpected call tree node type {successor.GetType().Name}.");
+                }
+
+                if(enteredCall)
+                    break;
+            }
+
+            if(enteredCall)
+                continue;
+
+            // Split successors follow all successors
+            if(splitSuccessorIndex < 0)
+            {
+                writer.WriteInt32(node.SplitSuccessors.Count);
+                splitSuccessorIndex = 0;
+            }
+
+            if(splitSuccessorIndex < node.SplitSuccessors.Count)
+            {
+                var splitSuccessor = node.SplitSuccessors[splitSuccessorIndex];
+                WriteSplitNodeHeader(writer, splitSuccessor);
+
+                pendingNodes.Push((node, successorIndex, splitSuccessorIndex + 1));
+                pendingNodes.Push((splitSuccessor, 0, -1));
+            }
+        }
+    }
+
+    /// <summary>
+    /// Writes the type, the testcases and the number of successors of the given node.
+    /// </summary>
+    private static void WriteSplitNodeHeader(IFastBinaryWriter writer, SplitNode node)
+    {
+        if(node is CallNode callNode)
+        {
+            writer.WriteByte((byte)SavedNodeType.Call);
+            writer.WriteUInt64(callNode.SourceInstructionId);
+            writer.WriteUInt64(callNode.TargetInstructionId);
+            writer.WriteUInt64(callNode.CallStackId);
+        }
+        else
+            writer.WriteByte((byte)SavedNodeType.Split);
+
+        node.TestcaseIds.Store(writer);
+        writer.WriteInt32(node.Successors.Count);
+    }
+
+    /// <summary>
+    /// Loads a call tree which was saved by <see cref="WriteCallTree"/>.
+    /// The allocations of the loaded tree get new shared allocation IDs, so they can not be confused with allocations of the main call tree.
+    /// </summary>
+    /// <param name="reader">Binary reader.</param>
+    private RootNode ReadCallTree(IFastBinaryReader reader)
+    {
+        var allocationIdMapping = new Dictionary<int, int>();
+        var memoryAccessNodes = new List<MemoryAccessNode>();
+
+        var rootNode = new RootNode();
+        ReadSavedNodeType(reader, SavedNodeType.Split);
+        int rootSuccessorCount = ReadSplitNodeContents(reader, rootNode);
+
+        var pendingNodes = new Stack<(SplitNode node, int remainingSuccessors, int remainingSplitSuccessors)>();
+        pendingNodes.Push((rootNode, rootSuccessorCount, -1));
+        while(pendingNodes.TryPop(out var entry))
+        {
+            var (node, remainingSuccessors, remainingSplitSuccessors) = entry;
+
+            bool enteredCall = false;
+            while(remainingSuccessors > 0)
+            {
+                --remainingSuccessors;
+                var nodeType = (SavedNodeType)reader.ReadByte();
+                switch(nodeType)
+                {
+                    case SavedNodeType.Call:
+                    {
+                        ulong sourceInstructionId = reader.ReadUInt64();
+                        ulong targetInstructionId = reader.ReadUInt64();
+                        ulong callStackId = reader.ReadUInt64();
+                        var callNode = new CallNode(sourceInstructionId, targetInstructionId, callStackId);
+                        int callSuccessorCount = ReadSplitNodeContents(reader, callNode);
+                        node.Successors.Add(callNode);
+
+                        pendingNodes.Push((node, remainingSuccessors, -1));
+                        pendingNodes.Push((callNode, callSuccessorCount, -1));
+                        enteredCall = true;
+                        break;
+                    }
+
+                    case SavedNodeType.Return:
+                    {
+                        node.Successors.Add(new ReturnNode(reader.ReadUInt64(), reader.ReadUInt64()));
+                        break;
+                    }
+
+                    case SavedNodeType.Branch:
+                    {
+                        node.Successors.Add(new BranchNode(reader.ReadUInt64(), reader.ReadUInt64(), reader.ReadBoolean()));
+                        break;
+                    }
+
+                    case SavedNodeType.SimpleMemoryAccess:
+                    {
+                        var memoryNode = new SimpleMemoryAccessNode(reader.ReadUInt64(), reader.ReadBoolean(), reader.ReadUInt64());
+                        node.Successors.Add(memoryNode);
+                        memoryAccessNodes.Add(memoryNode);
+                        break;
+                    }
+
+                    case SavedNodeType.SplitMemoryAccess:
+                    {
+                        var memoryNode = new SplitMemoryAccessNode(reader.ReadUInt64(), reader.ReadBoolean());
+                        int targetCount = reader.ReadInt32();
+                        for(int i = 0; i < targetCount; ++i)
+                            memoryNode.Targets.Add(reader.ReadUInt64(), new TestcaseIdSet(reader));
+                        node.Successors.Add(memoryNode);
+                        memoryAccessNodes.Add(memoryNode);
+                        break;
+                    }
+
+                    case SavedNodeType.Allocation:
+                    {
+                        int id = reader.ReadInt32();
+                        var allocationNode = new AllocationNode(id, reader.ReadUInt32(), reader.ReadBoolean());
+                        if(id != _unmappedStackAllocationId && id != _unmappedHeapAllocationId)
+                        {
+                            allocationNode.Id = GetNextSharedAllocationId();
+                            allocationIdMapping.Add(id, allocationNode.Id);
+                        }
+
+                        node.Successors.Add(allocationNode);
+                        break;
+                    }
+
+                    default:
+                        throw new Exception($"Invalid call tree node type {nodeType} in saved state.");
+                }
+
+                if(enteredCall)
+                    break;
+            }
+
+            if(enteredCall)
+                continue;
+
+            if(remainingSplitSuccessors < 0)
+                remainingSplitSuccessors = reader.ReadInt32();
+
+            if(remainingSplitSuccessors > 0)
+            {
+                var splitSuccessor = new SplitNode();
+                ReadSavedNodeType(reader, SavedNodeType.Split);
+                int splitSuccessorCount = ReadSplitNodeContents(reader, splitSuccessor);
+                node.SplitSuccessors.Add(splitSuccessor);
+
+                pendingNodes.Push((node, 0, remainingSplitSuccessors - 1));
+                pendingNodes.Push((splitSuccessor, splitSuccessorCount, -1));
+            }
+        }
+
+        // Memory accesses may refer to any allocation preceding them
+        foreach(var memoryNode in memoryAccessNodes)
+            TranslateMemoryAccessTargets(memoryNode, allocationIdMapping);
+
+        return rootNode;
+    }
+
+    /// <summary>
+    /// Reads the testcases of a split node, and returns its number of successors.
+    /// </summary>
+    private static int ReadSplitNodeContents(IFastBinaryReader reader, SplitNode node)
+    {
+        node.TestcaseIds.UnionWith(new TestcaseIdSet(reader));
+        return reader.ReadInt32();
+    }
+
+    private static void ReadSavedNodeType(IFastBinaryReader reader, SavedNodeType expectedType)
+    {
+        var nodeType = (SavedNodeType)reader.ReadByte();
+        if(nodeType != expectedType)
+            throw new Exception($"Invalid call tree node type {nodeType} in saved state, expected {expectedType}.");
+    }
+}
\ No newline at end of file
@@ -1,7 +1,7 @@
 ﻿using System;
 using System.Collections.Generic;
 using System.Numerics;
-using Standart.Hash.xxHash;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.Analysis.Modules;
 
@@ -9,30 +9,36 @@ public partial class ControlFlowLeakage
 {
     /// <summary>
     /// Utility class for efficient storage of a testcase ID set.
-    /// Assumes that testcase IDs are small and don't have large gaps in between.
+    ///
+    /// The testcase IDs are partitioned into blocks of 2^16 IDs, which share the upper 16 bits. Each non-empty block is stored in a container
+    /// which picks the smallest of three representations (like a roaring bitmap): A sorted array for sparse blocks, a bitmap for dense blocks,
+    /// and a list of ranges for blocks consisting of few consecutive runs of IDs. Thus, a set only needs memory proportional to its
+    /// actual content, instead of to the largest testcase ID.
     /// </summary>
     /// <remarks>
     /// This class is not thread-safe.
     /// </remarks>
     private class TestcaseIdSet
     {
-        private ulong[] _testcaseIdBitField = new ulong[1];
-
-        private void EnsureArraySize(int id)
-        {
-            if(id / 64 < _testcaseIdBitField.Length)
-                return;
+        /// <summary>
+        /// Maximum number of values in an array container. At this point an array container has the same size as a bitmap container.
+        /// </summary>
+        private const int _maxArrayContainerLength = 4096;
 
-            int newSize = 2 * _testcaseIdBitField.Length;
-            while(newSize <= id / 64)
-                newSize *= 2;
+        /// <summary>
+        /// Size of a bitmap container in bytes.
+        /// </summary>
+        private const int _bitmapContainerSize = 8192;
 
-            // Resize
-            ulong[] newBitField = new ulong[newSize];
-            _testcaseIdBitField.CopyTo(newBitField, 0);
+        /// <summary>
+        /// Non-empty containers, sorted by key.
+        /// </summary>
+        private Container[] _containers = Array.Empty<Container>();
 
-            _testcaseIdBitField = newBitField;
-        }
+        /// <summary>
+        /// Number of used entries in <see cref="_containers"/>.
+        /// </summary>
+        private int _containerCount;
 
         /// <summary>
         /// Adds the given testcase ID to this set, if it is not yet included.
@@ -40,9 +46,12 @@ public partial class ControlFlowLeakage
         /// <param name="id">Testcase ID.</param>
         public void Add(int id)
         {
-            EnsureArraySize(id);
-
-            _testcaseIdBitField[id / 64] |= (1ul << (id % 64));
+            ushort key = (ushort)(id >> 16);
+            int index = FindContainer(key);
+            if(index >= 0)
+                _containers[index] = _containers[index].Add((ushort)id);
+            else
+                InsertContainer(~index, new ArrayContainer(key, (ushort)id));
         }
 
         /// <summary>
@@ -51,9 +60,81 @@ public partial class ControlFlowLeakage
         /// <param name="id">Testcase ID.</param>
         public void Remove(int id)
         {
-            EnsureArraySize(id);
+            int index = FindContainer((ushort)(id >> 16));
+            if(index < 0)
+                return;
+
+            var container = _containers[index].Remove((ushort)id);
+            if(container.Cardinality == 0)
+                RemoveContainer(index);
+            else
+                _containers[index] = container;
+        }
 
-            _testcaseIdBitField[id / 64] &= ~(1ul << (id % 64));
+        /// <summary>
+        /// Adds all testcase IDs of the given set to this set.
+        /// </summary>
+        /// <param name="other">Testcase ID set.</param>
+        public void UnionWith(TestcaseIdSet other)
+        {
+            for(int i = 0; i < other._containerCount; ++i)
+            {
+                var otherContainer = other._containers[i];
+                int index = FindContainer(otherContainer.Key);
+                if(index >= 0)
+                    _containers[index] = Container.Union(_containers[index], otherContainer);
+                else
+                    InsertContainer(~index, otherContainer.Copy());
+            }
+        }
+
+        /// <summary>
+        /// Removes all testcase IDs of the given set from this set.
+        /// </summary>
+        /// <param name="other">Testcase ID set.</param>
+        public void ExceptWith(TestcaseIdSet other)
+        {
+            int otherIndex = 0;
+            int newContainerCount = 0;
+            for(int i = 0; i < _containerCount; ++i)
+            {
+                var container = _containers[i];
+                while(otherIndex < other._containerCount && other._containers[otherIndex].Key < container.Key)
+                    ++otherIndex;
+                if(otherIndex < other._containerCount && other._containers[otherIndex].Key == container.Key)
+                    container = Container.Except(container, other._containers[otherIndex]);
+
+                if(container.Cardinality > 0)
+                    _containers[newContainerCount++] = container;
+            }
+
+            Array.Clear(_containers, newContainerCount, _containerCount - newContainerCount);
+            _containerCount = newContainerCount;
+        }
+
+        /// <summary>
+        /// Removes all testcase IDs from this set which are not included in the given set.
+        /// </summary>
+        /// <param name="other">Testcase ID set.</param>
+        public void IntersectWith(TestcaseIdSet other)
+        {
+            int otherIndex = 0;
+            int newContainerCount = 0;
+            for(int i = 0; i < _containerCount; ++i)
+            {
+                var container = _containers[i];
+                while(otherIndex < other._containerCount && other._containers[otherIndex].Key < container.Key)
+                    ++otherIndex;
+                if(otherIndex == other._containerCount || other._containers[otherIndex].Key != container.Key)
+                    continue;
+
+                container = Container.Intersect(container, other._containers[otherIndex]);
+                if(container.Cardinality > 0)
+                    _containers[newContainerCount++] = container;
+            }
+
+            Array.Clear(_containers, newContainerCount, _containerCount - newContainerCount);
+            _containerCount = newContainerCount;
         }
 
         /// <summary>
@@ -73,6 +154,45 @@ public partial class ControlFlowLeakage
                 Add(t);
         }
 
+        /// <summary>
+        /// Loads a set which was previously saved with <see cref="Store"/>.
+        /// </summary>
+        /// <param name="reader">Binary reader.</param>
+        public TestcaseIdSet(IFastBinaryReader reader)
+        {
+            _containerCount = reader.ReadInt32();
+            _containers = new Container[_containerCount];
+            for(int i = 0; i < _containerCount; ++i)
+            {
+                ushort key = (ushort)reader.ReadInt16();
+                int runCount = reader.ReadInt32();
+                var runs = new List<Run>(runCount);
+                for(int r = 0; r < runCount; ++r)
+                    runs.Add(new Run((ushort)reader.ReadInt16(), (ushort)reader.ReadInt16()));
+                _containers[i] = Container.FromRuns(key, runs);
+            }
+        }
+
+        /// <summary>
+        /// Saves this set. Each container is stored as a list of runs, independently of its representation.
+        /// </summary>
+        /// <param name="writer">Binary writer.</param>
+        public void Store(IFastBinaryWriter writer)
+        {
+            writer.WriteInt32(_containerCount);
+            for(int i = 0; i < _containerCount; ++i)
+            {
+                writer.WriteUInt16(_containers[i].Key);
+                var runs = _containers[i].GetRuns();
+                writer.WriteInt32(runs.Count);
+                foreach(var run in runs)
+                {
+                    writer.WriteUInt16((ushort)run.Start);
+                    writer.WriteUInt16((ushort)run.End);
+                }
+            }
+        }
+
         /// <summary>
         /// Returns a deep copy of this set.
         /// </summary>
@@ -80,9 +200,11 @@ public partial class ControlFlowLeakage
         {
             TestcaseIdSet s = new TestcaseIdSet
             {
-                _testcaseIdBitField = new ulong[_testcaseIdBitField.Length]
+                _containers = new Container[_containerCount],
+                _containerCount = _containerCount
             };
-            _testcaseIdBitField.CopyTo(s._testcaseIdBitField, 0);
+            for(int i = 0; i < _containerCount; ++i)
+                s._containers[i] = _containers[i].Copy();
 
             return s;
         }
@@ -105,19 +227,19 @@ public partial class ControlFlowLeakage
         /// </summary>
         public IEnumerable<int> AsEnumerable()
         {
-            for(int i = 0; i < _testcaseIdBitField.Length; ++i)
+            for(int i = 0; i < _containerCount; ++i)
             {
-                ulong b = _testcaseIdBitField[i];
-                for(int j = 0; j < 64; ++j)
-                {
-                    if((b & 1) != 0)
-                        yield return 64 * i + j;
-
-                    b >>= 1;
-                }
+                int high = _containers[i].Key << 16;
+                foreach(var low in _containers[i].AsEnumerable())
+                    yield return high | low;
             }
         }
 
+        /// <summary>
+        /// Returns the smallest included testcase ID, or -1 if this set is empty.
+        /// </summary>
+        public int Min => _containerCount == 0 ? -1 : (_containers[0].Key << 16) | _containers[0].Min;
+
         public override string ToString()
         {
             return FormatIntegerSequence(AsEnumerable());
@@ -130,12 +252,719 @@ public partial class ControlFlowLeakage
         {
             get
             {
-                // This is much faster than _testcaseIdBitField.Sum(BitOperations.PopCount), probably due to better inlining
                 int count = 0;
-                foreach(var b in _testcaseIdBitField)
-                    count += BitOperations.PopCount(b);
+                for(int i = 0; i < _containerCount; ++i)
+                    count += _containers[i].Cardinality;
                 return count;
             }
         }
+
+        /// <summary>
+        /// Returns the index of the container with the given key, or the bitwise complement of the index where it would need to be inserted.
+        /// </summary>
+        private int FindContainer(ushort key)
+        {
+            // Testcase IDs are mostly added in ascending order, so check the last container first
+            if(_containerCount > 0 && _containers[_containerCount - 1].Key == key)
+                return _containerCount - 1;
+
+            int low = 0;
+            int high = _containerCount - 1;
+            while(low <= high)
+            {
+                int mid = (low + high) >>> 1;
+                ushort midKey = _containers[mid].Key;
+                if(midKey < key)
+                    low = mid + 1;
+                else if(midKey > key)
+                    high = mid - 1;
+                else
+                    return mid;
+            }
+
+            return ~low;
+        }
+
+        private void InsertContainer(int index, Container container)
+        {
+            if(_containerCount == _containers.Length)
+                Array.Resize(ref _containers, Math.Max(1, 2 * _containerCount));
+
+            Array.Copy(_containers, index, _containers, index + 1, _containerCount - index);
+            _containers[index] = container;
+            ++_containerCount;
+        }
+
+        private void RemoveContainer(int index)
+        {
+            --_containerCount;
+            Array.Copy(_containers, index + 1, _containers, index, _containerCount - index);
+            _containers[_containerCount] = null!;
+        }
+
+        /// <summary>
+        /// Inclusive range of values in a container.
+        /// </summary>
+        private readonly record struct Run(int Start, int End);
+
+        /// <summary>
+        /// Stores the lower 16 bits of all testcase IDs which share the same upper 16 bits.
+        /// </summary>
+        private abstract class Container
+        {
+            protected Container(ushort key)
+            {
+                Key = key;
+            }
+
+            /// <summary>
+            /// Upper 16 bits of the stored testcase IDs.
+            /// </summary>
+            public ushort Key { get; }
+
+            /// <summary>
+            /// Number of values in this container.
+            /// </summary>
+            public int Cardinality { get; protected set; }
+
+            /// <summary>
+            /// Smallest value in this container. Must not be called if the container is empty.
+            /// </summary>
+            public abstract int Min { get; }
+
+            /// <summary>
+            /// Adds the given value, and returns the container which holds the result. This is either the current one, or a new one with a more
+            /// suitable representation.
+            /// </summary>
+            public abstract Container Add(ushort value);
+
+            /// <summary>
+            /// Removes the given value, and returns the container which holds the result. This is either the current one, or a new one with a more
+            /// suitable representation.
+            /// </summary>
+            public abstract Container Remove(ushort value);
+
+            public abstract Container Copy();
+
+            /// <summary>
+            /// Appends the values of this container as ascending, non-adjacent runs to the given list.
+            /// </summary>
+            public abstract void AppendRuns(List<Run> runs);
+
+            /// <summary>
+            /// Returns the values of this container in ascending order.
+            /// </summary>
+            public abstract IEnumerable<int> AsEnumerable();
+
+            public List<Run> GetRuns()
+            {
+                var runs = new List<Run>();
+                AppendRuns(runs);
+                return runs;
+            }
+
+            /// <summary>
+            /// Creates a container with the most compact representation for the given runs.
+            /// </summary>
+            public static Container FromRuns(ushort key, List<Run> runs)
+            {
+                int cardinality = 0;
+                foreach(var run in runs)
+                    cardinality += run.End - run.Start + 1;
+
+                if(4 * runs.Count < Math.Min(2 * cardinality, _bitmapContainerSize))
+                    return new RunContainer(key, runs, cardinality);
+                if(cardinality <= _maxArrayContainerLength)
+                    return new ArrayContainer(key, runs, cardinality);
+                return new BitmapContainer(key, runs);
+            }
+
+            /// <summary>
+            /// Returns a container holding the union of the given containers. The first container may be modified.
+            /// </summary>
+            public static Container Union(Container container, Container other)
+            {
+                if(container is BitmapContainer bitmapContainer)
+                    return bitmapContainer.UnionWith(other);
+                if(other is BitmapContainer otherBitmapContainer)
+                    return ((BitmapContainer)otherBitmapContainer.Copy()).UnionWith(container);
+
+                var runs1 = container.GetRuns();
+                var runs2 = other.GetRuns();
+                var result = new List<Run>(runs1.Count + runs2.Count);
+                int i = 0;
+                int j = 0;
+                while(i < runs1.Count || j < runs2.Count)
+                {
+                    var run = j == runs2.Count || (i < runs1.Count && runs1[i].Start <= runs2[j].Start) ? runs1[i++] : runs2[j++];
+                    if(result.Count > 0 && run.Start <= result[^1].End + 1)
+                    {
+                        if(run.End > result[^1].End)
+                            result[^1] = result[^1] with { End = run.End };
+                    }
+                    else
+                        result.Add(run);
+                }
+
+                return FromRuns(container.Key, result);
+            }
+
+            /// <summary>
+            /// Returns a container holding the values of the first container which are not in the second one. The first container may be modified.
+            /// </summary>
+            public static Container Except(Container container, Container other)
+            {
+                if(container is BitmapContainer bitmapContainer)
+                    return bitmapContainer.ExceptWith(other);
+
+                var runs1 = container.GetRuns();
+                var runs2 = other.GetRuns();
+                var result = new List<Run>(runs1.Count);
+                int j = 0;
+                foreach(var run in runs1)
+                {
+                    int start = run.Start;
+                    while(j < runs2.Count && runs2[j].End < start)
+                        ++j;
+                    while(j < runs2.Count && runs2[j].Start <= run.End)
+                    {
+                        if(runs2[j].Start > start)
+                            result.Add(new Run(start, runs2[j].Start - 1));
+                        start = runs2[j].End + 1;
+
+                        // The current run of the other container may overlap the next run as well
+                        if(runs2[j].End >= run.End)
+                            break;
+                        ++j;
+                    }
+
+                    if(start <= run.End)
+                        result.Add(new Run(start, run.End));
+                }
+
+                return FromRuns(container.Key, result);
+            }
+
+            /// <summary>
+            /// Returns a container holding the values which are in both containers. The first container may be modified.
+            /// </summary>
+            public static Container Intersect(Container container, Container other)
+            {
+                if(container is BitmapContainer bitmapContainer && other is BitmapContainer otherBitmapContainer)
+                    return bitmapContainer.IntersectWith(otherBitmapContainer);
+
+                var runs1 = container.GetRuns();
+                var runs2 = other.GetRuns();
+                var result = new List<Run>();
+                int i = 0;
+                int j = 0;
+                while(i < runs1.Count && j < runs2.Count)
+                {
+                    int start = Math.Max(runs1[i].Start, runs2[j].Start);
+                    int end = Math.Min(runs1[i].End, runs2[j].End);
+                    if(start <= end)
+                        result.Add(new Run(start, end));
+
+                    if(runs1[i].End < runs2[j].End)
+                        ++i;
+                    else
+                        ++j;
+                }
+
+                return FromRuns(container.Key, result);
+            }
+        }
+
+        /// <summary>
+        /// Stores the values as a sorted array.
+        /// </summary>
+        private sealed class ArrayContainer : Container
+        {
+            private ushort[] _values;
+
+            public ArrayContainer(ushort key, ushort value)
+                : base(key)
+            {
+                _values = new[] { value };
+                Cardinality = 1;
+            }
+
+            public ArrayContainer(ushort key, List<Run> runs, int cardinality)
+                : base(key)
+            {
+                _values = new ushort[cardinality];
+                int i = 0;
+                foreach(var run in runs)
+                {
+                    for(int value = run.Start; value <= run.End; ++value)
+                        _values[i++] = (ushort)value;
+                }
+
+                Cardinality = cardinality;
+            }
+
+            private ArrayContainer(ArrayContainer other)
+                : base(other.Key)
+            {
+                _values = other._values.AsSpan(0, other.Cardinality).ToArray();
+                Cardinality = other.Cardinality;
+            }
+
+            public override int Min => _values[0];
+
+            public override Container Add(ushort value)
+            {
+                // Testcase IDs are mostly added in ascending order
+                int index = Cardinality;
+                if(Cardinality > 0 && value <= _values[Cardinality - 1])
+                {
+                    index = Array.BinarySearch(_values, 0, Cardinality, value);
+                    if(index >= 0)
+                        return this;
+                    index = ~index;
+                }
+
+                if(Cardinality == _maxArrayContainerLength)
+                {
+                    var runs = GetRuns();
+                    runs.Insert(index == Cardinality ? runs.Count : runs.FindIndex(r => r.Start > value), new Run(value, value));
+                    return FromRuns(Key, Coalesce(runs));
+                }
+
+                if(Cardinality == _values.Length)
+                    Array.Resize(ref _values, Math.Min(2 * Cardinality, _maxArrayContainerLength));
+
+                Array.Copy(_values, index, _values, index + 1, Cardinality - index);
+                _values[index] = value;
+                ++Cardinality;
+
+                return this;
+            }
+
+            public override Container Remove(ushort value)
+            {
+                int index = Array.BinarySearch(_values, 0, Cardinality, value);
+                if(index < 0)
+                    return this;
+
+                --Cardinality;
+                Array.Copy(_values, index + 1, _values, index, Cardinality - index);
+
+                return this;
+            }
+
+            public override Container Copy()
+            {
+                return new ArrayContainer(this);
+            }
+
+            public override void AppendRuns(List<Run> runs)
+            {
+                int i = 0;
+                while(i < Cardinality)
+                {
+                    int start = _values[i];
+                    int end = start;
+                    while(++i < Cardinality && _values[i] == end + 1)
+                        ++end;
+
+                    runs.Add(new Run(start, end));
+                }
+            }
+
+            public override IEnumerable<int> AsEnumerable()
+            {
+                for(int i = 0; i < Cardinality; ++i)
+                    yield return _values[i];
+            }
+
+            /// <summary>
+            /// Merges adjacent runs in the given sorted list.
+            /// </summary>
+            private static List<Run> Coalesce(List<Run> runs)
+            {
+                var result = new List<Run>(runs.Count);
+                foreach(var run in runs)
+                {
+                    if(result.Count > 0 && run.Start == result[^1].End + 1)
+                        result[^1] = result[^1] with { End = run.End };
+                    else
+                        result.Add(run);
+                }
+
+                return result;
+            }
+        }
+
+        /// <summary>
+        /// Stores the values as a bit field with 2^16 entries.
+        /// </summary>
+        private sealed class BitmapContainer : Container
+        {
+            private const int _wordCount = 65536 / 64;
+
+            private readonly ulong[] _words = new ulong[_wordCount];
+
+            public BitmapContainer(ushort key, List<Run> runs)
+                : base(key)
+            {
+                foreach(var run in runs)
+                    SetRange(run.Start, run.End);
+                UpdateCardinality();
+            }
+
+            private BitmapContainer(BitmapContainer other)
+                : base(other.Key)
+            {
+                other._words.CopyTo(_words, 0);
+                Cardinality = other.Cardinality;
+            }
+
+            public override int Min
+            {
+                get
+                {
+                    for(int i = 0; i < _wordCount; ++i)
+                    {
+                        if(_words[i] != 0)
+                            return 64 * i + BitOperations.TrailingZeroCount(_words[i]);
+                    }
+
+                    return -1;
+                }
+            }
+
+            public override Container Add(ushort value)
+            {
+                ulong mask = 1ul << (value % 64);
+                if((_words[value / 64] & mask) == 0)
+                {
+                    _words[value / 64] |= mask;
+                    ++Cardinality;
+                }
+
+                return this;
+            }
+
+            public override Container Remove(ushort value)
+            {
+                ulong mask = 1ul << (value % 64);
+                if((_words[value / 64] & mask) == 0)
+                    return this;
+
+                _words[value / 64] &= ~mask;
+                --Cardinality;
+
+                return Shrink();
+            }
+
+            public override Container Copy()
+            {
+                return new BitmapContainer(this);
+            }
+
+            public override void AppendRuns(List<Run> runs)
+            {
+                int i = 0;
+                ulong word = _words[0];
+                while(true)
+                {
+                    // Find start of next run
+                    while(word == 0)
+                    {
+                        if(++i == _wordCount)
+                            return;
+                        word = _words[i];
+                    }
+
+                    int start = 64 * i + BitOperations.TrailingZeroCount(word);
+
+                    // Find end of run, by looking for the next zero bit
+                    word |= word - 1;
+                    while(word == ulong.MaxValue)
+                    {
+                        if(++i == _wordCount)
+                        {
+                            runs.Add(new Run(start, 65535));
+                            return;
+                        }
+
+                        word = _words[i];
+                    }
+
+                    runs.Add(new Run(start, 64 * i + BitOperations.TrailingZeroCount(~word) - 1));
+
+                    // Clear the bits of the run in the current word
+                    word &= word + 1;
+                }
+            }
+
+            public override IEnumerable<int> AsEnumerable()
+            {
+                for(int i = 0; i < _wordCount; ++i)
+                {
+                    ulong word = _words[i];
+                    while(word != 0)
+                    {
+                        yield return 64 * i + BitOperations.TrailingZeroCount(word);
+                        word &= word - 1;
+                    }
+                }
+            }
+
+            public Container UnionWith(Container other)
+            {
+                if(other is BitmapContainer otherBitmapContainer)
+                {
+                    for(int i = 0; i < _wordCount; ++i)
+                        _words[i] |= otherBitmapContainer._words[i];
+                }
+                else
+                {
+                    foreach(var run in other.GetRuns())
+                        SetRange(run.Start, run.End);
+                }
+
+                UpdateCardinality();
+                return this;
+            }
+
+            public Container ExceptWith(Container other)
+            {
+                if(other is BitmapContainer otherBitmapContainer)
+                {
+                    for(int i = 0; i < _wordCount; ++i)
+                        _words[i] &= ~otherBitmapContainer._words[i];
+                }
+                else
+                {
+                    foreach(var run in other.GetRuns())
+                        ClearRange(run.Start, run.End);
+                }
+
+                UpdateCardinality();
+                return Shrink();
+            }
+
+            public Container IntersectWith(BitmapContainer other)
+            {
+                for(int i = 0; i < _wordCount; ++i)
+                    _words[i] &= other._words[i];
+
+                UpdateCardinality();
+                return Shrink();
+            }
+
+            /// <summary>
+            /// Converts this container into a more compact one, if its cardinality became small enough.
+            /// </summary>
+            private Container Shrink()
+            {
+                return Cardinality <= _maxArrayContainerLength ? FromRuns(Key, GetRuns()) : this;
+            }
+
+            private void UpdateCardinality()
+            {
+                int cardinality = 0;
+                foreach(var word in _words)
+                    cardinality += BitOperations.PopCount(word);
+                Cardinality = cardinality;
+            }
+
+            private void SetRange(int start, int end)
+            {
+                int firstWord = start / 64;
+                int lastWord = end / 64;
+                ulong firstMask = ulong.MaxValue << (start % 64);
+                ulong lastMask = ulong.MaxValue >> (63 - end % 64);
+                if(firstWord == lastWord)
+                {
+                    _words[firstWord] |= firstMask & lastMask;
+                    return;
+                }
+
+                _words[firstWord] |= firstMask;
+                _words.AsSpan(firstWord + 1, lastWord - firstWord - 1).Fill(ulong.MaxValue);
+                _words[lastWord] |= lastMask;
+            }
+
+            private void ClearRange(int start, int end)
+            {
+                int firstWord = start / 64;
+                int lastWord = end / 64;
+                ulong firstMask = ulong.MaxValue << (start % 64);
+                ulong lastMask = ulong.MaxValue >> (63 - end % 64);
+                if(firstWord == lastWord)
+                {
+                    _words[firstWord] &= ~(firstMask & lastMask);
+                    return;
+                }
+
+                _words[firstWord] &= ~firstMask;
+                _words.AsSpan(firstWord + 1, lastWord - firstWord - 1).Clear();
+                _words[lastWord] &= ~lastMask;
+            }
+        }
+
+        /// <summary>
+        /// Stores the values as a sorted list of runs of consecutive values.
+        /// </summary>
+        private sealed class RunContainer : Container
+        {
+            /// <summary>
+            /// Start and (inclusive) end of each run.
+            /// </summary>
+            private ushort[] _runs;
+
+            private int _runCount;
+
+            public RunContainer(ushort key, List<Run> runs, int cardinality)
+                : base(key)
+            {
+                _runs = new ushort[2 * runs.Count];
+                foreach(var run in runs)
+                {
+                    _runs[2 * _runCount] = (ushort)run.Start;
+                    _runs[2 * _runCount + 1] = (ushort)run.End;
+                    ++_runCount;
+                }
+
+                Cardinality = cardinality;
+            }
+
+            private RunContainer(RunContainer other)
+                : base(other.Key)
+            {
+                _runs = other._runs.AsSpan(0, 2 * other._runCount).ToArray();
+                _runCount = other._runCount;
+                Cardinality = other.Cardinality;
+            }
+
+            public override int Min => _runs[0];
+
+            public override Container Add(ushort value)
+            {
+                int index = FindRun(value);
+                if(index >= 0 && value <= _runs[2 * index + 1])
+                    return this;
+
+                ++Cardinality;
+                bool extendsPrevious = index >= 0 && _runs[2 * index + 1] + 1 == value;
+                bool extendsNext = index + 1 < _runCount && _runs[2 * (index + 1)] == value + 1;
+                if(extendsPrevious && extendsNext)
+                {
+                    // Merge both runs
+                    _runs[2 * index + 1] = _runs[2 * (index + 1) + 1];
+                    RemoveRun(index + 1);
+                }
+                else if(extendsPrevious)
+                    _runs[2 * index + 1] = value;
+                else if(extendsNext)
+                    _runs[2 * (index + 1)] = value;
+                else
+                {
+                    InsertRun(index + 1, value, value);
+                    return Reshape();
+                }
+
+                return this;
+            }
+
+            public override Container Remove(ushort value)
+            {
+                int index = FindRun(value);
+                if(index < 0 || value > _runs[2 * index + 1])
+                    return this;
+
+                --Cardinality;
+                ushort start = _runs[2 * index];
+                ushort end = _runs[2 * index + 1];
+                if(start == end)
+                    RemoveRun(index);
+                else if(value == start)
+                    _runs[2 * index] = (ushort)(value + 1);
+                else if(value == end)
+                    _runs[2 * index + 1] = (ushort)(value - 1);
+                else
+                {
+                    // Split run
+                    _runs[2 * index + 1] = (ushort)(value - 1);
+                    InsertRun(index + 1, (ushort)(value + 1), end);
+                }
+
+                return Reshape();
+            }
+
+            public override Container Copy()
+            {
+                return new RunContainer(this);
+            }
+
+            public override void AppendRuns(List<Run> runs)
+            {
+                for(int i = 0; i < _runCount; ++i)
+                    runs.Add(new Run(_runs[2 * i], _runs[2 * i + 1]));
+            }
+
+            public override IEnumerable<int> AsEnumerable()
+            {
+                for(int i = 0; i < _runCount; ++i)
+                {
+                    for(int value = _runs[2 * i]; value <= _runs[2 * i + 1]; ++value)
+                        yield return value;
+                }
+            }
+
+            /// <summary>
+            /// Returns the index of the last run starting at or before the given value, or -1 if there is none.
+            /// </summary>
+            private int FindRun(ushort value)
+            {
+                int low = 0;
+                int high = _runCount - 1;
+                int result = -1;
+                while(low <= high)
+                {
+                    int mid = (low + high) >>> 1;
+                    if(_runs[2 * mid] <= value)
+                    {
+                        result = mid;
+                        low = mid + 1;
+                    }
+                    else
+                        high = mid - 1;
+                }
+
+                return result;
+            }
+
+            private void InsertRun(int index, ushort start, ushort end)
+            {
+                if(2 * _runCount == _runs.Length)
+                    Array.Resize(ref _runs, Math.Max(2, 2 * _runs.Length));
+
+                Array.Copy(_runs, 2 * index, _runs, 2 * index + 2, 2 * (_runCount - index));
+                _runs[2 * index] = start;
+                _runs[2 * index + 1] = end;
+                ++_runCount;
+            }
+
+            private void RemoveRun(int index)
+            {
+                --_runCount;
+                Array.Copy(_runs, 2 * index + 2, _runs, 2 * index, 2 * (_runCount - index));
+            }
+
+            /// <summary>
+            /// Converts this container into a different representation, if that one is more compact.
+            /// </summary>
+            private Container Reshape()
+            {
+                if(Cardinality == 0 || 4 * _runCount < Math.Min(2 * Cardinality, _bitmapContainerSize))
+                    return this;
+
+                return FromRuns(Key, GetRuns());
+            }
+        }
     }
 }
\ No newline at end of file
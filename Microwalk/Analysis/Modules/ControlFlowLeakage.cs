@@ -1,10 +1,12 @@
 ﻿using System;
-using System.Buffers.Binary;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Runtime.InteropServices;
 using System.Text;
+using System.Threading;
 using System.Threading.Tasks;
 using Microwalk.FrameworkBase;
 using Microwalk.FrameworkBase.Configuration;
@@ -13,7 +15,6 @@ using Microwalk.FrameworkBase.Stages;
 using Microwalk.FrameworkBase.TraceFormat;
 using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
 using Microwalk.FrameworkBase.Utilities;
-using Standart.Hash.xxHash;
 
 namespace Microwalk.Analysis.Modules;
 
@@ -26,11 +27,13 @@ public partial class ControlFlowLeakage : AnalysisStage
     private const ulong _addressIdFlagsMask = 0xC000_0000_0000_0000;
 
     /// <summary>
-    /// Call stack ID of the root node (base value for call stack ID hashing)
+    /// Call stack hash of the root node.
     /// </summary>
-    private const ulong _rootNodeCallStackId = 0;
+    private const ulong _rootNodeCallStackId = CallStackTrie.RootHash;
 
-    public override bool SupportsParallelism => false;
+    public override bool SupportsParallelism => true;
+
+    public override bool SupportsLeakageEstimates => true;
 
     /// <summary>
     /// The output directory for analysis results.
@@ -57,25 +60,36 @@ public partial class ControlFlowLeakage : AnalysisStage
     /// </summary>
     private bool _includeTestcasesInCallStacks;
 
+    /// <summary>
+    /// Number of traces after which a partial call tree is merged into the main call tree.
+    /// </summary>
+    private int _mergeInterval;
+
     /// <summary>
     /// Root node of merged call tree.
     /// </summary>
     private readonly RootNode _rootNode = new();
 
     /// <summary>
-    /// Lookup for formatted image addresses.
+    /// Partial call trees which are not currently used by a thread.
     /// </summary>
-    private readonly Dictionary<ulong, string> _formattedImageAddresses = new();
+    private readonly ConcurrentBag<PartialCallTree> _idlePartialCallTrees = new();
 
     /// <summary>
-    /// Lookup for image addresses (used for machine-readable call stack dump, which needs to preserve image offsets).
+    /// Running leakage estimate per (call stack ID, branch instruction ID), based on the sequence of branch targets.
+    /// Only updated when <see cref="AnalysisStage.TrackLeakageEstimates"/> is set.
     /// </summary>
-    private readonly Dictionary<ulong, (string imageName, uint offset)> _imageAddresses = new();
+    private readonly LeakageEstimator<(ulong, ulong)> _leakageEstimator = new();
 
     /// <summary>
-    /// Lookup for formatted heap/stack addresses.
+    /// Lookup for formatted image addresses.
+    /// </summary>
+    private readonly ConcurrentDictionary<ulong, string> _formattedImageAddresses = new();
+
+    /// <summary>
+    /// Lookup for image addresses (used for machine-readable call stack dump, which needs to preserve image offsets).
     /// </summary>
-    private readonly Dictionary<ulong, string> _formattedMemoryAddresses = new();
+    private readonly ConcurrentDictionary<ulong, (string imageName, uint offset)> _imageAddresses = new();
 
     /// <summary>
     /// Allocation ID which is used for all stack memory accesses which could not be resolved to an allocation.
@@ -126,734 +140,764 @@ public partial class ControlFlowLeakage : AnalysisStage
         string logMessagePrefix = $"[analyze:cfl:{traceEntity.Id}]";
         await Logger.LogDebugAsync($"{logMessagePrefix} Processing trace #{traceEntity.Id}");
 
+        // Traces are added to a partial call tree which is exclusively owned by the current thread, so concurrent traces do not need to synchronize
+        if(!_idlePartialCallTrees.TryTake(out var partialCallTree))
+            partialCallTree = new PartialCallTree();
+
         // Mark our visit at the root node
-        _rootNode.TestcaseIds.Add(traceEntity.Id);
+        partialCallTree.RootNode.TestcaseIds.Add(traceEntity.Id);
+
+        // Run through trace entries
+        var visitor = new TraceVisitor(this, partialCallTree.RootNode, traceEntity.Id, traceEntity.PreprocessedTraceFile.Prefix, logMessagePrefix);
+        traceEntity.PreprocessedTraceFile.VisitWithPrefix(ref visitor);
+
+        // Update running estimate
+        if(visitor.BranchHashes != null)
+        {
+            foreach(var (branch, hash) in visitor.BranchHashes)
+                _leakageEstimator.Add(branch, new UInt128(hash.LastValue, hash.GetHash()));
+            _leakageEstimator.CompleteTestcase();
+        }
+
+        // Move partial call tree into main call tree, if it is large enough
+        if(++partialCallTree.TraceCount >= _mergeInterval)
+        {
+            await Logger.LogDebugAsync($"{logMessagePrefix} Merging partial call tree with {partialCallTree.TraceCount} traces");
+            lock(_rootNode)
+                MergeCallTree(partialCallTree.RootNode);
+            return;
+        }
+
+        _idlePartialCallTrees.Add(partialCallTree);
+    }
 
-        // Buffer for call stack ID computations
-        byte[] callStackBuffer = new byte[24]; // hash | source address | target address
-        var callStackBufferHash = callStackBuffer.AsMemory(0..8);
-        var callStackBufferSource = callStackBuffer.AsMemory(8..16);
-        var callStackBufferTarget = callStackBuffer.AsMemory(16..24);
+    public override LeakageEstimate? GetLeakageEstimate() => TrackLeakageEstimates ? _leakageEstimator.GetEstimate() : null;
+
+    /// <summary>
+    /// Merges a single trace into the call tree.
+    /// </summary>
+    private struct TraceVisitor : ITraceEntryVisitor
+    {
+        private readonly ControlFlowLeakage _analysis;
+        private readonly int _testcaseId;
+        private readonly Dictionary<int, TracePrefixFile.ImageFileInfo> _imageFiles;
+        private readonly CallStackTrie _callStacks;
+        private readonly string _logMessagePrefix;
 
         // Mapping for trace allocation IDs to call tree allocation IDs
-        Dictionary<int, int> heapAllocationIdMapping = new();
-        Dictionary<int, int> stackAllocationIdMapping = new();
+        private readonly Dictionary<int, int> _heapAllocationIdMapping = new();
+        private readonly Dictionary<int, int> _stackAllocationIdMapping = new();
 
-        // Run through trace entries
-        Stack<(SplitNode node, int successorIndex)> nodeStack = new();
-        Stack<ulong> callStackIds = new();
-        SplitNode currentNode = _rootNode;
-        int successorIndex = 0;
-        ulong currentCallStackId = _rootNodeCallStackId;
-        int traceEntryId = -1;
-        var traceEnumerator = traceEntity.PreprocessedTraceFile.GetNonAllocatingEnumeratorWithPrefix();
-        while(traceEnumerator.MoveNext())
+        private readonly Stack<(SplitNode node, int successorIndex)> _nodeStack = new();
+        private SplitNode _currentNode;
+        private int _successorIndex = 0;
+        private ulong _currentCallStackId = _rootNodeCallStackId;
+        private int _traceEntryId = -1;
+
+        /// <summary>
+        /// Hashes of the target sequences of each (call stack ID, branch instruction ID), for the running leakage estimate.
+        /// Null if no estimate is tracked.
+        /// </summary>
+        public Dictionary<(ulong, ulong), AccessSequenceHash>? BranchHashes { get; }
+
+        public TraceVisitor(ControlFlowLeakage analysis, RootNode rootNode, int testcaseId, TracePrefixFile tracePrefix, string logMessagePrefix)
         {
-            var traceEntry = traceEnumerator.Current;
-            ++traceEntryId;
+            _analysis = analysis;
+            _testcaseId = testcaseId;
+            _imageFiles = tracePrefix.ImageFiles;
+            _callStacks = tracePrefix.CallStacks;
+            _logMessagePrefix = logMessagePrefix;
 
-            if(traceEntry.EntryType == TraceEntryTypes.Branch)
-            {
-                var branchEntry = (Branch)traceEntry;
+            _currentNode = rootNode;
 
-                // Format addresses
-                ulong sourceInstructionId = StoreFormattedImageAddress(traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[branchEntry.SourceImageId], branchEntry.SourceInstructionRelativeAddress);
+            if(analysis.TrackLeakageEstimates)
+                BranchHashes = new Dictionary<(ulong, ulong), AccessSequenceHash>();
+        }
+
+        public void VisitBranch(Branch.View entry)
+        {
+            ++_traceEntryId;
+
+            // Format addresses
+            ulong sourceInstructionId = _analysis.StoreFormattedImageAddress(_imageFiles[entry.SourceImageId], entry.SourceInstructionRelativeAddress);
+
+            ulong targetInstructionId = 0;
+            if(entry.Taken)
+                targetInstructionId = _analysis.StoreFormattedImageAddress(_imageFiles[entry.DestinationImageId], entry.DestinationInstructionRelativeAddress);
 
-                ulong targetInstructionId = 0;
-                if(branchEntry.Taken)
-                    targetInstructionId = StoreFormattedImageAddress(traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[branchEntry.DestinationImageId], branchEntry.DestinationInstructionRelativeAddress);
+            // Record branch target for the running estimate (0 for non-taken branches)
+            if(BranchHashes != null)
+                CollectionsMarshal.GetValueRefOrAddDefault(BranchHashes, (_currentCallStackId, sourceInstructionId), out _).Add(targetInstructionId);
 
-                switch(branchEntry.BranchType)
+            switch(entry.BranchType)
+            {
+                case Branch.BranchTypes.Call:
                 {
-                    case Branch.BranchTypes.Call:
+                    // Enter call stack of callee, as interned by the preprocessor
+                    // The trie IDs depend on the order in which the traces were preprocessed, so we use the hash of the call chain instead
+                    _currentCallStackId = _callStacks.GetNode(entry.CallStackId).Hash;
+
+                    // Are there successor nodes from previous testcases?
+                    if(_successorIndex < _currentNode.Successors.Count)
                     {
-                        // Compute new call stack ID
-                        callStackIds.Push(currentCallStackId);
-                        BinaryPrimitives.WriteUInt64LittleEndian(callStackBufferHash.Span, currentCallStackId);
-                        BinaryPrimitives.WriteUInt64LittleEndian(callStackBufferSource.Span, sourceInstructionId);
-                        BinaryPrimitives.WriteUInt64LittleEndian(callStackBufferTarget.Span, targetInstructionId);
-                        currentCallStackId = xxHash64.ComputeHash(callStackBuffer, callStackBuffer.Length);
-
-                        // Are there successor nodes from previous testcases?
-                        if(successorIndex < currentNode.Successors.Count)
+                        // Check current successor
+                        if(_currentNode.Successors[_successorIndex] is CallNode callNode && callNode.SourceInstructionId == sourceInstructionId && callNode.TargetInstructionId == targetInstructionId)
                         {
-                            // Check current successor
-                            if(currentNode.Successors[successorIndex] is CallNode callNode && callNode.SourceInstructionId == sourceInstructionId && callNode.TargetInstructionId == targetInstructionId)
-                            {
-                                // The successor matches, we can continue there
+                            // The successor matches, we can continue there
 
-                                nodeStack.Push((currentNode, successorIndex + 1)); // The node still has linear history, we want to return there
-                                callNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode = callNode;
-                                successorIndex = 0;
-                            }
-                            else
-                            {
-                                // Successor does not match, we need to split the current node at this point
+                            _nodeStack.Push((_currentNode, _successorIndex + 1)); // The node still has linear history, we want to return there
+                            callNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode = callNode;
+                            _successorIndex = 0;
+                        }
+                        else
+                        {
+                            // Successor does not match, we need to split the current node at this point
 
-                                callNode = new CallNode(sourceInstructionId, targetInstructionId, currentCallStackId);
-                                var newSplitNode = currentNode.SplitAtSuccessor(successorIndex, traceEntity.Id, callNode);
+                            callNode = new CallNode(sourceInstructionId, targetInstructionId, _currentCallStackId);
+                            var newSplitNode = _currentNode.SplitAtSuccessor(_successorIndex, _testcaseId, callNode);
 
-                                nodeStack.Push((newSplitNode, 1)); // Return to split node and keep filling its successors
-                                callNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode = callNode;
-                                successorIndex = 0;
-                            }
+                            _nodeStack.Push((newSplitNode, 1)); // Return to split node and keep filling its successors
+                            callNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode = callNode;
+                            _successorIndex = 0;
                         }
-                        else
+                    }
+                    else
+                    {
+                        // We ran out of successor nodes
+                        // Check whether another testcase already hit this particular path
+                        if(_currentNode.TestcaseIds.Count == 1)
                         {
-                            // We ran out of successor nodes
-                            // Check whether another testcase already hit this particular path
-                            if(currentNode.TestcaseIds.Count == 1)
-                            {
-                                // No, this is purely ours. So just append another successor
-                                var callNode = new CallNode(sourceInstructionId, targetInstructionId, currentCallStackId);
-                                currentNode.Successors.Add(callNode);
-
-                                nodeStack.Push((currentNode, successorIndex + 1)); // The node still has linear history, we want to return there
-                                callNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode = callNode;
-                                successorIndex = 0;
-                            }
-                            else if(currentNode.SplitSuccessors.Count > 0)
+                            // No, this is purely ours. So just append another successor
+                            var callNode = new CallNode(sourceInstructionId, targetInstructionId, _currentCallStackId);
+                            _currentNode.Successors.Add(callNode);
+
+                            _nodeStack.Push((_currentNode, _successorIndex + 1)); // The node still has linear history, we want to return there
+                            callNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode = callNode;
+                            _successorIndex = 0;
+                        }
+                        else if(_currentNode.SplitSuccessors.Count > 0)
+                        {
+                            // Is there a split successor that matches?
+                            bool found = false;
+                            foreach(var splitSuccessor in _currentNode.SplitSuccessors)
                             {
-                                // Is there a split successor that matches?
-                                bool found = false;
-                                foreach(var splitSuccessor in currentNode.SplitSuccessors)
+                                if(splitSuccessor.Successors[0] is CallNode callNode && callNode.SourceInstructionId == sourceInstructionId && callNode.TargetInstructionId == targetInstructionId)
                                 {
-                                    if(splitSuccessor.Successors[0] is CallNode callNode && callNode.SourceInstructionId == sourceInstructionId && callNode.TargetInstructionId == targetInstructionId)
-                                    {
-                                        // The split successor matches, we can continue there
+                                    // The split successor matches, we can continue there
 
-                                        splitSuccessor.TestcaseIds.Add(traceEntity.Id);
+                                    splitSuccessor.TestcaseIds.Add(_testcaseId);
 
-                                        nodeStack.Push((splitSuccessor, 1)); // Return to split node and keep going through its successors
-                                        callNode.TestcaseIds.Add(traceEntity.Id);
-                                        currentNode = callNode;
-                                        successorIndex = 0;
-
-                                        found = true;
-                                        break;
-                                    }
-                                }
+                                    _nodeStack.Push((splitSuccessor, 1)); // Return to split node and keep going through its successors
+                                    callNode.TestcaseIds.Add(_testcaseId);
+                                    _currentNode = callNode;
+                                    _successorIndex = 0;
 
-                                if(!found)
-                                {
-                                    // Add new split successor
-                                    var splitNode = new SplitNode();
-                                    var callNode = new CallNode(sourceInstructionId, targetInstructionId, currentCallStackId);
-
-                                    splitNode.Successors.Add(callNode);
-                                    splitNode.TestcaseIds.Add(traceEntity.Id);
-                                    currentNode.SplitSuccessors.Add(splitNode);
-
-                                    nodeStack.Push((splitNode, 1)); // Return to split node and keep filling its successors
-                                    callNode.TestcaseIds.Add(traceEntity.Id);
-                                    currentNode = callNode;
-                                    successorIndex = 0;
+                                    found = true;
+                                    break;
                                 }
                             }
-                            else
-                            {
-                                // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
-                                await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Encountered weird case for call entry");
 
+                            if(!found)
+                            {
+                                // Add new split successor
                                 var splitNode = new SplitNode();
-                                var callNode = new CallNode(sourceInstructionId, targetInstructionId, currentCallStackId);
+                                var callNode = new CallNode(sourceInstructionId, targetInstructionId, _currentCallStackId);
 
                                 splitNode.Successors.Add(callNode);
-                                splitNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode.SplitSuccessors.Add(splitNode);
+                                splitNode.TestcaseIds.Add(_testcaseId);
+                                _currentNode.SplitSuccessors.Add(splitNode);
 
-                                nodeStack.Push((splitNode, 1)); // Return to split node and keep filling its successors
-                                callNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode = callNode;
-                                successorIndex = 0;
+                                _nodeStack.Push((splitNode, 1)); // Return to split node and keep filling its successors
+                                callNode.TestcaseIds.Add(_testcaseId);
+                                _currentNode = callNode;
+                                _successorIndex = 0;
                             }
                         }
+                        else
+                        {
+                            // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
+                            _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Encountered weird case for call entry").Wait();
+
+                            var splitNode = new SplitNode();
+                            var callNode = new CallNode(sourceInstructionId, targetInstructionId, _currentCallStackId);
+
+                            splitNode.Successors.Add(callNode);
+                            splitNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode.SplitSuccessors.Add(splitNode);
 
-                        break;
+                            _nodeStack.Push((splitNode, 1)); // Return to split node and keep filling its successors
+                            callNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode = callNode;
+                            _successorIndex = 0;
+                        }
                     }
 
-                    case Branch.BranchTypes.Jump:
+                    break;
+                }
+
+                case Branch.BranchTypes.Jump:
+                {
+                    // Are there successor nodes from previous testcases?
+                    if(_successorIndex < _currentNode.Successors.Count)
                     {
-                        // Are there successor nodes from previous testcases?
-                        if(successorIndex < currentNode.Successors.Count)
+                        // Check current successor
+                        if(_currentNode.Successors[_successorIndex] is BranchNode branchNode && branchNode.SourceInstructionId == sourceInstructionId && branchNode.TargetInstructionId == targetInstructionId)
                         {
-                            // Check current successor
-                            if(currentNode.Successors[successorIndex] is BranchNode branchNode && branchNode.SourceInstructionId == sourceInstructionId && branchNode.TargetInstructionId == targetInstructionId)
-                            {
-                                // The successor matches, nothing to do here
+                            // The successor matches, nothing to do here
 
-                                ++successorIndex;
-                            }
-                            else
-                            {
-                                // Successor does not match, we need to split the current node at this point
+                            ++_successorIndex;
+                        }
+                        else
+                        {
+                            // Successor does not match, we need to split the current node at this point
 
-                                branchNode = new BranchNode(sourceInstructionId, targetInstructionId, branchEntry.Taken);
-                                var newSplitNode = currentNode.SplitAtSuccessor(successorIndex, traceEntity.Id, branchNode);
+                            branchNode = new BranchNode(sourceInstructionId, targetInstructionId, entry.Taken);
+                            var newSplitNode = _currentNode.SplitAtSuccessor(_successorIndex, _testcaseId, branchNode);
 
-                                // Continue with new split node
-                                currentNode = newSplitNode;
-                                successorIndex = 1;
-                            }
+                            // Continue with new split node
+                            _currentNode = newSplitNode;
+                            _successorIndex = 1;
                         }
-                        else
+                    }
+                    else
+                    {
+                        // We ran out of successor nodes
+                        // Check whether another testcase already hit this particular path
+                        if(_currentNode.TestcaseIds.Count == 1)
                         {
-                            // We ran out of successor nodes
-                            // Check whether another testcase already hit this particular path
-                            if(currentNode.TestcaseIds.Count == 1)
-                            {
-                                // No, this is purely ours. So just append another successor
-                                var branchNode = new BranchNode(sourceInstructionId, targetInstructionId, branchEntry.Taken);
-                                currentNode.Successors.Add(branchNode);
+                            // No, this is purely ours. So just append another successor
+                            var branchNode = new BranchNode(sourceInstructionId, targetInstructionId, entry.Taken);
+                            _currentNode.Successors.Add(branchNode);
 
-                                // Next
-                                ++successorIndex;
-                            }
-                            else if(currentNode.SplitSuccessors.Count > 0)
+                            // Next
+                            ++_successorIndex;
+                        }
+                        else if(_currentNode.SplitSuccessors.Count > 0)
+                        {
+                            // Is there a split successor that matches?
+                            bool found = false;
+                            foreach(var splitSuccessor in _currentNode.SplitSuccessors)
                             {
-                                // Is there a split successor that matches?
-                                bool found = false;
-                                foreach(var splitSuccessor in currentNode.SplitSuccessors)
+                                if(splitSuccessor.Successors[0] is BranchNode branchNode && branchNode.SourceInstructionId == sourceInstructionId && branchNode.TargetInstructionId == targetInstructionId)
                                 {
-                                    if(splitSuccessor.Successors[0] is BranchNode branchNode && branchNode.SourceInstructionId == sourceInstructionId && branchNode.TargetInstructionId == targetInstructionId)
-                                    {
-                                        // The split successor matches, we can continue there
-
-                                        splitSuccessor.TestcaseIds.Add(traceEntity.Id);
-
-                                        currentNode = splitSuccessor;
-                                        successorIndex = 1;
-
-                                        found = true;
-                                        break;
-                                    }
-                                }
+                                    // The split successor matches, we can continue there
 
-                                if(!found)
-                                {
-                                    // Add new split successor
-                                    var splitNode = new SplitNode();
-                                    var branchNode = new BranchNode(sourceInstructionId, targetInstructionId, branchEntry.Taken);
+                                    splitSuccessor.TestcaseIds.Add(_testcaseId);
 
-                                    splitNode.Successors.Add(branchNode);
-                                    splitNode.TestcaseIds.Add(traceEntity.Id);
-                                    currentNode.SplitSuccessors.Add(splitNode);
+                                    _currentNode = splitSuccessor;
+                                    _successorIndex = 1;
 
-                                    // Continue with new split node
-                                    currentNode = splitNode;
-                                    successorIndex = 1;
+                                    found = true;
+                                    break;
                                 }
                             }
-                            else
-                            {
-                                // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
-                                await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Encountered weird case for branch entry");
 
+                            if(!found)
+                            {
+                                // Add new split successor
                                 var splitNode = new SplitNode();
-                                var branchNode = new BranchNode(sourceInstructionId, targetInstructionId, branchEntry.Taken);
+                                var branchNode = new BranchNode(sourceInstructionId, targetInstructionId, entry.Taken);
 
                                 splitNode.Successors.Add(branchNode);
-                                splitNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode.SplitSuccessors.Add(splitNode);
+                                splitNode.TestcaseIds.Add(_testcaseId);
+                                _currentNode.SplitSuccessors.Add(splitNode);
 
                                 // Continue with new split node
-                                currentNode = splitNode;
-                                successorIndex = 1;
+                                _currentNode = splitNode;
+                                _successorIndex = 1;
                             }
                         }
+                        else
+                        {
+                            // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
+                            _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Encountered weird case for branch entry").Wait();
+
+                            var splitNode = new SplitNode();
+                            var branchNode = new BranchNode(sourceInstructionId, targetInstructionId, entry.Taken);
+
+                            splitNode.Successors.Add(branchNode);
+                            splitNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode.SplitSuccessors.Add(splitNode);
 
-                        break;
+                            // Continue with new split node
+                            _currentNode = splitNode;
+                            _successorIndex = 1;
+                        }
                     }
 
-                    case Branch.BranchTypes.Return:
+                    break;
+                }
+
+                case Branch.BranchTypes.Return:
+                {
+                    // Are there successor nodes from previous testcases?
+                    if(_successorIndex < _currentNode.Successors.Count)
                     {
-                        // Are there successor nodes from previous testcases?
-                        if(successorIndex < currentNode.Successors.Count)
+                        // Check current successor
+                        if(_currentNode.Successors[_successorIndex] is ReturnNode returnNode && returnNode.SourceInstructionId == sourceInstructionId && returnNode.TargetInstructionId == targetInstructionId)
                         {
-                            // Check current successor
-                            if(currentNode.Successors[successorIndex] is ReturnNode returnNode && returnNode.SourceInstructionId == sourceInstructionId && returnNode.TargetInstructionId == targetInstructionId)
-                            {
-                                // The successor matches, we don't need to do anything here
+                            // The successor matches, we don't need to do anything here
 
-                                if(nodeStack.Count == 0)
-                                {
-                                    await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] (1) Encountered return entry, but node stack is empty; continuing with root node");
-                                    ++successorIndex;
-                                }
-                                else
-                                {
-                                    (currentNode, successorIndex) = nodeStack.Pop();
-                                }
+                            if(_nodeStack.Count == 0)
+                            {
+                                _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] (1) Encountered return entry, but node stack is empty; continuing with root node").Wait();
+                                ++_successorIndex;
                             }
                             else
                             {
-                                // Successor does not match, we need to split the current node at this point
-
-                                returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
-                                currentNode.SplitAtSuccessor(successorIndex, traceEntity.Id, returnNode);
-
-                                if(nodeStack.Count == 0)
-                                    await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] (2) Encountered return entry, but node stack is empty; continuing with root node");
-                                else
-                                {
-                                    (currentNode, successorIndex) = nodeStack.Pop();
-                                }
+                                (_currentNode, _successorIndex) = _nodeStack.Pop();
                             }
                         }
                         else
                         {
-                            // We ran out of successor nodes
-                            // Check whether another testcase already hit this particular path
-                            if(currentNode.TestcaseIds.Count == 1)
+                            // Successor does not match, we need to split the current node at this point
+
+                            returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
+                            _currentNode.SplitAtSuccessor(_successorIndex, _testcaseId, returnNode);
+
+                            if(_nodeStack.Count == 0)
+                                _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] (2) Encountered return entry, but node stack is empty; continuing with root node").Wait();
+                            else
                             {
-                                // No, this is purely ours. So just append another successor
-                                var returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
-                                currentNode.Successors.Add(returnNode);
+                                (_currentNode, _successorIndex) = _nodeStack.Pop();
+                            }
+                        }
+                    }
+                    else
+                    {
+                        // We ran out of successor nodes
+                        // Check whether another testcase already hit this particular path
+                        if(_currentNode.TestcaseIds.Count == 1)
+                        {
+                            // No, this is purely ours. So just append another successor
+                            var returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
+                            _currentNode.Successors.Add(returnNode);
 
-                                if(nodeStack.Count == 0)
-                                {
-                                    await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] (3) Encountered return entry, but node stack is empty; continuing with root node");
-                                    ++successorIndex;
-                                }
-                                else
-                                {
-                                    (currentNode, successorIndex) = nodeStack.Pop();
-                                }
+                            if(_nodeStack.Count == 0)
+                            {
+                                _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] (3) Encountered return entry, but node stack is empty; continuing with root node").Wait();
+                                ++_successorIndex;
                             }
-                            else if(currentNode.SplitSuccessors.Count > 0)
+                            else
                             {
-                                // Is there a split successor that matches?
-                                bool found = false;
-                                foreach(var splitSuccessor in currentNode.SplitSuccessors)
-                                {
-                                    if(splitSuccessor.Successors[0] is ReturnNode returnNode && returnNode.SourceInstructionId == sourceInstructionId && returnNode.TargetInstructionId == targetInstructionId)
-                                    {
-                                        // The split successor matches, we don't have to do anything here
-
-                                        splitSuccessor.TestcaseIds.Add(traceEntity.Id);
-
-                                        if(nodeStack.Count == 0)
-                                            await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] (4) Encountered return entry, but node stack is empty; continuing with root node");
-                                        else
-                                        {
-                                            (currentNode, successorIndex) = nodeStack.Pop();
-                                        }
-
-                                        found = true;
-                                        break;
-                                    }
-                                }
-
-                                if(!found)
+                                (_currentNode, _successorIndex) = _nodeStack.Pop();
+                            }
+                        }
+                        else if(_currentNode.SplitSuccessors.Count > 0)
+                        {
+                            // Is there a split successor that matches?
+                            bool found = false;
+                            foreach(var splitSuccessor in _currentNode.SplitSuccessors)
+                            {
+                                if(splitSuccessor.Successors[0] is ReturnNode returnNode && returnNode.SourceInstructionId == sourceInstructionId && returnNode.TargetInstructionId == targetInstructionId)
                                 {
-                                    // Add new split successor
-                                    var splitNode = new SplitNode();
-                                    var returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
+                                    // The split successor matches, we don't have to do anything here
 
-                                    splitNode.Successors.Add(returnNode);
-                                    splitNode.TestcaseIds.Add(traceEntity.Id);
-                                    currentNode.SplitSuccessors.Add(splitNode);
+                                    splitSuccessor.TestcaseIds.Add(_testcaseId);
 
-                                    if(nodeStack.Count == 0)
-                                        await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] (5) Encountered return entry, but node stack is empty; continuing with root node");
+                                    if(_nodeStack.Count == 0)
+                                        _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] (4) Encountered return entry, but node stack is empty; continuing with root node").Wait();
                                     else
                                     {
-                                        (currentNode, successorIndex) = nodeStack.Pop();
+                                        (_currentNode, _successorIndex) = _nodeStack.Pop();
                                     }
+
+                                    found = true;
+                                    break;
                                 }
                             }
-                            else
-                            {
-                                // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
-                                await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Encountered weird case for return entry");
 
+                            if(!found)
+                            {
+                                // Add new split successor
                                 var splitNode = new SplitNode();
                                 var returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
 
                                 splitNode.Successors.Add(returnNode);
-                                splitNode.TestcaseIds.Add(traceEntity.Id);
-                                currentNode.SplitSuccessors.Add(splitNode);
+                                splitNode.TestcaseIds.Add(_testcaseId);
+                                _currentNode.SplitSuccessors.Add(splitNode);
 
-                                if(nodeStack.Count == 0)
-                                    await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] (6) Encountered return entry, but node stack is empty; continuing with root node");
+                                if(_nodeStack.Count == 0)
+                                    _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] (5) Encountered return entry, but node stack is empty; continuing with root node").Wait();
                                 else
                                 {
-                                    (currentNode, successorIndex) = nodeStack.Pop();
+                                    (_currentNode, _successorIndex) = _nodeStack.Pop();
                                 }
                             }
                         }
+                        else
+                        {
+                            // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
+                            _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Encountered weird case for return entry").Wait();
 
-                        // Restore call stack ID
-                        // We do not emit an extra warning when the call stack is empty, as the node stack is already checked
-                        if(callStackIds.Count > 0)
-                            currentCallStackId = callStackIds.Pop();
+                            var splitNode = new SplitNode();
+                            var returnNode = new ReturnNode(sourceInstructionId, targetInstructionId);
+
+                            splitNode.Successors.Add(returnNode);
+                            splitNode.TestcaseIds.Add(_testcaseId);
+                            _currentNode.SplitSuccessors.Add(splitNode);
 
-                        break;
+                            if(_nodeStack.Count == 0)
+                                _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] (6) Encountered return entry, but node stack is empty; continuing with root node").Wait();
+                            else
+                            {
+                                (_currentNode, _successorIndex) = _nodeStack.Pop();
+                            }
+                        }
                     }
+
+                    // Restore call stack ID
+                    // The preprocessor keeps unbalanced returns at the root, we do not emit an extra warning here, as the node stack is already checked
+                    _currentCallStackId = _callStacks.GetNode(entry.CallStackId).Hash;
+
+                    break;
                 }
             }
-            else if(traceEntry.EntryType is TraceEntryTypes.HeapAllocation or TraceEntryTypes.StackAllocation)
-            {
-                /*
-                 * Step 1: Extract allocation data
-                 */
-
-                int id = 0;
-                uint size = 0;
-                bool isHeap = false;
-                switch(traceEntry.EntryType)
-                {
-                    case TraceEntryTypes.HeapAllocation:
-                    {
-                        var alloc = (HeapAllocation)traceEntry;
-
-                        id = alloc.Id;
-                        size = alloc.Size;
-                        isHeap = true;
+        }
 
-                        break;
-                    }
+        public void VisitHeapAllocation(HeapAllocation.View entry)
+        {
+            ++_traceEntryId;
 
-                    case TraceEntryTypes.StackAllocation:
-                    {
-                        var alloc = (StackAllocation)traceEntry;
+            HandleAllocation(entry.Id, entry.Size, true);
+        }
 
-                        id = alloc.Id;
-                        size = alloc.Size;
-                        isHeap = false;
+        public void VisitStackAllocation(StackAllocation.View entry)
+        {
+            ++_traceEntryId;
 
-                        break;
-                    }
-                }
+            HandleAllocation(entry.Id, entry.Size, false);
+        }
 
-                /*
-                * Step 2: Handle individual cases, same as for branches.
-                *
-                * We split when the allocation size differs; else we re-use existing allocation nodes, and map all subsequent memory accesses
-                * to its unique ID.
-                */
+        public void VisitHeapFree(HeapFree.View entry)
+        {
+            ++_traceEntryId;
+        }
 
-                var allocationIdMapping = isHeap ? heapAllocationIdMapping : stackAllocationIdMapping;
+        public void VisitImageMemoryAccess(ImageMemoryAccess.View entry)
+        {
+            ++_traceEntryId;
 
-                // Are there successor nodes from previous testcases?
-                if(successorIndex < currentNode.Successors.Count)
-                {
-                    // Check current successor
-                    if(currentNode.Successors[successorIndex] is AllocationNode allocationNode && allocationNode.Size == size && allocationNode.IsHeap == isHeap)
-                    {
-                        // The successor matches, nothing to do here
+            // Extract and format address information
+            ulong instructionId = _analysis.StoreFormattedImageAddress(_imageFiles[entry.InstructionImageId], entry.InstructionRelativeAddress);
+            ulong targetAddressId = _analysis.StoreFormattedImageAddress(_imageFiles[entry.MemoryImageId], entry.MemoryRelativeAddress);
 
-                        allocationIdMapping.Add(id, allocationNode.Id);
+            HandleMemoryAccess(instructionId, targetAddressId, entry.IsWrite);
+        }
 
-                        ++successorIndex;
-                    }
-                    else
-                    {
-                        // Successor does not match, we need to split the current node at this point
+        public void VisitStackMemoryAccess(StackMemoryAccess.View entry)
+        {
+            ++_traceEntryId;
 
-                        allocationNode = new AllocationNode(_nextSharedAllocationId++, size, isHeap);
-                        var newSplitNode = currentNode.SplitAtSuccessor(successorIndex, traceEntity.Id, allocationNode);
+            // Extract and format address information
+            ulong instructionId = _analysis.StoreFormattedImageAddress(_imageFiles[entry.InstructionImageId], entry.InstructionRelativeAddress);
 
-                        allocationIdMapping.Add(id, allocationNode.Id);
+            // Resolve shared allocation ID
+            int allocationId;
+            if(entry.StackAllocationBlockId == -1)
+                allocationId = _unmappedStackAllocationId;
+            else if(!_stackAllocationIdMapping.TryGetValue(entry.StackAllocationBlockId, out allocationId))
+            {
+                allocationId = _unmappedStackAllocationId;
+                _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Could not find shared stack allocation node S#{entry.StackAllocationBlockId}, using default unmapped allocation ID").Wait();
+            }
 
-                        // Continue with new split node
-                        currentNode = newSplitNode;
-                        successorIndex = 1;
-                    }
-                }
-                else
-                {
-                    // We ran out of successor nodes
-                    // Check whether another testcase already hit this particular path
-                    if(currentNode.TestcaseIds.Count == 1)
-                    {
-                        // No, this is purely ours. So just append another successor
-                        var allocationNode = new AllocationNode(_nextSharedAllocationId++, size, isHeap);
-                        currentNode.Successors.Add(allocationNode);
+            ulong targetAddressId = _addressIdFlagMemory | ((((ulong)allocationId << 32) | entry.MemoryRelativeAddress) & ~_addressIdFlagsMask);
 
-                        allocationIdMapping.Add(id, allocationNode.Id);
+            HandleMemoryAccess(instructionId, targetAddressId, entry.IsWrite);
+        }
 
-                        // Next
-                        ++successorIndex;
-                    }
-                    else if(currentNode.SplitSuccessors.Count > 0)
-                    {
-                        // Is there a split successor that matches?
-                        bool found = false;
-                        foreach(var splitSuccessor in currentNode.SplitSuccessors)
-                        {
-                            if(splitSuccessor.Successors[0] is AllocationNode allocationNode && allocationNode.Size == size && allocationNode.IsHeap == isHeap)
-                            {
-                                // The split successor matches, we can continue there
+        public void VisitHeapMemoryAccess(HeapMemoryAccess.View entry)
+        {
+            ++_traceEntryId;
 
-                                splitSuccessor.TestcaseIds.Add(traceEntity.Id);
+            // Extract and format address information
+            ulong instructionId = _analysis.StoreFormattedImageAddress(_imageFiles[entry.InstructionImageId], entry.InstructionRelativeAddress);
 
-                                allocationIdMapping.Add(id, allocationNode.Id);
+            // Resolve shared allocation ID
+            if(!_heapAllocationIdMapping.TryGetValue(entry.HeapAllocationBlockId, out var allocationId))
+            {
+                allocationId = _unmappedHeapAllocationId;
+                _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Could not find shared heap allocation node, using default unmapped allocation ID").Wait();
+            }
 
-                                currentNode = splitSuccessor;
-                                successorIndex = 1;
+            ulong targetAddressId = _addressIdFlagMemory | _addressIdFlagHeap | ((((ulong)allocationId << 32) | entry.MemoryRelativeAddress) & ~_addressIdFlagsMask);
 
-                                found = true;
-                                break;
-                            }
-                        }
+            HandleMemoryAccess(instructionId, targetAddressId, entry.IsWrite);
+        }
 
-                        if(!found)
-                        {
-                            // Add new split successor
-                            var splitNode = new SplitNode();
-                            var allocationNode = new AllocationNode(_nextSharedAllocationId++, size, isHeap);
+        /// <summary>
+        /// Merges an allocation into the call tree.
+        /// </summary>
+        /// <param name="id">Allocation ID in the current trace.</param>
+        /// <param name="size">Allocation size.</param>
+        /// <param name="isHeap">Determines whether this is a heap or a stack allocation.</param>
+        private void HandleAllocation(int id, uint size, bool isHeap)
+        {
+            /*
+            * Handle individual cases, same as for branches.
+            *
+            * We split when the allocation size differs; else we re-use existing allocation nodes, and map all subsequent memory accesses
+            * to its unique ID.
+            */
 
-                            allocationIdMapping.Add(id, allocationNode.Id);
+            var allocationIdMapping = isHeap ? _heapAllocationIdMapping : _stackAllocationIdMapping;
 
-                            splitNode.Successors.Add(allocationNode);
-                            splitNode.TestcaseIds.Add(traceEntity.Id);
-                            currentNode.SplitSuccessors.Add(splitNode);
+            // Are there successor nodes from previous testcases?
+            if(_successorIndex < _currentNode.Successors.Count)
+            {
+                // Check current successor
+                if(_currentNode.Successors[_successorIndex] is AllocationNode allocationNode && allocationNode.Size == size && allocationNode.IsHeap == isHeap)
+                {
+                    // The successor matches, nothing to do here
 
-                            // Continue with new split node
-                            currentNode = splitNode;
-                            successorIndex = 1;
-                        }
-                    }
-                    else
-                    {
-                        // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
-                        await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Encountered weird case for allocation entry");
+                    allocationIdMapping.Add(id, allocationNode.Id);
 
-                        var splitNode = new SplitNode();
-                        var allocationNode = new AllocationNode(_nextSharedAllocationId++, size, isHeap);
+                    ++_successorIndex;
+                }
+                else
+                {
+                    // Successor does not match, we need to split the current node at this point
 
-                        allocationIdMapping.Add(id, allocationNode.Id);
+                    allocationNode = new AllocationNode(_analysis.GetNextSharedAllocationId(), size, isHeap);
+                    var newSplitNode = _currentNode.SplitAtSuccessor(_successorIndex, _testcaseId, allocationNode);
 
-                        splitNode.Successors.Add(allocationNode);
-                        splitNode.TestcaseIds.Add(traceEntity.Id);
-                        currentNode.SplitSuccessors.Add(splitNode);
+                    allocationIdMapping.Add(id, allocationNode.Id);
 
-                        // Continue with new split node
-                        currentNode = splitNode;
-                        successorIndex = 1;
-                    }
+                    // Continue with new split node
+                    _currentNode = newSplitNode;
+                    _successorIndex = 1;
                 }
             }
-            else if(traceEntry.EntryType is TraceEntryTypes.ImageMemoryAccess or TraceEntryTypes.StackMemoryAccess or TraceEntryTypes.HeapMemoryAccess)
+            else
             {
-                /*
-                 * Step 1: Extract memory access info
-                 */
-
-                // Extract and format address information
-                ulong instructionId = 0;
-                ulong targetAddressId = 0;
-                bool isWrite = false;
-                switch(traceEntry.EntryType)
+                // We ran out of successor nodes
+                // Check whether another testcase already hit this particular path
+                if(_currentNode.TestcaseIds.Count == 1)
                 {
-                    case TraceEntryTypes.ImageMemoryAccess:
-                    {
-                        var memoryAccess = (ImageMemoryAccess)traceEntry;
+                    // No, this is purely ours. So just append another successor
+                    var allocationNode = new AllocationNode(_analysis.GetNextSharedAllocationId(), size, isHeap);
+                    _currentNode.Successors.Add(allocationNode);
 
-                        instructionId = StoreFormattedImageAddress(traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[memoryAccess.InstructionImageId], memoryAccess.InstructionRelativeAddress);
-                        targetAddressId = StoreFormattedImageAddress(traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[memoryAccess.MemoryImageId], memoryAccess.MemoryRelativeAddress);
-
-                        isWrite = memoryAccess.IsWrite;
-
-                        break;
-                    }
+                    allocationIdMapping.Add(id, allocationNode.Id);
 
-                    case TraceEntryTypes.StackMemoryAccess:
+                    // Next
+                    ++_successorIndex;
+                }
+                else if(_currentNode.SplitSuccessors.Count > 0)
+                {
+                    // Is there a split successor that matches?
+                    bool found = false;
+                    foreach(var splitSuccessor in _currentNode.SplitSuccessors)
                     {
-                        var memoryAccess = (StackMemoryAccess)traceEntry;
-
-                        instructionId = StoreFormattedImageAddress(traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[memoryAccess.InstructionImageId], memoryAccess.InstructionRelativeAddress);
-
-                        // Resolve shared allocation ID
-                        int allocationId;
-                        if(memoryAccess.StackAllocationBlockId == -1)
-                            allocationId = _unmappedStackAllocationId;
-                        else if(!stackAllocationIdMapping.TryGetValue(memoryAccess.StackAllocationBlockId, out allocationId))
+                        if(splitSuccessor.Successors[0] is AllocationNode allocationNode && allocationNode.Size == size && allocationNode.IsHeap == isHeap)
                         {
-                            allocationId = _unmappedStackAllocationId;
-                            await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Could not find shared stack allocation node S#{memoryAccess.StackAllocationBlockId}, using default unmapped allocation ID");
-                        }
+                            // The split successor matches, we can continue there
 
-                        targetAddressId = _addressIdFlagMemory | ((((ulong)allocationId << 32) | memoryAccess.MemoryRelativeAddress) & ~_addressIdFlagsMask);
-                        if(!_formattedMemoryAddresses.ContainsKey(targetAddressId))
-                            _formattedMemoryAddresses.Add(targetAddressId, $"S#{(allocationId == _unmappedStackAllocationId ? "?" : allocationId)}+{memoryAccess.MemoryRelativeAddress:x8}");
+                            splitSuccessor.TestcaseIds.Add(_testcaseId);
 
-                        isWrite = memoryAccess.IsWrite;
+                            allocationIdMapping.Add(id, allocationNode.Id);
+
+                            _currentNode = splitSuccessor;
+                            _successorIndex = 1;
 
-                        break;
+                            found = true;
+                            break;
+                        }
                     }
 
-                    case TraceEntryTypes.HeapMemoryAccess:
+                    if(!found)
                     {
-                        var memoryAccess = (HeapMemoryAccess)traceEntry;
-
-                        instructionId = StoreFormattedImageAddress(traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[memoryAccess.InstructionImageId], memoryAccess.InstructionRelativeAddress);
-
-                        // Resolve shared allocation ID
-                        if(!heapAllocationIdMapping.TryGetValue(memoryAccess.HeapAllocationBlockId, out var allocationId))
-                        {
-                            allocationId = _unmappedHeapAllocationId;
-                            await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Could not find shared heap allocation node, using default unmapped allocation ID");
-                        }
+                        // Add new split successor
+                        var splitNode = new SplitNode();
+                        var allocationNode = new AllocationNode(_analysis.GetNextSharedAllocationId(), size, isHeap);
 
-                        targetAddressId = _addressIdFlagMemory | _addressIdFlagHeap | ((((ulong)allocationId << 32) | memoryAccess.MemoryRelativeAddress) & ~_addressIdFlagsMask);
-                        if(!_formattedMemoryAddresses.ContainsKey(targetAddressId))
-                            _formattedMemoryAddresses.Add(targetAddressId, $"H#{allocationId}+{memoryAccess.MemoryRelativeAddress:x8}");
+                        allocationIdMapping.Add(id, allocationNode.Id);
 
-                        isWrite = memoryAccess.IsWrite;
+                        splitNode.Successors.Add(allocationNode);
+                        splitNode.TestcaseIds.Add(_testcaseId);
+                        _currentNode.SplitSuccessors.Add(splitNode);
 
-                        break;
+                        // Continue with new split node
+                        _currentNode = splitNode;
+                        _successorIndex = 1;
                     }
                 }
+                else
+                {
+                    // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
+                    _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Encountered weird case for allocation entry").Wait();
 
-                /*
-                 * Step 2: Handle individual cases, same as for branches.
-                 *
-                 * Contrary to branches, we don't split the tree as long as the instruction ID is identical, since memory accesses do not affect control flow.
-                 * Instead, a split memory access stores a record of all accessed addresses and the respective testcase IDs.
-                 */
+                    var splitNode = new SplitNode();
+                    var allocationNode = new AllocationNode(_analysis.GetNextSharedAllocationId(), size, isHeap);
 
-                // Are there successor nodes from previous testcases?
-                if(successorIndex < currentNode.Successors.Count)
+                    allocationIdMapping.Add(id, allocationNode.Id);
+
+                    splitNode.Successors.Add(allocationNode);
+                    splitNode.TestcaseIds.Add(_testcaseId);
+                    _currentNode.SplitSuccessors.Add(splitNode);
+
+                    // Continue with new split node
+                    _currentNode = splitNode;
+                    _successorIndex = 1;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Merges a memory access into the call tree.
+        /// </summary>
+        /// <param name="instructionId">ID of the accessing instruction.</param>
+        /// <param name="targetAddressId">ID of the accessed address.</param>
+        /// <param name="isWrite">Determines whether this is a write access.</param>
+        private void HandleMemoryAccess(ulong instructionId, ulong targetAddressId, bool isWrite)
+        {
+            /*
+             * Handle individual cases, same as for branches.
+             *
+             * Contrary to branches, we don't split the tree as long as the instruction ID is identical, since memory accesses do not affect control flow.
+             * Instead, a split memory access stores a record of all accessed addresses and the respective testcase IDs.
+             */
+
+            // Are there successor nodes from previous testcases?
+            if(_successorIndex < _currentNode.Successors.Count)
+            {
+                // Check current successor
+                if(_currentNode.Successors[_successorIndex] is MemoryAccessNode memoryNode && memoryNode.InstructionId == instructionId)
                 {
-                    // Check current successor
-                    if(currentNode.Successors[successorIndex] is MemoryAccessNode memoryNode && memoryNode.InstructionId == instructionId)
-                    {
-                        // The successor matches, check whether our access target is recorded
+                    // The successor matches, check whether our access target is recorded
 
-                        if(memoryNode is SimpleMemoryAccessNode simpleMemoryNode)
+                    if(memoryNode is SimpleMemoryAccessNode simpleMemoryNode)
+                    {
+                        if(simpleMemoryNode.TargetAddress != targetAddressId)
                         {
-                            if(simpleMemoryNode.TargetAddress != targetAddressId)
-                            {
-                                var splitMemoryNode = new SplitMemoryAccessNode(memoryNode.InstructionId, memoryNode.IsWrite);
-                                splitMemoryNode.Targets.Add(simpleMemoryNode.TargetAddress, currentNode.TestcaseIds.Without(traceEntity.Id));
-                                splitMemoryNode.Targets.Add(targetAddressId, new TestcaseIdSet(traceEntity.Id));
-                                currentNode.Successors[successorIndex] = splitMemoryNode;
-                            }
+                            var splitMemoryNode = new SplitMemoryAccessNode(memoryNode.InstructionId, memoryNode.IsWrite);
+                            splitMemoryNode.Targets.Add(simpleMemoryNode.TargetAddress, _currentNode.TestcaseIds.Without(_testcaseId));
+                            splitMemoryNode.Targets.Add(targetAddressId, new TestcaseIdSet(_testcaseId));
+                            _currentNode.Successors[_successorIndex] = splitMemoryNode;
                         }
-                        else if(memoryNode is SplitMemoryAccessNode splitMemoryNode)
+                    }
+                    else if(memoryNode is SplitMemoryAccessNode splitMemoryNode)
+                    {
+                        if(splitMemoryNode.Targets.TryGetValue(targetAddressId, out var targetTestcaseIdSet))
+                            targetTestcaseIdSet.Add(_testcaseId);
+                        else
                         {
-                            if(splitMemoryNode.Targets.TryGetValue(targetAddressId, out var targetTestcaseIdSet))
-                                targetTestcaseIdSet.Add(traceEntity.Id);
-                            else
-                            {
-                                targetTestcaseIdSet = new TestcaseIdSet();
-                                targetTestcaseIdSet.Add(traceEntity.Id);
-                                splitMemoryNode.Targets.Add(targetAddressId, targetTestcaseIdSet);
-                            }
+                            targetTestcaseIdSet = new TestcaseIdSet();
+                            targetTestcaseIdSet.Add(_testcaseId);
+                            splitMemoryNode.Targets.Add(targetAddressId, targetTestcaseIdSet);
                         }
-
-                        ++successorIndex;
                     }
-                    else
-                    {
-                        // Successor does not match, we need to split the current node at this point
-                        // This is unlikely, as we should have seen a control flow deviation beforehand. But maybe this is some weird
-                        // kind of masked instruction or a conditional move, which sometimes does trigger a memory access and sometimes does not,
-                        // so we handle this case anyway.
 
-                        var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
+                    ++_successorIndex;
+                }
+                else
+                {
+                    // Successor does not match, we need to split the current node at this point
+                    // This is unlikely, as we should have seen a control flow deviation beforehand. But maybe this is some weird
+                    // kind of masked instruction or a conditional move, which sometimes does trigger a memory access and sometimes does not,
+                    // so we handle this case anyway.
 
-                        var newSplitNode = currentNode.SplitAtSuccessor(successorIndex, traceEntity.Id, simpleMemoryNode);
+                    var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
 
-                        // Continue with new split node
-                        currentNode = newSplitNode;
-                        successorIndex = 1;
-                    }
+                    var newSplitNode = _currentNode.SplitAtSuccessor(_successorIndex, _testcaseId, simpleMemoryNode);
+
+                    // Continue with new split node
+                    _currentNode = newSplitNode;
+                    _successorIndex = 1;
                 }
-                else
+            }
+            else
+            {
+                // We ran out of successor nodes
+                // Check whether another testcase already hit this particular path
+                if(_currentNode.TestcaseIds.Count == 1)
                 {
-                    // We ran out of successor nodes
-                    // Check whether another testcase already hit this particular path
-                    if(currentNode.TestcaseIds.Count == 1)
-                    {
-                        // No, this is purely ours. So just append another successor
-                        var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
+                    // No, this is purely ours. So just append another successor
+                    var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
 
-                        currentNode.Successors.Add(simpleMemoryNode);
+                    _currentNode.Successors.Add(simpleMemoryNode);
 
-                        // Next
-                        ++successorIndex;
-                    }
-                    else if(currentNode.SplitSuccessors.Count > 0)
+                    // Next
+                    ++_successorIndex;
+                }
+                else if(_currentNode.SplitSuccessors.Count > 0)
+                {
+                    // Is there a split successor that matches?
+                    bool found = false;
+                    foreach(var splitSuccessor in _currentNode.SplitSuccessors)
                     {
-                        // Is there a split successor that matches?
-                        bool found = false;
-                        foreach(var splitSuccessor in currentNode.SplitSuccessors)
+                        if(splitSuccessor.Successors[0] is MemoryAccessNode memoryNode && memoryNode.InstructionId == instructionId)
                         {
-                            if(splitSuccessor.Successors[0] is MemoryAccessNode memoryNode && memoryNode.InstructionId == instructionId)
-                            {
-                                // The split successor matches, we can continue there
+                            // The split successor matches, we can continue there
 
-                                // Check whether our access target is recorded
-                                if(memoryNode is SimpleMemoryAccessNode simpleMemoryNode)
+                            // Check whether our access target is recorded
+                            if(memoryNode is SimpleMemoryAccessNode simpleMemoryNode)
+                            {
+                                if(simpleMemoryNode.TargetAddress != targetAddressId)
                                 {
-                                    if(simpleMemoryNode.TargetAddress != targetAddressId)
-                                    {
-                                        var splitMemoryNode = new SplitMemoryAccessNode(memoryNode.InstructionId, memoryNode.IsWrite);
-                                        splitMemoryNode.Targets.Add(simpleMemoryNode.TargetAddress, currentNode.TestcaseIds.Without(traceEntity.Id));
-                                        splitMemoryNode.Targets.Add(targetAddressId, new TestcaseIdSet(traceEntity.Id));
-                                        splitSuccessor.Successors[0] = splitMemoryNode;
-                                    }
+                                    var splitMemoryNode = new SplitMemoryAccessNode(memoryNode.InstructionId, memoryNode.IsWrite);
+                                    splitMemoryNode.Targets.Add(simpleMemoryNode.TargetAddress, splitSuccessor.TestcaseIds.Copy());
+                                    splitMemoryNode.Targets.Add(targetAddressId, new TestcaseIdSet(_testcaseId));
+                                    splitSuccessor.Successors[0] = splitMemoryNode;
                                 }
-                                else if(memoryNode is SplitMemoryAccessNode splitMemoryNode)
+                            }
+                            else if(memoryNode is SplitMemoryAccessNode splitMemoryNode)
+                            {
+                                if(splitMemoryNode.Targets.TryGetValue(targetAddressId, out var targetTestcaseIdSet))
+                                    targetTestcaseIdSet.Add(_testcaseId);
+                                else
                                 {
-                                    if(splitMemoryNode.Targets.TryGetValue(targetAddressId, out var targetTestcaseIdSet))
-                                        targetTestcaseIdSet.Add(traceEntity.Id);
-                                    else
-                                    {
-                                        targetTestcaseIdSet = new TestcaseIdSet();
-                                        targetTestcaseIdSet.Add(traceEntity.Id);
-                                        splitMemoryNode.Targets.Add(targetAddressId, targetTestcaseIdSet);
-                                    }
+                                    targetTestcaseIdSet = new TestcaseIdSet();
+                                    targetTestcaseIdSet.Add(_testcaseId);
+                                    splitMemoryNode.Targets.Add(targetAddressId, targetTestcaseIdSet);
                                 }
-
-                                splitSuccessor.TestcaseIds.Add(traceEntity.Id);
-
-                                currentNode = splitSuccessor;
-                                successorIndex = 1;
-
-                                found = true;
-                                break;
                             }
-                        }
 
-                        if(!found)
-                        {
-                            // Add new split successor
-                            var splitNode = new SplitNode();
-                            var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
+                            splitSuccessor.TestcaseIds.Add(_testcaseId);
 
-                            splitNode.Successors.Add(simpleMemoryNode);
-                            splitNode.TestcaseIds.Add(traceEntity.Id);
-                            currentNode.SplitSuccessors.Add(splitNode);
+                            _currentNode = splitSuccessor;
+                            _successorIndex = 1;
 
-                            // Continue with new split node
-                            currentNode = splitNode;
-                            successorIndex = 1;
+                            found = true;
+                            break;
                         }
                     }
-                    else
-                    {
-                        // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
-                        await Logger.LogWarningAsync($"{logMessagePrefix} [{traceEntryId}] Encountered weird case for memory access entry");
 
+                    if(!found)
+                    {
+                        // Add new split successor
                         var splitNode = new SplitNode();
                         var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
 
                         splitNode.Successors.Add(simpleMemoryNode);
-                        splitNode.TestcaseIds.Add(traceEntity.Id);
-                        currentNode.SplitSuccessors.Add(splitNode);
+                        splitNode.TestcaseIds.Add(_testcaseId);
+                        _currentNode.SplitSuccessors.Add(splitNode);
 
                         // Continue with new split node
-                        currentNode = splitNode;
-                        successorIndex = 1;
+                        _currentNode = splitNode;
+                        _successorIndex = 1;
                     }
                 }
+                else
+                {
+                    // Another testcase already hit this branch and ended just before ours, which is weird, but we handle it anyway by creating a dummy split
+                    _analysis.Logger.LogWarningAsync($"{_logMessagePrefix} [{_traceEntryId}] Encountered weird case for memory access entry").Wait();
+
+                    var splitNode = new SplitNode();
+                    var simpleMemoryNode = new SimpleMemoryAccessNode(instructionId, isWrite, targetAddressId);
+
+                    splitNode.Successors.Add(simpleMemoryNode);
+                    splitNode.TestcaseIds.Add(_testcaseId);
+                    _currentNode.SplitSuccessors.Add(splitNode);
+
+                    // Continue with new split node
+                    _currentNode = splitNode;
+                    _successorIndex = 1;
+                }
             }
         }
     }
@@ -873,6 +917,10 @@ public partial class ControlFlowLeakage : AnalysisStage
         string logMessagePrefix = "[analyze:cfl]";
         await Logger.LogInfoAsync($"{logMessagePrefix} Running control flow leakage analysis");
 
+        // Merge remaining partial call trees, and make the result independent of the order in which traces were added
+        MergeIdlePartialCallTrees();
+        NormalizeCallTree();
+
         // Write call tree to text file
         await using var callTreeDumpWriter = new StreamWriter(File.Create(Path.Combine(_outputDirectory.FullName, "call-tree-dump.txt")));
 
@@ -1083,7 +1131,7 @@ public partial class ControlFlowLeakage : AnalysisStage
                             if(memoryAccessNode is SimpleMemoryAccessNode simpleMemoryNode)
                             {
                                 string formattedTargetAddress = (simpleMemoryNode.TargetAddress & _addressIdFlagMemory) != 0
-                                    ? _formattedMemoryAddresses[simpleMemoryNode.TargetAddress]
+                                    ? FormatMemoryAddress(simpleMemoryNode.TargetAddress)
                                     : _formattedImageAddresses[simpleMemoryNode.TargetAddress];
 
                                 await callTreeDumpWriter.WriteLineAsync($"{indentation}      {formattedTargetAddress}");
@@ -1093,7 +1141,7 @@ public partial class ControlFlowLeakage : AnalysisStage
                                 foreach(var targetAddress in splitMemoryNode.Targets)
                                 {
                                     string formattedTargetAddress = (targetAddress.Key & _addressIdFlagMemory) != 0
-                                        ? _formattedMemoryAddresses[targetAddress.Key]
+                                        ? FormatMemoryAddress(targetAddress.Key)
                                         : _formattedImageAddresses[targetAddress.Key];
 
                                     await callTreeDumpWriter.WriteLineAsync($"{indentation}      {formattedTargetAddress} : {FormatIntegerSequence(targetAddress.Value.AsEnumerable())} ({targetAddress.Value.Count} total)");
@@ -1431,6 +1479,10 @@ public partial class ControlFlowLeakage : AnalysisStage
         _dumpCallTree = moduleOptions.GetChildNodeOrDefault("dump-call-tree")?.AsBoolean() ?? false;
         _includeMemoryAccessesInCallTreeDump = moduleOptions.GetChildNodeOrDefault("include-memory-accesses-in-dump")?.AsBoolean() ?? true;
         _includeTestcasesInCallStacks = moduleOptions.GetChildNodeOrDefault("include-testcases-in-call-stacks")?.AsBoolean() ?? true;
+
+        _mergeInterval = moduleOptions.GetChildNodeOrDefault("merge-interval")?.AsInteger() ?? 64;
+        if(_mergeInterval < 1)
+            throw new ConfigurationException("The call tree merge interval must be positive.");
     }
 
     public override Task UnInitAsync()
@@ -1452,11 +1504,41 @@ public partial class ControlFlowLeakage : AnalysisStage
         if(!_formattedImageAddresses.ContainsKey(key))
             _formattedImageAddresses.TryAdd(key, _mapFileCollection.FormatAddress(imageFileInfo.Id, imageFileInfo.Name, address));
         if(!_imageAddresses.ContainsKey(key))
-            _imageAddresses.Add(key, (imageFileInfo.Name, address));
+            _imageAddresses.TryAdd(key, (imageFileInfo.Name, address));
 
         return key;
     }
 
+    /// <summary>
+    /// Formats the given heap/stack address ID.
+    /// </summary>
+    /// <param name="addressId">Memory address ID, as created by the trace visitor.</param>
+    private static string FormatMemoryAddress(ulong addressId)
+    {
+        int allocationId = GetAllocationId(addressId);
+        uint offset = unchecked((uint)addressId);
+        if((addressId & _addressIdFlagHeap) != 0)
+            return $"H#{allocationId}+{offset:x8}";
+        return $"S#{(allocationId == _unmappedStackAllocationId ? "?" : allocationId)}+{offset:x8}";
+    }
+
+    /// <summary>
+    /// Extracts the allocation ID from the given heap/stack address ID.
+    /// </summary>
+    /// <param name="addressId">Memory address ID.</param>
+    private static int GetAllocationId(ulong addressId)
+    {
+        return (int)((addressId & ~_addressIdFlagsMask) >> 32);
+    }
+
+    /// <summary>
+    /// Reserves a new, globally unique allocation ID.
+    /// </summary>
+    private int GetNextSharedAllocationId()
+    {
+        return Interlocked.Increment(ref _nextSharedAllocationId) - 1;
+    }
+
     /// <summary>
     /// Formats a sequence of integers in compressed form.
     /// Example:
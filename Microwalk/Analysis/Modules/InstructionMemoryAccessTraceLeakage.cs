@@ -5,15 +5,17 @@ using System.Collections.Generic;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Runtime.InteropServices;
+using System.Threading;
 using System.Threading.Tasks;
 using Microwalk.FrameworkBase;
 using Microwalk.FrameworkBase.Configuration;
 using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.Extensions;
 using Microwalk.FrameworkBase.Stages;
 using Microwalk.FrameworkBase.TraceFormat;
 using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
 using Microwalk.FrameworkBase.Utilities;
-using Standart.Hash.xxHash;
 
 namespace Microwalk.Analysis.Modules
 {
@@ -21,9 +23,20 @@ namespace Microwalk.Analysis.Modules
     internal class InstructionMemoryAccessTraceLeakage : AnalysisStage
     {
         /// <summary>
-        /// Maps testcase IDs to lists of instruction hashes (testcase ID => instruction ID => hash).
+        /// Aggregated memory access hashes, indexed by instruction ID.
+        /// The hashes of each testcase are folded in as soon as the testcase is analyzed, so memory usage only depends on the number of distinct hashes.
         /// </summary>
-        private readonly ConcurrentDictionary<int, Dictionary<ulong, byte[]>> _testcaseInstructionHashes = new();
+        private readonly ConcurrentDictionary<ulong, InstructionData> _instructions = new();
+
+        /// <summary>
+        /// Number of analyzed testcases.
+        /// </summary>
+        private int _testcaseCount;
+
+        /// <summary>
+        /// Running leakage estimate per instruction. Only updated when <see cref="AnalysisStage.TrackLeakageEstimates"/> is set.
+        /// </summary>
+        private readonly LeakageEstimator<ulong> _leakageEstimator = new();
 
         /// <summary>
         /// Maps instruction addresses to formatted instructions.
@@ -52,140 +65,121 @@ namespace Microwalk.Analysis.Modules
 
         public override bool SupportsParallelism => true;
 
+        public override bool SupportsLeakageEstimates => true;
+
+        public override bool SupportsStateSerialization => true;
+
         public override Task AddTraceAsync(TraceEntity traceEntity)
         {
             // Input check
             if(traceEntity.PreprocessedTraceFile == null)
                 throw new Exception("Preprocessed trace is null. Is the preprocessor stage missing?");
             
-            // Allocate dictionary for mapping instruction addresses to memory access hashes
-            var instructionHashes = new Dictionary<ulong, byte[]>();
-
             // Hash all memory access instructions
-            foreach(var traceEntry in traceEntity.PreprocessedTraceFile)
+            var visitor = new TraceVisitor(this, traceEntity.PreprocessedTraceFile.Prefix!);
+            traceEntity.PreprocessedTraceFile.Visit(ref visitor);
+
+            // Fold instruction hashes into the per-instruction counts
+            // The instructions are enumerated in order of their first memory access, which determines the output order
+            int instructionIndex = 0;
+            foreach(var (instructionId, hash) in visitor.InstructionHashes)
             {
-                // Extract instruction and memory address IDs (some kind of hash consisting of image ID and relative address)
-                ulong instructionId;
-                ulong memoryAddressId;
-                switch(traceEntry.EntryType)
-                {
-                    case TraceEntryTypes.HeapMemoryAccess:
-                    {
-                        var heapMemoryAccess = (HeapMemoryAccess)traceEntry;
-                        instructionId = ((ulong)heapMemoryAccess.InstructionImageId << 32) | heapMemoryAccess.InstructionRelativeAddress;
-                        memoryAddressId = ((ulong)heapMemoryAccess.HeapAllocationBlockId << 32) | heapMemoryAccess.MemoryRelativeAddress;
-
-                        // Format instruction
-                        StoreFormattedInstruction(instructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[heapMemoryAccess.InstructionImageId],
-                                                  heapMemoryAccess.InstructionRelativeAddress);
-                        break;
-                    }
-                    case TraceEntryTypes.ImageMemoryAccess:
-                    {
-                        var imageMemoryAccess = (ImageMemoryAccess)traceEntry;
-                        instructionId = ((ulong)imageMemoryAccess.InstructionImageId << 32) | imageMemoryAccess.InstructionRelativeAddress;
-                        memoryAddressId = ((ulong)imageMemoryAccess.MemoryImageId << 32) | imageMemoryAccess.MemoryRelativeAddress;
-
-                        // Format instruction
-                        StoreFormattedInstruction(instructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[imageMemoryAccess.InstructionImageId],
-                                                  imageMemoryAccess.InstructionRelativeAddress);
-                        break;
-                    }
-                    case TraceEntryTypes.StackMemoryAccess:
-                    {
-                        var stackMemoryAccess = (StackMemoryAccess)traceEntry;
-                        instructionId = ((ulong)stackMemoryAccess.InstructionImageId << 32) | stackMemoryAccess.InstructionRelativeAddress;
-                        memoryAddressId = stackMemoryAccess.MemoryRelativeAddress;
-
-                        // Format instruction
-                        StoreFormattedInstruction(instructionId,
-                                                  traceEntity.PreprocessedTraceFile.Prefix!.ImageFiles[stackMemoryAccess.InstructionImageId],
-                                                  stackMemoryAccess.InstructionRelativeAddress);
-                        break;
-                    }
-                    default:
-                        continue;
-                }
+                // The lower half of the final hash is the sequence hash, the upper half the last accessed address
+                var finalHash = new UInt128(hash.LastValue, hash.GetHash());
+                _instructions.GetOrAdd(instructionId, _ => new InstructionData()).AddTestcase(traceEntity.Id, instructionIndex++, finalHash, _dumpFullData);
+                if(TrackLeakageEstimates)
+                    _leakageEstimator.Add(instructionId, finalHash);
+            }
+            Interlocked.Increment(ref _testcaseCount);
+            if(TrackLeakageEstimates)
+                _leakageEstimator.CompleteTestcase();
 
-                // Retrieve old hash
-                if(!instructionHashes.TryGetValue(instructionId, out var hash))
-                {
-                    hash = new byte[16];
-                    instructionHashes.Add(instructionId, hash);
-                }
+            // Done
+            return Task.CompletedTask;
+        }
 
-                // Update hash:
-                // newHash = hash(oldHash || address)
-                var hashLeft = hash.AsSpan(0);
-                var hashRight = hash.AsSpan(8);
-                BinaryPrimitives.WriteUInt64LittleEndian(hashRight, memoryAddressId);
-                BinaryPrimitives.WriteUInt64LittleEndian(hashLeft, xxHash64.ComputeHash(hash, 16));
+        public override LeakageEstimate? GetLeakageEstimate() => TrackLeakageEstimates ? _leakageEstimator.GetEstimate() : null;
+
+        public override Task SaveStateAsync(IFastBinaryWriter writer)
+        {
+            writer.WriteInt32(_testcaseCount);
+            writer.WriteBoolean(_dumpFullData);
+
+            writer.WriteInt32(_formattedInstructions.Count);
+            foreach(var (instructionId, formattedInstruction) in _formattedInstructions)
+            {
+                writer.WriteUInt64(instructionId);
+                writer.WriteLengthPrefixedString(formattedInstruction);
             }
 
-            // Store instruction hashes
-            _testcaseInstructionHashes.AddOrUpdate(traceEntity.Id, instructionHashes, (_, h) => h);
+            writer.WriteInt32(_instructions.Count);
+            foreach(var (instructionId, instructionData) in _instructions)
+            {
+                writer.WriteUInt64(instructionId);
+                instructionData.Store(writer);
+            }
 
-            // Done
             return Task.CompletedTask;
         }
 
-        public override async Task FinishAsync()
+        public override Task MergeStateAsync(IFastBinaryReader reader)
         {
-            var instructionLeakage = new Dictionary<ulong, InstructionLeakageResult>();
+            _testcaseCount += reader.ReadInt32();
+            bool hasTestcaseIds = reader.ReadBoolean();
+            if(_dumpFullData && !hasTestcaseIds)
+                throw new Exception("The saved state does not contain testcase IDs, which are needed for a full data dump. Enable dump-full-data when saving the state.");
 
-            // Transform instruction hash lists into better usable form
-            await Logger.LogInfoAsync("Running memory access trace leakage analysis");
-            var instructions = new Dictionary<ulong, InstructionData>(); // Maps instruction addresses to testcase count and hash count
-            foreach(var testcase in _testcaseInstructionHashes)
+            int formattedInstructionCount = reader.ReadInt32();
+            for(int i = 0; i < formattedInstructionCount; ++i)
             {
-                // Iterate instructions in this testcase
-                foreach(var instruction in testcase.Value)
-                {
-                    // Retrieve instruction data object
-                    if(!instructions.TryGetValue(instruction.Key, out var instructionData))
-                    {
-                        instructionData = new InstructionData();
-                        instructions.Add(instruction.Key, instructionData);
-                    }
-
-                    // Add data from this testcase
-                    ++instructionData.TestcaseCount;
-                    instructionData.HashCounts.TryGetValue(instruction.Value, out int hashCount); // Will be 0 if not existing
-                    instructionData.HashCounts[instruction.Value] = hashCount + 1;
+                ulong instructionId = reader.ReadUInt64();
+                string formattedInstruction = reader.ReadLengthPrefixedString();
+                if(_formattedInstructions.GetOrAdd(instructionId, formattedInstruction) != formattedInstruction)
+                    throw new Exception($"The saved state resolves instruction {instructionId:X16} differently, were the traces generated with the same target binaries?");
+            }
 
-                    // Store testcase IDs only when a full data dump is requested, since this is quite expensive
-                    if(_dumpFullData)
-                    {
-                        // Make sure testcase ID list exists
-                        if(!instructionData.HashTestcases.ContainsKey(instruction.Value))
-                            instructionData.HashTestcases.Add(instruction.Value, new List<int>());
-                        instructionData.HashTestcases[instruction.Value].Add(testcase.Key);
-                    }
-                }
+            int instructionCount = reader.ReadInt32();
+            for(int i = 0; i < instructionCount; ++i)
+            {
+                ulong instructionId = reader.ReadUInt64();
+                _instructions.GetOrAdd(instructionId, _ => new InstructionData()).Merge(reader, hasTestcaseIds, _dumpFullData);
             }
 
+            return Task.CompletedTask;
+        }
+
+        public override async Task FinishAsync()
+        {
+            var instructionLeakage = new Dictionary<ulong, InstructionLeakageResult>();
+
+            // Restore the order in which a sequential analysis would have encountered the instructions and hashes, to get deterministic results
+            await Logger.LogInfoAsync("Running memory access trace leakage analysis");
+            var instructions = _instructions
+                .OrderBy(i => i.Value.FirstTestcaseId)
+                .ThenBy(i => i.Value.FirstTestcaseInstructionIndex)
+                .Select(i => (instructionId: i.Key, testcaseCount: i.Value.TestcaseCount, hashes: i.Value.GetOrderedHashes()))
+                .ToList();
+
             // Calculate leakage measures for each instruction
             double maximumMutualInformation = 0.0;
             foreach(var instruction in instructions)
             {
                 var leakageResult = new InstructionLeakageResult();
-                instructionLeakage.Add(instruction.Key, leakageResult);
+                instructionLeakage.Add(instruction.instructionId, leakageResult);
 
                 // Mutual information
                 {
                     // Calculate probabilities of keys, and keys with traces (if they caused a call of this instruction)
                     // Since the keys are distinct and randomly generated, we have a uniform distribution
-                    double pX = 1.0 / instruction.Value.TestcaseCount; // p(x)
-                    double pXy = 1.0 / instruction.Value.TestcaseCount; // p(x,y)
+                    double pX = 1.0 / instruction.testcaseCount; // p(x)
+                    double pXy = 1.0 / instruction.testcaseCount; // p(x,y)
 
                     // Calculate mutual information
                     double mutualInformation = 0.0;
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    foreach(var hashCount in instruction.hashes)
                     {
-                        double pY = (double)hashCount.Value / instruction.Value.TestcaseCount; // p(y)
-                        mutualInformation += hashCount.Value * pXy * Math.Log2(pXy / (pX * pY));
+                        double pY = (double)hashCount.Value.Count / instruction.testcaseCount; // p(y)
+                        mutualInformation += hashCount.Value.Count * pXy * Math.Log2(pXy / (pX * pY));
                     }
 
                     leakageResult.MutualInformation = mutualInformation;
@@ -194,7 +188,7 @@ namespace Microwalk.Analysis.Modules
                 // Minimum entropy
                 {
                     // Compute amount of unique traces
-                    int uniqueTraceCount = instruction.Value.HashCounts.Count;
+                    int uniqueTraceCount = instruction.hashes.Count;
                     leakageResult.MinEntropy = Math.Log2(uniqueTraceCount);
                 }
 
@@ -202,14 +196,14 @@ namespace Microwalk.Analysis.Modules
                 {
                     // Sum guessing entropy for each trace, weighting by its probability -> average value
                     double conditionalGuessingEntropy = 0.0;
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    foreach(var hashCount in instruction.hashes)
                     {
                         // Probability of trace
-                        double pY = (double)hashCount.Value / instruction.Value.TestcaseCount; // p(y)
+                        double pY = (double)hashCount.Value.Count / instruction.testcaseCount; // p(y)
 
                         // Sum over all possible inputs
                         // Application of Gaussian sum formula, simplification due to test cases being distinct and uniformly distributed -> p(x) = 1/n
-                        conditionalGuessingEntropy += pY * (hashCount.Value + 1.0) / 2;
+                        conditionalGuessingEntropy += pY * (hashCount.Value.Count + 1.0) / 2;
                     }
 
                     leakageResult.ConditionalGuessingEntropy = conditionalGuessingEntropy;
@@ -220,10 +214,10 @@ namespace Microwalk.Analysis.Modules
                     // Find minimum guessing entropy of each trace, weighting is not needed here
                     // Also store the hash value which has the lowest guessing entropy value
                     double minConditionalGuessingEntropy = double.MaxValue;
-                    byte[] minConditionalGuessingEntropyHash = Array.Empty<byte>();
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    UInt128 minConditionalGuessingEntropyHash = 0;
+                    foreach(var hashCount in instruction.hashes)
                     {
-                        double traceConditionalGuessingEntropy = (hashCount.Value + 1.0) / 2;
+                        double traceConditionalGuessingEntropy = (hashCount.Value.Count + 1.0) / 2;
                         if(traceConditionalGuessingEntropy < minConditionalGuessingEntropy)
                         {
                             minConditionalGuessingEntropy = traceConditionalGuessingEntropy;
@@ -238,7 +232,7 @@ namespace Microwalk.Analysis.Modules
 
             // Show warning if there likely were not enough testcases
             const double warnThreshold = 0.9;
-            double testcaseCountBits = Math.Log2(_testcaseInstructionHashes.Count);
+            double testcaseCountBits = Math.Log2(_testcaseCount);
             if(maximumMutualInformation > testcaseCountBits - warnThreshold)
                 await Logger.LogWarningAsync("For some instructions the calculated mutual information is suspiciously near to the testcase range. It is recommended to run more testcases.");
 
@@ -267,7 +261,7 @@ namespace Microwalk.Analysis.Modules
                 foreach(var instructionData in instructionLeakage.OrderBy(l => l.Value.MinConditionalGuessingEntropy).ThenBy(mi => mi.Key))
                     await minCondGuessEntropyWriter.WriteLineAsync($"Instruction {_formattedInstructions[instructionData.Key]}: " +
                                                                    $"{instructionData.Value.MinConditionalGuessingEntropy.ToString("N", numberFormat)} guesses " +
-                                                                   $"[{string.Concat(instructionData.Value.MinConditionalGuessingEntropyHash.Select(b => b.ToString("X2")))}]");
+                                                                   $"[{FormatHash(instructionData.Value.MinConditionalGuessingEntropyHash)}]");
             }
             else if(_outputFormat == OutputFormat.Csv)
             {
@@ -302,7 +296,7 @@ namespace Microwalk.Analysis.Modules
                                                    listSeparator +
                                                    leakageData.MinConditionalGuessingEntropy.ToString("N3") +
                                                    listSeparator +
-                                                   string.Concat(leakageData.MinConditionalGuessingEntropyHash.Select(b => b.ToString("X2"))));
+                                                   FormatHash(leakageData.MinConditionalGuessingEntropyHash));
                 }
             }
 
@@ -321,20 +315,21 @@ namespace Microwalk.Analysis.Modules
                 foreach(var instruction in instructions)
                 {
                     // Instruction name
-                    await writer.WriteLineAsync(_formattedInstructions[instruction.Key]);
+                    await writer.WriteLineAsync(_formattedInstructions[instruction.instructionId]);
 
                     // Hashes
-                    foreach(var hashCount in instruction.Value.HashCounts)
+                    foreach(var hashCount in instruction.hashes)
                     {
                         // Write hash and number of hits
-                        await writer.WriteAsync($"  {string.Concat(hashCount.Key.Select(b => b.ToString("X2")))}: [{hashCount.Value}]");
+                        await writer.WriteAsync($"  {FormatHash(hashCount.Key)}: [{hashCount.Value.Count}]");
 
                         // Write testcases yielding this hash
                         // Try to merge consecutive test case IDs: "1 3 4 5 7" -> "1 3-5 7"
                         int consecutiveStart = -1;
                         int consecutiveCurrent = -1;
                         const int consecutiveThreshold = 2;
-                        foreach(var testcaseId in instruction.Value.HashTestcases[hashCount.Key])
+                        hashCount.Value.TestcaseIds!.Sort();
+                        foreach(var testcaseId in hashCount.Value.TestcaseIds)
                         {
                             if(consecutiveStart == -1)
                             {
@@ -422,24 +417,236 @@ namespace Microwalk.Analysis.Modules
         }
 
         /// <summary>
-        /// Utility class to hold a tuple of testcase count/hash count.
+        /// Formats the given hash as hex string.
+        /// </summary>
+        private static string FormatHash(UInt128 hash)
+        {
+            Span<byte> hashBytes = stackalloc byte[16];
+            BinaryPrimitives.WriteUInt128LittleEndian(hashBytes, hash);
+            return Convert.ToHexString(hashBytes);
+        }
+
+        /// <summary>
+        /// Computes the memory access hashes of the instructions in a single trace.
+        /// </summary>
+        private readonly struct TraceVisitor : ITraceEntryVisitor
+        {
+            private readonly InstructionMemoryAccessTraceLeakage _analysis;
+            private readonly TracePrefixFile _tracePrefix;
+
+            /// <summary>
+            /// Maps instruction addresses to the hashes of their memory access sequences.
+            /// </summary>
+            public Dictionary<ulong, AccessSequenceHash> InstructionHashes { get; } = new();
+
+            public TraceVisitor(InstructionMemoryAccessTraceLeakage analysis, TracePrefixFile tracePrefix)
+            {
+                _analysis = analysis;
+                _tracePrefix = tracePrefix;
+            }
+
+            public void VisitHeapMemoryAccess(HeapMemoryAccess.View entry)
+            {
+                // Extract instruction and memory address IDs (some kind of hash consisting of image ID and relative address)
+                ulong instructionId = ((ulong)entry.InstructionImageId << 32) | entry.InstructionRelativeAddress;
+                ulong memoryAddressId = ((ulong)entry.HeapAllocationBlockId << 32) | entry.MemoryRelativeAddress;
+
+                UpdateHash(instructionId, memoryAddressId, entry.InstructionImageId, entry.InstructionRelativeAddress);
+            }
+
+            public void VisitImageMemoryAccess(ImageMemoryAccess.View entry)
+            {
+                ulong instructionId = ((ulong)entry.InstructionImageId << 32) | entry.InstructionRelativeAddress;
+                ulong memoryAddressId = ((ulong)entry.MemoryImageId << 32) | entry.MemoryRelativeAddress;
+
+                UpdateHash(instructionId, memoryAddressId, entry.InstructionImageId, entry.InstructionRelativeAddress);
+            }
+
+            public void VisitStackMemoryAccess(StackMemoryAccess.View entry)
+            {
+                ulong instructionId = ((ulong)entry.InstructionImageId << 32) | entry.InstructionRelativeAddress;
+                ulong memoryAddressId = entry.MemoryRelativeAddress;
+
+                UpdateHash(instructionId, memoryAddressId, entry.InstructionImageId, entry.InstructionRelativeAddress);
+            }
+
+            public void VisitHeapAllocation(HeapAllocation.View entry)
+            {
+            }
+
+            public void VisitHeapFree(HeapFree.View entry)
+            {
+            }
+
+            public void VisitStackAllocation(StackAllocation.View entry)
+            {
+            }
+
+            public void VisitBranch(Branch.View entry)
+            {
+            }
+
+            private void UpdateHash(ulong instructionId, ulong memoryAddressId, int instructionImageId, uint instructionRelativeAddress)
+            {
+                // Retrieve hash state, and format the instruction when it is encountered first in this trace
+                ref var hash = ref CollectionsMarshal.GetValueRefOrAddDefault(InstructionHashes, instructionId, out bool exists);
+                if(!exists)
+                    _analysis.StoreFormattedInstruction(instructionId, _tracePrefix.ImageFiles[instructionImageId], instructionRelativeAddress);
+
+                // Append address to the instruction's access sequence
+                hash.Add(memoryAddressId);
+            }
+        }
+
+        /// <summary>
+        /// Aggregated hashes of one instruction. This class is thread-safe.
         /// </summary>
         private class InstructionData
         {
-            public int TestcaseCount { get; set; }
-            public Dictionary<byte[], int> HashCounts { get; }
+            public int TestcaseCount { get; private set; }
+
+            /// <summary>
+            /// Smallest ID of a testcase which executed this instruction.
+            /// </summary>
+            public int FirstTestcaseId { get; private set; } = int.MaxValue;
 
             /// <summary>
-            /// This is only filled and used when a data dump is requested.
+            /// Position of this instruction in the hash list of the testcase with ID <see cref="FirstTestcaseId"/>.
             /// </summary>
-            public Dictionary<byte[], List<int>> HashTestcases { get; }
+            public int FirstTestcaseInstructionIndex { get; private set; }
 
-            public InstructionData()
+            /// <summary>
+            /// Number of testcases and further information for each distinct hash.
+            /// </summary>
+            private readonly Dictionary<UInt128, HashData> _hashes = new();
+
+            /// <summary>
+            /// Adds the hash of the given testcase.
+            /// </summary>
+            /// <param name="testcaseId">Testcase ID.</param>
+            /// <param name="instructionIndex">Position of this instruction in the hash list of the testcase.</param>
+            /// <param name="hash">Memory access hash.</param>
+            /// <param name="storeTestcaseIds">Controls whether the testcase IDs yielding each hash are recorded. This is quite expensive.</param>
+            public void AddTestcase(int testcaseId, int instructionIndex, UInt128 hash, bool storeTestcaseIds)
             {
-                TestcaseCount = 0;
-                HashCounts = new Dictionary<byte[], int>(new ByteArrayComparer());
-                HashTestcases = new Dictionary<byte[], List<int>>(new ByteArrayComparer());
+                lock(_hashes)
+                {
+                    ++TestcaseCount;
+                    if(testcaseId < FirstTestcaseId)
+                    {
+                        FirstTestcaseId = testcaseId;
+                        FirstTestcaseInstructionIndex = instructionIndex;
+                    }
+
+                    ref var hashData = ref CollectionsMarshal.GetValueRefOrAddDefault(_hashes, hash, out bool exists);
+                    if(!exists)
+                    {
+                        hashData.FirstTestcaseId = testcaseId;
+                        if(storeTestcaseIds)
+                            hashData.TestcaseIds = new List<int>();
+                    }
+
+                    ++hashData.Count;
+                    if(testcaseId < hashData.FirstTestcaseId)
+                        hashData.FirstTestcaseId = testcaseId;
+                    hashData.TestcaseIds?.Add(testcaseId);
+                }
             }
+
+            /// <summary>
+            /// Saves the aggregated hashes. Must not be called concurrently to <see cref="AddTestcase"/>.
+            /// </summary>
+            /// <param name="writer">Binary writer.</param>
+            public void Store(IFastBinaryWriter writer)
+            {
+                writer.WriteInt32(TestcaseCount);
+                writer.WriteInt32(FirstTestcaseId);
+                writer.WriteInt32(FirstTestcaseInstructionIndex);
+
+                writer.WriteInt32(_hashes.Count);
+                foreach(var (hash, hashData) in _hashes)
+                {
+                    writer.WriteUInt128(hash);
+                    writer.WriteInt32(hashData.Count);
+                    writer.WriteInt32(hashData.FirstTestcaseId);
+
+                    if(hashData.TestcaseIds != null)
+                    {
+                        writer.WriteInt32(hashData.TestcaseIds.Count);
+                        foreach(var testcaseId in hashData.TestcaseIds)
+                            writer.WriteInt32(testcaseId);
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Merges hashes which were saved by <see cref="Store"/>. Must not be called concurrently to <see cref="AddTestcase"/>.
+            /// </summary>
+            /// <param name="reader">Binary reader.</param>
+            /// <param name="hasTestcaseIds">Determines whether the saved hashes include testcase IDs.</param>
+            /// <param name="storeTestcaseIds">Controls whether the testcase IDs are kept.</param>
+            public void Merge(IFastBinaryReader reader, bool hasTestcaseIds, bool storeTestcaseIds)
+            {
+                TestcaseCount += reader.ReadInt32();
+                int firstTestcaseId = reader.ReadInt32();
+                int firstTestcaseInstructionIndex = reader.ReadInt32();
+                if(firstTestcaseId < FirstTestcaseId)
+                {
+                    FirstTestcaseId = firstTestcaseId;
+                    FirstTestcaseInstructionIndex = firstTestcaseInstructionIndex;
+                }
+
+                int hashCount = reader.ReadInt32();
+                for(int i = 0; i < hashCount; ++i)
+                {
+                    ref var hashData = ref CollectionsMarshal.GetValueRefOrAddDefault(_hashes, reader.ReadUInt128(), out bool exists);
+                    if(!exists)
+                    {
+                        hashData.FirstTestcaseId = int.MaxValue;
+                        if(storeTestcaseIds)
+                            hashData.TestcaseIds = new List<int>();
+                    }
+
+                    hashData.Count += reader.ReadInt32();
+                    hashData.FirstTestcaseId = Math.Min(hashData.FirstTestcaseId, reader.ReadInt32());
+
+                    if(hasTestcaseIds)
+                    {
+                        int testcaseIdCount = reader.ReadInt32();
+                        for(int t = 0; t < testcaseIdCount; ++t)
+                        {
+                            int testcaseId = reader.ReadInt32();
+                            hashData.TestcaseIds?.Add(testcaseId);
+                        }
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Returns the hashes ordered by the first testcase yielding them. Must not be called concurrently to <see cref="AddTestcase"/>.
+            /// </summary>
+            public List<KeyValuePair<UInt128, HashData>> GetOrderedHashes() => _hashes.OrderBy(h => h.Value.FirstTestcaseId).ToList();
+        }
+
+        /// <summary>
+        /// Information about one distinct hash of an instruction.
+        /// </summary>
+        private struct HashData
+        {
+            /// <summary>
+            /// Number of testcases yielding this hash.
+            /// </summary>
+            public int Count;
+
+            /// <summary>
+            /// Smallest ID of a testcase yielding this hash.
+            /// </summary>
+            public int FirstTestcaseId;
+
+            /// <summary>
+            /// IDs of the testcases yielding this hash. This is only filled and used when a data dump is requested.
+            /// </summary>
+            public List<int>? TestcaseIds;
         }
 
         /// <summary>
@@ -451,7 +658,7 @@ namespace Microwalk.Analysis.Modules
             public double MinEntropy { get; set; }
             public double ConditionalGuessingEntropy { get; set; }
             public double MinConditionalGuessingEntropy { get; set; }
-            public byte[] MinConditionalGuessingEntropyHash { get; set; } = null!;
+            public UInt128 MinConditionalGuessingEntropyHash { get; set; }
         }
 
         /// <summary>
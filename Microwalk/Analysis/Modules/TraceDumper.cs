@@ -143,7 +143,7 @@ namespace Microwalk.Analysis.Modules
                         // Output entry and update call level
                         if(branchEntry.BranchType == Branch.BranchTypes.Call)
                         {
-                            string line = $"{entryPrefix}Call: <{formattedSource}> -> <{formattedDestination}>";
+                            string line = $"{entryPrefix}Call: <{formattedSource}> -> <{formattedDestination}>, CS#{branchEntry.CallStackId}";
                             await writer.WriteLineAsync(line);
                             callStack.Push(line);
                             ++callLevel;
@@ -153,7 +153,7 @@ namespace Microwalk.Analysis.Modules
                         else if(branchEntry.BranchType == Branch.BranchTypes.Return)
                         {
                             if(!_skipReturns)
-                                await writer.WriteLineAsync($"{entryPrefix}Return: <{formattedSource}> -> <{formattedDestination}>");
+                                await writer.WriteLineAsync($"{entryPrefix}Return: <{formattedSource}> -> <{formattedDestination}>, CS#{branchEntry.CallStackId}");
 
                             if(callStack.Any())
                                 callStack.Pop();
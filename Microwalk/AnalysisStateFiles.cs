@@ -0,0 +1,117 @@
+﻿using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase;
+using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.Extensions;
+using Microwalk.FrameworkBase.Stages;
+using Microwalk.FrameworkBase.Utilities;
+
+namespace Microwalk;
+
+/// <summary>
+/// Saves and merges the intermediate states of analysis modules, so an analysis can be split into several runs with disjoint testcases (shards),
+/// whose results are combined afterwards.
+///
+/// Each module state is stored in its own file in a state directory, which is named after the position of the module in the analysis stage
+/// configuration and the module name. The file starts with a small header, which is checked when merging.
+/// </summary>
+internal static class AnalysisStateFiles
+{
+    /// <summary>
+    /// Identifies analysis state files ("MWAS").
+    /// </summary>
+    private const uint _magic = 0x5341574D;
+
+    /// <summary>
+    /// Version of the analysis state file format. This must be incremented whenever the saved state of a module changes.
+    /// </summary>
+    private const int _formatVersion = 2;
+
+    /// <summary>
+    /// Ensures that all given analysis modules support saving their state. This should be checked before the pipeline is started, so a run does not
+    /// fail after all testcases were analyzed.
+    /// </summary>
+    /// <param name="modules">Analysis modules.</param>
+    /// <param name="purpose">Purpose of the saved states, for the error message.</param>
+    /// <exception cref="ConfigurationException">A module does not support saving its state.</exception>
+    public static void EnsureSupported(IEnumerable<AnalysisStage> modules, string purpose)
+    {
+        var unsupportedModule = modules.FirstOrDefault(m => !m.SupportsStateSerialization);
+        if(unsupportedModule != null)
+            throw new ConfigurationException($"The analysis module '{GetModuleName(unsupportedModule)}' does not support saving its state, which is needed for {purpose}.");
+    }
+
+    /// <summary>
+    /// Saves the state of the given analysis module into the given state directory.
+    /// </summary>
+    /// <param name="module">Analysis module.</param>
+    /// <param name="moduleIndex">Position of the module in the analysis stage configuration.</param>
+    /// <param name="stateDirectoryPath">State directory.</param>
+    public static async Task SaveAsync(AnalysisStage module, int moduleIndex, string stateDirectoryPath)
+    {
+        string moduleName = GetModuleName(module);
+        if(!module.SupportsStateSerialization)
+            throw new ConfigurationException($"The analysis module '{moduleName}' does not support saving its state.");
+
+        Directory.CreateDirectory(stateDirectoryPath);
+        string path = GetPath(stateDirectoryPath, moduleIndex, moduleName);
+
+        // Write to a temporary file first, so an interrupted run does not leave a truncated state
+        string temporaryPath = path + ".tmp";
+        using(var writer = new FastBinaryFileWriter(temporaryPath))
+        {
+            writer.WriteUInt32(_magic);
+            writer.WriteInt32(_formatVersion);
+            writer.WriteLengthPrefixedString(moduleName);
+
+            await module.SaveStateAsync(writer);
+        }
+
+        File.Move(temporaryPath, path, true);
+    }
+
+    /// <summary>
+    /// Merges the state of the given analysis module from the given state directory.
+    /// </summary>
+    /// <param name="module">Analysis module.</param>
+    /// <param name="moduleIndex">Position of the module in the analysis stage configuration.</param>
+    /// <param name="stateDirectoryPath">State directory.</param>
+    public static async Task MergeAsync(AnalysisStage module, int moduleIndex, string stateDirectoryPath)
+    {
+        string moduleName = GetModuleName(module);
+        if(!module.SupportsStateSerialization)
+            throw new ConfigurationException($"The analysis module '{moduleName}' does not support merging saved states.");
+
+        string path = GetPath(stateDirectoryPath, moduleIndex, moduleName);
+        if(!File.Exists(path))
+            throw new FileNotFoundException($"Could not find the saved state of analysis module '{moduleName}'. Make sure that the analysis modules are configured like in the saving runs.", path);
+
+        using var reader = new FastBinaryFileReader(path);
+        if(reader.ReadUInt32() != _magic)
+            throw new AnalysisStateFormatException($"The file '{path}' is not an analysis state file.");
+        int formatVersion = reader.ReadInt32();
+        if(formatVersion != _formatVersion)
+            throw new AnalysisStateFormatException($"The analysis state file '{path}' has unsupported format version {formatVersion}.");
+        string savedModuleName = reader.ReadLengthPrefixedString();
+        if(savedModuleName != moduleName)
+            throw new AnalysisStateFormatException($"The analysis state file '{path}' belongs to module '{savedModuleName}' instead of '{moduleName}'.");
+
+        await module.MergeStateAsync(reader);
+
+        if(reader.Position != reader.Length)
+            throw new AnalysisStateFormatException($"The analysis state file '{path}' contains trailing data.");
+    }
+
+    private static string GetModuleName(AnalysisStage module)
+    {
+        return module.GetType().GetCustomAttribute<FrameworkModule>()?.Name ?? module.GetType().Name;
+    }
+
+    private static string GetPath(string stateDirectoryPath, int moduleIndex, string moduleName)
+    {
+        return Path.Combine(stateDirectoryPath, $"{moduleIndex}-{moduleName}.state");
+    }
+}
\ No newline at end of file
@@ -10,5 +10,11 @@ namespace Microwalk
         
         [Option('p', "plugin-directories", Required = false, Default = null, HelpText = "Specify plugin directories.")]
         public IEnumerable<string>? PluginDirectories { get; set; }
+
+        [Option('m', "merge", Required = false, Default = null, HelpText = "Merge the analysis states saved in the given directories, instead of running the pipeline.")]
+        public IEnumerable<string>? MergeStateDirectories { get; set; }
+
+        [Option('r', "resume", Required = false, Default = false, HelpText = "Resume the run from the latest checkpoint.")]
+        public bool Resume { get; set; }
     }
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+﻿using System.Collections.Generic;
+using System.Linq;
+using System.Reflection;
+using System.Threading;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase;
+using Microwalk.FrameworkBase.Configuration;
+using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.Stages;
+
+namespace Microwalk;
+
+/// <summary>
+/// Periodically compares the running leakage estimates of the analysis modules, and requests the testcase stage to stop once the estimates
+/// are stable, i.e., additional testcases are unlikely to change the analysis results.
+/// </summary>
+internal class LeakageConvergenceMonitor
+{
+    private readonly ILogger _logger;
+
+    /// <summary>
+    /// Analysis modules which provide leakage estimates.
+    /// </summary>
+    private readonly List<(string name, AnalysisStage module)> _modules;
+
+    /// <summary>
+    /// Number of analyzed testcases between two convergence checks.
+    /// </summary>
+    private readonly int _checkInterval;
+
+    /// <summary>
+    /// Maximum difference of the information measures (in bits) between two checks, such that the estimates are considered stable.
+    /// </summary>
+    private readonly double _tolerance;
+
+    /// <summary>
+    /// Number of consecutive checks with stable estimates which are needed to stop the testcase generation.
+    /// </summary>
+    private readonly int _requiredStableChecks;
+
+    /// <summary>
+    /// Ensures that only one convergence check runs at a time.
+    /// </summary>
+    private readonly SemaphoreSlim _checkSemaphore = new(1, 1);
+
+    /// <summary>
+    /// Estimates of the previous check, indexed like <see cref="_modules"/>.
+    /// </summary>
+    private LeakageEstimate?[]? _previousEstimates;
+
+    private int _analyzedTestcaseCount;
+    private int _stableCheckCount;
+    private volatile bool _isConverged;
+
+    private LeakageConvergenceMonitor(List<(string name, AnalysisStage module)> modules, int checkInterval, double tolerance, int requiredStableChecks, ILogger logger)
+    {
+        _logger = logger;
+        _modules = modules;
+        _checkInterval = checkInterval;
+        _tolerance = tolerance;
+        _requiredStableChecks = requiredStableChecks;
+    }
+
+    /// <summary>
+    /// Creates a convergence monitor from the given analysis stage options, or returns null if early stopping is not configured.
+    /// Enables tracking of leakage estimates in all supporting analysis modules.
+    /// </summary>
+    /// <param name="analysisStageOptions">Analysis stage options. May be null.</param>
+    /// <param name="analysisModules">Analysis modules.</param>
+    /// <param name="logger">Logger.</param>
+    public static async Task<LeakageConvergenceMonitor?> CreateAsync(MappingNode? analysisStageOptions, List<AnalysisStage> analysisModules, ILogger logger)
+    {
+        int checkInterval = analysisStageOptions?.GetChildNodeOrDefault("early-stop-check-interval")?.AsInteger() ?? 0;
+        if(checkInterval < 0)
+            throw new ConfigurationException("The early stop check interval must not be negative.");
+        if(checkInterval == 0)
+            return null;
+
+        double tolerance = analysisStageOptions!.GetChildNodeOrDefault("early-stop-tolerance")?.AsDouble() ?? 0.01;
+        if(tolerance < 0)
+            throw new ConfigurationException("The early stop tolerance must not be negative.");
+
+        int requiredStableChecks = analysisStageOptions.GetChildNodeOrDefault("early-stop-stable-checks")?.AsInteger() ?? 3;
+        if(requiredStableChecks < 1)
+            throw new ConfigurationException("The number of stable early stop checks must be positive.");
+
+        // Only modules with estimates can be considered
+        var modules = new List<(string name, AnalysisStage module)>();
+        foreach(var module in analysisModules)
+        {
+            string name = module.GetType().GetCustomAttribute<FrameworkModule>()?.Name ?? module.GetType().Name;
+            if(!module.SupportsLeakageEstimates)
+            {
+                await logger.LogWarningAsync($"[converge] Analysis module '{name}' does not provide leakage estimates and is ignored when checking for early stopping");
+                continue;
+            }
+
+            module.TrackLeakageEstimates = true;
+            modules.Add((name, module));
+        }
+
+        if(modules.Count == 0)
+        {
+            await logger.LogWarningAsync("[converge] None of the analysis modules provides leakage estimates, early stopping is disabled");
+            return null;
+        }
+
+        return new LeakageConvergenceMonitor(modules, checkInterval, tolerance, requiredStableChecks, logger);
+    }
+
+    /// <summary>
+    /// Returns whether the leakage estimates have converged, and the testcase generation should stop.
+    /// </summary>
+    public bool IsConverged => _isConverged;
+
+    /// <summary>
+    /// Notifies the monitor that a testcase was analyzed by all modules, and runs a convergence check if due.
+    /// </summary>
+    public async Task OnTestcaseAnalyzedAsync()
+    {
+        if(Interlocked.Increment(ref _analyzedTestcaseCount) % _checkInterval != 0 || _isConverged)
+            return;
+
+        await _checkSemaphore.WaitAsync();
+        try
+        {
+            await CheckConvergenceAsync();
+        }
+        finally
+        {
+            _checkSemaphore.Release();
+        }
+    }
+
+    /// <summary>
+    /// Compares the current estimates with those of the previous check.
+    /// </summary>
+    private async Task CheckConvergenceAsync()
+    {
+        var estimates = _modules.Select(m => m.module.GetLeakageEstimate()).ToArray();
+        for(int i = 0; i < _modules.Count; ++i)
+            await _logger.LogDebugAsync($"[converge] {_modules[i].name}: {estimates[i]?.ToString() ?? "no estimate"}");
+
+        bool isStable = _previousEstimates != null;
+        for(int i = 0; i < estimates.Length && isStable; ++i)
+        {
+            var estimate = estimates[i];
+            var previousEstimate = _previousEstimates![i];
+            if(estimate == null || previousEstimate == null || !estimate.IsWithinTolerance(previousEstimate, _tolerance))
+                isStable = false;
+        }
+
+        _previousEstimates = estimates;
+        _stableCheckCount = isStable ? _stableCheckCount + 1 : 0;
+        if(_stableCheckCount < _requiredStableChecks)
+            return;
+
+        await _logger.LogInfoAsync($"[converge] Leakage estimates are stable after {Volatile.Read(ref _analyzedTestcaseCount)} testcases, stopping testcase generation");
+        _isConverged = true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,265 @@
+﻿using System;
+using System.Threading;
+using Microwalk.FrameworkBase;
+using Microwalk.FrameworkBase.Configuration;
+using Microwalk.FrameworkBase.Exceptions;
+
+namespace Microwalk;
+
+/// <summary>
+/// Adjusts the parallelism of the preprocessor and analysis stages and the number of testcases in the pipeline at runtime, based on the
+/// sampled <see cref="PipelineStatistics"/> and the process memory usage.
+///
+/// The dataflow blocks cannot be reconfigured once they are created, so they are created with the configured maximum parallelism, and
+/// the actual parallelism is limited by <see cref="AdjustableConcurrencyLimit"/> objects. Instead of the capacities of the single buffers, the
+/// total number of testcases between the testcase and the end of the analysis stage is limited, which also bounds the amount of trace data
+/// held in memory.
+///
+/// In each tuning step, a stage gets an additional thread if it was fully busy and had queued input. It loses a thread if more than one
+/// thread was idle on average. The number of testcases in the pipeline grows while the analysis stage runs out of input, but the testcase
+/// stage is held back by the limit. If the memory usage approaches the memory budget, the number of testcases in the pipeline and the
+/// preprocessor parallelism are reduced instead.
+/// </summary>
+internal class PipelineAutoTuner
+{
+    /// <summary>
+    /// Fraction of the memory budget above which the tuner backs off.
+    /// </summary>
+    private const double _memoryHighWatermark = 0.9;
+
+    /// <summary>
+    /// Fraction of the memory budget below which the tuner may increase the amount of work in the pipeline.
+    /// </summary>
+    private const double _memoryLowWatermark = 0.75;
+
+    private readonly ILogger _logger;
+
+    /// <summary>
+    /// Minimum time between two tuning steps.
+    /// </summary>
+    private readonly TimeSpan _tuningInterval;
+
+    /// <summary>
+    /// Process memory budget in bytes, or 0 if memory usage is not considered.
+    /// </summary>
+    private readonly long _memoryBudget;
+
+    /// <summary>
+    /// Maximum number of testcases in the pipeline.
+    /// </summary>
+    private readonly int _maxTestcasesInFlight;
+
+    /// <summary>
+    /// Tuned stages.
+    /// </summary>
+    private readonly TunedStage[] _stages;
+
+    /// <summary>
+    /// Ensures that tuning steps do not overlap.
+    /// </summary>
+    private readonly object _updateLock = new();
+
+    private PipelineStatistics? _pipelineStatistics;
+    private double _lastTuningTime;
+    private double _lastAnalysisWaitForInputSeconds;
+
+    private PipelineAutoTuner(TimeSpan tuningInterval, long memoryBudget, int maxTestcasesInFlight, int maxPreprocessorParallelism, int maxAnalysisParallelism, ILogger logger)
+    {
+        _logger = logger;
+        _tuningInterval = tuningInterval;
+        _memoryBudget = memoryBudget;
+        _maxTestcasesInFlight = maxTestcasesInFlight;
+
+        Preprocessor = new TunedStage(maxPreprocessorParallelism);
+        Analysis = new TunedStage(maxAnalysisParallelism);
+        _stages = new[] { Preprocessor, Analysis };
+
+        // Start small, so the memory usage can be observed before the pipeline fills up
+        TestcasesInFlight = new AdjustableConcurrencyLimit(Math.Min(4, maxTestcasesInFlight));
+    }
+
+    /// <summary>
+    /// Creates an auto tuner from the given configuration, or returns null if auto tuning is not enabled.
+    /// </summary>
+    /// <param name="configuration">Auto tuning configuration. May be null.</param>
+    /// <param name="maxPreprocessorParallelism">Configured maximum parallelism of the preprocessor stage.</param>
+    /// <param name="maxAnalysisParallelism">Configured maximum parallelism of the analysis stage.</param>
+    /// <param name="logger">Logger.</param>
+    public static PipelineAutoTuner? Create(MappingNode? configuration, int maxPreprocessorParallelism, int maxAnalysisParallelism, ILogger logger)
+    {
+        if(!(configuration?.GetChildNodeOrDefault("enable")?.AsBoolean() ?? false))
+            return null;
+
+        int tuningInterval = configuration.GetChildNodeOrDefault("interval")?.AsInteger() ?? 5000;
+        if(tuningInterval < 1)
+            throw new ConfigurationException("The auto tuning interval must be positive.");
+
+        int memoryBudgetMegabytes = configuration.GetChildNodeOrDefault("memory-budget")?.AsInteger() ?? 0;
+        if(memoryBudgetMegabytes < 0)
+            throw new ConfigurationException("The auto tuning memory budget must not be negative.");
+
+        int maxTestcasesInFlight = configuration.GetChildNodeOrDefault("max-testcases-in-flight")?.AsInteger() ?? 64;
+        if(maxTestcasesInFlight < 1)
+            throw new ConfigurationException("The maximum number of testcases in flight must be positive.");
+
+        return new PipelineAutoTuner(TimeSpan.FromMilliseconds(tuningInterval), (long)memoryBudgetMegabytes * 1024 * 1024, maxTestcasesInFlight, maxPreprocessorParallelism, maxAnalysisParallelism, logger);
+    }
+
+    /// <summary>
+    /// Limits the parallelism of the preprocessor stage.
+    /// </summary>
+    public TunedStage Preprocessor { get; }
+
+    /// <summary>
+    /// Limits the parallelism of the analysis stage.
+    /// </summary>
+    public TunedStage Analysis { get; }
+
+    /// <summary>
+    /// Limits the number of testcases which were generated, but not yet analyzed.
+    /// </summary>
+    public AdjustableConcurrencyLimit TestcasesInFlight { get; }
+
+    /// <summary>
+    /// Sets the statistics which are used for tuning, and enables tuning.
+    /// </summary>
+    /// <param name="pipelineStatistics">Pipeline statistics.</param>
+    public void Start(PipelineStatistics pipelineStatistics)
+    {
+        Preprocessor.Statistics = pipelineStatistics.Preprocessor;
+        Analysis.Statistics = pipelineStatistics.Analysis;
+        _pipelineStatistics = pipelineStatistics;
+    }
+
+    /// <summary>
+    /// Accumulates the latest pipeline statistics sample, and runs a tuning step if due. This is called by the <see cref="ProcessMonitor"/>
+    /// after each sample.
+    /// </summary>
+    /// <param name="memoryUsage">Current process memory usage in bytes.</param>
+    public void Update(long memoryUsage)
+    {
+        if(_pipelineStatistics == null || !Monitor.TryEnter(_updateLock))
+            return;
+
+        try
+        {
+            foreach(var stage in _stages)
+                stage.AccumulateSample();
+
+            double time = _pipelineStatistics.Elapsed.TotalSeconds;
+            double interval = time - _lastTuningTime;
+            if(interval < _tuningInterval.TotalSeconds)
+                return;
+            _lastTuningTime = time;
+
+            Tune(interval, memoryUsage);
+        }
+        finally
+        {
+            Monitor.Exit(_updateLock);
+        }
+    }
+
+    /// <summary>
+    /// Adjusts the limits based on the statistics of the last tuning interval.
+    /// </summary>
+    /// <param name="interval">Length of the tuning interval, in seconds.</param>
+    /// <param name="memoryUsage">Current process memory usage in bytes.</param>
+    private void Tune(double interval, long memoryUsage)
+    {
+        double analysisWaitForInputSeconds = _pipelineStatistics!.Analysis.WaitForInputSeconds;
+        double analysisStarvation = (analysisWaitForInputSeconds - _lastAnalysisWaitForInputSeconds) / interval;
+        _lastAnalysisWaitForInputSeconds = analysisWaitForInputSeconds;
+
+        if(_memoryBudget > 0 && memoryUsage > _memoryHighWatermark * _memoryBudget)
+        {
+            // Back off: Fewer testcases in the pipeline, and fewer traces being preprocessed at once
+            int testcasesInFlight = Math.Max(1, TestcasesInFlight.Limit / 2);
+            TestcasesInFlight.SetLimit(testcasesInFlight);
+            Preprocessor.Limit.SetLimit(Math.Max(1, Preprocessor.Limit.Limit - 1));
+            foreach(var stage in _stages)
+                stage.ResetInterval();
+
+            _logger.LogWarningAsync($"[autotune] Memory usage {memoryUsage / (1024 * 1024)} MB is near the budget, reducing testcases in flight to {testcasesInFlight} "
+                                    + $"and preprocessor threads to {Preprocessor.Limit.Limit}").Wait();
+            return;
+        }
+
+        bool mayGrow = _memoryBudget == 0 || memoryUsage < _memoryLowWatermark * _memoryBudget;
+        foreach(var stage in _stages)
+            stage.Tune(interval, mayGrow);
+
+        // Fill the pipeline further, if the analysis stage had to wait for input while the testcase stage was held back
+        if(mayGrow && analysisStarvation > 0.1 && TestcasesInFlight.WaitingCount > 0 && TestcasesInFlight.Limit < _maxTestcasesInFlight)
+            TestcasesInFlight.SetLimit(Math.Min(_maxTestcasesInFlight, TestcasesInFlight.Limit + Math.Max(1, TestcasesInFlight.Limit / 4)));
+
+        _logger.LogDebugAsync($"[autotune] Preprocessor threads: {Preprocessor.Limit.Limit}, analysis threads: {Analysis.Limit.Limit}, testcases in flight: {TestcasesInFlight.Limit}, "
+                              + $"memory usage: {memoryUsage / (1024 * 1024)} MB").Wait();
+    }
+
+    /// <summary>
+    /// Parallelism limit of a single stage.
+    /// </summary>
+    public class TunedStage
+    {
+        /// <summary>
+        /// Configured maximum parallelism.
+        /// </summary>
+        private readonly int _maxParallelism;
+
+        private double _lastBusySeconds;
+        private long _queueDepthSum;
+        private int _sampleCount;
+
+        public TunedStage(int maxParallelism)
+        {
+            _maxParallelism = maxParallelism;
+            Limit = new AdjustableConcurrencyLimit(1);
+        }
+
+        /// <summary>
+        /// Current parallelism limit.
+        /// </summary>
+        public AdjustableConcurrencyLimit Limit { get; }
+
+        /// <summary>
+        /// Statistics of the stage.
+        /// </summary>
+        internal PipelineStatistics.StageStatistics? Statistics { get; set; }
+
+        internal void AccumulateSample()
+        {
+            _queueDepthSum += Statistics!.LastQueueDepth;
+            ++_sampleCount;
+        }
+
+        /// <summary>
+        /// Discards the data of the current tuning interval.
+        /// </summary>
+        internal void ResetInterval()
+        {
+            _lastBusySeconds = Statistics!.BusyTime.TotalSeconds;
+            _queueDepthSum = 0;
+            _sampleCount = 0;
+        }
+
+        /// <summary>
+        /// Adjusts the parallelism limit based on the statistics of the last tuning interval.
+        /// </summary>
+        /// <param name="interval">Length of the tuning interval, in seconds.</param>
+        /// <param name="mayGrow">Determines whether the parallelism may be increased.</param>
+        internal void Tune(double interval, bool mayGrow)
+        {
+            double busySeconds = Statistics!.BusyTime.TotalSeconds;
+            double busyThreads = (busySeconds - _lastBusySeconds) / interval;
+            double meanQueueDepth = _sampleCount == 0 ? 0.0 : (double)_queueDepthSum / _sampleCount;
+            ResetInterval();
+
+            int limit = Limit.Limit;
+            if(mayGrow && limit < _maxParallelism && busyThreads >= 0.9 * limit && meanQueueDepth >= 1)
+                Limit.SetLimit(limit + 1);
+            else if(limit > 1 && busyThreads < limit - 1.5)
+                Limit.SetLimit(limit - 1);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,287 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase;
+using Microwalk.FrameworkBase.Configuration;
+using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.Stages;
+using Microwalk.FrameworkBase.Utilities;
+
+namespace Microwalk;
+
+/// <summary>
+/// Periodically writes checkpoints of a running pipeline, so an interrupted run can be resumed without analyzing the same testcases again.
+///
+/// A checkpoint consists of the states of all analysis modules (see <see cref="AnalysisStateFiles"/>) and the IDs of the testcases contained in
+/// them. While a checkpoint is written, no trace is analyzed, so the module states are consistent. Testcases which were generated, traced or
+/// preprocessed, but not yet analyzed, are not part of the checkpoint and are processed again after resuming.
+///
+/// Each checkpoint is written into its own subdirectory of the checkpoint directory. Once it is complete, a pointer file is atomically replaced
+/// to refer to the new subdirectory, and the previous checkpoint is deleted. This way, there always is a complete checkpoint, even if the program
+/// is interrupted while writing a new one.
+/// </summary>
+internal class PipelineCheckpointer
+{
+    /// <summary>
+    /// Name of the file in the checkpoint directory which contains the name of the subdirectory of the latest complete checkpoint.
+    /// </summary>
+    private const string _pointerFileName = "checkpoint";
+
+    /// <summary>
+    /// Name of the file in a checkpoint subdirectory which contains the IDs of the analyzed testcases.
+    /// </summary>
+    private const string _testcasesFileName = "testcases";
+
+    /// <summary>
+    /// Prefix of the checkpoint subdirectory names, which is followed by a running number.
+    /// </summary>
+    private const string _checkpointNamePrefix = "checkpoint-";
+
+    private readonly ILogger _logger;
+
+    /// <summary>
+    /// Analysis modules.
+    /// </summary>
+    private readonly List<AnalysisStage> _analysisModules;
+
+    /// <summary>
+    /// Directory receiving the checkpoints.
+    /// </summary>
+    private readonly string _checkpointDirectoryPath;
+
+    /// <summary>
+    /// Number of analyzed testcases between two checkpoints.
+    /// </summary>
+    private readonly int _checkpointInterval;
+
+    /// <summary>
+    /// Admits analysis tasks. There is one slot for each analysis task which may run concurrently; a checkpoint is written after acquiring all
+    /// slots.
+    /// </summary>
+    private readonly SemaphoreSlim _analysisSlots;
+
+    /// <summary>
+    /// Number of slots of <see cref="_analysisSlots"/>.
+    /// </summary>
+    private readonly int _analysisSlotCount;
+
+    /// <summary>
+    /// Ensures that only one checkpoint is written at a time.
+    /// </summary>
+    private readonly SemaphoreSlim _checkpointSemaphore = new(1, 1);
+
+    /// <summary>
+    /// IDs of the testcases which are contained in the analysis module states, including those restored from a checkpoint.
+    /// </summary>
+    private readonly HashSet<int> _analyzedTestcaseIds = new();
+
+    /// <summary>
+    /// IDs of the testcases which were restored from a checkpoint, and thus must not be analyzed again.
+    /// </summary>
+    private readonly HashSet<int> _restoredTestcaseIds = new();
+
+    /// <summary>
+    /// Name of the subdirectory of the latest complete checkpoint, or null if there is none.
+    /// </summary>
+    private string? _currentCheckpointName;
+
+    private int _checkpointNumber;
+    private int _uncheckpointedTestcaseCount;
+    private volatile bool _isFaulted;
+
+    private PipelineCheckpointer(List<AnalysisStage> analysisModules, string checkpointDirectoryPath, int checkpointInterval, int analysisParallelism, ILogger logger)
+    {
+        _logger = logger;
+        _analysisModules = analysisModules;
+        _checkpointDirectoryPath = checkpointDirectoryPath;
+        _checkpointInterval = checkpointInterval;
+        _analysisSlotCount = analysisParallelism;
+        _analysisSlots = new SemaphoreSlim(analysisParallelism, analysisParallelism);
+    }
+
+    /// <summary>
+    /// Creates a checkpointer from the given analysis stage options, or returns null if checkpointing is not configured.
+    /// If requested, restores the analysis module states from the latest checkpoint.
+    /// </summary>
+    /// <param name="analysisStageOptions">Analysis stage options. May be null.</param>
+    /// <param name="analysisModules">Analysis modules.</param>
+    /// <param name="analysisParallelism">Maximum number of concurrently analyzed traces.</param>
+    /// <param name="resume">Determines whether the latest checkpoint should be restored.</param>
+    /// <param name="logger">Logger.</param>
+    public static async Task<PipelineCheckpointer?> CreateAsync(MappingNode? analysisStageOptions, List<AnalysisStage> analysisModules, int analysisParallelism, bool resume, ILogger logger)
+    {
+        string? checkpointDirectoryPath = analysisStageOptions?.GetChildNodeOrDefault("checkpoint-directory")?.AsString();
+        if(checkpointDirectoryPath == null)
+        {
+            if(resume)
+                throw new ConfigurationException("Resuming a run requires a checkpoint directory.");
+            return null;
+        }
+
+        int checkpointInterval = analysisStageOptions!.GetChildNodeOrDefault("checkpoint-interval")?.AsInteger() ?? 100;
+        if(checkpointInterval < 1)
+            throw new ConfigurationException("The checkpoint interval must be positive.");
+
+        AnalysisStateFiles.EnsureSupported(analysisModules, "checkpoints");
+
+        var checkpointer = new PipelineCheckpointer(analysisModules, checkpointDirectoryPath, checkpointInterval, analysisParallelism, logger);
+        string pointerFilePath = Path.Combine(checkpointDirectoryPath, _pointerFileName);
+        if(File.Exists(pointerFilePath))
+        {
+            // New checkpoints get higher numbers, so the existing one stays intact until it is replaced
+            string checkpointName = (await File.ReadAllTextAsync(pointerFilePath)).Trim();
+            checkpointer._currentCheckpointName = checkpointName;
+            if(checkpointName.StartsWith(_checkpointNamePrefix) && int.TryParse(checkpointName.AsSpan(_checkpointNamePrefix.Length), out int checkpointNumber))
+                checkpointer._checkpointNumber = checkpointNumber;
+
+            if(resume)
+                await checkpointer.RestoreAsync(checkpointName);
+            else
+                await logger.LogWarningAsync($"[checkpoint] The checkpoint directory {checkpointDirectoryPath} contains a checkpoint of an earlier run, which will be replaced. Use --resume to continue that run instead.");
+        }
+        else if(resume)
+            throw new FileNotFoundException("Could not find a checkpoint to resume from.", pointerFilePath);
+
+        return checkpointer;
+    }
+
+    /// <summary>
+    /// Returns whether the given testcase was restored from a checkpoint, and should thus be skipped.
+    /// </summary>
+    /// <param name="testcaseId">Testcase ID.</param>
+    public bool IsRestored(int testcaseId) => _restoredTestcaseIds.Contains(testcaseId);
+
+    /// <summary>
+    /// Runs the given analysis of a testcase, and writes a checkpoint if due.
+    /// </summary>
+    /// <param name="testcaseId">Testcase ID.</param>
+    /// <param name="analyze">Function which passes the trace of the testcase to all analysis modules.</param>
+    public async Task AnalyzeAsync(int testcaseId, Func<Task> analyze)
+    {
+        await _analysisSlots.WaitAsync();
+        try
+        {
+            await analyze();
+
+            lock(_analyzedTestcaseIds)
+                _analyzedTestcaseIds.Add(testcaseId);
+        }
+        catch
+        {
+            // The module states may now be inconsistent
+            _isFaulted = true;
+            throw;
+        }
+        finally
+        {
+            _analysisSlots.Release();
+        }
+
+        if(Interlocked.Increment(ref _uncheckpointedTestcaseCount) >= _checkpointInterval)
+            await WriteCheckpointAsync(false);
+    }
+
+    /// <summary>
+    /// Writes a final checkpoint after the pipeline has completed, so the final analysis steps can be repeated without analyzing any traces.
+    /// </summary>
+    public async Task CompleteAsync()
+    {
+        await WriteCheckpointAsync(true);
+    }
+
+    /// <summary>
+    /// Writes a checkpoint, if there are analyzed testcases which are not part of the latest checkpoint.
+    /// </summary>
+    /// <param name="wait">Determines whether to wait for a checkpoint which is currently written; else, this call returns immediately.</param>
+    private async Task WriteCheckpointAsync(bool wait)
+    {
+        if(!await _checkpointSemaphore.WaitAsync(wait ? Timeout.Infinite : 0))
+            return;
+
+        try
+        {
+            // Wait for running analysis tasks, and block new ones
+            for(int i = 0; i < _analysisSlotCount; ++i)
+                await _analysisSlots.WaitAsync();
+
+            try
+            {
+                if(_isFaulted || Volatile.Read(ref _uncheckpointedTestcaseCount) == 0)
+                    return;
+                Volatile.Write(ref _uncheckpointedTestcaseCount, 0);
+
+                await SaveAsync();
+            }
+            finally
+            {
+                _analysisSlots.Release(_analysisSlotCount);
+            }
+        }
+        finally
+        {
+            _checkpointSemaphore.Release();
+        }
+    }
+
+    /// <summary>
+    /// Saves the current analysis module states and analyzed testcase IDs as a new checkpoint. Must not be called concurrently to an analysis.
+    /// </summary>
+    private async Task SaveAsync()
+    {
+        string checkpointName = $"{_checkpointNamePrefix}{++_checkpointNumber}";
+        string checkpointPath = Path.Combine(_checkpointDirectoryPath, checkpointName);
+        await _logger.LogInfoAsync($"[checkpoint] Writing checkpoint with {_analyzedTestcaseIds.Count} testcases to {checkpointPath}");
+
+        // Remove leftovers of an interrupted earlier attempt
+        if(Directory.Exists(checkpointPath))
+            Directory.Delete(checkpointPath, true);
+        Directory.CreateDirectory(checkpointPath);
+
+        for(int i = 0; i < _analysisModules.Count; ++i)
+            await AnalysisStateFiles.SaveAsync(_analysisModules[i], i, checkpointPath);
+
+        using(var writer = new FastBinaryFileWriter(Path.Combine(checkpointPath, _testcasesFileName)))
+        {
+            writer.WriteInt32(_analyzedTestcaseIds.Count);
+            foreach(var testcaseId in _analyzedTestcaseIds.OrderBy(id => id))
+                writer.WriteInt32(testcaseId);
+        }
+
+        // Make the new checkpoint the current one
+        string pointerFilePath = Path.Combine(_checkpointDirectoryPath, _pointerFileName);
+        await File.WriteAllTextAsync(pointerFilePath + ".tmp", checkpointName);
+        File.Move(pointerFilePath + ".tmp", pointerFilePath, true);
+
+        if(_currentCheckpointName != null && _currentCheckpointName != checkpointName)
+            Directory.Delete(Path.Combine(_checkpointDirectoryPath, _currentCheckpointName), true);
+        _currentCheckpointName = checkpointName;
+    }
+
+    /// <summary>
+    /// Restores the analysis module states and analyzed testcase IDs from the given checkpoint.
+    /// </summary>
+    /// <param name="checkpointName">Name of the checkpoint subdirectory.</param>
+    private async Task RestoreAsync(string checkpointName)
+    {
+        string checkpointPath = Path.Combine(_checkpointDirectoryPath, checkpointName);
+        await _logger.LogInfoAsync($"[checkpoint] Resuming from checkpoint {checkpointPath}");
+
+        // The module states are merged into the freshly initialized modules
+        for(int i = 0; i < _analysisModules.Count; ++i)
+            await AnalysisStateFiles.MergeAsync(_analysisModules[i], i, checkpointPath);
+
+        using(var reader = new FastBinaryFileReader(Path.Combine(checkpointPath, _testcasesFileName)))
+        {
+            int testcaseCount = reader.ReadInt32();
+            for(int i = 0; i < testcaseCount; ++i)
+                _restoredTestcaseIds.Add(reader.ReadInt32());
+        }
+
+        _analyzedTestcaseIds.UnionWith(_restoredTestcaseIds);
+
+        await _logger.LogInfoAsync($"[checkpoint] Restored {_restoredTestcaseIds.Count} analyzed testcases");
+    }
+}
\ No newline at end of file
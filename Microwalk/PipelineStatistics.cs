@@ -0,0 +1,307 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace Microwalk;
+
+/// <summary>
+/// Collects per-stage statistics of the pipeline, which help finding the stage that limits the throughput, and tuning buffer sizes and
+/// parallelism.
+///
+/// The stage functions report the processing time of each item. The queue depths are sampled periodically by the <see cref="ProcessMonitor"/>;
+/// a sample also classifies the time since the previous one for each stage: If no item is processed and no input is queued, the stage waits
+/// for input. If no item is processed although there is input, the stage waits for the next stage to accept its output.
+/// </summary>
+internal class PipelineStatistics
+{
+    /// <summary>
+    /// Measures the time since the pipeline start.
+    /// </summary>
+    private readonly Stopwatch _stopwatch = Stopwatch.StartNew();
+
+    /// <summary>
+    /// Points in time (seconds since pipeline start) where queue depths were sampled.
+    /// </summary>
+    private readonly List<double> _sampleTimes = new();
+
+    /// <summary>
+    /// Protects the sample data.
+    /// </summary>
+    private readonly object _sampleLock = new();
+
+    private double _lastSampleTime;
+
+    public PipelineStatistics(int traceParallelism, int preprocessorParallelism, int analysisParallelism)
+    {
+        Testcase = new StageStatistics("testcase", 1, false);
+        Trace = new StageStatistics("trace", traceParallelism, true);
+        Preprocessor = new StageStatistics("preprocess", preprocessorParallelism, true);
+        Analysis = new StageStatistics("analysis", analysisParallelism, true);
+        Stages = new[] { Testcase, Trace, Preprocessor, Analysis };
+    }
+
+    public StageStatistics Testcase { get; }
+    public StageStatistics Trace { get; }
+    public StageStatistics Preprocessor { get; }
+    public StageStatistics Analysis { get; }
+
+    /// <summary>
+    /// All stages, in pipeline order.
+    /// </summary>
+    public IReadOnlyList<StageStatistics> Stages { get; }
+
+    /// <summary>
+    /// Time since the pipeline start, or the pipeline run time after <see cref="Complete"/> was called.
+    /// </summary>
+    public TimeSpan Elapsed => _stopwatch.Elapsed;
+
+    /// <summary>
+    /// Stops measuring, as the pipeline has completed.
+    /// </summary>
+    public void Complete()
+    {
+        lock(_sampleLock)
+            _stopwatch.Stop();
+    }
+
+    /// <summary>
+    /// Samples the queue depths and the state of each stage.
+    /// </summary>
+    public void Sample()
+    {
+        lock(_sampleLock)
+        {
+            if(!_stopwatch.IsRunning)
+                return;
+
+            double time = _stopwatch.Elapsed.TotalSeconds;
+            double interval = time - _lastSampleTime;
+            _lastSampleTime = time;
+
+            _sampleTimes.Add(time);
+            foreach(var stage in Stages)
+                stage.Sample(interval);
+        }
+    }
+
+    /// <summary>
+    /// Returns the stage with the highest utilization, i.e., the stage which limits the pipeline throughput.
+    /// </summary>
+    public StageStatistics GetBottleneck()
+    {
+        double elapsedSeconds = Elapsed.TotalSeconds;
+        return Stages.MaxBy(s => s.GetUtilization(elapsedSeconds))!;
+    }
+
+    /// <summary>
+    /// Formats a short summary of the current state of all stages.
+    /// </summary>
+    public string FormatProgress()
+    {
+        double elapsedSeconds = Elapsed.TotalSeconds;
+        return string.Join(" | ", Stages.Select(s => $"{s.Name}: {s.ItemCount} items, {100 * s.GetUtilization(elapsedSeconds):F1}% busy, queue {s.LastQueueDepth}"));
+    }
+
+    /// <summary>
+    /// Writes the statistics of all stages into a JSON file, and the sampled queue depths into a CSV file.
+    /// </summary>
+    /// <param name="outputDirectoryPath">Output directory.</param>
+    public async Task WriteReportAsync(string outputDirectoryPath)
+    {
+        Directory.CreateDirectory(outputDirectoryPath);
+        double elapsedSeconds = Elapsed.TotalSeconds;
+
+        await using(var reportWriter = new StreamWriter(File.Create(Path.Combine(outputDirectoryPath, "pipeline-statistics.json"))))
+        {
+            await reportWriter.WriteAsync($"{{\"ElapsedSeconds\":{elapsedSeconds},\"Bottleneck\":\"{GetBottleneck().Name}\",\"Stages\":[");
+            for(int i = 0; i < Stages.Count; ++i)
+            {
+                var stage = Stages[i];
+                var latencies = stage.GetLatencyPercentiles();
+                await reportWriter.WriteAsync($"{(i > 0 ? "," : "")}{{" +
+                                              $"\"Name\":\"{stage.Name}\"," +
+                                              $"\"Parallelism\":{stage.Parallelism}," +
+                                              $"\"ItemCount\":{stage.ItemCount}," +
+                                              $"\"BusySeconds\":{stage.BusyTime.TotalSeconds}," +
+                                              $"\"Utilization\":{stage.GetUtilization(elapsedSeconds)}," +
+                                              $"\"WaitForInputSeconds\":{stage.WaitForInputSeconds}," +
+                                              $"\"WaitForOutputSeconds\":{stage.WaitForOutputSeconds}," +
+                                              $"\"MeanQueueDepth\":{stage.MeanQueueDepth}," +
+                                              $"\"MaxQueueDepth\":{stage.MaxQueueDepth}," +
+                                              $"\"LatencyMilliseconds\":{{\"P50\":{latencies.p50},\"P90\":{latencies.p90},\"P99\":{latencies.p99},\"Max\":{latencies.max}}}" +
+                                              $"}}");
+            }
+
+            await reportWriter.WriteAsync("]}");
+        }
+
+        await using(var queueDepthWriter = new StreamWriter(File.Create(Path.Combine(outputDirectoryPath, "pipeline-queue-depths.csv"))))
+        {
+            var queueStages = Stages.Where(s => s.HasInputQueue).ToList();
+            await queueDepthWriter.WriteLineAsync("Seconds;" + string.Join(";", queueStages.Select(s => s.Name)));
+
+            lock(_sampleLock)
+            {
+                var line = new StringBuilder();
+                for(int i = 0; i < _sampleTimes.Count; ++i)
+                {
+                    line.Clear();
+                    line.Append(_sampleTimes[i].ToString("F3"));
+                    foreach(var stage in queueStages)
+                        line.Append(';').Append(stage.QueueDepthSamples[i]);
+                    queueDepthWriter.WriteLine(line.ToString());
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Statistics of a single pipeline stage.
+    /// </summary>
+    public class StageStatistics
+    {
+        /// <summary>
+        /// Processing times of the single items, in <see cref="Stopwatch"/> ticks.
+        /// </summary>
+        private readonly List<long> _latencies = new();
+
+        private long _itemCount;
+        private long _busyTicks;
+        private int _runningCount;
+        private long _queueDepthSum;
+
+        public StageStatistics(string name, int parallelism, bool hasInputQueue)
+        {
+            Name = name;
+            Parallelism = parallelism;
+            HasInputQueue = hasInputQueue;
+        }
+
+        public string Name { get; }
+
+        /// <summary>
+        /// Maximum number of concurrently processed items.
+        /// </summary>
+        public int Parallelism { get; }
+
+        /// <summary>
+        /// Determines whether the stage receives its input from a queue. This is not the case for the testcase stage.
+        /// </summary>
+        public bool HasInputQueue { get; }
+
+        /// <summary>
+        /// Returns the number of items which wait for being processed by this stage. Must be set for stages with an input queue.
+        /// </summary>
+        public Func<int>? QueueDepthProvider { get; set; }
+
+        public long ItemCount => Interlocked.Read(ref _itemCount);
+
+        /// <summary>
+        /// Total processing time of all items.
+        /// </summary>
+        public TimeSpan BusyTime => TimeSpan.FromSeconds((double)Interlocked.Read(ref _busyTicks) / Stopwatch.Frequency);
+
+        /// <summary>
+        /// Sampled time where no item was processed, as there was no input.
+        /// </summary>
+        public double WaitForInputSeconds { get; private set; }
+
+        /// <summary>
+        /// Sampled time where no item was processed, as the next stage did not accept output.
+        /// </summary>
+        public double WaitForOutputSeconds { get; private set; }
+
+        /// <summary>
+        /// Queue depth of each sample.
+        /// </summary>
+        public List<int> QueueDepthSamples { get; } = new();
+
+        /// <summary>
+        /// Queue depth of the latest sample.
+        /// </summary>
+        public int LastQueueDepth { get; private set; }
+
+        public int MaxQueueDepth { get; private set; }
+
+        public double MeanQueueDepth => QueueDepthSamples.Count == 0 ? 0.0 : (double)_queueDepthSum / QueueDepthSamples.Count;
+
+        /// <summary>
+        /// Notifies that the processing of an item begins, and returns a timestamp which must be passed to <see cref="End"/>.
+        /// </summary>
+        public long Begin()
+        {
+            Interlocked.Increment(ref _runningCount);
+            return Stopwatch.GetTimestamp();
+        }
+
+        /// <summary>
+        /// Notifies that the processing of an item has completed.
+        /// </summary>
+        /// <param name="beginTimestamp">Timestamp returned by <see cref="Begin"/>.</param>
+        public void End(long beginTimestamp)
+        {
+            long ticks = Stopwatch.GetTimestamp() - beginTimestamp;
+            Interlocked.Add(ref _busyTicks, ticks);
+            Interlocked.Increment(ref _itemCount);
+            Interlocked.Decrement(ref _runningCount);
+
+            lock(_latencies)
+                _latencies.Add(ticks);
+        }
+
+        /// <summary>
+        /// Returns the fraction of the available processing time (elapsed time times parallelism) which was spent on processing items.
+        /// </summary>
+        /// <param name="elapsedSeconds">Time since the pipeline start.</param>
+        public double GetUtilization(double elapsedSeconds)
+        {
+            return elapsedSeconds <= 0 ? 0.0 : BusyTime.TotalSeconds / (elapsedSeconds * Parallelism);
+        }
+
+        /// <summary>
+        /// Returns the 50th, 90th and 99th percentile and the maximum of the item processing times, in milliseconds.
+        /// </summary>
+        public (double p50, double p90, double p99, double max) GetLatencyPercentiles()
+        {
+            long[] latencies;
+            lock(_latencies)
+                latencies = _latencies.ToArray();
+            if(latencies.Length == 0)
+                return (0, 0, 0, 0);
+
+            Array.Sort(latencies);
+            double Percentile(double p) => 1000.0 * latencies[Math.Max(0, (int)Math.Ceiling(p * latencies.Length) - 1)] / Stopwatch.Frequency;
+            return (Percentile(0.5), Percentile(0.9), Percentile(0.99), 1000.0 * latencies[^1] / Stopwatch.Frequency);
+        }
+
+        /// <summary>
+        /// Samples the queue depth, and attributes the given time since the last sample.
+        /// </summary>
+        /// <param name="interval">Time since the last sample, in seconds.</param>
+        internal void Sample(double interval)
+        {
+            int queueDepth = QueueDepthProvider?.Invoke() ?? 0;
+            LastQueueDepth = queueDepth;
+            if(HasInputQueue)
+            {
+                QueueDepthSamples.Add(queueDepth);
+                _queueDepthSum += queueDepth;
+                MaxQueueDepth = Math.Max(MaxQueueDepth, queueDepth);
+            }
+
+            if(Volatile.Read(ref _runningCount) > 0)
+                return;
+
+            // The testcase stage is only idle while it waits for the trace stage to accept a testcase
+            if(HasInputQueue && queueDepth == 0)
+                WaitForInputSeconds += interval;
+            else
+                WaitForOutputSeconds += interval;
+        }
+    }
+}
\ No newline at end of file
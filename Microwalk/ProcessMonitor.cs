@@ -20,6 +20,33 @@ internal class ProcessMonitor : IDisposable
 
     private long _maxMemoryUsage = 0;
 
+    /// <summary>
+    /// Interval for logging the pipeline statistics. Zero disables periodic logging.
+    /// </summary>
+    private readonly TimeSpan _logInterval;
+
+    /// <summary>
+    /// Directory for the pipeline statistics report. May be null.
+    /// </summary>
+    private readonly string? _reportDirectoryPath;
+
+    private DateTime _nextLogTime;
+
+    /// <summary>
+    /// Trace spiller, whose statistics are included in the results. May be null.
+    /// </summary>
+    public TraceSpiller? TraceSpiller { get; set; }
+
+    /// <summary>
+    /// Pipeline statistics, which are sampled and included in the results. May be null.
+    /// </summary>
+    public PipelineStatistics? PipelineStatistics { get; set; }
+
+    /// <summary>
+    /// Pipeline auto tuner, which is updated after each sample of the <see cref="PipelineStatistics"/>. May be null.
+    /// </summary>
+    public PipelineAutoTuner? AutoTuner { get; set; }
+
     /// <summary>
     /// Starts a new process monitor with the given configuration.
     /// </summary>
@@ -34,6 +61,9 @@ internal class ProcessMonitor : IDisposable
 
         // Read configuration
         int sampleRate = configuration.GetChildNodeOrDefault("sample-rate")?.AsInteger() ?? 500;
+        _logInterval = TimeSpan.FromSeconds(configuration.GetChildNodeOrDefault("log-interval")?.AsInteger() ?? 60);
+        _reportDirectoryPath = configuration.GetChildNodeOrDefault("report-directory")?.AsString();
+        _nextLogTime = DateTime.Now + _logInterval;
 
         // Start timer
         _timer = new Timer(Update, null, TimeSpan.Zero, TimeSpan.FromMilliseconds(sampleRate));
@@ -51,6 +81,19 @@ internal class ProcessMonitor : IDisposable
         // Memory usage
         if(_thisProcess.PrivateMemorySize64 > _maxMemoryUsage)
             _maxMemoryUsage = _thisProcess.PrivateMemorySize64;
+
+        // Pipeline state
+        if(PipelineStatistics != null)
+        {
+            PipelineStatistics.Sample();
+            AutoTuner?.Update(_thisProcess.WorkingSet64);
+
+            if(_logInterval > TimeSpan.Zero && DateTime.Now >= _nextLogTime)
+            {
+                _nextLogTime = DateTime.Now + _logInterval;
+                _logger.LogInfoAsync($"[monitor] {PipelineStatistics.FormatProgress()}").Wait();
+            }
+        }
     }
 
     /// <summary>
@@ -63,6 +106,33 @@ internal class ProcessMonitor : IDisposable
 
         // Print results
         await _logger.LogInfoAsync($"[monitor] Maximum private memory size: {_maxMemoryUsage} bytes ({(double)_maxMemoryUsage / (1024 * 1024):N3} MB)");
+        if(TraceSpiller != null)
+        {
+            await _logger.LogInfoAsync($"[monitor] Maximum in-memory trace data: {TraceSpiller.PeakResidentBytes} bytes ({(double)TraceSpiller.PeakResidentBytes / (1024 * 1024):N3} MB)");
+            await _logger.LogInfoAsync($"[monitor] Spilled traces: {TraceSpiller.SpillCount} ({(double)TraceSpiller.SpilledBytes / (1024 * 1024):N3} MB), reloaded {TraceSpiller.ReloadCount} times");
+        }
+
+        if(PipelineStatistics != null)
+        {
+            double elapsedSeconds = PipelineStatistics.Elapsed.TotalSeconds;
+            await _logger.LogInfoAsync($"[monitor] Pipeline run time: {elapsedSeconds:N3} s");
+            foreach(var stage in PipelineStatistics.Stages)
+            {
+                var latencies = stage.GetLatencyPercentiles();
+                await _logger.LogInfoAsync($"[monitor] Stage '{stage.Name}': {stage.ItemCount} items, {stage.BusyTime.TotalSeconds:N3} s busy ({100 * stage.GetUtilization(elapsedSeconds):N1}% of {stage.Parallelism} thread(s)), "
+                                           + $"waited {stage.WaitForInputSeconds:N3} s for input and {stage.WaitForOutputSeconds:N3} s for output, "
+                                           + $"queue depth {stage.MeanQueueDepth:N1} (mean) / {stage.MaxQueueDepth} (max), "
+                                           + $"latency {latencies.p50:N3} / {latencies.p90:N3} / {latencies.p99:N3} / {latencies.max:N3} ms (p50/p90/p99/max)");
+            }
+
+            await _logger.LogInfoAsync($"[monitor] Bottleneck: '{PipelineStatistics.GetBottleneck().Name}' stage");
+
+            if(_reportDirectoryPath != null)
+            {
+                await PipelineStatistics.WriteReportAsync(_reportDirectoryPath);
+                await _logger.LogInfoAsync($"[monitor] Wrote pipeline statistics to {_reportDirectoryPath}");
+            }
+        }
     }
 
     public void Dispose()
@@ -31,6 +31,31 @@ namespace Microwalk
         /// </summary>
         private static ILogger? _logger;
 
+        /// <summary>
+        /// Limits the amount of preprocessed trace data held in memory. May be null.
+        /// </summary>
+        private static TraceSpiller? _traceSpiller;
+
+        /// <summary>
+        /// Stops the testcase generation once the analysis results are stable. May be null.
+        /// </summary>
+        private static LeakageConvergenceMonitor? _convergenceMonitor;
+
+        /// <summary>
+        /// Writes checkpoints for resuming an interrupted run. May be null.
+        /// </summary>
+        private static PipelineCheckpointer? _checkpointer;
+
+        /// <summary>
+        /// Per-stage statistics, if the process monitor is enabled. May be null.
+        /// </summary>
+        private static PipelineStatistics? _pipelineStatistics;
+
+        /// <summary>
+        /// Adjusts the stage parallelism and the number of testcases in the pipeline at runtime. May be null.
+        /// </summary>
+        private static PipelineAutoTuner? _autoTuner;
+
         /// <summary>
         /// Program entry point.
         /// </summary>
@@ -184,10 +209,17 @@ namespace Microwalk
                     processMonitor = new ProcessMonitor(monitorConfigurationNode, _logger);
                 }
 
+                // In merge mode, only the analysis stage is needed
+                var mergeStateDirectories = commandLineOptions.MergeStateDirectories?.ToList() ?? new List<string>();
+                bool mergeMode = mergeStateDirectories.Count > 0;
+
                 // Read stages
                 await _logger.LogDebugAsync("Reading pipeline configuration");
                 foreach(var rootNode in configurationParser.RootNodes)
                 {
+                    if(mergeMode && rootNode.Key != "analysis")
+                        continue;
+
                     // Read key
                     switch(rootNode.Key)
                     {
@@ -282,6 +314,17 @@ namespace Microwalk
 
                 // Check presence of needed pipeline modules and generic options
                 await _logger.LogDebugAsync("Doing some sanity checks");
+                if(mergeMode)
+                {
+                    if(_moduleConfiguration.AnalysesStageModules == null || !_moduleConfiguration.AnalysesStageModules.Any())
+                        throw new ConfigurationException("Incomplete module specification. Make sure that there is at least one analysis module.");
+
+                    await MergeAnalysisStatesAsync(mergeStateDirectories);
+
+                    await _logger.LogInfoAsync("Program completed.");
+                    return;
+                }
+
                 if(_moduleConfiguration.TestcaseStageModule == null
                    || _moduleConfiguration.TraceStageModule == null
                    || _moduleConfiguration.PreprocessorStageModule == null
@@ -289,13 +332,57 @@ namespace Microwalk
                    || !_moduleConfiguration.AnalysesStageModules.Any())
                     throw new ConfigurationException(
                         "Incomplete module specification. Make sure that there is at least one module for testcase generation, trace generation, preprocessing and analysis, respectively.");
+                if(_moduleConfiguration.TraceStageModule.NeedsTestcaseFiles && !_moduleConfiguration.TestcaseStageModule.ProvidesTestcaseFiles)
+                    throw new ConfigurationException("The trace module reads the test cases from files, but the test case module only keeps them in memory. Specify an output directory for the test cases, or use an in-memory test case delivery mode.");
+
+                // Memory budget for preprocessed traces
+                _traceSpiller = TraceSpiller.Create(_moduleConfiguration.PreprocessorStageOptions, _logger);
+                if(processMonitor != null)
+                    processMonitor.TraceSpiller = _traceSpiller;
+
+                // Early stopping
+                _convergenceMonitor = await LeakageConvergenceMonitor.CreateAsync(_moduleConfiguration.AnalysisStageOptions, _moduleConfiguration.AnalysesStageModules, _logger);
+
+                // Maximum parallelism of each stage
+                int traceParallelism = _moduleConfiguration.TraceStageModule.SupportsParallelism
+                    ? _moduleConfiguration.TraceStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
+                    : 1;
+                int preprocessorParallelism = _moduleConfiguration.PreprocessorStageModule.SupportsParallelism
+                    ? _moduleConfiguration.PreprocessorStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
+                    : 1;
+                int analysisParallelism = _moduleConfiguration.AnalysesStageModules.All(asm => asm.SupportsParallelism)
+                    ? _moduleConfiguration.AnalysisStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
+                    : 1;
+
+                // Auto tuning
+                _autoTuner = PipelineAutoTuner.Create(generalConfigurationNode?.GetChildNodeOrDefault("auto-tune") as MappingNode, preprocessorParallelism, analysisParallelism, _logger);
+                if(_autoTuner != null)
+                {
+                    if(processMonitor == null)
+                        throw new ConfigurationException("Auto tuning needs the process monitor to be enabled.");
+
+                    await _logger.LogInfoAsync("Enabling pipeline auto tuning");
+                }
+
+                // The auto tuner limits the total number of testcases in the pipeline instead of the single buffers
+                int GetInputBufferSize(MappingNode? stageOptions) => _autoTuner != null
+                    ? DataflowBlockOptions.Unbounded
+                    : stageOptions?.GetChildNodeOrDefault("input-buffer-size")?.AsInteger() ?? 1;
+
+                // Checkpoints
+                _checkpointer = await PipelineCheckpointer.CreateAsync(_moduleConfiguration.AnalysisStageOptions, _moduleConfiguration.AnalysesStageModules, analysisParallelism, commandLineOptions.Resume, _logger);
+
+                // Saving analysis states for merging them with other runs
+                string? saveStateDirectoryPath = _moduleConfiguration.AnalysisStageOptions?.GetChildNodeOrDefault("save-state-directory")?.AsString();
+                if(saveStateDirectoryPath != null)
+                    AnalysisStateFiles.EnsureSupported(_moduleConfiguration.AnalysesStageModules, "merging runs");
 
                 // Initialize pipeline stages
                 // -> [buffer] -> trace -> [buffer] -> preprocess -> [buffer] -> analysis
                 await _logger.LogDebugAsync("Initializing pipeline stages");
                 var traceStageBuffer = new BufferBlock<TraceEntity>(new DataflowBlockOptions
                 {
-                    BoundedCapacity = _moduleConfiguration.TraceStageOptions?.GetChildNodeOrDefault("input-buffer-size")?.AsInteger() ?? 1,
+                    BoundedCapacity = GetInputBufferSize(_moduleConfiguration.TraceStageOptions),
                     CancellationToken = globalCancellationToken.Token,
                     EnsureOrdered = true
                 });
@@ -303,16 +390,12 @@ namespace Microwalk
                 {
                     CancellationToken = globalCancellationToken.Token,
                     EnsureOrdered = true,
-                    MaxDegreeOfParallelism = _moduleConfiguration.TraceStageModule.SupportsParallelism
-                        ? _moduleConfiguration.TraceStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
-                        : 1,
-                    BoundedCapacity = _moduleConfiguration.TraceStageModule.SupportsParallelism
-                        ? _moduleConfiguration.TraceStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
-                        : 1
+                    MaxDegreeOfParallelism = traceParallelism,
+                    BoundedCapacity = traceParallelism
                 });
                 var preprocessorStageBuffer = new BufferBlock<TraceEntity>(new DataflowBlockOptions
                 {
-                    BoundedCapacity = _moduleConfiguration.PreprocessorStageOptions?.GetChildNodeOrDefault("input-buffer-size")?.AsInteger() ?? 1,
+                    BoundedCapacity = GetInputBufferSize(_moduleConfiguration.PreprocessorStageOptions),
                     CancellationToken = globalCancellationToken.Token,
                     EnsureOrdered = true
                 });
@@ -320,16 +403,12 @@ namespace Microwalk
                 {
                     CancellationToken = globalCancellationToken.Token,
                     EnsureOrdered = true,
-                    MaxDegreeOfParallelism = _moduleConfiguration.PreprocessorStageModule.SupportsParallelism
-                        ? _moduleConfiguration.PreprocessorStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
-                        : 1,
-                    BoundedCapacity = _moduleConfiguration.PreprocessorStageModule.SupportsParallelism
-                        ? _moduleConfiguration.PreprocessorStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
-                        : 1
+                    MaxDegreeOfParallelism = preprocessorParallelism,
+                    BoundedCapacity = preprocessorParallelism
                 });
                 var analysisStageBuffer = new BufferBlock<TraceEntity>(new DataflowBlockOptions
                 {
-                    BoundedCapacity = _moduleConfiguration.AnalysisStageOptions?.GetChildNodeOrDefault("input-buffer-size")?.AsInteger() ?? 1,
+                    BoundedCapacity = GetInputBufferSize(_moduleConfiguration.AnalysisStageOptions),
                     CancellationToken = globalCancellationToken.Token,
                     EnsureOrdered = true
                 });
@@ -337,12 +416,8 @@ namespace Microwalk
                 {
                     CancellationToken = globalCancellationToken.Token,
                     EnsureOrdered = true,
-                    MaxDegreeOfParallelism = _moduleConfiguration.AnalysesStageModules.All(asm => asm.SupportsParallelism)
-                        ? _moduleConfiguration.AnalysisStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
-                        : 1,
-                    BoundedCapacity = _moduleConfiguration.AnalysesStageModules.All(asm => asm.SupportsParallelism)
-                        ? _moduleConfiguration.AnalysisStageOptions?.GetChildNodeOrDefault("max-parallel-threads")?.AsInteger() ?? 1
-                        : 1
+                    MaxDegreeOfParallelism = analysisParallelism,
+                    BoundedCapacity = analysisParallelism
                 });
 
                 // Link pipeline stages
@@ -357,6 +432,22 @@ namespace Microwalk
                 preprocessorStage.LinkTo(analysisStageBuffer, linkOptions);
                 analysisStageBuffer.LinkTo(analysisStage, linkOptions);
 
+                // Collect per-stage statistics
+                if(processMonitor != null)
+                {
+                    _pipelineStatistics = new PipelineStatistics(traceParallelism, preprocessorParallelism, analysisParallelism);
+                    _pipelineStatistics.Trace.QueueDepthProvider = () => traceStageBuffer.Count + traceStage.InputCount;
+                    _pipelineStatistics.Preprocessor.QueueDepthProvider = () => preprocessorStageBuffer.Count + preprocessorStage.InputCount + (_autoTuner?.Preprocessor.Limit.WaitingCount ?? 0);
+                    _pipelineStatistics.Analysis.QueueDepthProvider = () => analysisStageBuffer.Count + analysisStage.InputCount + (_autoTuner?.Analysis.Limit.WaitingCount ?? 0);
+                    processMonitor.PipelineStatistics = _pipelineStatistics;
+
+                    if(_autoTuner != null)
+                    {
+                        _autoTuner.Start(_pipelineStatistics);
+                        processMonitor.AutoTuner = _autoTuner;
+                    }
+                }
+
                 // Start posting test cases
                 await _logger.LogInfoAsync("Start testcase thread -> pipeline start");
                 var testcaseTask = PostTestcases(traceStageBuffer, globalCancellationToken.Token)
@@ -378,8 +469,21 @@ namespace Microwalk
                 {
                     // Wait for all stages to complete
                     await analysisStage.Completion;
+                    _pipelineStatistics?.Complete();
                     await _logger.LogInfoAsync("Pipeline completed, executing final analysis steps");
 
+                    // Make sure that a resumed run does not need to analyze any traces
+                    if(_checkpointer != null)
+                        await _checkpointer.CompleteAsync();
+
+                    // Save analysis states for merging them with other runs?
+                    if(saveStateDirectoryPath != null)
+                    {
+                        await _logger.LogInfoAsync($"Saving analysis states to {saveStateDirectoryPath}");
+                        for(int i = 0; i < _moduleConfiguration.AnalysesStageModules.Count; ++i)
+                            await AnalysisStateFiles.SaveAsync(_moduleConfiguration.AnalysesStageModules[i], i, saveStateDirectoryPath);
+                    }
+
                     // Do final analysis steps
                     foreach(var module in _moduleConfiguration.AnalysesStageModules)
                         await module.FinishAsync();
@@ -439,12 +543,34 @@ namespace Microwalk
             }
             finally
             {
+                _traceSpiller?.Dispose();
                 processMonitor?.Dispose();
                 _logger?.Dispose();
                 globalCancellationToken.Dispose();
             }
         }
 
+        /// <summary>
+        /// Merges the analysis states saved by other runs, and executes the final analysis steps.
+        /// </summary>
+        /// <param name="stateDirectoryPaths">Directories containing the saved states.</param>
+        private static async Task MergeAnalysisStatesAsync(List<string> stateDirectoryPaths)
+        {
+            var analysisModules = _moduleConfiguration.AnalysesStageModules!;
+            foreach(var stateDirectoryPath in stateDirectoryPaths)
+            {
+                await _logger!.LogInfoAsync($"Merging analysis states from {stateDirectoryPath}");
+                for(int i = 0; i < analysisModules.Count; ++i)
+                    await AnalysisStateFiles.MergeAsync(analysisModules[i], i, stateDirectoryPath);
+            }
+
+            await _logger!.LogInfoAsync("Merging completed, executing final analysis steps");
+            foreach(var module in analysisModules)
+                await module.FinishAsync();
+
+            await Task.WhenAll(analysisModules.Select(module => module.UnInitAsync()));
+        }
+
         /// <summary>
         /// Posts testcases into the first pipeline block, and completes the block afterwards.
         /// </summary>
@@ -453,9 +579,31 @@ namespace Microwalk
         /// <returns></returns>
         private static async Task PostTestcases(BufferBlock<TraceEntity> traceStageBuffer, CancellationToken token)
         {
-            // Feed testcases into pipeline
-            while(!await _moduleConfiguration.TestcaseStageModule!.IsDoneAsync())
-                await traceStageBuffer.SendAsync(await _moduleConfiguration.TestcaseStageModule.NextTestcaseAsync(token), token);
+            // Feed testcases into pipeline, until the testcase stage is done or the analysis results are stable
+            // When resuming from a checkpoint, the testcases which were already analyzed are skipped. This relies on consecutive testcase IDs.
+            int nextTestcaseId = 0;
+            while(!(_convergenceMonitor?.IsConverged ?? false) && !await _moduleConfiguration.TestcaseStageModule!.IsDoneAsync())
+            {
+                if(_checkpointer?.IsRestored(nextTestcaseId) ?? false)
+                    await _moduleConfiguration.TestcaseStageModule.SkipTestcaseAsync(token);
+                else
+                {
+                    long beginTimestamp = _pipelineStatistics?.Testcase.Begin() ?? 0;
+                    var traceEntity = await _moduleConfiguration.TestcaseStageModule.NextTestcaseAsync(token);
+                    _pipelineStatistics?.Testcase.End(beginTimestamp);
+
+                    // Released when the testcase has been analyzed
+                    if(_autoTuner != null)
+                        await _autoTuner.TestcasesInFlight.WaitAsync(token);
+
+                    if(_checkpointer != null && traceEntity.Id != nextTestcaseId)
+                        throw new Exception($"Checkpoints require consecutive testcase IDs, but the testcase module returned #{traceEntity.Id} instead of #{nextTestcaseId}.");
+
+                    await traceStageBuffer.SendAsync(traceEntity, token);
+                }
+
+                ++nextTestcaseId;
+            }
 
             // Mark first block as completed
             // This should propagate through the entire pipeline
@@ -469,8 +617,12 @@ namespace Microwalk
         /// <returns></returns>
         private static async Task<TraceEntity> TraceStageFunc(TraceEntity t)
         {
+            long beginTimestamp = _pipelineStatistics?.Trace.Begin() ?? 0;
+
             // Run module
             await _moduleConfiguration.TraceStageModule!.GenerateTraceAsync(t);
+
+            _pipelineStatistics?.Trace.End(beginTimestamp);
             return t;
         }
 
@@ -481,9 +633,26 @@ namespace Microwalk
         /// <returns></returns>
         private static async Task<TraceEntity> PreprocessorStageFunc(TraceEntity t)
         {
-            // Run module
-            await _moduleConfiguration.PreprocessorStageModule!.PreprocessTraceAsync(t);
-            return t;
+            if(_autoTuner != null)
+                await _autoTuner.Preprocessor.Limit.WaitAsync();
+            try
+            {
+                long beginTimestamp = _pipelineStatistics?.Preprocessor.Begin() ?? 0;
+
+                // Run module
+                await _moduleConfiguration.PreprocessorStageModule!.PreprocessTraceAsync(t);
+
+                // Keep trace data within memory budget
+                if(_traceSpiller != null)
+                    await _traceSpiller.AdmitAsync(t);
+
+                _pipelineStatistics?.Preprocessor.End(beginTimestamp);
+                return t;
+            }
+            finally
+            {
+                _autoTuner?.Preprocessor.Limit.Release();
+            }
         }
 
         /// <summary>
@@ -491,10 +660,42 @@ namespace Microwalk
         /// </summary>
         /// <param name="t">Input trace entity.</param>
         /// <returns></returns>
-        private static Task AnalysisStageFunc(TraceEntity t)
+        private static async Task AnalysisStageFunc(TraceEntity t)
         {
-            // Run modules in parallel
-            return Task.WhenAll(_moduleConfiguration.AnalysesStageModules!.Select(module => module.AddTraceAsync(t)));
+            if(_autoTuner != null)
+                await _autoTuner.Analysis.Limit.WaitAsync();
+            try
+            {
+                long beginTimestamp = _pipelineStatistics?.Analysis.Begin() ?? 0;
+
+                _traceSpiller?.BeginAnalysis(t, _moduleConfiguration.AnalysesStageModules!.Count);
+
+                // Run modules in parallel
+                // The checkpointer keeps track of the analyzed testcases, and pauses the analysis while writing a checkpoint
+                Task AnalyzeAsync() => Task.WhenAll(_moduleConfiguration.AnalysesStageModules!.Select(module => module.AddTraceAsync(t)));
+                if(_checkpointer != null)
+                    await _checkpointer.AnalyzeAsync(t.Id, AnalyzeAsync);
+                else
+                    await AnalyzeAsync();
+
+                _traceSpiller?.Release(t);
+
+                // Release trace data which is not managed by the GC, e.g. memory-mapped files
+                t.PreprocessedTraceFile?.Dispose();
+
+                if(_convergenceMonitor != null)
+                    await _convergenceMonitor.OnTestcaseAnalyzedAsync();
+
+                _pipelineStatistics?.Analysis.End(beginTimestamp);
+            }
+            finally
+            {
+                if(_autoTuner != null)
+                {
+                    _autoTuner.Analysis.Limit.Release();
+                    _autoTuner.TestcasesInFlight.Release();
+                }
+            }
         }
 
         /// <summary>
@@ -46,6 +46,13 @@ namespace Microwalk.TestcaseGeneration.Modules
             return Task.FromResult(_nextTestcaseNumber >= _testcaseCount);
         }
 
+        public override Task SkipTestcaseAsync(CancellationToken token)
+        {
+            // The test case file was already generated, so there is no need to call the command again
+            ++_nextTestcaseNumber;
+            return Task.CompletedTask;
+        }
+
         public override async Task<TraceEntity> NextTestcaseAsync(CancellationToken token)
         {
             // Format argument string
@@ -26,9 +26,19 @@ namespace Microwalk.TestcaseGeneration.Modules
         private int _testcaseLength;
 
         /// <summary>
-        /// The test case output directory.
+        /// The test case output directory. May be null, if the test cases are only kept in memory.
         /// </summary>
-        private DirectoryInfo _outputDirectory = null!;
+        private DirectoryInfo? _outputDirectory;
+
+        /// <summary>
+        /// Seed for deterministic test case generation. If null, test cases are drawn from a cryptographic RNG.
+        /// </summary>
+        private ulong? _seed;
+
+        /// <summary>
+        /// The index of the next deterministic test case. This may differ from the test case number, as duplicates are skipped.
+        /// </summary>
+        private ulong _nextDeterministicIndex = 0;
 
         /// <summary>
         /// The number of the next test case.
@@ -60,31 +70,41 @@ namespace Microwalk.TestcaseGeneration.Modules
                 await Logger.LogWarningAsync("The requested number of test cases is near to the maximum possible number of possible test cases.\n" +
                                              "Consider increasing test case length or decreasing test case count to avoid performance hits and a possible endless loop.");
 
+            // Deterministic mode?
+            _seed = moduleOptions.GetChildNodeOrDefault("seed")?.AsUnsignedLongHex();
+            if(_seed != null)
+                await Logger.LogInfoAsync($"Generating deterministic test cases with seed 0x{_seed:x16}");
+
             // Make sure output directory exists
-            var outputDirectoryPath = moduleOptions.GetChildNodeOrDefault("output-directory")?.AsString() ?? throw new ConfigurationException("Missing output directory.");
-            _outputDirectory = Directory.CreateDirectory(outputDirectoryPath);
+            // Deterministic test cases can be reproduced at any time, so storing them is optional
+            var outputDirectoryPath = moduleOptions.GetChildNodeOrDefault("output-directory")?.AsString();
+            if(outputDirectoryPath != null)
+                _outputDirectory = Directory.CreateDirectory(outputDirectoryPath);
+            else if(_seed == null)
+                throw new ConfigurationException("Missing output directory.");
         }
 
+        public override bool ProvidesTestcaseFiles => _outputDirectory != null;
+
         public override async Task<TraceEntity> NextTestcaseAsync(CancellationToken token)
         {
-            // Generate random bytes
-            byte[] random = new byte[_testcaseLength];
-            do
-                _rng.GetBytes(random);
-            while(_knownTestcases.Contains(random));
-
-            // Remember test case
-            _knownTestcases.Add(random);
+            byte[] random = GenerateTestcaseData(out var deterministicTestcase);
 
             // Store test case
-            string testcaseFileName = Path.Combine(_outputDirectory.FullName, $"{_nextTestcaseNumber}.testcase");
-            await File.WriteAllBytesAsync(testcaseFileName, random, token);
+            string testcaseFileName = "";
+            if(_outputDirectory != null)
+            {
+                testcaseFileName = Path.Combine(_outputDirectory.FullName, $"{_nextTestcaseNumber}.testcase");
+                await File.WriteAllBytesAsync(testcaseFileName, random, token);
+            }
 
             // Create trace entity object
             var traceEntity = new TraceEntity
             {
                 Id = _nextTestcaseNumber,
-                TestcaseFilePath = testcaseFileName
+                TestcaseFilePath = testcaseFileName,
+                TestcaseData = random,
+                DeterministicTestcase = deterministicTestcase
             };
 
             // Done
@@ -93,6 +113,51 @@ namespace Microwalk.TestcaseGeneration.Modules
             return traceEntity;
         }
 
+        public override async Task SkipTestcaseAsync(CancellationToken token)
+        {
+            // Deterministic test cases are generated anyway, so the following ones get the same indices as in the original run.
+            // Random test cases cannot be reproduced, and the test case file must not be overwritten. Instead, the stored test case is remembered, so it is
+            // not generated again.
+            if(_seed != null)
+                GenerateTestcaseData(out _);
+            else
+            {
+                string testcaseFileName = Path.Combine(_outputDirectory!.FullName, $"{_nextTestcaseNumber}.testcase");
+                if(File.Exists(testcaseFileName))
+                    _knownTestcases.Add(await File.ReadAllBytesAsync(testcaseFileName, token));
+                else
+                    await Logger.LogWarningAsync($"Could not find file of skipped test case #{_nextTestcaseNumber}, it may be generated again");
+            }
+
+            ++_nextTestcaseNumber;
+        }
+
+        /// <summary>
+        /// Generates the data of a new, unique test case.
+        /// </summary>
+        /// <param name="deterministicTestcase">Parameters of the generated test case, if a seed is set; else null.</param>
+        private byte[] GenerateTestcaseData(out DeterministicTestcase? deterministicTestcase)
+        {
+            // Generate random bytes
+            byte[] random = new byte[_testcaseLength];
+            deterministicTestcase = null;
+            do
+            {
+                if(_seed != null)
+                {
+                    deterministicTestcase = new DeterministicTestcase { Seed = _seed.Value, Index = _nextDeterministicIndex++, Length = _testcaseLength };
+                    DeterministicTestcase.Generate(deterministicTestcase.Seed, deterministicTestcase.Index, random);
+                }
+                else
+                    _rng.GetBytes(random);
+            }
+            while(_knownTestcases.Contains(random));
+
+            // Remember test case
+            _knownTestcases.Add(random);
+            return random;
+        }
+
         public override Task<bool> IsDoneAsync()
         {
             return Task.FromResult(_nextTestcaseNumber >= _testcaseCount);
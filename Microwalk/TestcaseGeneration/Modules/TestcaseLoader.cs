@@ -56,6 +56,13 @@ namespace Microwalk.TestcaseGeneration.Modules
             return traceEntity;
         }
 
+        public override Task SkipTestcaseAsync(CancellationToken token)
+        {
+            _testcaseFileNames.Dequeue();
+            ++_nextTestcaseNumber;
+            return Task.CompletedTask;
+        }
+
         public override Task<bool> IsDoneAsync()
         {
             return Task.FromResult(_testcaseFileNames.Count == 0);
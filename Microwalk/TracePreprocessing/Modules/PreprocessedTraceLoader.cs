@@ -5,6 +5,7 @@ using Microwalk.FrameworkBase.Configuration;
 using Microwalk.FrameworkBase.Exceptions;
 using Microwalk.FrameworkBase.Stages;
 using Microwalk.FrameworkBase.TraceFormat;
+using Microwalk.FrameworkBase.Utilities;
 
 namespace Microwalk.TracePreprocessing.Modules
 {
@@ -16,6 +17,7 @@ namespace Microwalk.TracePreprocessing.Modules
         private DirectoryInfo _inputDirectory = null!;
         private TracePrefixFile _tracePrefix = null!;
         private bool _loadLazily;
+        private bool _memoryMap;
 
         protected override async Task InitAsync(MappingNode? moduleOptions)
         {
@@ -31,6 +33,9 @@ namespace Microwalk.TracePreprocessing.Modules
             // Lazy loading?
             _loadLazily = moduleOptions.GetChildNodeOrDefault("lazy")?.AsBoolean() ?? true;
 
+            // Map trace files into memory?
+            _memoryMap = moduleOptions.GetChildNodeOrDefault("memory-map")?.AsBoolean() ?? false;
+
             // Try to load prefix file
             string preprocessedPrefixFilePath = Path.Combine(_inputDirectory.FullName, "prefix.trace.preprocessed");
             if(!File.Exists(preprocessedPrefixFilePath))
@@ -40,7 +45,10 @@ namespace Microwalk.TracePreprocessing.Modules
             }
 
             var bytes = await File.ReadAllBytesAsync(preprocessedPrefixFilePath);
-            _tracePrefix = new TracePrefixFile(bytes);
+            _tracePrefix = new TracePrefixFile(bytes)
+            {
+                CallStacks = await LoadCallStacksAsync(_inputDirectory)
+            };
         }
 
         public override Task UnInitAsync()
@@ -61,7 +69,12 @@ namespace Microwalk.TracePreprocessing.Modules
             traceEntity.PreprocessedTraceFilePath = preprocessedTraceFilePath;
 
             // Load trace
-            if(_loadLazily)
+            if(_memoryMap && MappedFileMemory.CanMap(preprocessedTraceFilePath))
+            {
+                var mappedFile = new MappedFileMemory(preprocessedTraceFilePath);
+                traceEntity.PreprocessedTraceFile = new TraceFile(_tracePrefix, mappedFile.Memory, mappedFile);
+            }
+            else if(_loadLazily)
             {
                 traceEntity.PreprocessedTraceFile = new TraceFile(_tracePrefix, preprocessedTraceFilePath);
             }
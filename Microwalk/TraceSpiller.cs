@@ -0,0 +1,196 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading;
+using System.Threading.Tasks;
+using Microwalk.FrameworkBase;
+using Microwalk.FrameworkBase.Configuration;
+using Microwalk.FrameworkBase.Exceptions;
+using Microwalk.FrameworkBase.TraceFormat;
+
+namespace Microwalk;
+
+/// <summary>
+/// Limits the amount of preprocessed trace data which is held in memory while traces wait for or undergo analysis.
+///
+/// Preprocessed traces are admitted after preprocessing. If a trace does not fit into the remaining memory budget, its data is written to a scratch
+/// directory, and the analysis stage reads it lazily from there. Since traces are analyzed in order, the most recently preprocessed trace is the one
+/// which is needed last, so the trace being admitted is always the one that is spilled.
+/// </summary>
+internal class TraceSpiller : IDisposable
+{
+    private readonly ILogger _logger;
+
+    /// <summary>
+    /// Maximum number of bytes of trace data which may be held in memory.
+    /// </summary>
+    private readonly long _memoryBudget;
+
+    /// <summary>
+    /// Directory receiving the spilled traces.
+    /// </summary>
+    private readonly DirectoryInfo _spillDirectory;
+
+    /// <summary>
+    /// Determines whether the spill directory was created by this object and should be removed on disposal.
+    /// </summary>
+    private readonly bool _deleteSpillDirectory;
+
+    /// <summary>
+    /// State of the traces which were admitted, but not yet released, indexed by testcase ID.
+    /// </summary>
+    private readonly Dictionary<int, (long residentBytes, string? spillFilePath)> _traces = new();
+
+    /// <summary>
+    /// Number of bytes of trace data which is currently held in memory.
+    /// </summary>
+    private long _residentBytes;
+
+    private long _peakResidentBytes;
+    private int _spillCount;
+    private long _spilledBytes;
+    private int _reloadCount;
+
+    /// <summary>
+    /// Creates a new trace spiller with the given configuration.
+    /// </summary>
+    /// <param name="memoryBudget">Maximum number of bytes of trace data which may be held in memory.</param>
+    /// <param name="spillDirectoryPath">Directory for spilled traces. If null, a temporary directory is used.</param>
+    /// <param name="logger">Logger.</param>
+    private TraceSpiller(long memoryBudget, string? spillDirectoryPath, ILogger logger)
+    {
+        _logger = logger;
+        _memoryBudget = memoryBudget;
+
+        if(spillDirectoryPath != null)
+        {
+            _spillDirectory = Directory.CreateDirectory(spillDirectoryPath);
+        }
+        else
+        {
+            _spillDirectory = Directory.CreateTempSubdirectory("microwalk-spill-");
+            _deleteSpillDirectory = true;
+        }
+    }
+
+    /// <summary>
+    /// Creates a trace spiller from the given preprocessor stage options, or returns null if no memory budget is configured.
+    /// </summary>
+    /// <param name="preprocessorStageOptions">Preprocessor stage options. May be null.</param>
+    /// <param name="logger">Logger.</param>
+    public static TraceSpiller? Create(MappingNode? preprocessorStageOptions, ILogger logger)
+    {
+        var memoryBudgetNode = preprocessorStageOptions?.GetChildNodeOrDefault("memory-budget");
+        if(memoryBudgetNode == null)
+            return null;
+
+        int memoryBudgetMegabytes = memoryBudgetNode.AsInteger();
+        if(memoryBudgetMegabytes < 0)
+            throw new ConfigurationException("The trace memory budget must not be negative.");
+
+        string? spillDirectoryPath = preprocessorStageOptions!.GetChildNodeOrDefault("spill-directory")?.AsString();
+        return new TraceSpiller((long)memoryBudgetMegabytes * 1024 * 1024, spillDirectoryPath, logger);
+    }
+
+    /// <summary>
+    /// Number of traces which were spilled to disk.
+    /// </summary>
+    public int SpillCount => Volatile.Read(ref _spillCount);
+
+    /// <summary>
+    /// Number of bytes which were spilled to disk.
+    /// </summary>
+    public long SpilledBytes => Interlocked.Read(ref _spilledBytes);
+
+    /// <summary>
+    /// Number of times an analysis module read a spilled trace back from disk.
+    /// </summary>
+    public int ReloadCount => Volatile.Read(ref _reloadCount);
+
+    /// <summary>
+    /// Maximum number of bytes of trace data which was held in memory at once.
+    /// </summary>
+    public long PeakResidentBytes => Interlocked.Read(ref _peakResidentBytes);
+
+    /// <summary>
+    /// Accounts for the given freshly preprocessed trace, and spills it to disk if it does not fit into the memory budget.
+    /// </summary>
+    /// <param name="traceEntity">Trace entity.</param>
+    public async Task AdmitAsync(TraceEntity traceEntity)
+    {
+        var traceFile = traceEntity.PreprocessedTraceFile;
+        long traceSize = traceFile?.ManagedBufferSize ?? 0;
+        if(traceSize == 0)
+            return;
+
+        lock(_traces)
+        {
+            if(_residentBytes + traceSize <= _memoryBudget)
+            {
+                _residentBytes += traceSize;
+                if(_residentBytes > _peakResidentBytes)
+                    _peakResidentBytes = _residentBytes;
+                _traces.Add(traceEntity.Id, (traceSize, null));
+                return;
+            }
+        }
+
+        // Reuse the copy written by the preprocessor, if there is one
+        if(traceEntity.PreprocessedTraceFilePath != null && File.Exists(traceEntity.PreprocessedTraceFilePath))
+        {
+            traceEntity.PreprocessedTraceFile = new TraceFile(traceFile!.Prefix!, traceEntity.PreprocessedTraceFilePath);
+            lock(_traces)
+                _traces.Add(traceEntity.Id, (0, null));
+        }
+        else
+        {
+            string spillFilePath = Path.Combine(_spillDirectory.FullName, $"t{traceEntity.Id}.trace.preprocessed");
+            traceEntity.PreprocessedTraceFile = await traceFile!.SpillAsync(spillFilePath);
+            lock(_traces)
+                _traces.Add(traceEntity.Id, (0, spillFilePath));
+        }
+
+        Interlocked.Increment(ref _spillCount);
+        Interlocked.Add(ref _spilledBytes, traceSize);
+        await _logger.LogDebugAsync($"[spill] Trace #{traceEntity.Id} exceeds the memory budget, moved {traceSize} bytes to disk");
+    }
+
+    /// <summary>
+    /// Records that the given trace is about to be read by the given number of analysis modules.
+    /// </summary>
+    /// <param name="traceEntity">Trace entity.</param>
+    /// <param name="readerCount">Number of analysis modules.</param>
+    public void BeginAnalysis(TraceEntity traceEntity, int readerCount)
+    {
+        bool spilled;
+        lock(_traces)
+            spilled = _traces.TryGetValue(traceEntity.Id, out var trace) && trace.residentBytes == 0;
+
+        if(spilled)
+            Interlocked.Add(ref _reloadCount, readerCount);
+    }
+
+    /// <summary>
+    /// Releases the memory budget and the spill file of the given trace, after it was analyzed.
+    /// </summary>
+    /// <param name="traceEntity">Trace entity.</param>
+    public void Release(TraceEntity traceEntity)
+    {
+        (long residentBytes, string? spillFilePath) trace;
+        lock(_traces)
+        {
+            if(!_traces.Remove(traceEntity.Id, out trace))
+                return;
+            _residentBytes -= trace.residentBytes;
+        }
+
+        if(trace.spillFilePath != null)
+            File.Delete(trace.spillFilePath);
+    }
+
+    public void Dispose()
+    {
+        if(_deleteSpillDirectory)
+            _spillDirectory.Delete(true);
+    }
+}
\ No newline at end of file
@@ -28,8 +28,9 @@ TraceWriter::TraceWriter(const std::string& filenamePrefix)
 
 TraceWriter::~TraceWriter()
 {
-    // Close file stream
-    _outputFileStream.close();
+    // Close file stream (closing an already closed stream would trigger a failbit exception)
+    if(_outputFileStream.is_open())
+        _outputFileStream.close();
 }
 
 void TraceWriter::InitPrefixMode(const std::string& filenamePrefix)
@@ -118,7 +119,7 @@ void TraceWriter::TestcaseEnd(TraceEntry* nextEntry)
     else
     {
         // Notify caller that the trace file is complete
-		std::cout << "t\t" << _currentOutputFilename << std::endl;
+		std::cout << "t\t" << _currentOutputFilename << "\t" << std::dec << _testcaseId << std::endl;
     }
 
     // Disable tracing until next test case starts
@@ -148,6 +148,7 @@ public:
     void TestcaseStart(int testcaseId, TraceEntry* nextEntry);
 
     // Closes the current trace file and notifies the caller that the testcase has completed.
+    // The notification is a line "t\t<trace file path>\t<testcase ID>" on stdout.
     void TestcaseEnd(TraceEntry* nextEntry);
 
 public:
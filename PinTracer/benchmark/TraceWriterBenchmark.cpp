@@ -0,0 +1,210 @@
+/*
+Native microbenchmark for the TraceWriter insert, flush and testcase switch paths.
+The writer is driven exactly like the instrumentation code in PinTracer.cpp does it, i.e., by threading the next entry pointer
+through the static Insert*Entry functions.
+*/
+
+
+/* INCLUDES */
+
+#include "../TraceWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/* TYPES */
+
+using Clock = std::chrono::steady_clock;
+
+// Discards everything written to it, so the progress messages of the trace writer do not distort the measurements.
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        return count;
+    }
+};
+
+
+/* GLOBAL VARIABLES */
+
+// Latencies of all insert calls that triggered a buffer flush, in nanoseconds.
+static std::vector<double> _flushLatencies;
+
+
+/* FUNCTIONS */
+
+// Returns the seconds elapsed since the given point in time.
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Prints the throughput of a stream benchmark.
+static void PrintThroughput(const char* name, uint64_t entryCount, double seconds)
+{
+    double megabytes = static_cast<double>(entryCount * sizeof(TraceEntry)) / (1024 * 1024);
+    printf("%-24s %12.0f entries/s %10.1f MB/s (%.3f s)\n", name, entryCount / seconds, megabytes / seconds, seconds);
+}
+
+// Prints the distribution of the given latencies.
+static void PrintLatencyDistribution(const char* name, std::vector<double>& latencies)
+{
+    if(latencies.empty())
+    {
+        printf("%-24s no samples\n", name);
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+    printf("%-24s n=%zu min=%.1f us p50=%.1f us p90=%.1f us p99=%.1f us max=%.1f us\n",
+           name, latencies.size(),
+           latencies.front() / 1000, percentile(0.5) / 1000, percentile(0.9) / 1000, percentile(0.99) / 1000, latencies.back() / 1000);
+}
+
+// Records the latency of an insert call, if it caused the buffer to be flushed.
+static inline void RecordFlush(TraceWriter* traceWriter, TraceEntry* nextEntry, Clock::time_point start)
+{
+    if(nextEntry == traceWriter->Begin())
+        _flushLatencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+}
+
+// Writes a stream of memory accesses, with 90% reads and 10% writes.
+static TraceEntry* RunReadHeavyStream(TraceWriter* traceWriter, TraceEntry* nextEntry, uint64_t entryCount)
+{
+    for(uint64_t i = 0; i < entryCount; ++i)
+    {
+        ADDRINT instructionAddress = 0x401000 + (i % 64) * 4;
+        ADDRINT memoryAddress = 0x7ff000000000 + ((i * 2654435761u) & 0xffff);
+
+        // Only measure the calls which hit the flush path, the other ones are too short for the clock
+        bool mayFlush = nextEntry + 1 == traceWriter->End();
+        Clock::time_point start;
+        if(mayFlush)
+            start = Clock::now();
+
+        if(i % 10 == 0)
+            nextEntry = TraceWriter::InsertMemoryWriteEntry(traceWriter, nextEntry, instructionAddress, memoryAddress, 4);
+        else
+            nextEntry = TraceWriter::InsertMemoryReadEntry(traceWriter, nextEntry, instructionAddress, memoryAddress, 4);
+
+        if(mayFlush)
+            RecordFlush(traceWriter, nextEntry, start);
+    }
+
+    return nextEntry;
+}
+
+// Writes a stream which resembles typical library code: Branches, calls/returns, memory accesses and some heap allocations.
+static TraceEntry* RunMixedStream(TraceWriter* traceWriter, TraceEntry* nextEntry, uint64_t entryCount)
+{
+    uint64_t i = 0;
+    while(i < entryCount)
+    {
+        ADDRINT base = 0x401000 + (i % 256) * 16;
+        switch(i % 16)
+        {
+            case 0:
+                nextEntry = TraceWriter::InsertBranchEntry(traceWriter, nextEntry, base, base + 0x100, 1, static_cast<UINT8>(TraceEntryFlags::BranchTypeCall));
+                nextEntry = TraceWriter::InsertStackPointerModificationEntry(traceWriter, nextEntry, base, 0x7ffe0000 - (i % 32) * 8, static_cast<UINT8>(TraceEntryFlags::StackIsCall));
+                i += 2;
+                break;
+            case 7:
+                nextEntry = TraceWriter::InsertHeapAllocSizeParameterEntry(traceWriter, nextEntry, 64 + (i % 128));
+                nextEntry = TraceWriter::InsertHeapAllocAddressReturnEntry(traceWriter, nextEntry, 0x5555000000 + i * 64);
+                nextEntry = TraceWriter::InsertHeapFreeAddressParameterEntry(traceWriter, nextEntry, 0x5555000000 + i * 64);
+                i += 3;
+                break;
+            case 15:
+                nextEntry = TraceWriter::InsertRetBranchEntry(traceWriter, nextEntry, base + 0x1f0, base + 5);
+                ++i;
+                break;
+            default:
+                if(i % 3 == 0)
+                    nextEntry = TraceWriter::InsertBranchEntry(traceWriter, nextEntry, base + 8, base + 0x20, i % 2, static_cast<UINT8>(TraceEntryFlags::BranchTypeJump));
+                else
+                    nextEntry = TraceWriter::InsertMemoryReadEntry(traceWriter, nextEntry, base + 4, 0x7ff000000000 + (i & 0xfff), 8);
+                ++i;
+                break;
+        }
+    }
+
+    return nextEntry;
+}
+
+// Benchmark entry point.
+// Parameters: [output directory] [entry count]
+int main(int argc, const char** argv)
+{
+    std::string outputDirectory = argc > 1 ? argv[1] : "/tmp";
+    uint64_t entryCount = argc > 2 ? std::stoull(argv[2]) : 50'000'000;
+    const int testcaseCount = 1000;
+    std::string outputPrefix = outputDirectory + "/";
+
+    // Silence trace writer output
+    NullBuffer nullBuffer;
+    std::streambuf* stdoutBuffer = std::cout.rdbuf(&nullBuffer);
+    std::streambuf* stderrBuffer = std::cerr.rdbuf(&nullBuffer);
+
+    // Initialize writer like the Pin tool does it, and finish the prefix
+    TraceWriter::InitPrefixMode(outputPrefix);
+    auto traceWriter = std::make_unique<TraceWriter>(outputPrefix);
+    TraceEntry* nextEntry = traceWriter->Begin();
+    traceWriter->TestcaseStart(0, nextEntry);
+
+    // Read-heavy stream
+    auto start = Clock::now();
+    nextEntry = RunReadHeavyStream(traceWriter.get(), nextEntry, entryCount);
+    traceWriter->TestcaseEnd(nextEntry);
+    double readHeavySeconds = SecondsSince(start);
+
+    // Mixed stream
+    nextEntry = traceWriter->Begin();
+    traceWriter->TestcaseStart(1, nextEntry);
+    start = Clock::now();
+    nextEntry = RunMixedStream(traceWriter.get(), nextEntry, entryCount);
+    traceWriter->TestcaseEnd(nextEntry);
+    double mixedSeconds = SecondsSince(start);
+
+    // Testcase switches with small traces
+    std::vector<double> switchLatencies;
+    switchLatencies.reserve(testcaseCount);
+    for(int t = 0; t < testcaseCount; ++t)
+    {
+        start = Clock::now();
+        nextEntry = traceWriter->Begin();
+        traceWriter->TestcaseStart(2, nextEntry);
+        nextEntry = TraceWriter::InsertMemoryReadEntry(traceWriter.get(), nextEntry, 0x401000, 0x7ff000000000, 4);
+        traceWriter->TestcaseEnd(nextEntry);
+        switchLatencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+
+    std::cout.rdbuf(stdoutBuffer);
+    std::cerr.rdbuf(stderrBuffer);
+
+    // Print results
+    printf("TraceWriter benchmark: %llu entries per stream, buffer size %d entries\n", static_cast<unsigned long long>(entryCount), ENTRY_BUFFER_SIZE);
+    PrintThroughput("read-heavy stream", entryCount, readHeavySeconds);
+    PrintThroughput("mixed stream", entryCount, mixedSeconds);
+    PrintLatencyDistribution("buffer flush", _flushLatencies);
+    PrintLatencyDistribution("testcase switch", switchLatencies);
+
+    // Clean up
+    traceWriter.reset();
+    for(const char* name : { "prefix.trace", "prefix_data.txt", "t0.trace", "t1.trace", "t2.trace" })
+        std::remove((outputPrefix + name).c_str());
+
+    return 0;
+}
@@ -11,8 +11,37 @@ which helps reading the resulting call tree.
 
 // Switch for benchmarking code.
 // Uncommenting this enables a target which is designed to generate large traces, which take a long preprocessing and analysis time.
+// The concrete workload is selected through BENCHMARK_KERNEL (e.g., `-DBENCHMARK_KERNEL=3`), see the list below.
+// The script in benchmark/ builds all kernels and runs them through the entire pipeline.
 #define BENCHMARK
 
+#if defined(BENCHMARK)
+    // Writes into a small table at secret-dependent offsets (the original benchmark workload).
+    #define BENCHMARK_KERNEL_TABLE_WRITE 0
+
+    // Memory-bound table lookups at secret-dependent offsets, similar to a T-table AES implementation.
+    #define BENCHMARK_KERNEL_TABLE_LOOKUP 1
+
+    // Branch-heavy multi-precision arithmetic (square-and-multiply with secret-dependent branches).
+    #define BENCHMARK_KERNEL_BIGNUM 2
+
+    // Lots of small heap allocations and deallocations with secret-dependent sizes.
+    #define BENCHMARK_KERNEL_ALLOCATIONS 3
+
+    // Deep recursive call stacks with a secret-dependent depth.
+    #define BENCHMARK_KERNEL_CALL_STACK 4
+
+    // Large memcpy()/memset() operations with secret-dependent offsets and lengths.
+    #define BENCHMARK_KERNEL_MEMCPY 5
+
+    // Table lookups distributed over several worker threads (only the main thread is traced).
+    #define BENCHMARK_KERNEL_THREADS 6
+
+    #ifndef BENCHMARK_KERNEL
+        #define BENCHMARK_KERNEL BENCHMARK_KERNEL_TABLE_WRITE
+    #endif
+#endif
+
 /* INCLUDES */
 
 // OS-specific imports and helper macros
@@ -21,6 +50,8 @@ which helps reading the resulting call tree.
     
     #define WIN32_LEAN_AND_MEAN
     #include <Windows.h>
+    #include <io.h>
+    #include <fcntl.h>
     
     #define _EXPORT __declspec(dllexport)
     #define _NOINLINE __declspec(noinline)
@@ -33,11 +64,18 @@ which helps reading the resulting call tree.
     #define _NOINLINE __attribute__((noinline))
     
     #include <sys/resource.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #endif
 
 // *** TODO REFERENCE INVESTIGATED LIBRARY [
 #if defined(BENCHMARK)
-
+    #if BENCHMARK_KERNEL == BENCHMARK_KERNEL_THREADS
+        #include <thread>
+        #include <vector>
+    #endif
 #elif defined(_WIN32)
     #pragma comment(lib, "bcrypt.lib")
     #include <bcrypt.h>
@@ -67,8 +105,198 @@ which helps reading the resulting call tree.
     // Empty
 #endif
 
+// A command received from the trace generator, see ReadCommand().
+struct Command
+{
+    // 't' (testcase file), 'm' (testcase in shared memory arena), 'r' (generated testcases), or 0 (invalid command).
+    char Type;
+
+    // The ID of the (first) testcase.
+    int TestcaseId;
+
+    // The number of testcases.
+    int TestcaseCount;
+
+    // The testcase file path ('t').
+    char Path[512];
+
+    // The testcase offset in the shared memory arena ('m').
+    uint64_t ArenaOffset;
+
+    // The testcase length ('m', 'r').
+    uint32_t Length;
+
+    // Seed and index of the first generated testcase ('r').
+    uint64_t Seed;
+    uint64_t Index;
+};
+
+
+/* GLOBAL VARIABLES */
+
+// Shared memory arena, where the trace generator may place testcases (see ReadCommand()).
+static uint8_t* _testcaseArena = nullptr;
+static uint64_t _testcaseArenaSize = 0;
+
+
 /* FUNCTIONS */
 
+#if defined(BENCHMARK)
+
+// Benchmark kernels.
+// Each kernel receives 32 bytes of testcase data and should produce a trace of several 100k entries.
+
+// Fills a lookup table with pseudo-random values, so lookups cannot be optimized away.
+static void InitBenchmarkTable(uint32_t* table, int count)
+{
+    uint32_t state = 0x12345678;
+    for(int i = 0; i < count; ++i)
+    {
+        state = state * 1664525 + 1013904223;
+        table[i] = state;
+    }
+}
+
+_EXPORT _NOINLINE void BenchmarkTableWrite(const uint8_t* data)
+{
+    int* buffer = static_cast<int*>(calloc(256, sizeof(int)));
+    for(int i = 0; i < 1024 * 256; ++i)
+        buffer[data[i % 32]] = i;
+    free(buffer);
+}
+
+_EXPORT _NOINLINE void BenchmarkTableLookup(const uint8_t* data)
+{
+    // Four 1 KB tables, as in a T-table AES
+    uint32_t* tables = static_cast<uint32_t*>(malloc(4 * 256 * sizeof(uint32_t)));
+    InitBenchmarkTable(tables, 4 * 256);
+
+    uint32_t state[4];
+    memcpy(state, data, sizeof(state));
+    for(int round = 0; round < 16 * 1024; ++round)
+    {
+        uint32_t s0 = tables[0 * 256 + (state[0] & 0xff)] ^ tables[1 * 256 + ((state[1] >> 8) & 0xff)] ^ tables[2 * 256 + ((state[2] >> 16) & 0xff)] ^ tables[3 * 256 + (state[3] >> 24)];
+        uint32_t s1 = tables[0 * 256 + (state[1] & 0xff)] ^ tables[1 * 256 + ((state[2] >> 8) & 0xff)] ^ tables[2 * 256 + ((state[3] >> 16) & 0xff)] ^ tables[3 * 256 + (state[0] >> 24)];
+        uint32_t s2 = tables[0 * 256 + (state[2] & 0xff)] ^ tables[1 * 256 + ((state[3] >> 8) & 0xff)] ^ tables[2 * 256 + ((state[0] >> 16) & 0xff)] ^ tables[3 * 256 + (state[1] >> 24)];
+        uint32_t s3 = tables[0 * 256 + (state[3] & 0xff)] ^ tables[1 * 256 + ((state[0] >> 8) & 0xff)] ^ tables[2 * 256 + ((state[1] >> 16) & 0xff)] ^ tables[3 * 256 + (state[2] >> 24)];
+        state[0] = s0;
+        state[1] = s1;
+        state[2] = s2;
+        state[3] = s3;
+    }
+
+    free(tables);
+}
+
+// Multiplies two 256-bit numbers modulo 2^256 (schoolbook multiplication on 32-bit limbs).
+_EXPORT _NOINLINE void BenchmarkBignumMultiply(uint32_t* result, const uint32_t* a, const uint32_t* b)
+{
+    uint32_t tmp[8] = { 0 };
+    for(int i = 0; i < 8; ++i)
+    {
+        uint64_t carry = 0;
+        for(int j = 0; i + j < 8; ++j)
+        {
+            uint64_t product = static_cast<uint64_t>(a[i]) * b[j] + tmp[i + j] + carry;
+            tmp[i + j] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+    }
+    memcpy(result, tmp, sizeof(tmp));
+}
+
+_EXPORT _NOINLINE void BenchmarkBignum(const uint8_t* data)
+{
+    // Square-and-multiply, where the exponent is the testcase data
+    uint32_t base[8];
+    uint32_t result[8] = { 1 };
+    memcpy(base, data, sizeof(base));
+    for(int iteration = 0; iteration < 16; ++iteration)
+    {
+        for(int i = 0; i < 32 * 8; ++i)
+        {
+            BenchmarkBignumMultiply(result, result, result);
+            if((data[i / 8] >> (i % 8)) & 1)
+                BenchmarkBignumMultiply(result, result, base);
+        }
+    }
+}
+
+_EXPORT _NOINLINE void BenchmarkAllocations(const uint8_t* data)
+{
+    // Keep a sliding window of live blocks, so the allocation lookup in the preprocessor is not trivial
+    const int liveBlockCount = 512;
+    uint8_t* blocks[liveBlockCount] = { nullptr };
+    for(int i = 0; i < 64 * 1024; ++i)
+    {
+        int slot = (i * 7 + data[i % 32]) % liveBlockCount;
+        free(blocks[slot]);
+
+        size_t size = 16 + data[(i + 1) % 32];
+        blocks[slot] = static_cast<uint8_t*>(malloc(size));
+        blocks[slot][0] = static_cast<uint8_t>(i);
+        blocks[slot][size - 1] = data[i % 32];
+    }
+
+    for(auto& block : blocks)
+        free(block);
+}
+
+_EXPORT _NOINLINE uint32_t BenchmarkCallStackRecursion(const uint8_t* data, int depth)
+{
+    if(depth == 0)
+        return data[0];
+
+    // Use some stack memory in each frame
+    volatile uint32_t local = data[depth % 32] + depth;
+    return local + BenchmarkCallStackRecursion(data, depth - 1);
+}
+
+_EXPORT _NOINLINE void BenchmarkCallStack(const uint8_t* data)
+{
+    volatile uint32_t sum = 0;
+    for(int i = 0; i < 4 * 1024; ++i)
+        sum = sum + BenchmarkCallStackRecursion(data, 16 + (data[i % 32] % 48));
+}
+
+_EXPORT _NOINLINE void BenchmarkMemcpy(const uint8_t* data)
+{
+    const int bufferSize = 64 * 1024;
+    uint8_t* source = static_cast<uint8_t*>(malloc(bufferSize));
+    uint8_t* destination = static_cast<uint8_t*>(malloc(bufferSize));
+    memset(source, 0x55, bufferSize);
+
+    for(int i = 0; i < 256; ++i)
+    {
+        int offset = data[i % 32] * 64;
+        int length = 1024 + data[(i + 1) % 32] * 128;
+        memcpy(destination + offset, source + (bufferSize - offset - length), length);
+        memset(source + offset, data[i % 32], length / 2);
+    }
+
+    free(source);
+    free(destination);
+}
+
+#if BENCHMARK_KERNEL == BENCHMARK_KERNEL_THREADS
+_EXPORT _NOINLINE void BenchmarkThreads(const uint8_t* data)
+{
+    // The worker threads are not traced by Pin, but add contention and instrumentation overhead
+    const int workerCount = 4;
+    std::vector<std::thread> workers;
+    for(int w = 0; w < workerCount; ++w)
+        workers.emplace_back(BenchmarkTableLookup, data);
+
+    // The main thread does the same work
+    BenchmarkTableLookup(data);
+
+    for(auto& worker : workers)
+        worker.join();
+}
+#endif
+
+#endif
+
 // Performs target initialization steps.
 // This function is called once in the very beginning, to make sure that the target is entirely loaded.
 // The call is included into the trace prefix.
@@ -104,9 +332,23 @@ _EXPORT _NOINLINE void RunTarget(FILE* input)
     if(fread(data, 1, 32, input) != 32)
         return;
 
-    int* buffer = static_cast<int *>(calloc(256, sizeof(int)));
-    for(int i = 0; i < 1024 * 256; ++i)
-        buffer[data[i % 32]] = i;
+    #if BENCHMARK_KERNEL == BENCHMARK_KERNEL_TABLE_WRITE
+        BenchmarkTableWrite(data);
+    #elif BENCHMARK_KERNEL == BENCHMARK_KERNEL_TABLE_LOOKUP
+        BenchmarkTableLookup(data);
+    #elif BENCHMARK_KERNEL == BENCHMARK_KERNEL_BIGNUM
+        BenchmarkBignum(data);
+    #elif BENCHMARK_KERNEL == BENCHMARK_KERNEL_ALLOCATIONS
+        BenchmarkAllocations(data);
+    #elif BENCHMARK_KERNEL == BENCHMARK_KERNEL_CALL_STACK
+        BenchmarkCallStack(data);
+    #elif BENCHMARK_KERNEL == BENCHMARK_KERNEL_MEMCPY
+        BenchmarkMemcpy(data);
+    #elif BENCHMARK_KERNEL == BENCHMARK_KERNEL_THREADS
+        BenchmarkThreads(data);
+    #else
+        #error Unknown benchmark kernel.
+    #endif
 
 #elif defined(_WIN32)
 	BYTE secret_key[16];
@@ -161,12 +403,20 @@ _EXPORT _NOINLINE void RunTarget(FILE* input)
 // Pin notification functions.
 // These functions (and their names) must not be optimized away by the compiler, so Pin can find and instrument them.
 // The return values reduce the probability that the compiler uses these function in other places as no-ops (Visual C++ did do this in some experiments).
+// When building for the compiler-instrumentation tracer (see CompilerTracer/), these functions are provided by the tracer runtime instead.
+#ifdef MICROWALK_COMPILER_TRACER
+extern "C" int PinNotifyTestcaseStart(int t);
+extern "C" int PinNotifyTestcaseEnd();
+extern "C" int PinNotifyStackPointer(uint64_t spMin, uint64_t spMax);
+extern "C" int PinNotifyAllocation(uint64_t address, uint64_t size);
+#else
 #pragma optimize("", off)
 extern "C" _EXPORT _NOINLINE int PinNotifyTestcaseStart(int t) { return t + 42; }
 extern "C" _EXPORT _NOINLINE int PinNotifyTestcaseEnd() { return 42; }
 extern "C" _EXPORT _NOINLINE int PinNotifyStackPointer(uint64_t spMin, uint64_t spMax) { return static_cast<int>(spMin + spMax + 42); }
 extern "C" _EXPORT _NOINLINE int PinNotifyAllocation(uint64_t address, uint64_t size) { return (int)(address + 23 * size); }
 #pragma optimize("", on)
+#endif
 
 // Reads the stack pointer base value and transmits it to Pin.
 _EXPORT void ReadAndSendStackPointer()
@@ -198,10 +448,186 @@ _EXPORT void ReadAndSendStackPointer()
 #endif
 }
 
+// Decodes a little endian integer with the given number of bytes.
+static uint64_t DecodeLittleEndian(const uint8_t* bytes, int count)
+{
+    uint64_t value = 0;
+    for(int i = count - 1; i >= 0; --i)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+// Maps the testcase arena file which is passed by the trace generator, if any.
+static void MapTestcaseArena()
+{
+#if !defined(_WIN32)
+    const char* arenaPath = getenv("MICROWALK_TESTCASE_ARENA");
+    if(arenaPath == nullptr)
+        return;
+
+    int arenaFile = open(arenaPath, O_RDONLY);
+    struct stat arenaFileInfo;
+    if(arenaFile < 0 || fstat(arenaFile, &arenaFileInfo) != 0)
+    {
+        fprintf(stderr, "Error opening testcase arena '%s': [%d] %s\n", arenaPath, errno, strerror(errno));
+        exit(1);
+    }
+
+    void* arena = mmap(nullptr, arenaFileInfo.st_size, PROT_READ, MAP_SHARED, arenaFile, 0);
+    close(arenaFile);
+    if(arena == MAP_FAILED)
+    {
+        fprintf(stderr, "Error mapping testcase arena '%s': [%d] %s\n", arenaPath, errno, strerror(errno));
+        exit(1);
+    }
+
+    _testcaseArena = static_cast<uint8_t*>(arena);
+    _testcaseArenaSize = arenaFileInfo.st_size;
+#endif
+}
+
+// Generates a deterministic pseudo-random testcase with the given seed and index.
+// The i-th 8-byte block is the SplitMix64 output function applied to seed + index * 0xD1B54A32D192ED03 + (i + 1) * 0x9E3779B97F4A7C15, in little endian byte order.
+// This must match the implementation in Microwalk's DeterministicTestcase class.
+static void GenerateTestcase(uint64_t seed, uint64_t index, uint8_t* output, uint32_t length)
+{
+    uint64_t counterBase = seed + index * 0xD1B54A32D192ED03ull;
+    for(uint32_t i = 0; i < length; i += 8)
+    {
+        uint64_t z = counterBase + static_cast<uint64_t>(i / 8 + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z = z ^ (z >> 31);
+
+        for(uint32_t j = 0; j < 8 && i + j < length; ++j)
+            output[i + j] = static_cast<uint8_t>(z >> (8 * j));
+    }
+}
+
+// Reads the next command from stdin. Two encodings are supported, which can be distinguished by their first byte:
+//     Text: A line with "t" followed by a numeric ID, and another line with a file path determining a new testcase; or a line with "e 0".
+//     Binary: A command byte, followed by a 32-bit little endian payload length and the payload. All integers are little endian.
+//         'T': Testcase file. The payload consists of the 32-bit testcase ID and the file path (without null terminator).
+//         'M': Testcase in shared memory arena. The payload consists of the 32-bit testcase ID, the 64-bit arena offset and the 32-bit length.
+//         'R': Range of generated testcases (see GenerateTestcase()). The payload consists of the 32-bit ID of the first testcase, the 32-bit testcase count,
+//              the 64-bit seed, the 64-bit index of the first testcase, and the 32-bit testcase length. IDs and indices are consecutive.
+//         'E': Exit, no payload.
+// The binary encoding allows the trace generator to queue several testcases at once.
+// Returns false if the program should exit (exit command, or stdin was closed).
+static bool ReadCommand(Command* command)
+{
+    command->Type = 0;
+    int firstByte = fgetc(stdin);
+    if(firstByte == EOF)
+        return false;
+
+    if(firstByte == 'T' || firstByte == 'M' || firstByte == 'R' || firstByte == 'E')
+    {
+        // Binary command
+        uint8_t payload[4 + 4 + 8 + 8 + 4];
+        if(fread(payload, 1, 4, stdin) != 4)
+            return false;
+        uint32_t payloadLength = static_cast<uint32_t>(DecodeLittleEndian(payload, 4));
+
+        if(firstByte == 'E')
+            return false;
+
+        // Testcase ID
+        if(payloadLength < 4 || fread(payload, 1, 4, stdin) != 4)
+            return false;
+        command->TestcaseId = static_cast<int>(DecodeLittleEndian(payload, 4));
+        command->TestcaseCount = 1;
+
+        if(firstByte == 'M')
+        {
+            if(payloadLength != 4 + 8 + 4 || fread(payload + 4, 1, 8 + 4, stdin) != 8 + 4)
+                return false;
+            command->Type = 'm';
+            command->ArenaOffset = DecodeLittleEndian(payload + 4, 8);
+            command->Length = static_cast<uint32_t>(DecodeLittleEndian(payload + 12, 4));
+            return true;
+        }
+
+        if(firstByte == 'R')
+        {
+            if(payloadLength != sizeof(payload) || fread(payload + 4, 1, sizeof(payload) - 4, stdin) != sizeof(payload) - 4)
+                return false;
+            command->Type = 'r';
+            command->TestcaseCount = static_cast<int>(DecodeLittleEndian(payload + 4, 4));
+            command->Seed = DecodeLittleEndian(payload + 8, 8);
+            command->Index = DecodeLittleEndian(payload + 16, 8);
+            command->Length = static_cast<uint32_t>(DecodeLittleEndian(payload + 24, 4));
+            return true;
+        }
+
+        uint32_t pathLength = payloadLength - 4;
+        if(pathLength >= sizeof(command->Path) || fread(command->Path, 1, pathLength, stdin) != pathLength)
+        {
+            fprintf(stderr, "Invalid testcase command (payload length %u)\n", payloadLength);
+            return false;
+        }
+        command->Path[pathLength] = '\0';
+        command->Type = 't';
+        return true;
+    }
+
+    // Text command
+    ungetc(firstByte, stdin);
+    char inputBuffer[64];
+    char commandChar = 0;
+    if(fgets(inputBuffer, sizeof(inputBuffer), stdin) == nullptr)
+        return false;
+    sscanf(inputBuffer, "%c %d", &commandChar, &command->TestcaseId);
+    if(commandChar == 'e')
+        return false;
+    if(commandChar != 't')
+        return true;
+
+    // Read testcase file name
+    if(fgets(command->Path, sizeof(command->Path), stdin) == nullptr)
+        return false;
+    int pathLength = static_cast<int>(strlen(command->Path));
+    while(pathLength > 0 && (command->Path[pathLength - 1] == '\n' || command->Path[pathLength - 1] == '\r'))
+        command->Path[--pathLength] = '\0';
+    command->Type = 't';
+    command->TestcaseCount = 1;
+    return true;
+}
+
+// Reports to the trace generator that the given testcase could not be run, so it does not wait for its trace.
+// The record has the same layout as the trace completion records of the Pin tool ("t", trace file path, testcase ID), but starts with "f" and
+// contains an error message instead of the trace file path.
+static void ReportTestcaseFailure(int testcaseId, const char* message)
+{
+    fprintf(stdout, "f\t%s\t%d\n", message, testcaseId);
+    fflush(stdout);
+}
+
+// Runs the target function for the given testcase, which is already loaded into memory.
+static void RunTestcaseFromMemory(int testcaseId, uint8_t* data, uint32_t length)
+{
+#if defined(_WIN32)
+    fprintf(stderr, "In-memory testcases are not supported on Windows\n");
+    ReportTestcaseFailure(testcaseId, "In-memory testcases are not supported on Windows");
+#else
+    FILE* inputFile = fmemopen(data, length, "rb");
+    if(inputFile == nullptr)
+    {
+        fprintf(stderr, "Error opening in-memory testcase #%d: [%d] %s\n", testcaseId, errno, strerror(errno));
+        ReportTestcaseFailure(testcaseId, "Could not open in-memory testcase");
+        return;
+    }
+    PinNotifyTestcaseStart(testcaseId);
+    RunTarget(inputFile);
+    PinNotifyTestcaseEnd();
+    fclose(inputFile);
+#endif
+}
+
 // Main trace target function. The following actions are performed:
-//     The current action is read from stdin.
-//     A line with "t" followed by a numeric ID, and another line with a file path determining a new testcase, that is subsequently loaded and fed into the target function, while calling PinNotifyNextFile() beforehand.
-//     A line with "e 0" terminates the program.
+//     The current action is read from stdin, see ReadCommand().
+//     For each testcase, the testcase data is loaded and fed into the target function, while calling PinNotifyTestcaseStart() beforehand.
+//     An exit command terminates the program.
 extern "C" _EXPORT void TraceFunc()
 {
 	// First transmit stack pointer information
@@ -210,30 +636,53 @@ extern "C" _EXPORT void TraceFunc()
 	// Initialize target library
 	InitTarget();
 
+#if defined(_WIN32)
+    // Binary commands must not be subject to newline conversion
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+    // Shared memory testcase delivery
+    MapTestcaseArena();
+
+    // Buffer for generated testcases
+    uint8_t* generatedTestcase = nullptr;
+    uint32_t generatedTestcaseCapacity = 0;
+
     // Run until exit is requested
-    char inputBuffer[512];
+    Command command;
     char errBuffer[128];
-    while(true)
+    while(ReadCommand(&command))
     {
-        // Read command and testcase ID (0 for exit command)
-        char command;
-        int testcaseId;
-        fgets(inputBuffer, sizeof(inputBuffer), stdin);
-        sscanf(inputBuffer, "%c %d", &command, &testcaseId);
-
-        // Exit or process given testcase
-        if(command == 'e')
-            break;
-        if(command == 't')
+        if(command.Type == 'm')
+        {
+            // Testcase is in the shared memory arena
+            if(_testcaseArena == nullptr || command.ArenaOffset > _testcaseArenaSize || command.Length > _testcaseArenaSize - command.ArenaOffset)
+            {
+                fprintf(stderr, "Invalid testcase arena location %llu+%u\n", static_cast<unsigned long long>(command.ArenaOffset), command.Length);
+                ReportTestcaseFailure(command.TestcaseId, "Invalid testcase arena location");
+                continue;
+            }
+            RunTestcaseFromMemory(command.TestcaseId, _testcaseArena + command.ArenaOffset, command.Length);
+        }
+        else if(command.Type == 'r')
+        {
+            // Generate testcases (outside of the PinNotifyTestcaseStart/End calls, so this is not included in the traces)
+            if(command.Length > generatedTestcaseCapacity)
+            {
+                free(generatedTestcase);
+                generatedTestcase = static_cast<uint8_t*>(malloc(command.Length));
+                generatedTestcaseCapacity = command.Length;
+            }
+            for(int i = 0; i < command.TestcaseCount; ++i)
+            {
+                GenerateTestcase(command.Seed, command.Index + i, generatedTestcase, command.Length);
+                RunTestcaseFromMemory(command.TestcaseId + i, generatedTestcase, command.Length);
+            }
+        }
+        else if(command.Type == 't')
         {
-            // Read testcase file name
-            fgets(inputBuffer, sizeof(inputBuffer), stdin);
-            int inputFileNameLength = strlen(inputBuffer);
-            if(inputFileNameLength > 0 && inputBuffer[inputFileNameLength - 1] == '\n')
-                inputBuffer[inputFileNameLength - 1] = '\0';
-
             // Load testcase file and run target function
-            FILE* inputFile = fopen(inputBuffer, "rb");
+            FILE* inputFile = fopen(command.Path, "rb");
             if(inputFile == nullptr)
             {
 #if defined(_WIN32)
@@ -241,15 +690,18 @@ extern "C" _EXPORT void TraceFunc()
 #else
                 strerror_r(errno, errBuffer, sizeof(errBuffer));
 #endif
-                fprintf(stderr, "Error opening input file '%s': [%d] %s\n", inputBuffer, errno, errBuffer);
+                fprintf(stderr, "Error opening input file '%s': [%d] %s\n", command.Path, errno, errBuffer);
+                ReportTestcaseFailure(command.TestcaseId, "Could not open input file");
                 continue;
             }
-            PinNotifyTestcaseStart(testcaseId);
+            PinNotifyTestcaseStart(command.TestcaseId);
             RunTarget(inputFile);
             PinNotifyTestcaseEnd();
             fclose(inputFile);
         }
     }
+
+    free(generatedTestcase);
 }
 
 // Wrapper entry point.
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+
+"""
+Runs the benchmark kernels of PinTracerWrapper through the entire Microwalk pipeline and stores throughput and memory
+figures in a JSON report, which can serve as a baseline for evaluating performance changes.
+
+Each pipeline stage (trace generation, preprocessing, analysis) is executed as a separate Microwalk run, such that its
+runtime and peak memory usage can be measured in isolation.
+
+Required environment variables:
+  MICROWALK_PATH  Directory containing Microwalk.dll and the plugins.
+  PINTOOL         Path to the compiled PinTracer tool (PinTracer.so).
+  PIN_PATH        Pin root directory.
+"""
+
+import argparse
+import datetime
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+# Kernel IDs, must match the BENCHMARK_KERNEL_* definitions in PinTracerWrapper.cpp
+KERNELS = {
+    "table-write": 0,
+    "table-lookup": 1,
+    "bignum": 2,
+    "allocations": 3,
+    "call-stack": 4,
+    "memcpy": 5,
+    "threads": 6,
+}
+
+# Pipeline stages and their respective configuration files
+STAGES = ["trace", "preprocess", "analysis"]
+
+# Size of a raw trace entry, as written by the Pin tool
+RAW_TRACE_ENTRY_SIZE = 24
+
+THIS_DIR = os.path.dirname(os.path.realpath(__file__))
+WRAPPER_SOURCE = os.path.join(THIS_DIR, "..", "PinTracerWrapper.cpp")
+
+
+def get_env(name):
+    value = os.environ.get(name)
+    if not value:
+        sys.exit(f"Missing environment variable {name}.")
+    return value
+
+
+def build_kernel(kernel_id, output_path):
+    subprocess.run(
+        ["g++", WRAPPER_SOURCE, "-o", output_path, "-O2", "-fno-split-stack", "-pthread", f"-DBENCHMARK_KERNEL={kernel_id}"],
+        check=True)
+
+
+def get_directory_size(path, suffix):
+    """ Returns the number and total size of all files in the given directory which have the given suffix. """
+
+    count = 0
+    size = 0
+    if os.path.isdir(path):
+        for entry in os.scandir(path):
+            if entry.is_file() and entry.name.endswith(suffix):
+                count += 1
+                size += entry.stat().st_size
+    return count, size
+
+
+def run_stage(microwalk_path, stage, environment):
+    """ Runs Microwalk with the configuration of the given stage, and returns wall time and peak memory usage. """
+
+    config_path = os.path.join(THIS_DIR, f"{stage}.yml")
+
+    start_time = time.perf_counter()
+    process = subprocess.Popen(["dotnet", "Microwalk.dll", config_path], cwd=microwalk_path, env=environment)
+
+    # Use wait4() to get the resource usage of this specific child
+    _, status, usage = os.wait4(process.pid, 0)
+    elapsed = time.perf_counter() - start_time
+    process.returncode = os.waitstatus_to_exitcode(status)
+    if process.returncode != 0:
+        raise RuntimeError(f"Stage '{stage}' failed with exit code {process.returncode}.")
+
+    # ru_maxrss is reported in kilobytes on Linux
+    return elapsed, usage.ru_maxrss * 1024
+
+
+def run_kernel(kernel_name, kernel_id, args, microwalk_path):
+    work_dir = os.path.join(args.work_dir, kernel_name)
+    if os.path.isdir(work_dir):
+        shutil.rmtree(work_dir)
+    os.makedirs(work_dir)
+
+    wrapper_name = "wrapper"
+    wrapper_path = os.path.join(work_dir, wrapper_name)
+    build_kernel(kernel_id, wrapper_path)
+
+    environment = dict(os.environ)
+    environment["BENCHMARK_WORK_DIR"] = work_dir
+    environment["BENCHMARK_TESTCASE_COUNT"] = str(args.testcases)
+    environment["BENCHMARK_WRAPPER"] = wrapper_path
+    environment["BENCHMARK_WRAPPER_NAME"] = wrapper_name
+
+    traces_dir = os.path.join(work_dir, "traces")
+    result = {"kernel-id": kernel_id, "stages": {}}
+    raw_entries = 0
+    for stage in STAGES:
+        print(f"[{kernel_name}] Running stage '{stage}'...", flush=True)
+        elapsed, peak_memory = run_stage(microwalk_path, stage, environment)
+
+        # Throughput is measured in terms of the traces consumed/produced by the respective stage.
+        # Entry counts always refer to the raw trace, so the numbers of all stages are comparable.
+        if stage in ("trace", "preprocess"):
+            trace_count, trace_bytes = get_directory_size(traces_dir, ".trace")
+            raw_entries = trace_bytes // RAW_TRACE_ENTRY_SIZE
+        else:
+            trace_count, trace_bytes = get_directory_size(traces_dir, ".trace.preprocessed")
+
+        # Exclude the prefix, as it is not associated with a testcase
+        trace_count = max(0, trace_count - 1)
+
+        stage_result = {
+            "seconds": elapsed,
+            "peak-memory-bytes": peak_memory,
+            "testcases": trace_count,
+            "testcases-per-minute": trace_count * 60.0 / elapsed,
+            "trace-bytes": trace_bytes,
+            "megabytes-per-second": trace_bytes / (1024 * 1024) / elapsed,
+            "raw-entries": raw_entries,
+            "entries-per-second": raw_entries / elapsed,
+        }
+        result["stages"][stage] = stage_result
+
+    if not args.keep_work_dir:
+        shutil.rmtree(work_dir)
+
+    return result
+
+
+def get_git_revision():
+    try:
+        return subprocess.run(["git", "rev-parse", "HEAD"], cwd=THIS_DIR, capture_output=True, text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Runs the PinTracerWrapper benchmark kernels through the Microwalk pipeline.")
+    parser.add_argument("-k", "--kernels", nargs="+", choices=KERNELS.keys(), default=list(KERNELS.keys()), help="Kernels to run (default: all).")
+    parser.add_argument("-n", "--testcases", type=int, default=64, help="Number of testcases per kernel.")
+    parser.add_argument("-w", "--work-dir", default=os.path.join(THIS_DIR, "work"), help="Directory for testcases, traces and results.")
+    parser.add_argument("-o", "--output", default=os.path.join(THIS_DIR, "benchmark-report.json"), help="Path of the JSON report.")
+    parser.add_argument("--keep-work-dir", action="store_true", help="Keep the generated files after each kernel run.")
+    args = parser.parse_args()
+
+    microwalk_path = get_env("MICROWALK_PATH")
+    get_env("PINTOOL")
+    get_env("PIN_PATH")
+
+    report = {
+        "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "git-revision": get_git_revision(),
+        "cpu-count": os.cpu_count(),
+        "testcases": args.testcases,
+        "kernels": {},
+    }
+
+    for kernel_name in args.kernels:
+        report["kernels"][kernel_name] = run_kernel(kernel_name, KERNELS[kernel_name], args, microwalk_path)
+
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+    print(f"Report written to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,155 @@
+﻿using System.Buffers.Binary;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using Microwalk.FrameworkBase.Utilities;
+using Standart.Hash.xxHash;
+
+namespace Benchmarks;
+
+/// <summary>
+/// Hashes synthetic per-instruction memory access sequences like the memory access trace leakage analyses, once with the chained per-access
+/// hashing they used before and once with <see cref="AccessSequenceHash"/>, and reports the respective hashing rates and the number of distinct
+/// hashes found.
+/// </summary>
+public class AccessHashingBenchmark
+{
+    private readonly int _testcaseCount;
+    private readonly int _accessesPerTestcase;
+    private readonly int _instructionCount;
+
+    public AccessHashingBenchmark(int testcaseCount, int accessesPerTestcase, int instructionCount)
+    {
+        _testcaseCount = testcaseCount;
+        _accessesPerTestcase = accessesPerTestcase;
+        _instructionCount = instructionCount;
+    }
+
+    public void Run()
+    {
+        Console.WriteLine($"Generating workload: {_testcaseCount} testcases, {_accessesPerTestcase} accesses each, {_instructionCount} instructions");
+        var testcases = GenerateWorkload();
+        long accessCount = (long)_testcaseCount * _accessesPerTestcase;
+
+        Run("Chained xxHash64 per access", new ChainedHasher(), testcases, accessCount);
+        Run("AccessSequenceHash", new SequenceHasher(), testcases, accessCount);
+    }
+
+    private static void Run(string name, IAccessHasher hasher, Access[][] testcases, long accessCount)
+    {
+        Console.WriteLine(name);
+
+        // Warm up
+        hasher.HashTestcase(testcases[0]);
+
+        var distinctHashes = new HashSet<(ulong instructionId, UInt128 hash)>();
+        var hashingTime = TimeSpan.Zero;
+        var stopwatch = new Stopwatch();
+        foreach(var testcase in testcases)
+        {
+            stopwatch.Restart();
+            var hashes = hasher.HashTestcase(testcase);
+            stopwatch.Stop();
+            hashingTime += stopwatch.Elapsed;
+
+            foreach(var (instructionId, hash) in hashes)
+                distinctHashes.Add((instructionId, hash));
+        }
+
+        Console.WriteLine($"  Hashing: {hashingTime.TotalMilliseconds,10:F1} ms");
+        Console.WriteLine($"  Rate:    {accessCount / hashingTime.TotalSeconds / 1_000_000,10:F2} M accesses/s");
+        Console.WriteLine($"  Hashes:  {distinctHashes.Count,10} distinct (instruction, hash) pairs");
+    }
+
+    /// <summary>
+    /// Generates the memory accesses of several testcases.
+    /// Most instructions access fixed or linearly increasing addresses in every testcase; a few do secret-dependent table lookups, whose addresses
+    /// differ between testcases.
+    /// </summary>
+    private Access[][] GenerateWorkload()
+    {
+        var random = new Random(42);
+
+        // Per-instruction access patterns
+        var baseAddresses = new ulong[_instructionCount];
+        var strides = new ulong[_instructionCount];
+        var secretDependent = new bool[_instructionCount];
+        for(int i = 0; i < _instructionCount; ++i)
+        {
+            baseAddresses[i] = ((ulong)random.Next(1, 4) << 32) | (uint)random.Next(0, 1 << 20);
+            strides[i] = random.Next(2) == 0 ? 0u : 8u;
+            secretDependent[i] = random.Next(16) == 0;
+        }
+
+        var testcases = new Access[_testcaseCount][];
+        for(int t = 0; t < _testcaseCount; ++t)
+        {
+            var secret = new Random(t);
+            var accesses = new Access[_accessesPerTestcase];
+            var counters = new ulong[_instructionCount];
+
+            // Walk through the instructions in small loop bodies
+            int a = 0;
+            while(a < accesses.Length)
+            {
+                int loopStart = random.Next(_instructionCount);
+                int loopLength = Math.Min(random.Next(1, 8), _instructionCount - loopStart);
+                int iterations = random.Next(1, 64);
+                for(int i = 0; i < iterations && a < accesses.Length; ++i)
+                {
+                    for(int instruction = loopStart; instruction < loopStart + loopLength && a < accesses.Length; ++instruction)
+                    {
+                        ulong offset = secretDependent[instruction] ? (ulong)secret.Next(256) * 4 : counters[instruction]++ * strides[instruction];
+                        accesses[a++] = new Access((ulong)instruction + 0x1000, baseAddresses[instruction] + offset);
+                    }
+                }
+            }
+
+            testcases[t] = accesses;
+        }
+
+        return testcases;
+    }
+
+    private readonly record struct Access(ulong InstructionId, ulong MemoryAddressId);
+
+    private interface IAccessHasher
+    {
+        /// <summary>
+        /// Hashes the memory access sequence of each instruction of the given testcase.
+        /// </summary>
+        IEnumerable<KeyValuePair<ulong, UInt128>> HashTestcase(Access[] accesses);
+    }
+
+    /// <summary>
+    /// The hashing previously used by the analyses: newHash = xxHash64(oldHash || address).
+    /// </summary>
+    private class ChainedHasher : IAccessHasher
+    {
+        public IEnumerable<KeyValuePair<ulong, UInt128>> HashTestcase(Access[] accesses)
+        {
+            var instructionHashes = new Dictionary<ulong, UInt128>();
+            Span<byte> hashInput = stackalloc byte[16];
+            foreach(var access in accesses)
+            {
+                ref var hash = ref CollectionsMarshal.GetValueRefOrAddDefault(instructionHashes, access.InstructionId, out _);
+                BinaryPrimitives.WriteUInt64LittleEndian(hashInput, (ulong)hash);
+                BinaryPrimitives.WriteUInt64LittleEndian(hashInput[8..], access.MemoryAddressId);
+                hash = new UInt128(access.MemoryAddressId, xxHash64.ComputeHash(hashInput, 16));
+            }
+
+            return instructionHashes;
+        }
+    }
+
+    private class SequenceHasher : IAccessHasher
+    {
+        public IEnumerable<KeyValuePair<ulong, UInt128>> HashTestcase(Access[] accesses)
+        {
+            var instructionHashes = new Dictionary<ulong, AccessSequenceHash>();
+            foreach(var access in accesses)
+                CollectionsMarshal.GetValueRefOrAddDefault(instructionHashes, access.InstructionId, out _).Add(access.MemoryAddressId);
+
+            return instructionHashes.Select(h => new KeyValuePair<ulong, UInt128>(h.Key, new UInt128(h.Value.LastValue, h.Value.GetHash()))).ToList();
+        }
+    }
+}
\ No newline at end of file
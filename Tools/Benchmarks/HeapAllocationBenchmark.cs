@@ -0,0 +1,245 @@
+﻿using System.Diagnostics;
+using Microwalk.FrameworkBase.TraceFormat.TraceEntryTypes;
+using Microwalk.Plugins.PinTracer;
+
+namespace Benchmarks;
+
+/// <summary>
+/// Replays a synthetic allocation-heavy trace against the heap allocation lookup of the Pin trace preprocessor and against the sorted list it
+/// replaced, and reports the respective resolution rates.
+/// </summary>
+public class HeapAllocationBenchmark
+{
+    private const ulong _heapBaseAddress = 0x0000_7f00_0000_0000;
+
+    private readonly int _liveBlockCount;
+    private readonly int _churnStepCount;
+    private readonly int _accessesPerStep;
+
+    public HeapAllocationBenchmark(int liveBlockCount, int churnStepCount, int accessesPerStep)
+    {
+        _liveBlockCount = liveBlockCount;
+        _churnStepCount = churnStepCount;
+        _accessesPerStep = accessesPerStep;
+    }
+
+    public void Run()
+    {
+        CheckOverlappingAllocations();
+
+        Console.WriteLine($"Generating workload: {_liveBlockCount} live blocks, {_churnStepCount} churn steps, {_accessesPerStep} accesses per step");
+        var (initialAllocations, operations) = GenerateWorkload();
+        int accessCount = operations.Count(o => o.Type == OperationType.Access);
+        Console.WriteLine($"  {operations.Length} operations, {accessCount} memory accesses");
+
+        Run("SortedList + binary search", new SortedListLookup(), initialAllocations, operations, accessCount);
+        Run("HeapAllocationIndex", new IndexLookup(), initialAllocations, operations, accessCount);
+    }
+
+    private static void Run(string name, IAllocationLookup lookup, HeapAllocation[] initialAllocations, Operation[] operations, int accessCount)
+    {
+        Console.WriteLine(name);
+
+        var stopwatch = Stopwatch.StartNew();
+        foreach(var allocation in initialAllocations)
+            lookup.Add(allocation);
+        Console.WriteLine($"  Setup:  {stopwatch.Elapsed.TotalMilliseconds,10:F1} ms");
+
+        int hits = 0;
+        long checksum = 0;
+        stopwatch.Restart();
+        foreach(var operation in operations)
+        {
+            switch(operation.Type)
+            {
+                case OperationType.Allocation:
+                    lookup.Add(operation.Allocation!);
+                    break;
+
+                case OperationType.Free:
+                    lookup.Remove(operation.Address);
+                    break;
+
+                case OperationType.Access:
+                {
+                    var allocation = lookup.Find(operation.Address);
+                    if(allocation != null)
+                    {
+                        ++hits;
+                        checksum += allocation.Id;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        stopwatch.Stop();
+        Console.WriteLine($"  Replay: {stopwatch.Elapsed.TotalMilliseconds,10:F1} ms");
+        Console.WriteLine($"  Rate:   {accessCount / stopwatch.Elapsed.TotalSeconds / 1_000_000,10:F2} M resolutions/s (including allocation churn)");
+        Console.WriteLine($"  Hits:   {100.0 * hits / accessCount,10:F2} % ({hits} of {accessCount}, checksum {checksum})");
+    }
+
+    /// <summary>
+    /// Checks that the index returns the overlapping block with the highest start address, even if the lower block was resolved just before the
+    /// higher one was added (e.g., when a reallocated block is reported before the old one is freed).
+    /// </summary>
+    private static void CheckOverlappingAllocations()
+    {
+        var index = new HeapAllocationIndex();
+        var lowerAllocation = new HeapAllocation { Id = 0, Address = _heapBaseAddress, Size = 256 };
+        var higherAllocation = new HeapAllocation { Id = 1, Address = _heapBaseAddress + 64, Size = 256 };
+
+        index.Add(lowerAllocation);
+        if(index.Find(_heapBaseAddress + 128) != lowerAllocation)
+            throw new Exception("Overlap check failed: Could not resolve the lower block.");
+
+        index.Add(higherAllocation);
+        if(index.Find(_heapBaseAddress + 128) != higherAllocation)
+            throw new Exception("Overlap check failed: Lookup returned the lower block after the higher one was added.");
+
+        Console.WriteLine("Overlap check passed");
+    }
+
+    /// <summary>
+    /// Generates an initial heap state and a sequence of allocations, frees and memory accesses.
+    /// Freed addresses are often reused, and memory accesses mostly walk through a few recently used blocks, as in typical heap-heavy targets.
+    /// </summary>
+    private (HeapAllocation[] initialAllocations, Operation[] operations) GenerateWorkload()
+    {
+        var random = new Random(42);
+        int nextId = 0;
+        ulong nextAddress = _heapBaseAddress;
+
+        HeapAllocation Allocate(ulong? address, uint maxSize)
+        {
+            // Mostly small blocks, with an occasional huge one
+            uint size = random.Next(1000) == 0 ? (uint)random.Next(1 << 20, 1 << 24) : (uint)random.Next(16, 512);
+            size = Math.Min(size, maxSize);
+            var allocation = new HeapAllocation { Id = nextId++, Address = address ?? nextAddress, Size = size };
+            if(address == null)
+                nextAddress += (size + 31) & ~15u;
+            return allocation;
+        }
+
+        var liveAllocations = new List<HeapAllocation>(_liveBlockCount);
+        for(int i = 0; i < _liveBlockCount; ++i)
+            liveAllocations.Add(Allocate(null, uint.MaxValue));
+        var initialAllocations = liveAllocations.ToArray();
+
+        var operations = new List<Operation>(_churnStepCount * (_accessesPerStep + 2));
+        for(int step = 0; step < _churnStepCount; ++step)
+        {
+            // Free a random block
+            int freeIndex = random.Next(liveAllocations.Count);
+            var freedAllocation = liveAllocations[freeIndex];
+            liveAllocations[freeIndex] = liveAllocations[^1];
+            liveAllocations.RemoveAt(liveAllocations.Count - 1);
+            operations.Add(new Operation(OperationType.Free, freedAllocation.Address, null));
+
+            // Allocate a new block, either in place of the freed one or at the end of the heap
+            var newAllocation = random.Next(2) == 0 ? Allocate(freedAllocation.Address, freedAllocation.Size) : Allocate(null, uint.MaxValue);
+            liveAllocations.Add(newAllocation);
+            operations.Add(new Operation(OperationType.Allocation, newAllocation.Address, newAllocation));
+
+            // Access the new block and a few other blocks sequentially, and occasionally some random address
+            var accessedAllocation = newAllocation;
+            ulong offset = 0;
+            for(int i = 0; i < _accessesPerStep; ++i)
+            {
+                if(random.Next(16) == 0)
+                {
+                    operations.Add(new Operation(OperationType.Access, _heapBaseAddress + (ulong)random.NextInt64((long)(nextAddress - _heapBaseAddress)), null));
+                    continue;
+                }
+
+                if(offset > accessedAllocation.Size)
+                {
+                    accessedAllocation = liveAllocations[random.Next(liveAllocations.Count)];
+                    offset = 0;
+                }
+
+                operations.Add(new Operation(OperationType.Access, accessedAllocation.Address + offset, null));
+                offset += 8;
+            }
+        }
+
+        return (initialAllocations, operations.ToArray());
+    }
+
+    private enum OperationType
+    {
+        Allocation,
+        Free,
+        Access
+    }
+
+    private readonly record struct Operation(OperationType Type, ulong Address, HeapAllocation? Allocation);
+
+    private interface IAllocationLookup
+    {
+        void Add(HeapAllocation allocation);
+        void Remove(ulong address);
+        HeapAllocation? Find(ulong address);
+    }
+
+    private class IndexLookup : IAllocationLookup
+    {
+        private readonly HeapAllocationIndex _index = new();
+
+        public void Add(HeapAllocation allocation) => _index.Add(allocation);
+
+        public void Remove(ulong address)
+        {
+            if(_index.TryGetByAddress(address, out var allocation))
+                _index.Remove(allocation);
+        }
+
+        public HeapAllocation? Find(ulong address) => _index.Find(address);
+    }
+
+    /// <summary>
+    /// The lookup previously used by the preprocessor.
+    /// </summary>
+    private class SortedListLookup : IAllocationLookup
+    {
+        private readonly SortedList<ulong, HeapAllocation> _allocations = new();
+
+        public void Add(HeapAllocation allocation) => _allocations[allocation.Address] = allocation;
+
+        public void Remove(ulong address) => _allocations.Remove(address);
+
+        public HeapAllocation? Find(ulong address)
+        {
+            // Use binary search to find allocation block with start address <= address
+            var startAddresses = _allocations.Keys;
+            int left = 0;
+            int right = startAddresses.Count - 1;
+            int index = -1;
+            bool found = false;
+            while(left <= right)
+            {
+                index = left + ((right - left) / 2);
+                ulong startAddress = startAddresses[index];
+                if(startAddress == address)
+                {
+                    found = true;
+                    break;
+                }
+                else if(startAddress < address)
+                    left = index + 1;
+                else
+                    right = index - 1;
+            }
+
+            if(!found)
+                index = left - 1;
+            if(index < 0)
+                return null;
+
+            // Check end address
+            var block = _allocations.Values[index];
+            return address <= block.Address + block.Size ? block : null;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+﻿using Benchmarks;
+
+if(args.Length < 1)
+{
+    Console.WriteLine("Please specify the benchmark to run, followed by its parameters:");
+    Console.WriteLine("  heap-allocations [<live blocks>] [<churn steps>] [<accesses per step>]");
+    Console.WriteLine("  - Compares the resolution of heap memory accesses to allocation blocks in the Pin trace preprocessor");
+    Console.WriteLine("  access-hashing [<testcases>] [<accesses per testcase>] [<instructions>]");
+    Console.WriteLine("  - Compares the hashing of per-instruction memory access sequences in the memory access trace leakage analyses");
+    return;
+}
+
+switch(args[0])
+{
+    case "heap-allocations":
+    {
+        int liveBlockCount = args.Length > 1 ? int.Parse(args[1]) : 100_000;
+        int churnStepCount = args.Length > 2 ? int.Parse(args[2]) : 20_000;
+        int accessesPerStep = args.Length > 3 ? int.Parse(args[3]) : 64;
+        new HeapAllocationBenchmark(liveBlockCount, churnStepCount, accessesPerStep).Run();
+        break;
+    }
+
+    case "access-hashing":
+    {
+        int testcaseCount = args.Length > 1 ? int.Parse(args[1]) : 16;
+        int accessesPerTestcase = args.Length > 2 ? int.Parse(args[2]) : 4_000_000;
+        int instructionCount = args.Length > 3 ? int.Parse(args[3]) : 2_000;
+        new AccessHashingBenchmark(testcaseCount, accessesPerTestcase, instructionCount).Run();
+        break;
+    }
+
+    default:
+    {
+        Console.WriteLine($"Unknown benchmark: {args[0]}");
+        break;
+    }
+}
@@ -37,6 +37,23 @@ do
   mkdir -p $WORK_DIR/$targetName/work
   mkdir -p $WORK_DIR/$targetName/persist
   
+  # Optional native timing pre-screen (TIMING_SCREEN=report|gate), see TimingScreen() in main.c
+  if [ -n "$TIMING_SCREEN" ]; then
+    mkdir -p $WORK_DIR/$targetName/persist/results
+    fixedTestcase=$(find $TESTCASE_DIRECTORY -type f | sort | head -n 1)
+    screenResult=0
+    $thisDir/$targetName --timing-screen $fixedTestcase $WORK_DIR/$targetName/persist/results/timing-screen.txt $TIMING_SCREEN_MEASUREMENTS || screenResult=$?
+    if [ $screenResult -eq 1 ]; then
+      echo "Timing screen for target ${targetName} failed"
+      exit 1
+    fi
+    cp $WORK_DIR/$targetName/persist/results/timing-screen.txt $resultsDir/timing-screen-$targetName.txt
+    if [ "$TIMING_SCREEN" == "gate" ] && [ $screenResult -eq 0 ]; then
+      echo "Timing screen found no evidence of leakage, skipping full analysis of target ${targetName}"
+      continue
+    fi
+  fi
+  
   cd $MICROWALK_PATH
   dotnet Microwalk.dll $thisDir/config.yml
   
@@ -52,5 +69,10 @@ do
   echo "Running target ${targetName} successful, generated report ${reportFile}"
 done
 
+if [ -z "$reports" ]; then
+  echo "No reports generated, all targets were skipped by the timing screen"
+  exit 0
+fi
+
 echo "Merging report files..."
 cat $reports | jq -s '.[0].runs[0].results=([.[].runs[0].results]|flatten)|.[0]' > $resultsDir/report.sarif
\ No newline at end of file
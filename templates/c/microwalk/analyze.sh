@@ -20,6 +20,23 @@ do
   mkdir -p $WORK_DIR/work/$targetName
   mkdir -p $WORK_DIR/persist/$targetName
   
+  # Optional native timing pre-screen (TIMING_SCREEN=report|gate), see TimingScreen() in main.c
+  if [ -n "$TIMING_SCREEN" ]; then
+    mkdir -p $WORK_DIR/persist/$targetName/results
+    fixedTestcase=$(find $TESTCASE_DIRECTORY -type f | sort | head -n 1)
+    screenResult=0
+    $thisDir/$targetName --timing-screen $fixedTestcase $WORK_DIR/persist/$targetName/results/timing-screen.txt $TIMING_SCREEN_MEASUREMENTS || screenResult=$?
+    if [ $screenResult -eq 1 ]; then
+      echo "Timing screen for target ${targetName} failed"
+      exit 1
+    fi
+    cp $WORK_DIR/persist/$targetName/results/timing-screen.txt $resultsDir/timing-screen-$targetName.txt
+    if [ "$TIMING_SCREEN" == "gate" ] && [ $screenResult -eq 0 ]; then
+      echo "Timing screen found no evidence of leakage, skipping full analysis of target ${targetName}"
+      continue
+    fi
+  fi
+  
   cd $MICROWALK_PATH
   dotnet Microwalk.dll $thisDir/config.yml
 done
@@ -15,13 +15,22 @@ pushd $MAP_GENERATOR_PATH
 dotnet MapFileGenerator.dll $mainDir/libexample.so $thisDir/libexample.map
 popd
 
+# Compiler flags for tracing with the compiler-instrumentation tracer instead of Pin (optional, GCC only)
+# Set COMPILER_TRACER_PATH to the CompilerTracer directory to enable. The library should be compiled with the
+# instrumentation flags as well, if its memory accesses and control flow are of interest.
+instrumentationFlags=""
+if [ -n "$COMPILER_TRACER_PATH" ]; then
+  make -C "$COMPILER_TRACER_PATH"
+  instrumentationFlags="-DMICROWALK_COMPILER_TRACER -finstrument-functions -fsanitize-coverage=trace-pc -fsanitize=kernel-address --param asan-instrumentation-with-call-threshold=0 --param asan-stack=0 --param asan-globals=0 -L $COMPILER_TRACER_PATH -lCompilerTracer -Wl,-rpath,$COMPILER_TRACER_PATH"
+fi
+
 # Build targets
 for target in $(find . -name "target-*.c" -print)
 do
   targetName=$(basename -- ${target%.*})
   
   # TODO Adjust command line to link against your library
-  gcc main.c $targetName.c -g -fno-inline -fno-split-stack -L "$mainDir" -lexample -I "$mainDir/src" -o $targetName
+  gcc main.c $targetName.c -g -fno-inline -fno-split-stack -L "$mainDir" -lexample -lm -I "$mainDir/src" $instrumentationFlags -o $targetName
   
   pushd $MAP_GENERATOR_PATH
   dotnet MapFileGenerator.dll $thisDir/$targetName $thisDir/$targetName.map
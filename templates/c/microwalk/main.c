@@ -3,11 +3,22 @@
 #endif
 
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
 
 
 // Performs target initialization steps.
@@ -23,12 +34,24 @@ extern void RunTarget(FILE* input);
 // Pin notification functions.
 // These functions (and their names) must not be optimized away by the compiler, so Pin can find and instrument them.
 // The return values reduce the probability that the compiler uses these function in other places as no-ops (Visual C++ did do this in some experiments).
+// When building for the compiler-instrumentation tracer (see CompilerTracer/), these functions are provided by the tracer runtime instead.
+#ifdef MICROWALK_COMPILER_TRACER
+int PinNotifyTestcaseStart(int t);
+int PinNotifyTestcaseEnd();
+int PinNotifyStackPointer(uint64_t spMin, uint64_t spMax);
+int PinNotifyAllocation(uint64_t address, uint64_t size);
+#else
 #pragma optimize("", off)
 int PinNotifyTestcaseStart(int t) { return t + 42; }
 int PinNotifyTestcaseEnd() { return 42; }
 int PinNotifyStackPointer(uint64_t spMin, uint64_t spMax) { return (int)(spMin + spMax + 42); }
 int PinNotifyAllocation(uint64_t address, uint64_t size) { return (int)(address + 23 * size); }
 #pragma optimize("", on)
+#endif
+
+// Shared memory arena, where the trace generator may place testcases (see ReadCommand()).
+static uint8_t* testcaseArena = NULL;
+static uint64_t testcaseArenaSize = 0;
 
 // Reads the stack pointer base value and transmits it to Pin.
 void ReadAndSendStackPointer()
@@ -54,10 +77,204 @@ void ReadAndSendStackPointer()
     PinNotifyStackPointer(stackMin, stackMax);
 }
 
+// Decodes a little endian integer with the given number of bytes.
+static uint64_t DecodeLittleEndian(const uint8_t* bytes, int count)
+{
+    uint64_t value = 0;
+    for(int i = count - 1; i >= 0; --i)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+// Maps the testcase arena file which is passed by the trace generator, if any.
+static void MapTestcaseArena()
+{
+    const char* arenaPath = getenv("MICROWALK_TESTCASE_ARENA");
+    if(!arenaPath)
+        return;
+
+    int arenaFile = open(arenaPath, O_RDONLY);
+    struct stat arenaFileInfo;
+    if(arenaFile < 0 || fstat(arenaFile, &arenaFileInfo) != 0)
+    {
+        fprintf(stderr, "Error opening testcase arena '%s': [%d] %s\n", arenaPath, errno, strerror(errno));
+        exit(1);
+    }
+
+    void* arena = mmap(NULL, arenaFileInfo.st_size, PROT_READ, MAP_SHARED, arenaFile, 0);
+    close(arenaFile);
+    if(arena == MAP_FAILED)
+    {
+        fprintf(stderr, "Error mapping testcase arena '%s': [%d] %s\n", arenaPath, errno, strerror(errno));
+        exit(1);
+    }
+
+    testcaseArena = (uint8_t*)arena;
+    testcaseArenaSize = arenaFileInfo.st_size;
+}
+
+// Generates a deterministic pseudo-random testcase with the given seed and index.
+// The i-th 8-byte block is the SplitMix64 output function applied to seed + index * 0xD1B54A32D192ED03 + (i + 1) * 0x9E3779B97F4A7C15, in little endian byte order.
+// This must match the implementation in Microwalk's DeterministicTestcase class.
+static void GenerateTestcase(uint64_t seed, uint64_t index, uint8_t* output, uint32_t length)
+{
+    uint64_t counterBase = seed + index * 0xD1B54A32D192ED03ull;
+    for(uint32_t i = 0; i < length; i += 8)
+    {
+        uint64_t z = counterBase + (uint64_t)(i / 8 + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z = z ^ (z >> 31);
+
+        for(uint32_t j = 0; j < 8 && i + j < length; ++j)
+            output[i + j] = (uint8_t)(z >> (8 * j));
+    }
+}
+
+// A command received from the trace generator, see ReadCommand().
+typedef struct
+{
+    // 't' (testcase file), 'm' (testcase in shared memory arena), 'r' (generated testcases), or 0 (invalid command).
+    char type;
+
+    // The ID of the (first) testcase.
+    int testcaseId;
+
+    // The number of testcases.
+    int testcaseCount;
+
+    // The testcase file path ('t').
+    char path[512];
+
+    // The testcase offset in the shared memory arena ('m').
+    uint64_t arenaOffset;
+
+    // The testcase length ('m', 'r').
+    uint32_t length;
+
+    // Seed and index of the first generated testcase ('r').
+    uint64_t seed;
+    uint64_t index;
+} Command;
+
+// Reads the next command from stdin. Two encodings are supported, which can be distinguished by their first byte:
+//     Text: A line with "t" followed by a numeric ID, and another line with a file path determining a new testcase; or a line with "e 0".
+//     Binary: A command byte, followed by a 32-bit little endian payload length and the payload. All integers are little endian.
+//         'T': Testcase file. The payload consists of the 32-bit testcase ID and the file path (without null terminator).
+//         'M': Testcase in shared memory arena. The payload consists of the 32-bit testcase ID, the 64-bit arena offset and the 32-bit length.
+//         'R': Range of generated testcases (see GenerateTestcase()). The payload consists of the 32-bit ID of the first testcase, the 32-bit testcase count,
+//              the 64-bit seed, the 64-bit index of the first testcase, and the 32-bit testcase length. IDs and indices are consecutive.
+//         'E': Exit, no payload.
+// Returns 0 if the program should exit (exit command, or stdin was closed).
+static int ReadCommand(Command* command)
+{
+    command->type = 0;
+    int firstByte = fgetc(stdin);
+    if(firstByte == EOF)
+        return 0;
+
+    if(firstByte == 'T' || firstByte == 'M' || firstByte == 'R' || firstByte == 'E')
+    {
+        // Binary command
+        uint8_t payload[4 + 4 + 8 + 8 + 4];
+        if(fread(payload, 1, 4, stdin) != 4)
+            return 0;
+        uint32_t payloadLength = (uint32_t)DecodeLittleEndian(payload, 4);
+
+        if(firstByte == 'E')
+            return 0;
+
+        // Testcase ID
+        if(payloadLength < 4 || fread(payload, 1, 4, stdin) != 4)
+            return 0;
+        command->testcaseId = (int)DecodeLittleEndian(payload, 4);
+        command->testcaseCount = 1;
+
+        if(firstByte == 'M')
+        {
+            if(payloadLength != 4 + 8 + 4 || fread(payload + 4, 1, 8 + 4, stdin) != 8 + 4)
+                return 0;
+            command->type = 'm';
+            command->arenaOffset = DecodeLittleEndian(payload + 4, 8);
+            command->length = (uint32_t)DecodeLittleEndian(payload + 12, 4);
+            return 1;
+        }
+
+        if(firstByte == 'R')
+        {
+            if(payloadLength != sizeof(payload) || fread(payload + 4, 1, sizeof(payload) - 4, stdin) != sizeof(payload) - 4)
+                return 0;
+            command->type = 'r';
+            command->testcaseCount = (int)DecodeLittleEndian(payload + 4, 4);
+            command->seed = DecodeLittleEndian(payload + 8, 8);
+            command->index = DecodeLittleEndian(payload + 16, 8);
+            command->length = (uint32_t)DecodeLittleEndian(payload + 24, 4);
+            return 1;
+        }
+
+        uint32_t pathLength = payloadLength - 4;
+        if(pathLength >= sizeof(command->path) || fread(command->path, 1, pathLength, stdin) != pathLength)
+        {
+            fprintf(stderr, "Invalid testcase command (payload length %u)\n", payloadLength);
+            return 0;
+        }
+        command->path[pathLength] = '\0';
+        command->type = 't';
+        return 1;
+    }
+
+    // Text command
+    ungetc(firstByte, stdin);
+    char inputBuffer[64];
+    char commandChar = 0;
+    if(!fgets(inputBuffer, sizeof(inputBuffer), stdin))
+        return 0;
+    sscanf(inputBuffer, "%c %d", &commandChar, &command->testcaseId);
+    if(commandChar == 'e')
+        return 0;
+    if(commandChar != 't')
+        return 1;
+
+    // Read testcase file name
+    if(!fgets(command->path, sizeof(command->path), stdin))
+        return 0;
+    int pathLength = strlen(command->path);
+    while(pathLength > 0 && (command->path[pathLength - 1] == '\n' || command->path[pathLength - 1] == '\r'))
+        command->path[--pathLength] = '\0';
+    command->type = 't';
+    command->testcaseCount = 1;
+    return 1;
+}
+
+// Reports to the trace generator that the given testcase could not be run, so it does not wait for its trace.
+// The record has the same layout as the trace completion records of the tracer ("t", trace file path, testcase ID), but starts with "f" and
+// contains an error message instead of the trace file path.
+static void ReportTestcaseFailure(int testcaseId, const char* message)
+{
+    fprintf(stdout, "f\t%s\t%d\n", message, testcaseId);
+    fflush(stdout);
+}
+
+// Runs the target function for the given testcase.
+static void RunTestcase(int testcaseId, FILE* inputFile, int* targetInitialized)
+{
+    // If the target was not yet initialized, call the init function for the first test case
+    if(!*targetInitialized)
+    {
+        InitTarget(inputFile);
+        fseek(inputFile, 0, SEEK_SET);
+        *targetInitialized = 1;
+    }
+
+    PinNotifyTestcaseStart(testcaseId);
+    RunTarget(inputFile);
+    PinNotifyTestcaseEnd();
+}
+
 // Main trace target function. The following actions are performed:
-//     The current action is read from stdin.
-//     A line with "t" followed by a numeric ID, and another line with a file path determining a new testcase, that is subsequently loaded and fed into the target function, while calling PinNotifyNextFile() beforehand.
-//     A line with "e 0" terminates the program.
+//     The current action is read from stdin, see ReadCommand().
+//     For each testcase, the testcase data is loaded and fed into the target function, while calling PinNotifyTestcaseStart() beforehand.
+//     An exit command terminates the program.
 void TraceFunc()
 {
     // First transmit stack pointer information
@@ -65,58 +282,325 @@ void TraceFunc()
 	
 	PinNotifyAllocation((uint64_t)&errno, 8);
 
+    // Shared memory testcase delivery
+    MapTestcaseArena();
+
+    // Buffer for generated testcases
+    uint8_t* generatedTestcase = NULL;
+    uint32_t generatedTestcaseCapacity = 0;
+
     // Run until exit is requested
-    char inputBuffer[512];
+    Command command;
     char errBuffer[128];
 	int targetInitialized = 0;
-    while(1)
-    {
-        // Read command and testcase ID (0 for exit command)
-        char command;
-        int testcaseId;
-        fgets(inputBuffer, sizeof(inputBuffer), stdin);
-        sscanf(inputBuffer, "%c %d", &command, &testcaseId);
-
-        // Exit or process given testcase
-        if(command == 'e')
-            break;
-        if(command == 't')
+    while(ReadCommand(&command))
+    {
+        if(command.type == 'm')
+        {
+            // Testcase is in the shared memory arena
+            if(!testcaseArena || command.arenaOffset > testcaseArenaSize || command.length > testcaseArenaSize - command.arenaOffset)
+            {
+                fprintf(stderr, "Invalid testcase arena location %llu+%u\n", (unsigned long long)command.arenaOffset, command.length);
+                ReportTestcaseFailure(command.testcaseId, "Invalid testcase arena location");
+                continue;
+            }
+            FILE* inputFile = fmemopen(testcaseArena + command.arenaOffset, command.length, "rb");
+            if(!inputFile)
+            {
+                strerror_r(errno, errBuffer, sizeof(errBuffer));
+                fprintf(stderr, "Error opening in-memory testcase #%d: [%d] %s\n", command.testcaseId, errno, errBuffer);
+                ReportTestcaseFailure(command.testcaseId, "Could not open in-memory testcase");
+                continue;
+            }
+            RunTestcase(command.testcaseId, inputFile, &targetInitialized);
+            fclose(inputFile);
+        }
+        else if(command.type == 'r')
+        {
+            // Generate testcases (outside of the PinNotifyTestcaseStart/End calls, so this is not included in the traces)
+            if(command.length > generatedTestcaseCapacity)
+            {
+                free(generatedTestcase);
+                generatedTestcase = (uint8_t*)malloc(command.length);
+                generatedTestcaseCapacity = command.length;
+            }
+            for(int i = 0; i < command.testcaseCount; ++i)
+            {
+                GenerateTestcase(command.seed, command.index + i, generatedTestcase, command.length);
+                FILE* inputFile = fmemopen(generatedTestcase, command.length, "rb");
+                if(!inputFile)
+                {
+                    strerror_r(errno, errBuffer, sizeof(errBuffer));
+                    fprintf(stderr, "Error opening in-memory testcase #%d: [%d] %s\n", command.testcaseId + i, errno, errBuffer);
+                    ReportTestcaseFailure(command.testcaseId + i, "Could not open in-memory testcase");
+                    continue;
+                }
+                RunTestcase(command.testcaseId + i, inputFile, &targetInitialized);
+                fclose(inputFile);
+            }
+        }
+        else if(command.type == 't')
         {
-            // Read testcase file name
-            fgets(inputBuffer, sizeof(inputBuffer), stdin);
-            int inputFileNameLength = strlen(inputBuffer);
-            if(inputFileNameLength > 0 && inputBuffer[inputFileNameLength - 1] == '\n')
-                inputBuffer[inputFileNameLength - 1] = '\0';
-
             // Load testcase file and run target function
-            FILE* inputFile = fopen(inputBuffer, "rb");
+            FILE* inputFile = fopen(command.path, "rb");
             if(!inputFile)
             {
                 strerror_r(errno, errBuffer, sizeof(errBuffer));
-                fprintf(stderr, "Error opening input file '%s': [%d] %s\n", inputBuffer, errno, errBuffer);
+                fprintf(stderr, "Error opening input file '%s': [%d] %s\n", command.path, errno, errBuffer);
+                ReportTestcaseFailure(command.testcaseId, "Could not open input file");
                 continue;
             }
-			
-			// If the target was not yet initialized, call the init function for the first test case
-			if(!targetInitialized)
-			{
-				InitTarget(inputFile);
-				fseek(inputFile, 0, SEEK_SET);
-				targetInitialized = 1;
-			}
-            
-            PinNotifyTestcaseStart(testcaseId);
-            RunTarget(inputFile);
-            PinNotifyTestcaseEnd();
-            
+            RunTestcase(command.testcaseId, inputFile, &targetInitialized);
             fclose(inputFile);
         }
     }
+
+    free(generatedTestcase);
+}
+
+// Number of initial measurements which are discarded, and used for determining the cropping thresholds of the timing screen.
+#define TIMING_SCREEN_WARMUP_COUNT 1000
+
+// Number of percentile-cropped t-tests in the timing screen, in addition to the uncropped one.
+#define TIMING_SCREEN_CROP_COUNT 16
+
+// Online Welch's t-test for two classes of measurements.
+typedef struct
+{
+    double count[2];
+    double mean[2];
+    double m2[2];
+} WelchTTest;
+
+// Adds a measurement of the given class (0 or 1) to the t-test, using Welford's online algorithm.
+static void WelchTTestPush(WelchTTest* test, int inputClass, double value)
+{
+    test->count[inputClass] += 1;
+    double delta = value - test->mean[inputClass];
+    test->mean[inputClass] += delta / test->count[inputClass];
+    test->m2[inputClass] += delta * (value - test->mean[inputClass]);
+}
+
+// Computes the t statistic of the given t-test, or 0 if there are not enough measurements.
+static double WelchTTestCompute(const WelchTTest* test)
+{
+    if(test->count[0] < 2 || test->count[1] < 2)
+        return 0;
+
+    double variance0 = test->m2[0] / (test->count[0] - 1);
+    double variance1 = test->m2[1] / (test->count[1] - 1);
+    double denominator = sqrt(variance0 / test->count[0] + variance1 / test->count[1]);
+    if(denominator == 0)
+        return 0;
+    return (test->mean[0] - test->mean[1]) / denominator;
+}
+
+// Returns the current timestamp in cycles (x86) or nanoseconds.
+static inline uint64_t ReadTimestamp()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int auxiliary;
+    return __rdtscp(&auxiliary);
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ull + (uint64_t)time.tv_nsec;
+#endif
+}
+
+// Comparison function for sorting measurements.
+static int CompareMeasurements(const void* a, const void* b)
+{
+    uint64_t valueA = *(const uint64_t*)a;
+    uint64_t valueB = *(const uint64_t*)b;
+    return (valueA > valueB) - (valueA < valueB);
+}
+
+// Runs the target on the given input, and returns the elapsed time.
+static uint64_t MeasureTarget(uint8_t* input, uint32_t length)
+{
+    FILE* inputFile = fmemopen(input, length, "rb");
+    if(!inputFile)
+    {
+        fprintf(stderr, "Error opening in-memory testcase: [%d] %s\n", errno, strerror(errno));
+        exit(1);
+    }
+
+    uint64_t start = ReadTimestamp();
+    RunTarget(inputFile);
+    uint64_t end = ReadTimestamp();
+
+    fclose(inputFile);
+    return end - start;
+}
+
+// Native constant-time pre-screen, which does not need Pin (similar to dudect).
+// The target is run alternately on a fixed input (the given testcase file) and on random inputs of the same length, in random order,
+// and the execution times of both classes are compared with Welch's t-test. To reduce the influence of outliers, the test is also
+// done on measurements below several percentile thresholds.
+// A large |t| value indicates that the execution time depends on the input, i.e., that the target needs a full analysis.
+// Command line: --timing-screen <fixed testcase file> <report file> [measurement count] [seed]
+// Returns 0 if no timing differences were found, 2 if there is evidence for timing leakage, and 1 on errors.
+static int TimingScreen(int argc, const char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage: --timing-screen <fixed testcase file> <report file> [measurement count] [seed]\n");
+        return 1;
+    }
+    const char* fixedInputPath = argv[0];
+    const char* reportPath = argv[1];
+    long measurementCount = argc >= 3 ? strtol(argv[2], NULL, 10) : 100000;
+    uint64_t seed = argc >= 4 ? strtoull(argv[3], NULL, 16) : 0x4d6963726f77616bull;
+    if(measurementCount <= 0)
+    {
+        fprintf(stderr, "Invalid measurement count\n");
+        return 1;
+    }
+
+    // Load fixed input
+    FILE* fixedInputFile = fopen(fixedInputPath, "rb");
+    if(!fixedInputFile)
+    {
+        fprintf(stderr, "Error opening input file '%s': [%d] %s\n", fixedInputPath, errno, strerror(errno));
+        return 1;
+    }
+    fseek(fixedInputFile, 0, SEEK_END);
+    long inputLength = ftell(fixedInputFile);
+    fseek(fixedInputFile, 0, SEEK_SET);
+    uint8_t* fixedInput = (uint8_t*)malloc(inputLength > 0 ? inputLength : 1);
+    uint8_t* randomInput = (uint8_t*)malloc(inputLength > 0 ? inputLength : 1);
+    if(fread(fixedInput, 1, inputLength, fixedInputFile) != (size_t)inputLength)
+    {
+        fprintf(stderr, "Error reading input file '%s'\n", fixedInputPath);
+        return 1;
+    }
+
+    // The target may read its initialization data from the input file as well
+    fseek(fixedInputFile, 0, SEEK_SET);
+    InitTarget(fixedInputFile);
+    fclose(fixedInputFile);
+
+    // Run measurements
+    uint64_t* warmupMeasurements = (uint64_t*)malloc(TIMING_SCREEN_WARMUP_COUNT * sizeof(uint64_t));
+    uint64_t cropThresholds[TIMING_SCREEN_CROP_COUNT];
+    WelchTTest tests[1 + TIMING_SCREEN_CROP_COUNT];
+    memset(tests, 0, sizeof(tests));
+    uint8_t classes[8];
+    for(long i = 0; i < TIMING_SCREEN_WARMUP_COUNT + measurementCount; ++i)
+    {
+        // Pick class and prepare input outside of the measurement
+        if(i % 64 == 0)
+            GenerateTestcase(~seed, (uint64_t)i / 64, classes, sizeof(classes));
+        int inputClass = (classes[(i % 64) / 8] >> (i % 8)) & 1;
+        uint8_t* input = fixedInput;
+        if(inputClass == 1)
+        {
+            GenerateTestcase(seed, (uint64_t)i, randomInput, (uint32_t)inputLength);
+            input = randomInput;
+        }
+
+        uint64_t measurement = MeasureTarget(input, (uint32_t)inputLength);
+
+        if(i < TIMING_SCREEN_WARMUP_COUNT)
+        {
+            warmupMeasurements[i] = measurement;
+            if(i == TIMING_SCREEN_WARMUP_COUNT - 1)
+            {
+                // Cropping thresholds at percentiles 1 - 0.5^(10 * (j + 1) / cropCount), like dudect
+                qsort(warmupMeasurements, TIMING_SCREEN_WARMUP_COUNT, sizeof(uint64_t), CompareMeasurements);
+                for(int j = 0; j < TIMING_SCREEN_CROP_COUNT; ++j)
+                {
+                    double percentile = 1 - pow(0.5, 10.0 * (j + 1) / TIMING_SCREEN_CROP_COUNT);
+                    cropThresholds[j] = warmupMeasurements[(int)(percentile * (TIMING_SCREEN_WARMUP_COUNT - 1))];
+                }
+            }
+            continue;
+        }
+
+        WelchTTestPush(&tests[0], inputClass, (double)measurement);
+        for(int j = 0; j < TIMING_SCREEN_CROP_COUNT; ++j)
+        {
+            if(measurement < cropThresholds[j])
+                WelchTTestPush(&tests[1 + j], inputClass, (double)measurement);
+        }
+    }
+
+    // Find strongest evidence for timing differences
+    double maxT = 0;
+    for(int j = 0; j < 1 + TIMING_SCREEN_CROP_COUNT; ++j)
+    {
+        double t = fabs(WelchTTestCompute(&tests[j]));
+        if(t > maxT)
+            maxT = t;
+    }
+
+    // Thresholds as used by dudect
+    const char* verdict = "No evidence of timing leakage";
+    int result = 0;
+    if(maxT > 10)
+    {
+        verdict = "Definitely not constant time";
+        result = 2;
+    }
+    else if(maxT > 4.5)
+    {
+        verdict = "Probably not constant time";
+        result = 2;
+    }
+
+    // Write report
+    FILE* reportFile = fopen(reportPath, "w");
+    if(!reportFile)
+    {
+        fprintf(stderr, "Error opening report file '%s': [%d] %s\n", reportPath, errno, strerror(errno));
+        return 1;
+    }
+    fprintf(reportFile, "Timing screen (fixed vs. random inputs, Welch's t-test)\n");
+    fprintf(reportFile, "  Fixed input: %s (%ld bytes)\n", fixedInputPath, inputLength);
+    fprintf(reportFile, "  Measurements: %.0f fixed, %.0f random\n", tests[0].count[0], tests[0].count[1]);
+#if defined(__x86_64__) || defined(__i386__)
+    fprintf(reportFile, "  Timer: rdtscp (cycles)\n");
+#else
+    fprintf(reportFile, "  Timer: clock_gettime (ns)\n");
+#endif
+    fprintf(reportFile, "\n%-10s %12s %12s %14s %14s %10s\n", "Test", "Threshold", "Samples", "Mean fixed", "Mean random", "t");
+    for(int j = 0; j < 1 + TIMING_SCREEN_CROP_COUNT; ++j)
+    {
+        char testName[16];
+        char threshold[24];
+        if(j == 0)
+        {
+            snprintf(testName, sizeof(testName), "all");
+            snprintf(threshold, sizeof(threshold), "-");
+        }
+        else
+        {
+            snprintf(testName, sizeof(testName), "crop-%d", j);
+            snprintf(threshold, sizeof(threshold), "%llu", (unsigned long long)cropThresholds[j - 1]);
+        }
+        fprintf(reportFile, "%-10s %12s %12.0f %14.1f %14.1f %10.2f\n", testName, threshold,
+                tests[j].count[0] + tests[j].count[1], tests[j].mean[0], tests[j].mean[1], WelchTTestCompute(&tests[j]));
+    }
+    fprintf(reportFile, "\nMaximum |t|: %.2f\n", maxT);
+    fprintf(reportFile, "Result: %s\n", verdict);
+    fclose(reportFile);
+
+    fprintf(stderr, "Timing screen: max |t| = %.2f, %s\n", maxT, verdict);
+
+    free(warmupMeasurements);
+    free(fixedInput);
+    free(randomInput);
+    return result;
 }
 
 // Wrapper entry point.
+// Usually the wrapper runs in trace mode, see TraceFunc(). Passing --timing-screen runs the native timing pre-screen instead, see TimingScreen().
 int main(int argc, const char** argv)
 {
+    if(argc >= 2 && strcmp(argv[1], "--timing-screen") == 0)
+        return TimingScreen(argc - 2, argv + 2);
+
     // Run target function
     TraceFunc();
     return 0;